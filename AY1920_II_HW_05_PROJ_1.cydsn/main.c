@@ -5,78 +5,69 @@
 * to understand the I2C protocol and communicate with a
 * a I2C Slave device (LIS3DH Accelerometer).
 *
+* Between two temperature readings the device sleeps
+* (see LowPower.h): the Sleep mode once the UART is
+* done with the last frame, Alternate Active before.
+*
+* With FAST_BOOT the sensor is polled out of its boot
+* and configured first; the bus scan, the register
+* banners and the times of the boot phases (see
+* Boot.h) follow the first reading.
+*
 * \author Gabriele Belotti
 * \date , 2020
 */
 
 // Include required header files
+#include "Boot.h"
 #include "I2C_Interface.h"
+#include "LIS3DH.h"
+#include "LowPower.h"
+#include "Timestamp.h"
 #include "project.h"
 #include "stdio.h"
 
 /**
-*   \brief 7-bit I2C address of the slave device.
-*/
-#define LIS3DH_DEVICE_ADDRESS 0x18
-
-/**
-*   \brief Address of the WHO AM I register
-*/
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
-
-/**
-*   \brief Address of the Status register
-*/
-#define LIS3DH_STATUS_REG 0x27
-
-/**
-*   \brief Address of the Control register 1
+*   \brief Sensor configuration.
+*
+*   Normal mode at 50 Hz (CTRL_REG1 0x47), block data update (CTRL_REG4 0x80),
+*   auxiliary ADC and temperature sensor enabled (TEMP_CFG_REG 0xC0).
 */
-#define LIS3DH_CTRL_REG1 0x20
+static const LIS3DH_Config lis3dh_config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = LIS3DH_ODR_50_HZ,
+    .mode = LIS3DH_MODE_NORMAL,
+    .full_scale = LIS3DH_FULL_SCALE_2G,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+    .adc = 1,
+    .temperature = 1,
+};
 
 /**
-*   \brief Hex value to set normal mode to the accelerator
+*   \brief Register of interest in a TEMP_CFG_REG..CTRL_REG6 block.
 */
-#define LIS3DH_NORMAL_MODE_CTRL_REG1 0x47
+#define CONFIG_REG(registers, address) ((registers)[(address) - LIS3DH_CONFIG_FIRST_REG])
 
 /**
-*   \brief  Address of the Temperature Sensor Configuration register
+*   \brief Period of the temperature readings [us].
 */
-#define LIS3DH_TEMP_CFG_REG 0x1F
-
-#define LIS3DH_TEMP_CFG_REG_ACTIVE 0xC0
+#define TEMPERATURE_PERIOD_US 100000u
 
 /**
-*   \brief Address of the Control register 4
+*   \brief 1 to start the readings first and print the diagnostics after
+*          the first one, 0 for the diagnostics of every register before.
 */
-#define LIS3DH_CTRL_REG4 0x23
+#ifndef FAST_BOOT
+    #define FAST_BOOT 1
+#endif
 
-#define LIS3DH_CTRL_REG4_BDU_ACTIVE 0x80
+// String to print out messages on the UART
+static char message[64];
 
-/**
-*   \brief Address of the ADC output LSB register
-*/
-#define LIS3DH_OUT_ADC_3L 0x0C
-
-/**
-*   \brief Address of the ADC output MSB register
-*/
-#define LIS3DH_OUT_ADC_3H 0x0D
-
-int main(void)
+// Print the devices present on the I2C bus
+static void ScanBus(void)
 {
-    CyGlobalIntEnable; /* Enable global interrupts. */
-
-    /* Place your initialization/startup code here (e.g. MyInst_Start()) */
-    I2C_Peripheral_Start();
-    UART_Debug_Start();
-    
-    CyDelay(5); //"The boot procedure is complete about 5 milliseconds after device power-up."
-    
-    // String to print out messages on the UART
-    char message[50];
-
-    // Check which devices are present on the I2C bus
     for (int i = 0 ; i < 128; i++)
     {
         if (I2C_Peripheral_IsDeviceConnected(i))
@@ -85,13 +76,12 @@ int main(void)
             sprintf(message, "Device 0x%02X is connected\r\n", i);
             UART_Debug_PutString(message); 
         }
-        
     }
-    
-    /******************************************/
-    /*            I2C Reading                 */
-    /******************************************/
-    
+}
+
+// Print WHO AM I and STATUS REGISTER
+static void PrintSensor(void)
+{
     /* Read WHO AM I REGISTER register */
     uint8_t who_am_i_reg;
     ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
@@ -123,149 +113,137 @@ int main(void)
     {
         UART_Debug_PutString("Error occurred during I2C comm to read status register\r\n");   
     }
+}
+
+// Print the configuration registers read back from the sensor, checked against the values written
+static void PrintConfig(void)
+{
+    uint8_t config_regs[LIS3DH_CONFIG_REG_COUNT];
     
-    /******************************************/
-    /*        Read Control Register 1         */
-    /******************************************/
-    uint8_t ctrl_reg1; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
+    // Read back from the sensor rather than from the register shadow
+    I2C_Peripheral_SetCacheMode(I2C_CACHE_VERIFY);
+    ErrorCode error = LIS3DH_ReadConfig(LIS3DH_DEVICE_ADDRESS, config_regs);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 1: 0x%02X\r\n", ctrl_reg1);
+        sprintf(message, "CONTROL REGISTER 1 after overwrite operation: 0x%02X\r\n", CONFIG_REG(config_regs, LIS3DH_CTRL_REG1));
+        UART_Debug_PutString(message); 
+        sprintf(message, "TEMPERATURE CONFIG REGISTER after being updated: 0x%02X\r\n", CONFIG_REG(config_regs, LIS3DH_TEMP_CFG_REG));
+        UART_Debug_PutString(message); 
+        sprintf(message, "CONTROL REGISTER 4 after being updated: 0x%02X\r\n", CONFIG_REG(config_regs, LIS3DH_CTRL_REG4));
+        UART_Debug_PutString(message); 
+        sprintf(message, "Registers differing from the values written: %u\r\n",
+                (unsigned)I2C_Peripheral_GetStats().verify_mismatches);
         UART_Debug_PutString(message); 
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to read configuration registers\r\n");   
     }
+}
+
+// Print the times of the boot phases [us]
+static void PrintBoot(void)
+{
+    static const char* const names[BOOT_PHASES] = { "sensor ready", "configured", "first reading", "diagnostics" };
     
-    /******************************************/
-    /*            I2C Writing                 */
-    /******************************************/
-    
-        
-    UART_Debug_PutString("\r\nWriting new values..\r\n");
-    
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_CTRL_REG1)
+    for (int phase = 0; phase < BOOT_PHASES; phase++)
     {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_CTRL_REG1;
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
-    
-        if (error == NO_ERROR)
+        uint32_t time = Boot_Time((Boot_Phase)phase);
+        if (time != BOOT_NOT_REACHED)
         {
-            sprintf(message, "CONTROL REGISTER 1 successfully written as: 0x%02X\r\n", ctrl_reg1);
+            sprintf(message, "Boot %s: %lu us\r\n", names[phase], (unsigned long)time);
             UART_Debug_PutString(message); 
         }
-        else
-        {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 1\r\n");   
-        }
     }
-    
-    /******************************************/
-    /*     Read Control Register 1 again      */
-    /******************************************/
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "CONTROL REGISTER 1 after overwrite operation: 0x%02X\r\n", ctrl_reg1);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
-    }
-    
-     /******************************************/
-     /* I2C Reading Temperature sensor CFG reg */
-     /******************************************/
+}
 
-    uint8_t tmp_cfg_reg;
+int main(void)
+{
+    CyGlobalIntEnable; /* Enable global interrupts. */
 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_TEMP_CFG_REG,
-                                        &tmp_cfg_reg);
+    /* Place your initialization/startup code here (e.g. MyInst_Start()) */
+    Timestamp_Start();
+    Boot_Reset();
+    LowPower_Start();
+    I2C_Peripheral_Start();
+    UART_Debug_Start();
     
+#if FAST_BOOT
+    // Polled until WHO AM I answers instead of the 5 ms of a power-up (see LIS3DH.h)
+    ErrorCode error = LIS3DH_WaitBoot(LIS3DH_DEVICE_ADDRESS, LIS3DH_BOOT_TIMEOUT_US);
     if (error == NO_ERROR)
     {
-        sprintf(message, "TEMPERATURE CONFIG REGISTER: 0x%02X\r\n", tmp_cfg_reg);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read temperature config register\r\n");   
+        Boot_Mark(BOOT_SENSOR_READY);
     }
     
+    // Whole configuration in one burst (see LIS3DH.h), checked once the readings run
+    error = LIS3DH_Configure(&lis3dh_config);
+    Boot_Mark(BOOT_CONFIGURED);
+#else
+    CyDelay(5); //"The boot procedure is complete about 5 milliseconds after device power-up."
     
-    tmp_cfg_reg = LIS3DH_TEMP_CFG_REG_ACTIVE; // must be changed to the appropriate value
-    
-    error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_TEMP_CFG_REG,
-                                         tmp_cfg_reg);
+    // Check which devices are present on the I2C bus
+    ScanBus();
     
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_TEMP_CFG_REG,
-                                        &tmp_cfg_reg);
+    /******************************************/
+    /*            I2C Reading                 */
+    /******************************************/
     
+    PrintSensor();
+    Boot_Mark(BOOT_SENSOR_READY);
     
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "TEMPERATURE CONFIG REGISTER after being updated: 0x%02X\r\n", tmp_cfg_reg);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read temperature config register\r\n");   
-    }
+    /******************************************/
+    /*     Read configuration registers       */
+    /******************************************/
     
-    uint8_t ctrl_reg4;
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
+    // TEMP_CFG_REG..CTRL_REG6 in one burst
+    uint8_t config_regs[LIS3DH_CONFIG_REG_COUNT];
+    ErrorCode error = LIS3DH_ReadConfig(LIS3DH_DEVICE_ADDRESS, config_regs);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
+        sprintf(message, "CONTROL REGISTER 1: 0x%02X\r\n", CONFIG_REG(config_regs, LIS3DH_CTRL_REG1));
+        UART_Debug_PutString(message); 
+        sprintf(message, "TEMPERATURE CONFIG REGISTER: 0x%02X\r\n", CONFIG_REG(config_regs, LIS3DH_TEMP_CFG_REG));
+        UART_Debug_PutString(message); 
+        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", CONFIG_REG(config_regs, LIS3DH_CTRL_REG4));
         UART_Debug_PutString(message); 
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to read configuration registers\r\n");   
     }
     
+    /******************************************/
+    /*            I2C Writing                 */
+    /******************************************/
     
-    ctrl_reg4 = LIS3DH_CTRL_REG4_BDU_ACTIVE; // must be changed to the appropriate value
-    
-    error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_CTRL_REG4,
-                                         ctrl_reg4);
+        
+    UART_Debug_PutString("\r\nWriting new values..\r\n");
     
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
+    // Read back from the sensor rather than from the register shadow,
+    // checking that the values written have landed
+    I2C_Peripheral_SetCacheMode(I2C_CACHE_VERIFY);
     
+    // Whole configuration in one burst (see LIS3DH.h)
+    error = LIS3DH_Configure(&lis3dh_config);
+    Boot_Mark(BOOT_CONFIGURED);
+#endif
     
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "CONTROL REGISTER 4 after being updated: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
-    }
-    else
+    if (error != NO_ERROR)
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to write configuration registers\r\n");   
     }
     
+#if !FAST_BOOT
+    /******************************************/
+    /*   Read configuration registers again   */
+    /******************************************/
+
+    PrintConfig();
+#endif
+    
     int16_t OutTemp;
     uint8_t header = 0xA0;
     uint8_t footer = 0xC0;
@@ -275,9 +253,34 @@ int main(void)
     OutArray[0] = header;
     OutArray[3] = footer;
     
+    // Time of the next reading, and whether the UART has shifted out the last byte
+    uint32_t next_reading = Timestamp_Now() + TEMPERATURE_PERIOD_US;
+    uint8_t uart_done = 0;
+    
+    // Diagnostics still to print after the first reading
+    uint8_t diagnostics_due = 1;
+    
     for(;;)
     {
-        CyDelay(100);
+        // Sleep until the next reading: interrupts are taken once the CPU runs again
+        for(;;)
+        {
+            CyGlobalIntDisable;
+            int32_t idle = (int32_t)(next_reading - Timestamp_Now());
+            if (idle <= 0)
+            {
+                CyGlobalIntEnable;
+                break;
+            }
+            // The Sleep mode stops the UART clock: wait for the end of the frame
+            if (!uart_done)
+            {
+                uart_done = (UART_Debug_ReadTxStatus() & UART_Debug_TX_STS_COMPLETE) != 0;
+            }
+            LowPower_Idle((uint32_t)idle, uart_done);
+            CyGlobalIntEnable;
+        }
+        next_reading += TEMPERATURE_PERIOD_US;
 		
 		error=I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
 												LIS3DH_OUT_ADC_3L, 2,
@@ -297,6 +300,21 @@ int main(void)
             OutArray[1] = (uint8_t)(OutTemp & 0xFF);
             OutArray[2] = (uint8_t)(OutTemp >> 8);
             UART_Debug_PutArray(OutArray, 4);
+            uart_done = 0;
+            Boot_Mark(BOOT_STREAMING);
+        }
+        
+        // Once the readings run: the ones falling due while the banners block on the UART follow right after
+        if (diagnostics_due && Boot_Time(BOOT_STREAMING) != BOOT_NOT_REACHED)
+        {
+            diagnostics_due = 0;
+#if FAST_BOOT
+            ScanBus();
+            PrintSensor();
+            PrintConfig();
+#endif
+            Boot_Mark(BOOT_DIAGNOSTICS);
+            PrintBoot();
         }
     }
 }
@@ -9,7 +9,7 @@
 #include "InterruptRoutines.h"
 #include "Timer_LISD3H.h"
 
-uint8_t flag = 0;
+volatile uint8_t flag = 0;
 
 CY_ISR(DataReady_ISR)
 {
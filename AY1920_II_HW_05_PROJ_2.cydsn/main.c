@@ -5,7 +5,10 @@
  * a LIS3DH tri-axial accelerometer in Normal Mode
  * at 100 Hz. 
  * 
-   
+ * The STATUS REGISTER is read on every Timer_LISD3H
+ * terminal count; in between the CPU is halted in
+ * Alternate Active mode (see LowPower.h): the timer
+ * and the UART must keep running, so no Sleep.
  *
  * ========================================
 */
@@ -13,104 +16,69 @@
 // Include header files
 #include "InterruptRoutines.h"
 #include "I2C_Interface.h"
+#include "LIS3DH.h"
+#include "LIS3DH_Convert.h"
+#include "LowPower.h"
+#include "Timestamp.h"
 #include "project.h"
 #include "stdio.h"
 
-//Brief slave device address
-#define LIS3DH_DEVICE_ADDRESS 0x18
-
-//Brief WHO AM I register address
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
-
-//Brief STATUS REGISTER address
-#define LIS3DH_STATUS_REG 0x27
-
-//Brieg CONTROL REGISTER 1 address
-#define LIS3DH_CTRL_REG1 0x20
-
-/*Brief HEX value for CONTROL REGISTER 1: Normal mode at 100 Hz
-CTRL_REG1[3]=LPen=0 (Normal mode);
-CTRL_REG1[7:4]=ODR[3:0]=0101 (100 Hz)*/
-#define LIS3DH_NORMAL_MODE_100_HZ_CTRL_REG1 0x57
+/*Brief sensor configuration: Normal mode at 100 Hz, +- 2.0 g FSR, BDU
+CTRL_REG1[7:4]=ODR[3:0]=0101 (100 Hz), CTRL_REG1[3]=LPen=0 (Normal mode);
+CTRL_REG4[3]=0 (High resolution disabled), CTRL_REG4[5:4]=FS[1:0]=00 (2.0 g FSR) */
+static const LIS3DH_Config lis3dh_config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = LIS3DH_ODR_100_HZ,
+    .mode = LIS3DH_MODE_NORMAL,
+    .full_scale = LIS3DH_FULL_SCALE_2G,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+};
 
-
-//Brief CONTROL REGISTER 4 address
-#define LIS3DH_CTRL_REG4 0x23
-/*Brief HEX value for CONTROL REGISTER 4: +- 2.0 g FSR
-CTRL_REG4[3]=0 (High resolution disabled)
-CTRL_REG4[5:4]=FS[1:0]=00 (2.0 g FSR) */
-#define LIS3DH_CTRL_REG4_2g 0x80
-
-//Brief OUT_X_L register address (x-axis output LSB)
-#define LIS3DH_OUT_X_L 0x28
-
-//Brief HEADER and FOOTER values for UART communication
-#define HEADER 0xA0
-#define FOOTER 0xC0
+/*Brief conversion of output blocks into right-justified 10-bit digits (Normal mode),
+scaled by 4 mg/digit in the Bridge Control Panel (see LIS3DH_Convert.h) */
+LIS3DH_DEFINE_DIGITS_CONVERTER(Convert, LIS3DH_MODE_NORMAL)
 
 int main(void)
 {
     CyGlobalIntEnable; 
     
     //Initialization
+    Timestamp_Start();
+    LowPower_Start();
     Timer_LISD3H_Start();
     I2C_Peripheral_Start();
     UART_Debug_Start();
     ISR_DataReady_StartEx(DataReady_ISR);
     
-    //"The boot procedure is complete about 5 milliseconds after device power-up."
-    CyDelay(5); 
-   
-    //Reading CONTROL REGISTER 1
-    uint8_t ctrl_reg1; 
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
-    
-    //Writing CONTROL REGISTER 1
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_100_HZ_CTRL_REG1)
-    {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_100_HZ_CTRL_REG1;
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
-    }
+    //Polled until WHO_AM_I answers instead of the 5 ms of a power-up (see LIS3DH.h)
+    LIS3DH_WaitBoot(LIS3DH_DEVICE_ADDRESS, LIS3DH_BOOT_TIMEOUT_US);
    
-    // Reading CONTROL REGISTER 4   
-    uint8_t ctrl_reg4;
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
-    // Writing CONTROL REGISTER 4
-    if (ctrl_reg4 != LIS3DH_CTRL_REG4_2g)
-    {
-        ctrl_reg4 = LIS3DH_CTRL_REG4_2g;
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_CTRL_REG4,
-                                         ctrl_reg4);
-    }
+    //Whole sensor configuration in one burst (see LIS3DH.h)
+    ErrorCode error = LIS3DH_Configure(&lis3dh_config);
     
     //Brief output acceleration data variables
     uint8_t AccelerationData[6];
     
-    int16_t X_Out;
-    
-    int16_t Y_Out;
-    
-    int16_t Z_Out;
-    
-    uint8_t OutArray[8];
-    
-    //Header and footer for communication w/ Bridge Control Panel
-    OutArray[0]=HEADER;
-    OutArray[7]=FOOTER;
+    //Brief A0..C0 frame for the Bridge Control Panel
+    uint8_t OutArray[LIS3DH_BRIDGE_FRAME_SIZE];
     
-    extern uint8_t flag; 
+    extern volatile uint8_t flag; 
     
     for(;;)
     {
+        //Nothing to do until the next terminal count: halt the CPU
+        CyGlobalIntDisable;
+        if (flag == 0)
+        {
+            LowPower_Idle(LOW_POWER_NO_DEADLINE, 0);
+        }
+        CyGlobalIntEnable;
+        
        if (flag == 1)
         { 
+            flag = 0;
+            
             //Reading STATUS REGISTER to check for data availability
             uint8_t status_reg;
             error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
@@ -127,28 +95,10 @@ int main(void)
 												AccelerationData); 
                     if (error == NO_ERROR)
                     {
-                        // Conversion of output data into right-justified 16 bit int (x-axis)
-                        X_Out=(int16)(AccelerationData[0] | (AccelerationData[1] << 8)) >> 6;
-                        //MSB (x-axis)
-                        OutArray[1]=(uint8_t)(X_Out >> 8); 
-                        //LSB (x-axis)
-                        OutArray[2]=(uint8_t)(X_Out & 0xFF);
-                    
-                        // Conversion of output data into right-justified 16 bit int (y-axis)
-                        Y_Out=(int16)(AccelerationData[2] | (AccelerationData[3]<<8)) >> 6;
-                        //MSB (y-axis)
-                        OutArray[3]=(uint8_t)(Y_Out >> 8);
-                         //LSB (y-axis)
-                        OutArray[4]=(uint8_t)(Y_Out & 0xFF);
-                    
-                        // Conversion of output data into right-justified 16 bit int (z-axis)
-                        Z_Out=(int16)(AccelerationData[4] | (AccelerationData[5]<<8)) >> 6;
-                        //MSB (z-axis)
-                        OutArray[5]=(uint8_t)(Z_Out >> 8);
-                        //LSB (z-axis)
-                        OutArray[6]=(uint8_t)(Z_Out & 0xFF);
+                        //Right-justified x, y, z, MSB first, between header and footer
+                        Convert_ToBridge(AccelerationData, OutArray, 1);
                 
-                        UART_Debug_PutArray(OutArray,8);
+                        UART_Debug_PutArray(OutArray,LIS3DH_BRIDGE_FRAME_SIZE);
                     }
                 }
             }
@@ -0,0 +1,80 @@
+/*
+* This file includes the source code of the motion detection gating
+* the stream.
+*/
+#include "Activity.h"
+
+    void Activity_Start(Activity* activity, LIS3DH_Mode mode, LIS3DH_FullScale full_scale,
+                        uint16_t threshold_mg, uint32_t timeout_us, uint32_t now)
+    {
+        activity->threshold_mg = threshold_mg;
+        activity->timeout_us = timeout_us;
+        activity->wakes = 0;
+        activity->idle = 0;
+        Activity_SetScale(activity, mode, full_scale);
+        Activity_Wake(activity, now);
+    }
+
+    void Activity_SetScale(Activity* activity, LIS3DH_Mode mode, LIS3DH_FullScale full_scale)
+    {
+        //Left-justified outputs: 2^shift units per digit
+        activity->threshold = ((int32_t)activity->threshold_mg << LIS3DH_OutputShift(mode)) /
+                              LIS3DH_SensitivityMg(mode, full_scale);
+        for (uint8_t device = 0; device < ACTIVITY_MAX_DEVICES; device++)
+        {
+            activity->primed[device] = 0;
+        }
+    }
+
+    uint8_t Activity_Update(Activity* activity, uint8_t device, const uint8_t* data, uint8_t count,
+                            uint32_t now)
+    {
+        int32_t* mean = activity->mean[device];
+        uint8_t motion = 0;
+        for (uint8_t i = 0; i < count; i++, data += 6)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                int32_t value = (int16_t)(data[2*axis] | (data[2*axis + 1] << 8));
+                if (!activity->primed[device])
+                {
+                    mean[axis] = value*(1 << ACTIVITY_MEAN_SHIFT);
+                }
+                //High-pass: deviation from the running mean, which moves by a fraction of it
+                int32_t deviation = value - (mean[axis] >> ACTIVITY_MEAN_SHIFT);
+                mean[axis] += deviation;
+                if (deviation > activity->threshold || deviation < -activity->threshold)
+                {
+                    motion = 1;
+                }
+            }
+            activity->primed[device] = 1;
+        }
+        if (motion)
+        {
+            activity->motion_timestamp = now;
+        }
+        return motion;
+    }
+
+    uint8_t Activity_IsIdleDue(const Activity* activity, uint32_t now)
+    {
+        return !activity->idle && now - activity->motion_timestamp >= activity->timeout_us;
+    }
+
+    void Activity_Sleep(Activity* activity)
+    {
+        activity->idle = 1;
+    }
+
+    void Activity_Wake(Activity* activity, uint32_t now)
+    {
+        if (activity->idle)
+        {
+            activity->wakes++;
+        }
+        activity->idle = 0;
+        activity->motion_timestamp = now;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,97 @@
+/**
+*   \file Activity.h
+*   \brief Motion detection gating the stream of a board that mostly sits still.
+*
+*   While the stream runs every batch read from a sensor goes through
+*   Activity_Update(), straight from the output registers: each axis is
+*   high-pass filtered by subtracting its running mean (gravity and
+*   offsets), and a sample beyond the threshold on any axis is motion.
+*   Once no motion has been seen for the timeout, Activity_IsIdleDue()
+*   tells the main loop to gate the stream off: the sensor drops to a
+*   low-power rate with its IA1 generator watching for motion with the
+*   same threshold (LIS3DH_ConfigureMotion()), and the main loop calls
+*   Activity_Sleep(). Activity_Wake() starts the timeout again once the
+*   generator has fired and the stream is back.
+*/
+#ifndef ACTIVITY_H
+    #define ACTIVITY_H
+
+    #include "cytypes.h"
+    #include "LIS3DH.h"
+
+    /** \brief Most sensors whose batches are watched. */
+    #ifndef ACTIVITY_MAX_DEVICES
+        #define ACTIVITY_MAX_DEVICES 8
+    #endif
+
+    /**
+    *   \brief Running mean over about 2^ACTIVITY_MEAN_SHIFT samples.
+    *
+    *   Slow tilts are followed, handling and vibration are not.
+    */
+    #ifndef ACTIVITY_MEAN_SHIFT
+        #define ACTIVITY_MEAN_SHIFT 5
+    #endif
+
+    /**
+    *   \brief State of the gate.
+    */
+    typedef struct {
+        uint16_t threshold_mg;                          ///< Motion threshold [mg]
+        int32_t threshold;                              ///< Threshold in left-justified output units
+        uint32_t timeout_us;                            ///< Time without motion before the stream stops
+        uint32_t motion_timestamp;                      ///< Last motion, or last wake-up [us]
+        int32_t mean[ACTIVITY_MAX_DEVICES][3];          ///< Running mean per sensor and axis (ACTIVITY_MEAN_SHIFT fractional bits)
+        uint8_t primed[ACTIVITY_MAX_DEVICES];           ///< Non-zero once mean holds a sample
+        uint8_t idle;                                   ///< Non-zero while the stream is gated off
+        uint32_t wakes;                                 ///< Motions that have ended an idle period
+    } Activity;
+
+    /**
+    *   \brief Start with the stream running, as if motion had just been seen.
+    *
+    *   \param mode Operating mode of the samples (see Activity_SetScale()).
+    *   \param full_scale Full scale of the samples.
+    *   \param threshold_mg Deviation from the running mean that counts as motion.
+    *   \param timeout_us Time without motion before Activity_IsIdleDue().
+    *   \param now Timestamp_Now() [us].
+    */
+    void Activity_Start(Activity* activity, LIS3DH_Mode mode, LIS3DH_FullScale full_scale,
+                        uint16_t threshold_mg, uint32_t timeout_us, uint32_t now);
+
+    /**
+    *   \brief Output format of the samples that follow (start, configuration switch).
+    *
+    *   The threshold is converted into output units; the means start
+    *   again from the next sample.
+    */
+    void Activity_SetScale(Activity* activity, LIS3DH_Mode mode, LIS3DH_FullScale full_scale);
+
+    /**
+    *   \brief Look for motion in a batch of a sensor.
+    *
+    *   \param device Index of the sensor, below ACTIVITY_MAX_DEVICES.
+    *   \param data Output registers of count samples, OUT_X_L..OUT_Z_H each.
+    *   \param now Timestamp_Now() [us].
+    *   \retval Non-zero if a sample of the batch is motion.
+    */
+    uint8_t Activity_Update(Activity* activity, uint8_t device, const uint8_t* data, uint8_t count,
+                            uint32_t now);
+
+    /**
+    *   \brief Check whether the stream runs with no motion for the timeout.
+    */
+    uint8_t Activity_IsIdleDue(const Activity* activity, uint32_t now);
+
+    /**
+    *   \brief The stream is gated off.
+    */
+    void Activity_Sleep(Activity* activity);
+
+    /**
+    *   \brief The stream runs again: the timeout starts from now.
+    */
+    void Activity_Wake(Activity* activity, uint32_t now);
+
+#endif // ACTIVITY_H
+/* [] END OF FILE */
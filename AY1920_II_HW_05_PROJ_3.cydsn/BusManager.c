@@ -0,0 +1,157 @@
+/*
+* This file includes the source code of the scheduling of the sensors
+* sharing the I2C bus.
+*/
+#include "BusManager.h"
+#include "I2C_Interface.h"
+#include "LIS3DH.h"
+#include "LowPower.h"
+
+    static void BusManager_Add(BusManager* bus, uint8_t address, uint8_t wired)
+    {
+        BusManager_Device* device = &bus->devices[bus->count++];
+        device->address = address;
+        device->wired = wired;
+        device->signalled = 0;
+        device->due_timestamp = 0;
+        device->drain_timestamp = 0;
+        device->sample_timestamp = 0;
+    }
+
+    uint8_t BusManager_Discover(BusManager* bus, uint8_t first_address, uint8_t address_count,
+                                uint8_t wired_address)
+    {
+        bus->count = 0;
+        bus->rejected = 0;
+        bus->last = BUS_MANAGER_NONE;
+        if (address_count > BUS_MANAGER_MAX_DEVICES)
+        {
+            address_count = BUS_MANAGER_MAX_DEVICES;
+        }
+        for (uint8_t i = 0; i < address_count; i++)
+        {
+            uint8_t address = (uint8_t)(first_address + i);
+            if (!I2C_Peripheral_IsDeviceConnected(address))
+            {
+                continue;
+            }
+            //Another device on the address: it is left alone
+            uint8_t who_am_i;
+            if (I2C_Peripheral_ReadRegister(address, LIS3DH_WHO_AM_I_REG_ADDR, &who_am_i) != NO_ERROR ||
+                who_am_i != LIS3DH_WHO_AM_I_VALUE)
+            {
+                bus->rejected++;
+                continue;
+            }
+            BusManager_Add(bus, address, address == wired_address);
+        }
+        uint8_t verified = bus->count;
+        if (verified == 0)
+        {
+            BusManager_Add(bus, wired_address, 1);
+        }
+        return verified;
+    }
+
+    void BusManager_Start(BusManager* bus, uint32_t period_us, uint32_t now)
+    {
+        bus->period = period_us;
+        for (uint8_t i = 0; i < bus->count; i++)
+        {
+            BusManager_Device* device = &bus->devices[i];
+            device->signalled = 0;
+            //Spread over the period: the FIFOs fill up in step, their bursts must not queue up
+            device->due_timestamp = now + (device->wired ? 0 : period_us / bus->count * i);
+            device->drain_timestamp = now;
+            device->sample_timestamp = now;
+        }
+    }
+
+    void BusManager_Signal(BusManager* bus, uint32_t timestamp)
+    {
+        for (uint8_t i = 0; i < bus->count; i++)
+        {
+            BusManager_Device* device = &bus->devices[i];
+            if (device->wired && !device->signalled)
+            {
+                device->signalled = 1;
+                device->due_timestamp = timestamp;
+            }
+        }
+    }
+
+    //Non-zero if the sensor has to be drained now
+    static uint8_t BusManager_IsDue(const BusManager_Device* device, uint32_t now)
+    {
+        if (device->wired)
+        {
+            return device->signalled;
+        }
+        return (int32_t)(now - device->due_timestamp) >= 0;
+    }
+
+    uint8_t BusManager_Next(BusManager* bus, uint32_t now)
+    {
+        //From the one after the last handed out, wrapping around
+        uint8_t start = bus->last == BUS_MANAGER_NONE ? 0 : (uint8_t)(bus->last + 1);
+        for (uint8_t n = 0; n < bus->count; n++)
+        {
+            uint8_t i = (uint8_t)((start + n) % bus->count);
+            if (BusManager_IsDue(&bus->devices[i], now))
+            {
+                bus->devices[i].signalled = 0;
+                bus->last = i;
+                return i;
+            }
+        }
+        return BUS_MANAGER_NONE;
+    }
+
+    void BusManager_Drained(BusManager* bus, uint8_t device, uint32_t now, uint8_t samples)
+    {
+        BusManager_Device* sensor = &bus->devices[device];
+        sensor->drain_timestamp = now;
+        if (samples > 0)
+        {
+            sensor->sample_timestamp = now;
+        }
+        if (!sensor->wired)
+        {
+            //Empty again: the watermark comes back a period later
+            sensor->due_timestamp = now + bus->period;
+        }
+    }
+
+    uint32_t BusManager_TimeToDue(const BusManager* bus, uint32_t now)
+    {
+        uint32_t wait = LOW_POWER_NO_DEADLINE;
+        for (uint8_t i = 0; i < bus->count; i++)
+        {
+            const BusManager_Device* device = &bus->devices[i];
+            if (BusManager_IsDue(device, now))
+            {
+                return 0;
+            }
+            if (!device->wired && device->due_timestamp - now < wait)
+            {
+                wait = device->due_timestamp - now;
+            }
+        }
+        return wait;
+    }
+
+    uint32_t BusManager_SilentFor(const BusManager* bus, uint32_t now)
+    {
+        uint32_t silent = 0;
+        for (uint8_t i = 0; i < bus->count; i++)
+        {
+            uint32_t elapsed = now - bus->devices[i].sample_timestamp;
+            if (elapsed > silent)
+            {
+                silent = elapsed;
+            }
+        }
+        return silent;
+    }
+
+/* [] END OF FILE */
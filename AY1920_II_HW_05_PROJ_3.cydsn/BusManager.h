@@ -0,0 +1,117 @@
+/**
+*   \file BusManager.h
+*   \brief Several LIS3DH sensors on one I2C bus, drained in turn.
+*
+*   At boot BusManager_Discover() probes a range of 7-bit addresses (0x18
+*   and 0x19 through SA0, more behind address translators) and keeps the
+*   sensors that acknowledge and answer WHO_AM_I with 0x33. The index of a
+*   sensor in the table, in address order, is its device ID in the stream
+*   (FRAME_TYPE_DEVICE, see Frame.h).
+*
+*   Only one sensor has its INT1 line wired to the PSoC: its FIFO is
+*   drained when BusManager_Signal() reports the interrupt (or the tick
+*   of Timer_LISD3H). The FIFO level of the others is estimated from the
+*   time of their last drain: they are due once BusManager.period has
+*   gone by, when the watermark is expected to be reached. Their first
+*   drains are spread over the period, so that the bursts of sensors
+*   started together do not keep queuing up behind each other.
+*
+*   BusManager_Next() hands out the due sensors round-robin, starting
+*   after the last one drained, so that a sensor always due cannot starve
+*   the others; the main loop asks for the next one as soon as the bus is
+*   free, and BusManager_TimeToDue() tells it how long the bus can stay
+*   idle.
+*/
+#ifndef BUS_MANAGER_H
+    #define BUS_MANAGER_H
+
+    #include "cytypes.h"
+
+    /** \brief Most sensors on the bus: 0x18 .. 0x1F. */
+    #ifndef BUS_MANAGER_MAX_DEVICES
+        #define BUS_MANAGER_MAX_DEVICES 8
+    #endif
+
+    /** \brief Device ID of no sensor. */
+    #define BUS_MANAGER_NONE 0xFF
+
+    /**
+    *   \brief A sensor on the bus.
+    */
+    typedef struct {
+        uint8_t address;            ///< 7-bit I2C address
+        uint8_t wired;              ///< Non-zero for the sensor with INT1 on the PSoC
+        uint8_t signalled;          ///< INT1 event waiting for the drain (wired sensor)
+        uint32_t due_timestamp;     ///< When the watermark was reached, or is expected [us]
+        uint32_t drain_timestamp;   ///< Last STATUS (FIFO SOURCE) REGISTER read that emptied the sensor [us]
+        uint32_t sample_timestamp;  ///< Last read that brought samples [us]
+    } BusManager_Device;
+
+    /**
+    *   \brief Sensors of the bus and state of the round-robin.
+    */
+    typedef struct {
+        BusManager_Device devices[BUS_MANAGER_MAX_DEVICES];
+        uint8_t count;              ///< Sensors in devices
+        uint8_t rejected;           ///< Addresses that acknowledged with another WHO_AM_I
+        uint8_t last;               ///< Device handed out last by BusManager_Next()
+        uint32_t period;            ///< Time for a FIFO to fill up to the watermark [us]
+    } BusManager;
+
+    /**
+    *   \brief Probe the bus for sensors, with blocking transfers (boot only).
+    *
+    *   An address is kept if it acknowledges and WHO_AM_I reads
+    *   LIS3DH_WHO_AM_I_VALUE. When none is found the wired address is
+    *   kept anyway, unverified, so that a sensor late out of its boot is
+    *   configured by the stall recovery of the main loop.
+    *   \param first_address Lowest address probed.
+    *   \param address_count Addresses probed, BUS_MANAGER_MAX_DEVICES at most.
+    *   \param wired_address Address of the sensor with INT1 on the PSoC.
+    *   \retval Sensors verified.
+    */
+    uint8_t BusManager_Discover(BusManager* bus, uint8_t first_address, uint8_t address_count,
+                                uint8_t wired_address);
+
+    /**
+    *   \brief Start the estimates from sensors just emptied (boot, configuration switch).
+    *
+    *   \param period_us Time for a FIFO to fill up to the watermark at the current ODR.
+    *   \param now Timestamp_Now() [us].
+    */
+    void BusManager_Start(BusManager* bus, uint32_t period_us, uint32_t now);
+
+    /**
+    *   \brief INT1 event of the wired sensor: its drain is due.
+    *
+    *   \param timestamp Time of the event [us]; an event already waiting keeps its own.
+    */
+    void BusManager_Signal(BusManager* bus, uint32_t timestamp);
+
+    /**
+    *   \brief Next sensor to drain, round-robin among the due ones.
+    *
+    *   The INT1 event of the wired sensor is consumed.
+    *   \retval Device ID, or BUS_MANAGER_NONE if no sensor is due.
+    */
+    uint8_t BusManager_Next(BusManager* bus, uint32_t now);
+
+    /**
+    *   \brief Record a STATUS (FIFO SOURCE) REGISTER read that emptied a sensor.
+    *
+    *   \param samples Samples the read found, 0 if the sensor had none.
+    */
+    void BusManager_Drained(BusManager* bus, uint8_t device, uint32_t now, uint8_t samples);
+
+    /**
+    *   \brief Time [us] until a sensor is due: 0 if one is already, or LOW_POWER_NO_DEADLINE.
+    */
+    uint32_t BusManager_TimeToDue(const BusManager* bus, uint32_t now);
+
+    /**
+    *   \brief Longest time [us] a sensor of the bus has gone without samples.
+    */
+    uint32_t BusManager_SilentFor(const BusManager* bus, uint32_t now);
+
+#endif // BUS_MANAGER_H
+/* [] END OF FILE */
@@ -0,0 +1,94 @@
+/*
+* This file includes the source code of the commands received on the
+* UART_Debug RX line.
+*/
+#include "Command.h"
+#include "Frame.h"
+#include "project.h"
+
+#define COMMAND_MAX_SIZE (FRAME_HEADER_SIZE + COMMAND_MAX_PAYLOAD + FRAME_CRC_SIZE)
+
+// Command being received
+static uint8_t command_buffer[COMMAND_MAX_SIZE];
+static uint8_t command_fill = 0;
+
+static uint32_t error_count = 0;
+
+    void Command_Reset(void)
+    {
+        command_fill = 0;
+        error_count = 0;
+    }
+
+    // Returns 1 once the bytes in command_buffer make a valid command
+    static uint8_t Command_Parse(Command* command)
+    {
+        uint8_t* b = command_buffer;
+
+        // Bytes before the sync pattern are dropped one by one
+        if (command_fill == 1 && b[0] != FRAME_SYNC_0)
+        {
+            command_fill = 0;
+            return 0;
+        }
+        if (command_fill == 2 && b[1] != FRAME_SYNC_1)
+        {
+            // The second byte may start the pattern itself
+            command_fill = (b[1] == FRAME_SYNC_0);
+            return 0;
+        }
+        if (command_fill == 4 && b[3] > COMMAND_MAX_PAYLOAD)
+        {
+            error_count++;
+            command_fill = 0;
+            return 0;
+        }
+        if (command_fill < 4 || command_fill < FRAME_HEADER_SIZE + b[3] + FRAME_CRC_SIZE)
+        {
+            return 0;
+        }
+
+        // Whole frame received: the CRC covers everything after the sync pattern
+        uint16_t size = FRAME_HEADER_SIZE + b[3];
+        uint16_t crc = (uint16_t)(b[size] | (b[size + 1] << 8));
+        command_fill = 0;
+        if (Frame_Crc16(0xFFFF, &b[2], size - 2) != crc)
+        {
+            error_count++;
+            return 0;
+        }
+        command->type = b[2];
+        command->length = b[3];
+        for (uint8_t i = 0; i < b[3]; i++)
+        {
+            command->payload[i] = b[FRAME_HEADER_SIZE + i];
+        }
+        return 1;
+    }
+
+    uint8_t Command_Poll(Command* command)
+    {
+#if defined(UART_Debug_RX_ENABLED) && UART_Debug_RX_ENABLED
+        while (UART_Debug_GetRxBufferSize() > 0)
+        {
+            command_buffer[command_fill++] = UART_Debug_ReadRxData();
+            if (Command_Parse(command))
+            {
+                return 1;
+            }
+        }
+#endif
+        return 0;
+    }
+
+    uint32_t Command_GetErrorCount(void)
+    {
+        return error_count;
+    }
+
+    void Command_Reject(void)
+    {
+        error_count++;
+    }
+
+/* [] END OF FILE */
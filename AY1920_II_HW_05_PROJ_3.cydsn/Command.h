@@ -0,0 +1,70 @@
+/**
+*   \file Command.h
+*   \brief Commands received from the host on the UART_Debug RX line.
+*
+*   Commands use the frame format of Frame.h: sync, type, length,
+*   sequence number, timestamp, payload and CRC. Sequence number and
+*   timestamp are not used by the device. Bytes are taken from the
+*   UART_Debug RX buffer without waiting, so a command may be completed
+*   over several calls. A frame with a bad CRC or a payload longer than
+*   COMMAND_MAX_PAYLOAD is thrown away and counted, as is a command the
+*   application refuses (Command_Reject()); the host repeats a command
+*   whose effect it does not see in the stream.
+*
+*   FRAME_TYPE_CONFIG carries one configuration byte in the format of
+*   the samples payload (FRAME_CONFIG): ODR code in bits 7:4, Frame_Mode
+*   in bits 3:2, full scale in bits 1:0. The samples frames sent after
+*   the switch report the new byte.
+*
+*   FRAME_TYPE_TRACE_QUERY carries one byte, the Trace_Stage to report
+*   (ORed with TRACE_QUERY_CLEAR to clear it): the device answers with a
+*   FRAME_TYPE_TRACE frame (see Trace.h).
+*
+*   FRAME_TYPE_LOG_DUMP needs no payload (any is ignored): the device sends the pages of
+*   its ring log back in FRAME_TYPE_LOG frames, oldest first, along with
+*   the stream (see FlashLog.h). Ignored without the log.
+*
+*   Without the RX part of UART_Debug no command is ever received.
+*/
+#ifndef COMMAND_H
+    #define COMMAND_H
+
+    #include "cytypes.h"
+
+    /** \brief Longest payload accepted in a command. */
+    #define COMMAND_MAX_PAYLOAD 16
+
+    /**
+    *   \brief A received command.
+    */
+    typedef struct {
+        uint8_t type;                           ///< Frame_Type of the command
+        uint8_t length;                         ///< Payload length
+        uint8_t payload[COMMAND_MAX_PAYLOAD];   ///< Payload bytes
+    } Command;
+
+    /**
+    *   \brief Forget a partially received command.
+    */
+    void Command_Reset(void);
+
+    /**
+    *   \brief Take the bytes waiting in the RX buffer.
+    *
+    *   \param command Receives the command once it is complete.
+    *   \retval Returns true (>0) when a command has been received.
+    */
+    uint8_t Command_Poll(Command* command);
+
+    /**
+    *   \brief Number of command frames rejected since Command_Reset().
+    */
+    uint32_t Command_GetErrorCount(void);
+
+    /**
+    *   \brief Count a received command whose payload the application refuses.
+    */
+    void Command_Reject(void);
+
+#endif // COMMAND_H
+/* [] END OF FILE */
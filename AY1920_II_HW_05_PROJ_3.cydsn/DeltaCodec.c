@@ -0,0 +1,93 @@
+/*
+* This file includes the source code of the delta compression of the
+* samples payload.
+*/
+#include "DeltaCodec.h"
+#include "Frame.h"
+
+//Longest varint of a 16-bit value, for the three axes of a sample
+#define DELTA_CODEC_MAX_SAMPLE_SIZE 9
+
+    void DeltaCodec_Reset(DeltaCodec_Encoder* encoder)
+    {
+        encoder->frames_to_key = 0;
+    }
+
+    static uint8_t DeltaCodec_EncodeRaw(const int16_t (*samples)[3], uint8_t count,
+                                        uint8_t config, uint8_t* payload)
+    {
+        uint8_t length = 0;
+        payload[length++] = config;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                payload[length++] = (uint8_t)(samples[i][axis] & 0xFF);
+                payload[length++] = (uint8_t)((uint16_t)samples[i][axis] >> 8);
+            }
+        }
+        return length;
+    }
+
+    uint8_t DeltaCodec_Encode(DeltaCodec_Encoder* encoder, uint8_t config,
+                              const int16_t (*samples)[3], uint8_t count,
+                              uint8_t* payload, uint8_t* type)
+    {
+        // Compressed payloads never grow past the plain one
+        uint16_t limit = 1 + FRAME_SAMPLE_SIZE * count;
+        uint8_t key = encoder->frames_to_key == 0 || config != encoder->config;
+        uint16_t length = 0;
+        uint8_t i = 0;
+
+        payload[length++] = config;
+        payload[length++] = count;
+        if (key)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                payload[length++] = (uint8_t)(samples[0][axis] & 0xFF);
+                payload[length++] = (uint8_t)((uint16_t)samples[0][axis] >> 8);
+            }
+            encoder->reference[0] = samples[0][0];
+            encoder->reference[1] = samples[0][1];
+            encoder->reference[2] = samples[0][2];
+            i = 1;
+        }
+
+        for (; i < count && length + DELTA_CODEC_MAX_SAMPLE_SIZE <= limit; i++)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                // Wrapping 16-bit difference, zig-zag mapped to small unsigned values
+                int16_t delta = (int16_t)((uint16_t)samples[i][axis] - (uint16_t)encoder->reference[axis]);
+                uint16_t zigzag = (uint16_t)(((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15));
+                encoder->reference[axis] = samples[i][axis];
+                while (zigzag >= 0x80)
+                {
+                    payload[length++] = (uint8_t)(zigzag | 0x80);
+                    zigzag >>= 7;
+                }
+                payload[length++] = (uint8_t)zigzag;
+            }
+        }
+
+        encoder->config = config;
+        if (i < count || length > limit)
+        {
+            // Not worth it: the plain samples go out instead, and are a keyframe as well
+            length = DeltaCodec_EncodeRaw(samples, count, config, payload);
+            encoder->reference[0] = samples[count - 1][0];
+            encoder->reference[1] = samples[count - 1][1];
+            encoder->reference[2] = samples[count - 1][2];
+            key = 1;
+            *type = FRAME_TYPE_SAMPLES;
+        }
+        else
+        {
+            *type = key ? FRAME_TYPE_DELTA_KEY : FRAME_TYPE_DELTA;
+        }
+        encoder->frames_to_key = key ? DELTA_CODEC_KEYFRAME_INTERVAL - 1 : encoder->frames_to_key - 1;
+        return (uint8_t)length;
+    }
+
+/* [] END OF FILE */
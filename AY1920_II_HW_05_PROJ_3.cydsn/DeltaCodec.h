@@ -0,0 +1,64 @@
+/**
+*   \file DeltaCodec.h
+*   \brief Delta compression of the samples payload.
+*
+*   At rest consecutive samples differ by a few mg, so each axis is sent
+*   as the difference from the previous sample, zig-zag mapped
+*   (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...) and written as a varint: 7 bits
+*   per byte, least significant group first, bit 7 set on every byte but
+*   the last. Differences within +-63 mg take one byte instead of two.
+*
+*   Payload layout:
+*
+*       FRAME_TYPE_DELTA_KEY: config, N, x0 y0 z0 (int16 LE), N-1 x/y/z varints
+*       FRAME_TYPE_DELTA:     config, N, N x/y/z varints
+*
+*   Delta frames continue from the last sample of the previous frame, so
+*   a lost frame makes the following ones undecodable: a keyframe is sent
+*   every DELTA_CODEC_KEYFRAME_INTERVAL frames, whenever the configuration
+*   byte changes and after DeltaCodec_Reset(). When the differences do not
+*   compress (shocks, range changes) the batch goes out as a plain
+*   FRAME_TYPE_SAMPLES payload, which also serves as a keyframe.
+*/
+#ifndef DELTA_CODEC_H
+    #define DELTA_CODEC_H
+
+    #include "cytypes.h"
+
+    /** \brief Frames between two keyframes (bounds the loss after a dropped frame). */
+    #ifndef DELTA_CODEC_KEYFRAME_INTERVAL
+        #define DELTA_CODEC_KEYFRAME_INTERVAL 16
+    #endif
+
+    /**
+    *   \brief State of the encoder.
+    */
+    typedef struct {
+        int16_t reference[3];           ///< Last sample sent
+        uint8_t config;                 ///< Configuration byte of the last frame
+        uint8_t frames_to_key;          ///< Delta frames left before the next keyframe
+    } DeltaCodec_Encoder;
+
+    /**
+    *   \brief Make the next frame a keyframe.
+    *
+    *   To be called at start and whenever a frame could not be sent.
+    */
+    void DeltaCodec_Reset(DeltaCodec_Encoder* encoder);
+
+    /**
+    *   \brief Encode a batch of samples.
+    *
+    *   \param config Configuration byte of the samples (see FRAME_CONFIG).
+    *   \param samples x, y, z in mg, oldest first.
+    *   \param count Number of samples, 1 to FRAME_MAX_SAMPLES.
+    *   \param payload Destination, at least 1 + FRAME_SAMPLE_SIZE * count bytes.
+    *   \param type Receives the Frame_Type of the payload.
+    *   \retval Length of the payload in bytes.
+    */
+    uint8_t DeltaCodec_Encode(DeltaCodec_Encoder* encoder, uint8_t config,
+                              const int16_t (*samples)[3], uint8_t count,
+                              uint8_t* payload, uint8_t* type);
+
+#endif // DELTA_CODEC_H
+/* [] END OF FILE */
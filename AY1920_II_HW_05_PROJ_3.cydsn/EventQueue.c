@@ -0,0 +1,99 @@
+/*
+* This file includes the source code of the lock-free event queue
+* between DataReady_ISR and the main loop.
+*/
+#include "EventQueue.h"
+#include "CyLib.h"
+
+/**
+*   \brief Compiler barrier: keeps the slot write before the index update.
+*
+*   Enough on the single-core Cortex-M3, where the ISR and the main loop
+*   observe memory in program order.
+*/
+#define EVENT_QUEUE_BARRIER() __asm__ volatile ("" ::: "memory")
+
+static EventQueue_Event queue[EVENT_QUEUE_SIZE];
+
+// Free-running indices: head written by the producer, tail by the consumer
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_tail = 0;
+
+// Producer-side state
+static uint16_t next_sequence = 0;
+static uint8_t pending_dropped = 0;
+static EventQueue_Stats stats;
+
+    void EventQueue_Reset(void)
+    {
+        queue_head = 0;
+        queue_tail = 0;
+        next_sequence = 0;
+        pending_dropped = 0;
+        stats = (EventQueue_Stats){ 0 };
+    }
+
+    uint8_t EventQueue_Push(uint32_t timestamp, uint32_t cycles)
+    {
+        uint8_t head = queue_head;
+        uint8_t count = (uint8_t)(head - queue_tail);
+        uint16_t sequence = next_sequence++;
+        
+        if (count >= EVENT_QUEUE_SIZE)
+        {
+            stats.dropped++;
+            if (pending_dropped < 0xFF)
+            {
+                pending_dropped++;
+            }
+            return 0;
+        }
+        
+        EventQueue_Event* event = &queue[head & (EVENT_QUEUE_SIZE - 1)];
+        event->timestamp = timestamp;
+        event->cycles = cycles;
+        event->sequence = sequence;
+        event->dropped = pending_dropped;
+        pending_dropped = 0;
+        
+        EVENT_QUEUE_BARRIER();
+        queue_head = head + 1;
+        
+        stats.pushed++;
+        if (count + 1 > stats.high_water)
+        {
+            stats.high_water = count + 1;
+        }
+        return 1;
+    }
+
+    uint8_t EventQueue_Pop(EventQueue_Event* event)
+    {
+        uint8_t tail = queue_tail;
+        if (tail == queue_head)
+        {
+            return 0;
+        }
+        
+        *event = queue[tail & (EVENT_QUEUE_SIZE - 1)];
+        
+        EVENT_QUEUE_BARRIER();
+        queue_tail = tail + 1;
+        return 1;
+    }
+
+    uint8_t EventQueue_IsEmpty(void)
+    {
+        return queue_tail == queue_head;
+    }
+
+    EventQueue_Stats EventQueue_GetStats(void)
+    {
+        // The producer updates several fields: copy them in one go
+        uint8 interrupts = CyEnterCriticalSection();
+        EventQueue_Stats copy = stats;
+        CyExitCriticalSection(interrupts);
+        return copy;
+    }
+
+/* [] END OF FILE */
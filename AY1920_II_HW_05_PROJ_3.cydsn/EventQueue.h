@@ -0,0 +1,71 @@
+/**
+*   \file EventQueue.h
+*   \brief Lock-free queue of sensor events from DataReady_ISR to main().
+*
+*   Single producer (DataReady_ISR) and single consumer (the main loop):
+*   the producer only writes the head index and the consumer only writes
+*   the tail index, so neither side has to mask interrupts. When the
+*   queue is full the event is dropped and counted; the next event that
+*   gets through reports how many were lost just before it.
+*/
+#ifndef EVENT_QUEUE_H
+    #define EVENT_QUEUE_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Number of slots in the queue.
+    *
+    *   Must be a power of two, at most 128.
+    */
+    #ifndef EVENT_QUEUE_SIZE
+        #define EVENT_QUEUE_SIZE 8
+    #endif
+
+    /**
+    *   \brief An INT1 (data ready or FIFO watermark) event.
+    */
+    typedef struct {
+        uint32_t timestamp;     ///< Timestamp_Now() when the interrupt was taken [us]
+        uint32_t cycles;        ///< Trace_Now() when the interrupt was taken
+        uint16_t sequence;      ///< Running number of the event, dropped ones included
+        uint8_t dropped;        ///< Events dropped right before this one (saturates at 255)
+    } EventQueue_Event;
+
+    /**
+    *   \brief Counters of the queue.
+    */
+    typedef struct {
+        uint32_t pushed;        ///< Events queued
+        uint32_t dropped;       ///< Events dropped because the queue was full
+        uint8_t high_water;     ///< Largest number of events waiting at the same time
+    } EventQueue_Stats;
+
+    /** \brief Empty the queue and clear its counters (interrupts must not push meanwhile). */
+    void EventQueue_Reset(void);
+
+    /**
+    *   \brief Queue an event (producer side only).
+    *
+    *   \param timestamp Time of the event [us].
+    *   \param cycles Cycle count of the event (see Trace.h).
+    *   \retval Returns false (0) if the queue was full and the event dropped.
+    */
+    uint8_t EventQueue_Push(uint32_t timestamp, uint32_t cycles);
+
+    /**
+    *   \brief Take the oldest event (consumer side only).
+    *
+    *   \param event Filled with the event.
+    *   \retval Returns false (0) if the queue is empty.
+    */
+    uint8_t EventQueue_Pop(EventQueue_Event* event);
+
+    /** \brief Check if no event is waiting (consumer side only). */
+    uint8_t EventQueue_IsEmpty(void);
+
+    /** \brief Copy of the counters. */
+    EventQueue_Stats EventQueue_GetStats(void);
+
+#endif // EVENT_QUEUE_H
+/* [] END OF FILE */
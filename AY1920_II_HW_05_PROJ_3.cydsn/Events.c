@@ -0,0 +1,80 @@
+/*
+* This file includes the source code of the click and free-fall event
+* frames.
+*/
+#include "Events.h"
+#include "LIS3DH.h"
+
+    uint8_t Events_ClickAxes(uint8_t click_source)
+    {
+        // CLICK_SRC[3]=Sign (1: negative), CLICK_SRC[2:0]=Z Y X
+        return (uint8_t)((click_source & LIS3DH_CLICK_SRC_NEGATIVE ? EVENTS_NEGATIVE : 0x00) |
+                         (click_source & 0x07));
+    }
+
+    uint8_t Events_FreeFallAxes(uint8_t int1_source)
+    {
+        // INT1_SRC[4]=ZL, INT1_SRC[2]=YL, INT1_SRC[0]=XL
+        return (uint8_t)((int1_source & 0x01) | ((int1_source >> 1) & 0x02) | ((int1_source >> 2) & 0x04));
+    }
+
+    // Sample of the peak of a click: the extreme of the first axis of the click, in its direction
+    static uint8_t ClickPeak(uint8_t axes, const int16_t samples[][3], uint8_t count)
+    {
+        uint8_t axis = (axes & 0x01) ? 0 : (axes & 0x02) ? 1 : 2;
+        uint8_t peak = 0;
+        for (uint8_t i = 1; i < count; i++)
+        {
+            int32_t deviation = samples[i][axis] - samples[peak][axis];
+            if ((axes & EVENTS_NEGATIVE) ? deviation < 0 : deviation > 0)
+            {
+                peak = i;
+            }
+        }
+        return peak;
+    }
+
+    // Sample of a free fall: the lowest magnitude
+    static uint8_t FreeFallPeak(const int16_t samples[][3], uint8_t count)
+    {
+        uint8_t peak = 0;
+        uint32_t lowest = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint32_t magnitude = 0;
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                magnitude += (uint32_t)((int32_t)samples[i][axis]*samples[i][axis]);
+            }
+            if (i == 0 || magnitude < lowest)
+            {
+                lowest = magnitude;
+                peak = i;
+            }
+        }
+        return peak;
+    }
+
+    void Events_Report(Events_Kind kind, uint8_t axes, uint8_t config,
+                       const int16_t samples[][3], uint8_t count, uint8_t* payload)
+    {
+        int16_t snapshot[3] = { 0, 0, 0 };
+        if (count > 0)
+        {
+            uint8_t peak = kind == EVENTS_CLICK ? ClickPeak(axes, samples, count) : FreeFallPeak(samples, count);
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                snapshot[axis] = samples[peak][axis];
+            }
+        }
+        payload[0] = config;
+        payload[1] = (uint8_t)kind;
+        payload[2] = axes;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            payload[3 + 2*axis] = (uint8_t)(snapshot[axis] & 0xFF);
+            payload[4 + 2*axis] = (uint8_t)((uint16_t)snapshot[axis] >> 8);
+        }
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,68 @@
+/**
+*   \file Events.h
+*   \brief Typed frames of the clicks and free falls detected by the sensor.
+*
+*   In the events output format the samples stay in the sensor: its click
+*   engine (LIS3DH_ConfigureClick()) and its IA1 generator set up for free
+*   falls (LIS3DH_ConfigureFreeFall()) watch them, both latched on INT1,
+*   while the FIFO in stream mode keeps the last 32. On INT1 the main loop
+*   reads CLICK_SRC and INT1_SRC, which releases the latches, then the
+*   FIFO, and sends one frame per source that has fired: the UART stays
+*   silent between events.
+*
+*   Event payload (FRAME_TYPE_EVENT, little-endian), written by
+*   Events_Report(), the frame stamped with the INT1 event:
+*
+*       offset  size  field
+*       0       1     configuration byte of the sensor (see FRAME_CONFIG)
+*       1       1     kind (Events_Kind)
+*       2       1     axes: X, Y, Z in bits 0..2, EVENTS_NEGATIVE for a
+*                     click towards the negative side of its axis
+*       3       6     snapshot x, y, z (int16) [mg]
+*
+*   The snapshot is the sample of the FIFO that stands for the event: the
+*   peak of a click, the extreme of its axis in its direction; the lowest
+*   magnitude of a free fall.
+*/
+#ifndef EVENTS_H
+    #define EVENTS_H
+
+    #include "cytypes.h"
+
+    /** \brief Bytes of the FRAME_TYPE_EVENT payload. */
+    #define EVENTS_REPORT_SIZE 9
+
+    /** \brief Flag of the axes byte: the click is towards the negative side. */
+    #define EVENTS_NEGATIVE 0x80
+
+    /**
+    *   \brief Kinds of event.
+    */
+    typedef enum {
+        EVENTS_CLICK = 1,               ///< Single click (tap, impact) of the click engine
+        EVENTS_FREE_FALL = 2            ///< Every axis weightless for the duration (IA1, AND of the low events)
+    } Events_Kind;
+
+    /**
+    *   \brief Axes byte of a CLICK_SRC value: X, Y, Z and the sign.
+    */
+    uint8_t Events_ClickAxes(uint8_t click_source);
+
+    /**
+    *   \brief Axes byte of an INT1_SRC value: the axes with a low event.
+    */
+    uint8_t Events_FreeFallAxes(uint8_t int1_source);
+
+    /**
+    *   \brief Write the payload of an event.
+    *
+    *   \param config Configuration byte of the sensor.
+    *   \param samples Contents of the FIFO read after the event [mg], oldest first.
+    *   \param count Samples, 0 for an event without snapshot (zeros).
+    *   \param payload Receives EVENTS_REPORT_SIZE bytes.
+    */
+    void Events_Report(Events_Kind kind, uint8_t axes, uint8_t config,
+                       const int16_t samples[][3], uint8_t count, uint8_t* payload);
+
+#endif // EVENTS_H
+/* [] END OF FILE */
@@ -0,0 +1,241 @@
+/*
+* This file includes the source code of the windowed statistics of the
+* samples.
+*/
+#include "Features.h"
+
+//Most samples in a window: the count is sent as 16 bits
+#define FEATURES_MAX_SAMPLES 65535u
+
+    static void Features_ClearPane(Features_Pane* pane)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            pane->sum[axis] = 0;
+            pane->sum_squares[axis] = 0;
+            pane->min[axis] = 32767;
+            pane->max[axis] = -32768;
+            pane->crossings[axis] = 0;
+        }
+        pane->sum_magnitude = 0;
+    }
+
+    //Start filling the next pane, the oldest of the window once all are complete
+    static void Features_NextPane(Features* features)
+    {
+        features->current = (uint8_t)((features->current + 1) % features->pane_count);
+        features->filled = 0;
+        features->ready = 0;
+        Features_ClearPane(&features->panes[features->current]);
+    }
+
+    void Features_Configure(Features* features, uint32_t odr_hz, uint16_t window_ms,
+                            uint8_t panes, uint16_t hysteresis_mg)
+    {
+        if (panes < 1)
+        {
+            panes = 1;
+        }
+        if (panes > FEATURES_MAX_PANES)
+        {
+            panes = FEATURES_MAX_PANES;
+        }
+        uint32_t pane_samples = (uint32_t)(((uint64_t)odr_hz*window_ms + 500u*panes)/(1000u*panes));
+        if (pane_samples < 1)
+        {
+            pane_samples = 1;
+        }
+        if (pane_samples*panes > FEATURES_MAX_SAMPLES)
+        {
+            pane_samples = FEATURES_MAX_SAMPLES/panes;
+        }
+
+        features->pane_count = panes;
+        features->pane_samples = (uint16_t)pane_samples;
+        features->hysteresis = hysteresis_mg;
+        features->current = 0;
+        features->filled = 0;
+        features->complete = 0;
+        features->ready = 0;
+        features->primed = 0;
+        Features_ClearPane(&features->panes[0]);
+    }
+
+    uint8_t Features_Add(Features* features, const int16_t (*samples)[3], uint8_t count)
+    {
+        if (features->ready)
+        {
+            //Summary not taken: the window slides on without it
+            Features_NextPane(features);
+        }
+        if (!features->primed && count > 0)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                features->level[axis] = samples[0][axis];
+                features->side[axis] = 0;
+            }
+            features->primed = 1;
+        }
+
+        Features_Pane* pane = &features->panes[features->current];
+        uint8_t n = 0;
+        while (n < count)
+        {
+            const int16_t* sample = samples[n++];
+            uint32_t magnitude = 0;
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                int32_t x = sample[axis];
+                pane->sum[axis] += x;
+                pane->sum_squares[axis] += (uint32_t)(x*x);
+                if (x < pane->min[axis])
+                {
+                    pane->min[axis] = (int16_t)x;
+                }
+                if (x > pane->max[axis])
+                {
+                    pane->max[axis] = (int16_t)x;
+                }
+                magnitude += (uint32_t)(x < 0 ? -x : x);
+
+                //Side of the level, unchanged inside the dead band
+                int8_t side = features->side[axis];
+                if (x > features->level[axis] + features->hysteresis)
+                {
+                    side = 1;
+                }
+                else if (x < features->level[axis] - features->hysteresis)
+                {
+                    side = -1;
+                }
+                if (features->side[axis] != 0 && side != features->side[axis])
+                {
+                    pane->crossings[axis]++;
+                }
+                features->side[axis] = side;
+            }
+            pane->sum_magnitude += magnitude;
+
+            if (++features->filled == features->pane_samples)
+            {
+                if (features->complete < features->pane_count)
+                {
+                    features->complete++;
+                }
+                if (features->complete == features->pane_count)
+                {
+                    features->ready = 1;
+                    break;
+                }
+                Features_NextPane(features);
+                pane = &features->panes[features->current];
+            }
+        }
+        return n;
+    }
+
+    uint8_t Features_IsReady(const Features* features)
+    {
+        return features->ready;
+    }
+
+    //floor(numerator / denominator + 1/2)
+    static int64_t Features_DivRound(int64_t numerator, uint64_t denominator)
+    {
+        int64_t twice = 2*numerator + (int64_t)denominator;
+        if (twice >= 0)
+        {
+            return (int64_t)((uint64_t)twice/(2*denominator));
+        }
+        return -(int64_t)(((uint64_t)-twice + 2*denominator - 1)/(2*denominator));
+    }
+
+    //floor(sqrt(value)), bit by bit
+    static uint16_t Features_Sqrt(uint32_t value)
+    {
+        uint32_t root = 0;
+        uint32_t bit = 1uL << 30;
+        while (bit > value)
+        {
+            bit >>= 2;
+        }
+        while (bit != 0)
+        {
+            if (value >= root + bit)
+            {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint16_t)root;
+    }
+
+    static uint8_t* Features_Put16(uint8_t* p, uint16_t value)
+    {
+        p[0] = (uint8_t)(value & 0xFF);
+        p[1] = (uint8_t)(value >> 8);
+        return p + 2;
+    }
+
+    static uint8_t* Features_Put32(uint8_t* p, uint32_t value)
+    {
+        p = Features_Put16(p, (uint16_t)(value & 0xFFFF));
+        return Features_Put16(p, (uint16_t)(value >> 16));
+    }
+
+    uint8_t Features_Report(Features* features, uint8_t config, uint8_t* payload)
+    {
+        uint32_t n = (uint32_t)features->pane_count*features->pane_samples;
+        uint64_t sum_magnitude = 0;
+        uint8_t* p = payload;
+
+        *p++ = config;
+        p = Features_Put16(p, (uint16_t)n);
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int64_t sum = 0;
+            uint64_t sum_squares = 0;
+            int16_t min = 32767;
+            int16_t max = -32768;
+            uint32_t crossings = 0;
+            for (uint8_t i = 0; i < features->pane_count; i++)
+            {
+                const Features_Pane* pane = &features->panes[i];
+                sum += pane->sum[axis];
+                sum_squares += pane->sum_squares[axis];
+                min = pane->min[axis] < min ? pane->min[axis] : min;
+                max = pane->max[axis] > max ? pane->max[axis] : max;
+                crossings += pane->crossings[axis];
+            }
+
+            //n sum(x^2) - sum^2 >= 0, below 2^63 for 65535 samples of 16 bits
+            int16_t mean = (int16_t)Features_DivRound(sum, n);
+            uint64_t magnitude = (uint64_t)(sum < 0 ? -sum : sum);
+            uint64_t spread = n*sum_squares - magnitude*magnitude;
+            uint64_t n2 = (uint64_t)n*n;
+            uint32_t variance = (uint32_t)((spread + n2/2)/n2);
+
+            p = Features_Put16(p, (uint16_t)mean);
+            p = Features_Put32(p, variance);
+            p = Features_Put16(p, Features_Sqrt((uint32_t)(sum_squares/n)));
+            p = Features_Put16(p, (uint16_t)(max - min));
+            p = Features_Put16(p, (uint16_t)(crossings > 0xFFFF ? 0xFFFF : crossings));
+            features->level[axis] = mean;
+        }
+        for (uint8_t i = 0; i < features->pane_count; i++)
+        {
+            sum_magnitude += features->panes[i].sum_magnitude;
+        }
+        p = Features_Put32(p, (uint32_t)Features_DivRound((int64_t)sum_magnitude, n));
+
+        Features_NextPane(features);
+        return FEATURES_REPORT_SIZE;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,133 @@
+/**
+*   \file Features.h
+*   \brief Windowed statistics of the samples: mean, variance, RMS, peak-to-peak,
+*          mean crossings and signal magnitude area.
+*
+*   The stream is cut into panes of Features.pane_samples samples; a
+*   window is made of the last Features.panes panes and a summary is
+*   ready whenever a pane completes the window: tumbling windows with one
+*   pane, sliding windows advancing by window / panes with more. Every
+*   pane keeps exact integer accumulators (sum, sum of squares, minimum,
+*   maximum, crossings, sum of |x| + |y| + |z|), merged when a summary is
+*   written, so that the samples are not stored and a sliding window
+*   costs no more per sample than a tumbling one.
+*
+*   The statistics are defined on the integer samples in mg, n samples
+*   per window, rounding half up:
+*
+*       mean            round(sum / n)
+*       variance        round((n sum(x^2) - sum^2) / n^2)   (population, mg^2)
+*       rms             floor(sqrt(floor(sum(x^2) / n)))
+*       peak-to-peak    max - min
+*       crossings       samples at which the axis has passed from one side
+*                       of the level to the other, with a dead band of
+*                       +-hysteresis mg; the level is the mean of the last
+*                       summary (the first sample to start with)
+*       sma             round(sum(|x| + |y| + |z|) / n)
+*
+*   These are exact (the sums are those a Welford update would track,
+*   without its rounding), so a receiver can check them bit for bit.
+*
+*   Summary payload (FRAME_TYPE_FEATURES, little-endian), written by
+*   Features_Report():
+*
+*       offset  size  field
+*       0       1     configuration byte of the sensor (see FRAME_CONFIG)
+*       1       2     samples in the window n
+*       3       12    x: mean (int16), variance (uint32), rms (uint16),
+*                     peak-to-peak (uint16), crossings (uint16)
+*       15      12    y, as x
+*       27      12    z, as x
+*       39      4     sma (uint32)
+*/
+#ifndef FEATURES_H
+    #define FEATURES_H
+
+    #include "cytypes.h"
+
+    /** \brief Longest window [ms]. */
+    #ifndef FEATURES_WINDOW_MS
+        #define FEATURES_WINDOW_MS 1000u
+    #endif
+
+    /** \brief Panes per window: 1 for tumbling windows, more to slide by a pane. */
+    #ifndef FEATURES_PANES
+        #define FEATURES_PANES 1u
+    #endif
+
+    /** \brief Dead band of the crossing count [mg] around the level. */
+    #ifndef FEATURES_HYSTERESIS_MG
+        #define FEATURES_HYSTERESIS_MG 16u
+    #endif
+
+    /** \brief Most panes a window can be made of. */
+    #define FEATURES_MAX_PANES 8
+
+    /** \brief Bytes of the FRAME_TYPE_FEATURES payload. */
+    #define FEATURES_REPORT_SIZE 43
+
+    /**
+    *   \brief Accumulators of a pane, per axis where indexed.
+    */
+    typedef struct {
+        int64_t sum[3];
+        uint64_t sum_squares[3];
+        int16_t min[3];
+        int16_t max[3];
+        uint16_t crossings[3];
+        uint64_t sum_magnitude;         ///< Sum of |x| + |y| + |z|
+    } Features_Pane;
+
+    /**
+    *   \brief Window state.
+    */
+    typedef struct {
+        Features_Pane panes[FEATURES_MAX_PANES];
+        uint8_t pane_count;             ///< Panes per window
+        uint16_t pane_samples;          ///< Samples per pane
+        uint16_t hysteresis;            ///< Dead band of the crossings [mg]
+        uint8_t current;                ///< Pane being filled
+        uint16_t filled;                ///< Samples in the current pane
+        uint8_t complete;               ///< Complete panes, up to pane_count
+        uint8_t ready;                  ///< The last pane has completed a window
+        uint8_t primed;                 ///< Level and side initialized from a sample
+        int16_t level[3];               ///< Crossing level: mean of the last summary
+        int8_t side[3];                 ///< +1 above, -1 below the level, 0 not known yet
+    } Features;
+
+    /**
+    *   \brief Size the panes for an ODR and start from an empty window.
+    *
+    *   The window is window_ms at odr_hz rounded to a whole number of
+    *   panes of one sample at least, 65535 samples at most.
+    *   \param panes 1 to FEATURES_MAX_PANES.
+    */
+    void Features_Configure(Features* features, uint32_t odr_hz, uint16_t window_ms,
+                            uint8_t panes, uint16_t hysteresis_mg);
+
+    /**
+    *   \brief Accumulate samples up to the end of the next pane.
+    *
+    *   \param samples x, y, z in mg, oldest first.
+    *   \param count Number of samples.
+    *   \retval Samples consumed: call again with the rest after checking
+    *           Features_IsReady().
+    */
+    uint8_t Features_Add(Features* features, const int16_t (*samples)[3], uint8_t count);
+
+    /**
+    *   \brief Non-zero if a window has just been completed by the last Features_Add().
+    */
+    uint8_t Features_IsReady(const Features* features);
+
+    /**
+    *   \brief Write the summary of the completed window and start the next pane.
+    *
+    *   \param config Configuration byte of the sensor (see FRAME_CONFIG).
+    *   \param payload Destination, FEATURES_REPORT_SIZE bytes.
+    *   \retval FEATURES_REPORT_SIZE.
+    */
+    uint8_t Features_Report(Features* features, uint8_t config, uint8_t* payload);
+
+#endif // FEATURES_H
+/* [] END OF FILE */
@@ -0,0 +1,213 @@
+/*
+* This file includes the source code of the filtering and decimation
+* of the samples.
+*/
+#include "Filter.h"
+
+//Q30 fixed point of the coefficients
+#define FILTER_ONE (1L << 30)
+
+//Quality factors of the Butterworth sections of order 2, 4, 6, 8, lowest first
+static const double section_q[4][4] = {
+    { 0.70710678 },
+    { 0.54119610, 1.30656296 },
+    { 0.51763809, 0.70710678, 1.93185165 },
+    { 0.50979558, 0.60134489, 0.89997622, 2.56291545 }
+};
+
+    /*
+    * tan(x) for 0 <= x < pi/2 by Lambert's continued fraction: the designs
+    * run once per configuration and the device links no libm
+    */
+    static double Filter_Tan(double x)
+    {
+        double x2 = x*x;
+        double fraction = 23.0;
+        for (int term = 21; term >= 1; term -= 2)
+        {
+            fraction = term - x2/fraction;
+        }
+        return x/fraction;
+    }
+
+    static int32_t Filter_Q30(double value)
+    {
+        return (int32_t)(value*FILTER_ONE + (value < 0 ? -0.5 : 0.5));
+    }
+
+    /*
+    * Butterworth sections of a low-pass (highpass = 0) or high-pass at cutoff_mhz,
+    * bilinear transform with the cutoff pre-warped. Returns the order
+    * designed, 0 if the stage is left out
+    */
+    static uint8_t Filter_AddStage(Filter* filter, uint32_t odr_hz, uint32_t cutoff_mhz,
+                                   uint8_t order, uint8_t highpass)
+    {
+        //No cutoff, or too close to Nyquist for the bilinear transform to be worth it
+        if (cutoff_mhz == 0 || order < 2 || order > 8 ||
+            20ull*cutoff_mhz >= 9000ull*odr_hz)
+        {
+            return 0;
+        }
+        double k = Filter_Tan(3.14159265358979*cutoff_mhz/(1000.0*odr_hz));
+        const double* q = section_q[order/2 - 1];
+        for (uint8_t i = 0; i < order/2; i++)
+        {
+            Filter_Section* section = &filter->sections[filter->section_count++];
+            double norm = 1.0/(1.0 + k/q[i] + k*k);
+            section->a1 = Filter_Q30(2.0*(k*k - 1.0)*norm);
+            section->a2 = Filter_Q30((1.0 - k/q[i] + k*k)*norm);
+            if (highpass)
+            {
+                //b0 - 2 b0 + b2 = 0: no DC at all
+                section->b0 = Filter_Q30(norm);
+                section->b1 = -2*section->b0;
+                section->dc_gain = 0;
+            }
+            else
+            {
+                //b0 + b1 + b2 = 1 + a1 + a2: exactly unity DC gain, whatever the rounding
+                section->b0 = Filter_Q30(k*k*norm);
+                section->b1 = FILTER_ONE + section->a1 + section->a2 - 2*section->b0;
+                section->dc_gain = 1;
+            }
+            section->b2 = section->b0;
+        }
+        return order;
+    }
+
+    void Filter_Configure(Filter* filter, uint32_t odr_hz)
+    {
+        filter->section_count = 0;
+        filter->phase = 0;
+        filter->primed = 0;
+
+        uint32_t decimation = 1;
+        if (FILTER_OUTPUT_HZ > 0 && odr_hz > FILTER_OUTPUT_HZ)
+        {
+            decimation = odr_hz/FILTER_OUTPUT_HZ;
+        }
+        filter->decimation = (uint8_t)(decimation > 0xFF ? 0xFF : decimation);
+
+        //Below the Nyquist frequency of the output: what is left would alias
+        uint32_t lowpass = FILTER_LOWPASS_MHZ;
+        if (filter->decimation > 1)
+        {
+            uint32_t antialias = (uint32_t)(10ull*FILTER_ANTIALIAS_PERCENT*odr_hz/filter->decimation);
+            if (lowpass == 0 || lowpass > antialias)
+            {
+                lowpass = antialias;
+            }
+        }
+        filter->lowpass_order = Filter_AddStage(filter, odr_hz, lowpass, FILTER_LOWPASS_ORDER, 0);
+        filter->lowpass_mhz = filter->lowpass_order ? lowpass : 0;
+        filter->highpass_order = Filter_AddStage(filter, odr_hz, FILTER_HIGHPASS_MHZ,
+                                                 FILTER_HIGHPASS_ORDER, 1);
+        filter->highpass_mhz = filter->highpass_order ? FILTER_HIGHPASS_MHZ : 0;
+    }
+
+    uint8_t Filter_IsBypassed(const Filter* filter)
+    {
+        return filter->section_count == 0 && filter->decimation == 1;
+    }
+
+    //State of every section as if the sample had been at the input for ever
+    static void Filter_Prime(Filter* filter, const int16_t* sample)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int32_t value = (int32_t)sample[axis]*256;
+            for (uint8_t i = 0; i < filter->section_count; i++)
+            {
+                Filter_Section* section = &filter->sections[i];
+                section->x1[axis] = value;
+                section->x2[axis] = value;
+                value = section->dc_gain ? value : 0;
+                section->y1[axis] = value;
+                section->y2[axis] = value;
+                section->residue[axis] = 0;
+            }
+        }
+        filter->primed = 1;
+    }
+
+    uint8_t Filter_Process(Filter* filter, int16_t (*samples)[3], uint8_t count)
+    {
+        if (Filter_IsBypassed(filter))
+        {
+            return count;
+        }
+        if (!filter->primed && count > 0)
+        {
+            Filter_Prime(filter, samples[0]);
+        }
+
+        uint8_t out = 0;
+        for (uint8_t n = 0; n < count; n++)
+        {
+            int32_t value[3];
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                //Q8 mg through the cascade, Direct Form I
+                int32_t x = (int32_t)samples[n][axis]*256;
+                for (uint8_t i = 0; i < filter->section_count; i++)
+                {
+                    Filter_Section* section = &filter->sections[i];
+                    int64_t acc = (int64_t)section->b0*x
+                                + (int64_t)section->b1*section->x1[axis]
+                                + (int64_t)section->b2*section->x2[axis]
+                                - (int64_t)section->a1*section->y1[axis]
+                                - (int64_t)section->a2*section->y2[axis]
+                                + section->residue[axis];
+                    //The fraction dropped goes into the next output (error feedback): no dead
+                    //band around the DC level with the poles close to 1 of the high ODRs
+                    int32_t y = (int32_t)(acc >> 30);
+                    section->residue[axis] = (int32_t)(acc - ((int64_t)y << 30));
+                    section->x2[axis] = section->x1[axis];
+                    section->x1[axis] = x;
+                    section->y2[axis] = section->y1[axis];
+                    section->y1[axis] = y;
+                    x = y;
+                }
+                value[axis] = x;
+            }
+
+            //Decimation: the sample is read before any output overwrites it
+            if (filter->phase > 0)
+            {
+                filter->phase--;
+                continue;
+            }
+            filter->phase = filter->decimation - 1;
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                int32_t mg = (value[axis] + 128) >> 8;
+                samples[out][axis] = (int16_t)(mg > 32767 ? 32767 : mg < -32768 ? -32768 : mg);
+            }
+            out++;
+        }
+        return out;
+    }
+
+    static uint8_t* Filter_Put32(uint8_t* p, uint32_t value)
+    {
+        p[0] = (uint8_t)(value & 0xFF);
+        p[1] = (uint8_t)(value >> 8);
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 24);
+        return p + 4;
+    }
+
+    uint8_t Filter_Report(const Filter* filter, uint8_t config, uint8_t* payload)
+    {
+        uint8_t* p = payload;
+        *p++ = config;
+        *p++ = filter->decimation;
+        *p++ = filter->lowpass_order;
+        p = Filter_Put32(p, filter->lowpass_mhz);
+        *p++ = filter->highpass_order;
+        p = Filter_Put32(p, filter->highpass_mhz);
+        return FILTER_REPORT_SIZE;
+    }
+
+/* [] END OF FILE */
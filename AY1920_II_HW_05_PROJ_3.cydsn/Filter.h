@@ -0,0 +1,133 @@
+/**
+*   \file Filter.h
+*   \brief Low-pass / high-pass filtering and decimation of the samples, in mg.
+*
+*   A cascade of second-order sections (biquads, Direct Form I) per axis,
+*   low-pass sections first, followed by an integer decimator that keeps
+*   one sample every Filter.decimation. The decimation factor is the
+*   largest that keeps the output at FILTER_OUTPUT_HZ at least, so that a
+*   high ODR is averaged down to the rate the consumers want: the noise
+*   outside the pass band is filtered out instead of aliased, and the UART
+*   carries 1/decimation of the samples.
+*
+*   Butterworth sections are designed by Filter_Configure() for the ODR
+*   of the sensor (bilinear transform, cutoff pre-warped) and stored as
+*   Q30 coefficients; samples go through them as Q8 mg with a 64-bit
+*   accumulator and error feedback. When decimating, the low-pass cutoff
+*   is lowered to FILTER_ANTIALIAS_PERCENT of the output rate if needed.
+*   A stage whose cutoff is not below 0.45 ODR is left out.
+*
+*   The filters start from the first sample after Filter_Configure() as
+*   if it had always been there (no start-up transient). The group delay
+*   of the low-pass (about 0.3 / cutoff seconds for the 4th order) is not
+*   compensated: the samples are late by that much on their frame
+*   timestamps.
+*
+*   The filter parameters are sent in FRAME_TYPE_FILTER frames (payload
+*   written by Filter_Report()):
+*
+*       offset  size  field
+*       0       1     configuration byte of the sensor (see FRAME_CONFIG)
+*       1       1     decimation factor
+*       2       1     low-pass order (0: off)
+*       3       4     low-pass cutoff [mHz]
+*       7       1     high-pass order (0: off)
+*       8       4     high-pass cutoff [mHz]
+*/
+#ifndef FILTER_H
+    #define FILTER_H
+
+    #include "cytypes.h"
+
+    /** \brief Low-pass cutoff [mHz], 0 for none (decimation still adds one). */
+    #ifndef FILTER_LOWPASS_MHZ
+        #define FILTER_LOWPASS_MHZ 20000u
+    #endif
+
+    /** \brief Order of the low-pass Butterworth: 2, 4, 6 or 8. */
+    #ifndef FILTER_LOWPASS_ORDER
+        #define FILTER_LOWPASS_ORDER 4
+    #endif
+
+    /** \brief High-pass cutoff [mHz] (e.g. 500 to remove gravity), 0 for none. */
+    #ifndef FILTER_HIGHPASS_MHZ
+        #define FILTER_HIGHPASS_MHZ 0u
+    #endif
+
+    /** \brief Order of the high-pass Butterworth: 2, 4, 6 or 8. */
+    #ifndef FILTER_HIGHPASS_ORDER
+        #define FILTER_HIGHPASS_ORDER 2
+    #endif
+
+    /** \brief Lowest output rate [Hz] the decimation may bring the ODR down to, 0 for none. */
+    #ifndef FILTER_OUTPUT_HZ
+        #define FILTER_OUTPUT_HZ 50u
+    #endif
+
+    /** \brief Highest low-pass cutoff when decimating, in percent of the output rate. */
+    #define FILTER_ANTIALIAS_PERCENT 40u
+
+    #define FILTER_MAX_SECTIONS ((FILTER_LOWPASS_ORDER + FILTER_HIGHPASS_ORDER)/2)
+
+    /** \brief Bytes of the FRAME_TYPE_FILTER payload. */
+    #define FILTER_REPORT_SIZE 12
+
+    /**
+    *   \brief Second-order section: coefficients (Q30, a0 = 1) and per-axis state (Q8 mg).
+    */
+    typedef struct {
+        int32_t b0, b1, b2, a1, a2;
+        int32_t x1[3], x2[3];           ///< Last two inputs
+        int32_t y1[3], y2[3];           ///< Last two outputs
+        int32_t residue[3];             ///< Fraction of the last output below Q8 (Q30)
+        uint8_t dc_gain;                ///< 1 for low-pass, 0 for high-pass sections
+    } Filter_Section;
+
+    /**
+    *   \brief Filter chain of one configuration.
+    */
+    typedef struct {
+        Filter_Section sections[FILTER_MAX_SECTIONS];
+        uint8_t section_count;          ///< Sections in use, low-pass first
+        uint8_t lowpass_order;          ///< 0 if the low-pass is left out
+        uint32_t lowpass_mhz;
+        uint8_t highpass_order;         ///< 0 if the high-pass is left out
+        uint32_t highpass_mhz;
+        uint8_t decimation;             ///< One output sample every decimation input samples
+        uint8_t phase;                  ///< Input samples to skip before the next output
+        uint8_t primed;                 ///< State initialized from a sample
+    } Filter;
+
+    /**
+    *   \brief Design the sections and the decimation for an ODR and clear the state.
+    *
+    *   \param odr_hz Output data rate of the sensor [Hz].
+    */
+    void Filter_Configure(Filter* filter, uint32_t odr_hz);
+
+    /**
+    *   \brief Non-zero if Filter_Process() returns its input unchanged.
+    */
+    uint8_t Filter_IsBypassed(const Filter* filter);
+
+    /**
+    *   \brief Filter and decimate a batch in place.
+    *
+    *   \param samples x, y, z in mg, oldest first; the first return value
+    *                  entries receive the output samples.
+    *   \param count Number of input samples.
+    *   \retval Number of output samples, 0 if the decimator keeps none of the batch.
+    */
+    uint8_t Filter_Process(Filter* filter, int16_t (*samples)[3], uint8_t count);
+
+    /**
+    *   \brief Write the FRAME_TYPE_FILTER payload.
+    *
+    *   \param config Configuration byte of the sensor (see FRAME_CONFIG).
+    *   \param payload Destination, FILTER_REPORT_SIZE bytes.
+    *   \retval FILTER_REPORT_SIZE.
+    */
+    uint8_t Filter_Report(const Filter* filter, uint8_t config, uint8_t* payload);
+
+#endif // FILTER_H
+/* [] END OF FILE */
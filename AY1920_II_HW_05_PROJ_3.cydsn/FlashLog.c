@@ -0,0 +1,271 @@
+/*
+* This file includes the source code of the ring log of the output frames
+* in the emulated EEPROM.
+*/
+#include "FlashLog.h"
+#include "Frame.h"
+#include "UART_Stream.h"
+#include "cy_em_eeprom.h"
+
+#if (FLASH_LOG_SIZE % FLASH_LOG_PAGE_SIZE) != 0 || FLASH_LOG_SIZE < 2 * FLASH_LOG_PAGE_SIZE
+    #error "FLASH_LOG_SIZE must be a multiple of FLASH_LOG_PAGE_SIZE, two pages at least"
+#endif
+
+// Page header fields
+#define PAGE_MAGIC 0
+#define PAGE_USED 1
+#define PAGE_FIRST 2
+#define PAGE_SEQUENCE 4
+
+// Flash area of the emulated EEPROM, blank in a new image; the ring levels the wear itself
+static const uint8_t log_storage[CY_EM_EEPROM_GET_PHYSICAL_SIZE(FLASH_LOG_SIZE, 1u, 0u)]
+    __attribute__((aligned(CY_EM_EEPROM_FLASH_SIZEOF_ROW))) = { 0u };
+
+// Blocking writes: the main loop waits for the row, the page in SRAM can be reused at once
+static cy_stc_eeprom_config_t eeprom_config = {
+    .eepromSize = FLASH_LOG_SIZE,
+    .wearLevelingFactor = 1u,
+    .redundantCopy = 0u,
+    .blockingWrite = 1u,
+};
+static cy_stc_eeprom_context_t eeprom_context;
+static uint8_t started = 0;
+
+// Pages in SRAM: the one being filled, after the full ones waiting for their write
+static uint8_t pages[FLASH_LOG_QUEUE_PAGES][FLASH_LOG_PAGE_SIZE];
+static uint8_t fill_index = 0;
+static uint8_t queued = 0;
+
+// Sequence number of the page being filled
+static uint32_t fill_sequence = 0;
+
+// Next page of the dump, and the last one
+static uint8_t dumping = 0;
+static uint32_t dump_sequence = 0;
+static uint32_t dump_end = 0;
+
+// Page read back from flash for the dump, and its frame
+static uint8_t dump_page[FLASH_LOG_PAGE_SIZE];
+static uint8_t dump_frame[FRAME_HEADER_SIZE + FRAME_LOG_HEADER_SIZE + FLASH_LOG_DATA_SIZE + FRAME_CRC_SIZE];
+
+static FlashLog_Stats log_stats;
+
+    static uint32_t PageSequence(const uint8_t* page)
+    {
+        return (uint32_t)page[PAGE_SEQUENCE] | ((uint32_t)page[PAGE_SEQUENCE + 1] << 8) |
+               ((uint32_t)page[PAGE_SEQUENCE + 2] << 16) | ((uint32_t)page[PAGE_SEQUENCE + 3] << 24);
+    }
+
+    // Empty page with the given sequence number
+    static void PageReset(uint8_t* page, uint32_t sequence)
+    {
+        page[PAGE_MAGIC] = FLASH_LOG_MAGIC;
+        page[PAGE_USED] = 0;
+        page[PAGE_FIRST] = FLASH_LOG_NO_FRAME;
+        page[3] = 0;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            page[PAGE_SEQUENCE + i] = (uint8_t)(sequence >> (8 * i));
+        }
+    }
+
+    // Oldest of the full pages waiting for FlashLog_Poll()
+    static uint8_t* QueuedPage(uint8_t age)
+    {
+        return pages[(fill_index + FLASH_LOG_QUEUE_PAGES - queued + age) % FLASH_LOG_QUEUE_PAGES];
+    }
+
+    // Full page queued for FlashLog_Poll(), or lost if the queue is full
+    static void PageDone(void)
+    {
+        if (queued == FLASH_LOG_QUEUE_PAGES - 1)
+        {
+            log_stats.bytes_lost += pages[fill_index][PAGE_USED];
+        }
+        else
+        {
+            queued++;
+            fill_index = (fill_index + 1) % FLASH_LOG_QUEUE_PAGES;
+        }
+        // A lost page still takes its number: the host sees the gap
+        fill_sequence++;
+        PageReset(pages[fill_index], fill_sequence);
+    }
+
+    ErrorCode FlashLog_Start(void)
+    {
+        uint8_t header[FLASH_LOG_HEADER_SIZE];
+        uint8_t found = 0;
+        uint32_t newest = 0;
+
+        eeprom_config.userFlashStartAddr = (uint32)(uintptr_t)log_storage;
+        started = Cy_Em_EEPROM_Init(&eeprom_config, &eeprom_context) == CY_EM_EEPROM_SUCCESS;
+        for (uint32_t page = 0; started && page < FLASH_LOG_PAGES; page++)
+        {
+            // Blank or torn pages do not carry the magic and the sequence number of their place
+            if (Cy_Em_EEPROM_Read(page * FLASH_LOG_PAGE_SIZE, header, FLASH_LOG_HEADER_SIZE,
+                                  &eeprom_context) == CY_EM_EEPROM_SUCCESS &&
+                header[PAGE_MAGIC] == FLASH_LOG_MAGIC && PageSequence(header) % FLASH_LOG_PAGES == page &&
+                (!found || PageSequence(header) > newest))
+            {
+                newest = PageSequence(header);
+                found = 1;
+            }
+        }
+
+        // The page being filled at the reset is lost: its number is skipped, the host sees the gap
+        fill_index = 0;
+        queued = 0;
+        dumping = 0;
+        fill_sequence = found ? newest + 2 : 0;
+        PageReset(pages[fill_index], fill_sequence);
+        log_stats = (FlashLog_Stats){ 0 };
+        return started ? NO_ERROR : ERROR;
+    }
+
+    void FlashLog_Append(const uint8_t* frame, uint16_t size)
+    {
+        if (!started)
+        {
+            return;
+        }
+        log_stats.bytes_logged += size;
+
+        uint8_t* page = pages[fill_index];
+        if (page[PAGE_FIRST] == FLASH_LOG_NO_FRAME)
+        {
+            page[PAGE_FIRST] = page[PAGE_USED];
+        }
+        while (size > 0)
+        {
+            uint8_t used = page[PAGE_USED];
+            uint16_t chunk = FLASH_LOG_DATA_SIZE - used;
+            if (chunk > size)
+            {
+                chunk = size;
+            }
+            for (uint16_t i = 0; i < chunk; i++)
+            {
+                page[FLASH_LOG_HEADER_SIZE + used + i] = frame[i];
+            }
+            page[PAGE_USED] = (uint8_t)(used + chunk);
+            frame += chunk;
+            size -= chunk;
+
+            if (page[PAGE_USED] == FLASH_LOG_DATA_SIZE)
+            {
+                PageDone();
+                page = pages[fill_index];
+            }
+        }
+    }
+
+    uint8_t FlashLog_IsPending(void)
+    {
+        return queued > 0;
+    }
+
+    ErrorCode FlashLog_Poll(void)
+    {
+        if (queued == 0)
+        {
+            return NO_ERROR;
+        }
+        uint8_t* page = QueuedPage(0);
+        uint32_t address = (PageSequence(page) % FLASH_LOG_PAGES) * FLASH_LOG_PAGE_SIZE;
+
+        queued--;
+        if (Cy_Em_EEPROM_Write(address, page, FLASH_LOG_PAGE_SIZE, &eeprom_context) != CY_EM_EEPROM_SUCCESS)
+        {
+            log_stats.write_errors++;
+            return ERROR;
+        }
+        log_stats.pages_written++;
+        return NO_ERROR;
+    }
+
+    void FlashLog_StartDump(void)
+    {
+        // Every page the ring can hold, up to the one being filled
+        dumping = started;
+        dump_end = fill_sequence;
+        dump_sequence = fill_sequence > FLASH_LOG_PAGES ? fill_sequence - FLASH_LOG_PAGES : 0;
+    }
+
+    uint8_t FlashLog_IsDumping(void)
+    {
+        return dumping;
+    }
+
+    // Page with the given sequence number, in SRAM or in flash; NULL if overwritten or empty
+    static const uint8_t* FindPage(uint32_t sequence)
+    {
+        const uint8_t* page = dump_page;
+
+        if (sequence == fill_sequence)
+        {
+            return pages[fill_index][PAGE_USED] > 0 ? pages[fill_index] : NULL;
+        }
+        for (uint8_t age = 0; age < queued; age++)
+        {
+            if (PageSequence(QueuedPage(age)) == sequence)
+            {
+                return QueuedPage(age);
+            }
+        }
+        if (Cy_Em_EEPROM_Read((sequence % FLASH_LOG_PAGES) * FLASH_LOG_PAGE_SIZE, dump_page,
+                                   FLASH_LOG_PAGE_SIZE, &eeprom_context) != CY_EM_EEPROM_SUCCESS ||
+                 dump_page[PAGE_MAGIC] != FLASH_LOG_MAGIC || PageSequence(dump_page) != sequence)
+        {
+            return NULL;
+        }
+        return page;
+    }
+
+    ErrorCode FlashLog_DumpNext(uint32_t timestamp)
+    {
+        uint8_t payload[FRAME_LOG_HEADER_SIZE + FLASH_LOG_DATA_SIZE];
+        const uint8_t* page = NULL;
+
+        while (dumping && page == NULL)
+        {
+            page = FindPage(dump_sequence);
+            if (page == NULL)
+            {
+                dumping = dump_sequence++ != dump_end;
+            }
+        }
+        if (page == NULL)
+        {
+            return NO_ERROR;
+        }
+
+        // Page sequence number and first frame, then the frames
+        uint8_t used = page[PAGE_USED];
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            payload[i] = page[PAGE_SEQUENCE + i];
+        }
+        payload[4] = page[PAGE_FIRST];
+        for (uint8_t i = 0; i < used; i++)
+        {
+            payload[FRAME_LOG_HEADER_SIZE + i] = page[FLASH_LOG_HEADER_SIZE + i];
+        }
+        // Outside the numbering of the stream and of Frame_Send(): the page is not logged again
+        uint16_t size = Frame_Encode(dump_frame, FRAME_TYPE_LOG, (uint16_t)dump_sequence, timestamp,
+                                     payload, FRAME_LOG_HEADER_SIZE + used);
+        if (UART_Stream_Write(dump_frame, size) != NO_ERROR)
+        {
+            return ERROR;
+        }
+        log_stats.pages_dumped++;
+        dumping = dump_sequence++ != dump_end;
+        return NO_ERROR;
+    }
+
+    void FlashLog_GetStats(FlashLog_Stats* stats)
+    {
+        *stats = log_stats;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,150 @@
+/**
+*   \file FlashLog.h
+*   \brief Ring log of the output frames in flash, through the Em_EEPROM middleware.
+*
+*   Frames are appended to a page in SRAM; a full page is queued and
+*   written to the emulated EEPROM as one Em_EEPROM block (half a flash
+*   row) from the main loop, while the next page fills. Page n goes to
+*   block n modulo FLASH_LOG_PAGES, so the ring itself spreads the
+*   erases over every row of the area and the middleware needs no
+*   wear-levelling rows of its own: the flash holds FLASH_LOG_SIZE bytes
+*   of log, the newest pages overwriting the oldest. A row is erased once
+*   per FLASH_LOG_PAGES * FLASH_LOG_DATA_SIZE bytes of frames, so at the
+*   100k cycles of the flash the log takes about 3 GB of stream in its
+*   default size, in proportion to FLASH_LOG_SIZE. Each page starts
+*   with a header:
+*
+*       offset  size  field
+*       0       1     FLASH_LOG_MAGIC
+*       1       1     bytes of frames in the page
+*       2       1     offset of the first frame starting in the page, 0xFF for none
+*       3       1     reserved (0)
+*       4       4     page sequence number, +1 for every page
+*
+*   At start the headers are scanned for the highest sequence number and
+*   the log goes on after it, so no other state is written; the number of
+*   the page lost in SRAM by the reset is skipped. Frames are
+*   logged whole, as sent on the UART (see Frame.h), and may straddle two
+*   pages. A page filled while the queue is full of pages waiting for
+*   their flash write is lost, and counted; the pages in SRAM are lost on
+*   a reset.
+*
+*   On a FRAME_TYPE_LOG_DUMP command the pages are sent back oldest first
+*   in FRAME_TYPE_LOG frames, the one being filled last. The host decodes
+*   the frames in them as a stream, resynchronising on the first frame of
+*   a page after a gap in the page sequence numbers.
+*
+*   Not safe from interrupts: frames, page writes and the dump all belong
+*   to the main loop.
+*/
+#ifndef FLASH_LOG_H
+    #define FLASH_LOG_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    /**
+    *   \brief Bytes of log in the emulated EEPROM, a multiple of FLASH_LOG_PAGE_SIZE.
+    *
+    *   Takes twice as many bytes of flash: each Em_EEPROM block fills a row.
+    */
+    #ifndef FLASH_LOG_SIZE
+        #define FLASH_LOG_SIZE 32768u
+    #endif
+
+    /**
+    *   \brief Pages in SRAM: the one being filled and the full ones waiting for their write.
+    *
+    *   A pass of the main loop can fill more than one page (a status frame
+    *   and a batch), FlashLog_Poll() writes one.
+    */
+    #ifndef FLASH_LOG_QUEUE_PAGES
+        #define FLASH_LOG_QUEUE_PAGES 4
+    #endif
+
+    /** \brief Bytes of a page: one Em_EEPROM block, half a flash row. */
+    #define FLASH_LOG_PAGE_SIZE 128u
+
+    /** \brief Bytes of the page header. */
+    #define FLASH_LOG_HEADER_SIZE 8u
+
+    /** \brief Bytes of frames in a page. */
+    #define FLASH_LOG_DATA_SIZE (FLASH_LOG_PAGE_SIZE - FLASH_LOG_HEADER_SIZE)
+
+    /** \brief Pages in the ring. */
+    #define FLASH_LOG_PAGES (FLASH_LOG_SIZE / FLASH_LOG_PAGE_SIZE)
+
+    /** \brief First byte of a written page. */
+    #define FLASH_LOG_MAGIC 0x4C
+
+    /** \brief Offset of the first frame of a page that has no frame starting in it. */
+    #define FLASH_LOG_NO_FRAME 0xFF
+
+    /**
+    *   \brief Counters since FlashLog_Start().
+    */
+    typedef struct {
+        uint32_t bytes_logged;          ///< Frame bytes appended
+        uint32_t bytes_lost;            ///< Frame bytes of the pages lost with the queue full
+        uint32_t pages_written;         ///< Pages written to the emulated EEPROM
+        uint32_t write_errors;          ///< Page writes refused by the middleware
+        uint32_t pages_dumped;          ///< FRAME_TYPE_LOG frames sent
+    } FlashLog_Stats;
+
+    /**
+    *   \brief Set up the emulated EEPROM and resume the log after its newest page.
+    *
+    *   \retval ERROR if the middleware refuses the configuration: nothing is logged.
+    */
+    ErrorCode FlashLog_Start(void);
+
+    /**
+    *   \brief Log one whole frame.
+    *
+    *   Only copies into the page in SRAM; a full page waits for FlashLog_Poll().
+    */
+    void FlashLog_Append(const uint8_t* frame, uint16_t size);
+
+    /**
+    *   \brief Check if full pages wait for their flash write.
+    */
+    uint8_t FlashLog_IsPending(void);
+
+    /**
+    *   \brief Write the oldest full page, if any.
+    *
+    *   Blocks for the erase and program of a flash row, so it is better
+    *   called with the I2C bus idle.
+    *   \retval ERROR if the middleware has failed to write it.
+    */
+    ErrorCode FlashLog_Poll(void);
+
+    /**
+    *   \brief Start sending the log back, from the oldest page to the one being filled.
+    */
+    void FlashLog_StartDump(void);
+
+    /**
+    *   \brief Check if pages are still to be sent by FlashLog_DumpNext().
+    */
+    uint8_t FlashLog_IsDumping(void);
+
+    /**
+    *   \brief Send the next page of the dump in a FRAME_TYPE_LOG frame.
+    *
+    *   Pages overwritten since FlashLog_StartDump() are skipped. The frame
+    *   goes straight to UART_Stream, outside the numbering of Frame_Send()
+    *   and its tap; a page dropped by UART_Stream is tried again on the
+    *   next call.
+    *   \param timestamp Timestamp of the frame [us].
+    *   \retval ERROR if the frame has been dropped.
+    */
+    ErrorCode FlashLog_DumpNext(uint32_t timestamp);
+
+    /**
+    *   \brief Read the counters.
+    */
+    void FlashLog_GetStats(FlashLog_Stats* stats);
+
+#endif // FLASH_LOG_H
+/* [] END OF FILE */
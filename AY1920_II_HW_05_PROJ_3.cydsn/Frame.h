@@ -0,0 +1,173 @@
+/**
+*   \file Frame.h
+*   \brief Batched binary frames sent over UART_Debug.
+*
+*   Wire format (multi-byte fields little-endian):
+*
+*       offset  size  field
+*       0       2     sync, 0xA5 0x5A
+*       2       1     type (Frame_Type)
+*       3       1     payload length L
+*       4       2     sequence number, +1 for every frame of any type
+*       6       4     timestamp [us] (Timestamp_Now() of the triggering event)
+*       10      L     payload
+*       10+L    2     CRC-16/CCITT-FALSE of bytes 2 .. 10+L-1
+*
+*   A gap in the sequence numbers means frames were dropped; a CRC
+*   mismatch means the frame was corrupted and the receiver resyncs on
+*   the next sync pattern.
+*
+*   Samples payload (FRAME_TYPE_SAMPLES): one configuration byte
+*   (CTRL_REG1[7:4] ODR in bits 7:4, mode in bits 3:2 as Frame_Mode,
+*   CTRL_REG4 FS in bits 1:0) followed by N samples of three int16 in mg
+*   (x, y, z), oldest first.
+*
+*   Compressed payloads (FRAME_TYPE_DELTA_KEY, FRAME_TYPE_DELTA) carry the
+*   same samples as per-axis differences, see DeltaCodec.h.
+*
+*   Samples are filtered and decimated before framing as described by the
+*   last FRAME_TYPE_FILTER frame (see Filter.h): the ODR in the
+*   configuration byte is the sensor's, the samples come at ODR divided
+*   by the decimation factor.
+*
+*   With several sensors on the bus (see BusManager.h) the frames of a
+*   sensor are preceded by a FRAME_TYPE_DEVICE frame whenever the stream
+*   switches to it, and after every frame dropped by the device: device
+*   ID (uint8) and 7-bit I2C address (uint8). The frames that follow, up
+*   to the next device frame, come from that sensor; after a sequence gap
+*   the receiver cannot tell until the next one.
+*
+*   Once the stream runs the device sends one FRAME_TYPE_BOOT frame with
+*   the times [us] at which the boot phases of Boot.h were reached,
+*   uint32 each in Boot_Phase order (0xFFFFFFFF: not reached).
+*
+*   Clicks and free falls detected by the sensor go in FRAME_TYPE_EVENT
+*   frames stamped with their INT1 event, see Events.h.
+*
+*   Pages of the ring log kept in flash (FlashLog.h) are read back in
+*   FRAME_TYPE_LOG frames: page sequence number (uint32), offset of the
+*   first frame starting in the page (uint8, 0xFF for none), then the
+*   bytes of the frames logged in the page. They are outside the
+*   numbering of the stream: their sequence number is the low half of the
+*   page sequence number, the frames around them are numbered as if they
+*   were not there, so the frames logged during a dump stay contiguous.
+*
+*   The host sends commands in the same format on the RX line, see
+*   Command.h.
+*/
+#ifndef FRAME_H
+    #define FRAME_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    #define FRAME_SYNC_0            0xA5
+    #define FRAME_SYNC_1            0x5A
+    #define FRAME_HEADER_SIZE       10
+    #define FRAME_CRC_SIZE          2
+    #define FRAME_MAX_PAYLOAD       255
+    #define FRAME_MAX_SIZE          (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE)
+
+    /** \brief Bytes of one sample in a samples payload. */
+    #define FRAME_SAMPLE_SIZE       6
+
+    /** \brief Largest number of samples in one samples frame. */
+    #define FRAME_MAX_SAMPLES       ((FRAME_MAX_PAYLOAD - 1) / FRAME_SAMPLE_SIZE)
+
+    /** \brief Bytes of the FRAME_TYPE_DEVICE payload: device ID, I2C address. */
+    #define FRAME_DEVICE_SIZE       2
+
+    /** \brief Bytes of the FRAME_TYPE_BOOT payload: one time per boot phase. */
+    #define FRAME_BOOT_SIZE         16
+
+    /** \brief Bytes of the FRAME_TYPE_LOG payload before the logged bytes: page sequence, first offset. */
+    #define FRAME_LOG_HEADER_SIZE   5
+
+    /**
+    *   \brief Frame types.
+    */
+    typedef enum {
+        FRAME_TYPE_SAMPLES = 0x01,      ///< Configuration byte + N XYZ samples in mg
+        FRAME_TYPE_DELTA_KEY = 0x02,    ///< Compressed samples, first one sent in full
+        FRAME_TYPE_DELTA = 0x03,        ///< Compressed samples relative to the previous frame
+        FRAME_TYPE_TRACE = 0x04,        ///< Latency statistics of a stage (Trace.h)
+        FRAME_TYPE_STATUS = 0x05,       ///< Loss and error counters (StatusReport.h)
+        FRAME_TYPE_FILTER = 0x06,       ///< Filtering and decimation of the samples frames (Filter.h)
+        FRAME_TYPE_FEATURES = 0x07,     ///< Statistics of a window of samples (Features.h)
+        FRAME_TYPE_SPECTRUM = 0x08,     ///< Magnitude bins of an axis over a window (Spectrum.h)
+        FRAME_TYPE_PEAKS = 0x09,        ///< Highest spectral peaks per axis over a window (Spectrum.h)
+        FRAME_TYPE_DEVICE = 0x0A,       ///< Sensor the next frames come from (BusManager.h)
+        FRAME_TYPE_BOOT = 0x0B,         ///< Times of the boot phases (Boot.h)
+        FRAME_TYPE_EVENT = 0x0C,        ///< Click or free fall with its snapshot (Events.h)
+        FRAME_TYPE_LOG = 0x0D,          ///< Page of the ring log in flash (FlashLog.h)
+        FRAME_TYPE_CONFIG = 0x10,       ///< Host to device: configuration byte to switch to (Command.h)
+        FRAME_TYPE_TRACE_QUERY = 0x11,  ///< Host to device: stage to report (Command.h)
+        FRAME_TYPE_LOG_DUMP = 0x12      ///< Host to device: send the ring log back (Command.h)
+    } Frame_Type;
+
+    /**
+    *   \brief Operating modes reported in the configuration byte.
+    */
+    typedef enum {
+        FRAME_MODE_LOW_POWER = 0,       ///< 8-bit output
+        FRAME_MODE_NORMAL = 1,          ///< 10-bit output
+        FRAME_MODE_HIGH_RESOLUTION = 2  ///< 12-bit output
+    } Frame_Mode;
+
+    /**
+    *   \brief Observer of the frames sent with Frame_Send().
+    *
+    *   Called with every encoded frame, whether UART_Stream has queued it
+    *   or dropped it.
+    */
+    typedef void (*Frame_Tap)(const uint8_t* frame, uint16_t size);
+
+    /** \brief Build the configuration byte of a samples payload. */
+    #define FRAME_CONFIG(odr, mode, fs) ((uint8_t)(((odr) << 4) | ((mode) << 2) | (fs)))
+
+    /**
+    *   \brief Update a CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+    *
+    *   \param crc CRC of the previous bytes (0xFFFF to start).
+    *   \param data Bytes to add.
+    *   \param length Number of bytes.
+    */
+    uint16_t Frame_Crc16(uint16_t crc, const uint8_t* data, uint16_t length);
+
+    /**
+    *   \brief Encode a frame into \p frame.
+    *
+    *   \param frame Destination, at least FRAME_HEADER_SIZE + length + FRAME_CRC_SIZE bytes.
+    *   \retval Size of the encoded frame in bytes.
+    */
+    uint16_t Frame_Encode(uint8_t* frame, uint8_t type, uint16_t sequence, uint32_t timestamp,
+                          const uint8_t* payload, uint8_t length);
+
+    /**
+    *   \brief Encode a frame with the next sequence number and queue it on UART_Stream.
+    *
+    *   The sequence number is consumed even if the stream drops the frame,
+    *   so that the receiver sees the gap.
+    *   \retval ERROR if the frame has been dropped.
+    */
+    ErrorCode Frame_Send(uint8_t type, uint32_t timestamp, const uint8_t* payload, uint8_t length);
+
+    /**
+    *   \brief Frame_Send() a frame of a sensor, named first by a FRAME_TYPE_DEVICE frame if needed.
+    *
+    *   The device frame goes out when the last one named another sensor
+    *   or a frame has been dropped since.
+    *   \param device Device ID of the sensor (see BusManager.h).
+    *   \param address Its 7-bit I2C address.
+    *   \retval ERROR if the device frame or the frame has been dropped.
+    */
+    ErrorCode Frame_SendFrom(uint8_t device, uint8_t address, uint8_t type, uint32_t timestamp,
+                             const uint8_t* payload, uint8_t length);
+
+    /**
+    *   \brief Hand every frame sent from now on to \p tap as well (NULL to stop).
+    */
+    void Frame_SetTap(Frame_Tap tap);
+
+#endif // FRAME_H
+/* [] END OF FILE */
@@ -8,16 +8,25 @@
 */
 #include "InterruptRoutines.h"
 #include "Timer_LISD3H.h"
-
-uint8_t flag = 0;
+#include "EventQueue.h"
+#include "Timestamp.h"
+#include "Trace.h"
 
 CY_ISR(DataReady_ISR)
 {
+    //Start of the sample path (see Trace.h)
+    uint32_t cycles = Trace_Now();
+    
+#if DATA_READY_FROM_INT1
+    //Release the pin interrupt: the next rising edge of INT1 fires again
+    Pin_INT1_ClearInterrupt();
+#else
     //Put interrupt line low
     Timer_LISD3H_ReadStatusRegister();
+#endif
     
-    flag=1;
-    
+    //Hand the event to the main loop with the time it happened
+    EventQueue_Push(Timestamp_Now(), cycles);
 }
 
 /* [] END OF FILE */
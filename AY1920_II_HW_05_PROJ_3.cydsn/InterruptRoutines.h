@@ -8,6 +8,20 @@
     
     #include "project.h"
     
+    /*Brief 1 when ISR_DataReady is driven by the LIS3DH INT1 line through
+    Pin_INT1 (rising edge), 0 when it is driven by Timer_LISD3H.
+    INT1 needs in TopDesign: a digital input pin Pin_INT1 with a rising
+    edge interrupt, its irq terminal wired to ISR_DataReady in place of the
+    Timer_LISD3H interrupt, and in the .cydwr the pin assigned to the line
+    from the LIS3DH INT1 output */
+    #ifndef DATA_READY_FROM_INT1
+        #define DATA_READY_FROM_INT1 1
+    #endif
+    
+    #if DATA_READY_FROM_INT1 && !defined(Pin_INT1__INTSTAT)
+        #error "DATA_READY_FROM_INT1 needs Pin_INT1 in TopDesign (see above), or build with DATA_READY_FROM_INT1=0"
+    #endif
+    
     CY_ISR_PROTO(DataReady_ISR);
     
 #endif
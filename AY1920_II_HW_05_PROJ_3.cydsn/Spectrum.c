@@ -0,0 +1,309 @@
+/*
+* This file includes the source code of the fixed-point spectrum of the
+* samples.
+*/
+#include "Spectrum.h"
+
+//sin(2 pi i / 512) in Q15 for i = 0 .. 128, the rest by symmetry
+static const int16_t quarter_sine[129] = {
+    0, 402, 804, 1206, 1608, 2009, 2411, 2811,
+    3212, 3612, 4011, 4410, 4808, 5205, 5602, 5998,
+    6393, 6787, 7180, 7571, 7962, 8351, 8740, 9127,
+    9512, 9896, 10279, 10660, 11039, 11417, 11793, 12167,
+    12540, 12910, 13279, 13646, 14010, 14373, 14733, 15091,
+    15447, 15800, 16151, 16500, 16846, 17190, 17531, 17869,
+    18205, 18538, 18868, 19195, 19520, 19841, 20160, 20475,
+    20788, 21097, 21403, 21706, 22006, 22302, 22595, 22884,
+    23170, 23453, 23732, 24008, 24279, 24548, 24812, 25073,
+    25330, 25583, 25833, 26078, 26320, 26557, 26791, 27020,
+    27246, 27467, 27684, 27897, 28106, 28311, 28511, 28707,
+    28899, 29086, 29269, 29448, 29622, 29792, 29957, 30118,
+    30274, 30425, 30572, 30715, 30853, 30986, 31114, 31238,
+    31357, 31471, 31581, 31686, 31786, 31881, 31972, 32058,
+    32138, 32214, 32286, 32352, 32413, 32470, 32522, 32568,
+    32610, 32647, 32679, 32706, 32729, 32746, 32758, 32766,
+    32767
+};
+
+//log2 of the points of the sine table
+#define SPECTRUM_TABLE_BITS 9
+
+    //sin(2 pi i / 512) in Q15
+    static int32_t Spectrum_Sin(uint16_t i)
+    {
+        i &= SPECTRUM_MAX_POINTS - 1;
+        if (i <= 128)
+        {
+            return quarter_sine[i];
+        }
+        if (i <= 256)
+        {
+            return quarter_sine[256 - i];
+        }
+        if (i <= 384)
+        {
+            return -quarter_sine[i - 256];
+        }
+        return -quarter_sine[512 - i];
+    }
+
+    //cos(2 pi i / 512) in Q15
+    static int32_t Spectrum_Cos(uint16_t i)
+    {
+        return Spectrum_Sin((uint16_t)(i + 128));
+    }
+
+    void Spectrum_Configure(Spectrum* spectrum, uint16_t points)
+    {
+        uint8_t log2_points = 6;
+        while (log2_points < SPECTRUM_TABLE_BITS && (1u << (log2_points + 1)) <= points)
+        {
+            log2_points++;
+        }
+        spectrum->log2_points = log2_points;
+        spectrum->points = (uint16_t)(1u << log2_points);
+        spectrum->filled = 0;
+        spectrum->ready = 0;
+    }
+
+    uint8_t Spectrum_Add(Spectrum* spectrum, const int16_t (*samples)[3], uint8_t count)
+    {
+        if (spectrum->ready)
+        {
+            spectrum->filled = 0;
+            spectrum->ready = 0;
+        }
+        uint8_t n = 0;
+        while (n < count && spectrum->filled < spectrum->points)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                spectrum->samples[axis][spectrum->filled] = samples[n][axis];
+            }
+            spectrum->filled++;
+            n++;
+        }
+        spectrum->ready = spectrum->filled == spectrum->points;
+        return n;
+    }
+
+    uint8_t Spectrum_IsReady(const Spectrum* spectrum)
+    {
+        return spectrum->ready;
+    }
+
+    /*
+    * In-place radix-2 decimation-in-time FFT of 2^log2_size complex points
+    * (real and imaginary parts interleaved), every stage halved: Z[k] / size
+    */
+    static void Spectrum_Transform(int32_t* data, uint8_t log2_size)
+    {
+        uint16_t size = (uint16_t)(1u << log2_size);
+
+        //Bit-reversed order
+        for (uint16_t i = 1, j = 0; i < size; i++)
+        {
+            uint16_t bit = size >> 1;
+            while (j & bit)
+            {
+                j ^= bit;
+                bit >>= 1;
+            }
+            j |= bit;
+            if (i < j)
+            {
+                int32_t re = data[2*i];
+                int32_t im = data[2*i + 1];
+                data[2*i] = data[2*j];
+                data[2*i + 1] = data[2*j + 1];
+                data[2*j] = re;
+                data[2*j + 1] = im;
+            }
+        }
+
+        for (uint8_t stage = 1; stage <= log2_size; stage++)
+        {
+            uint16_t half = (uint16_t)(1u << (stage - 1));
+            for (uint16_t j = 0; j < half; j++)
+            {
+                //W = exp(-i 2 pi j / 2^stage), shared by the butterflies of the stage
+                uint16_t angle = (uint16_t)(j << (SPECTRUM_TABLE_BITS - stage));
+                int64_t c = Spectrum_Cos(angle);
+                int64_t s = Spectrum_Sin(angle);
+                for (uint16_t top = j; top < size; top += 2*half)
+                {
+                    int32_t* a = &data[2*top];
+                    int32_t* b = &data[2*(top + half)];
+                    int32_t re = (int32_t)((b[0]*c + b[1]*s + (1L << 14)) >> 15);
+                    int32_t im = (int32_t)((b[1]*c - b[0]*s + (1L << 14)) >> 15);
+                    b[0] = (a[0] - re + 1) >> 1;
+                    b[1] = (a[1] - im + 1) >> 1;
+                    a[0] = (a[0] + re + 1) >> 1;
+                    a[1] = (a[1] + im + 1) >> 1;
+                }
+            }
+        }
+    }
+
+    //floor(sqrt(value)), bit by bit
+    static uint32_t Spectrum_Sqrt(uint64_t value)
+    {
+        uint64_t root = 0;
+        uint64_t bit = 1uLL << 62;
+        while (bit > value)
+        {
+            bit >>= 2;
+        }
+        while (bit != 0)
+        {
+            if (value >= root + bit)
+            {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t)root;
+    }
+
+    static void Spectrum_Axis(Spectrum* spectrum, uint8_t axis)
+    {
+        const int16_t* x = spectrum->samples[axis];
+        int32_t* z = spectrum->work;
+        uint16_t points = spectrum->points;
+        uint8_t shift = (uint8_t)(SPECTRUM_TABLE_BITS - spectrum->log2_points);
+
+        //Mean in Q8 mg, rounded half up
+        int32_t sum = 0;
+        for (uint16_t n = 0; n < points; n++)
+        {
+            sum += x[n];
+        }
+        int32_t mean = (int32_t)(((int64_t)sum*256 + points/2) >> spectrum->log2_points);
+
+        //Windowed: even samples in the real parts, odd ones in the imaginary parts
+        for (uint16_t n = 0; n < points; n++)
+        {
+            int64_t window = 32768 - Spectrum_Cos((uint16_t)(n << shift));     //Q16
+            z[n] = (int32_t)((((int64_t)x[n]*256 - mean)*window + (1L << 15)) >> 16);
+        }
+        Spectrum_Transform(z, (uint8_t)(spectrum->log2_points - 1));
+
+        /*
+        * Split: with A = Z[k], B = conj(Z[M - k]), M = N/2, the transforms of
+        * the even and odd samples are E = (A + B) / 2 and O = (A - B) / 2i, and
+        * X[k] = E + exp(-i 2 pi k / N) O. Halved once more: X[k] / N
+        */
+        uint16_t half = points/2;
+        for (uint16_t k = 0; k <= half; k++)
+        {
+            uint16_t mirror = (uint16_t)((half - k) & (half - 1));
+            int64_t ar = z[2*(k & (half - 1))];
+            int64_t ai = z[2*(k & (half - 1)) + 1];
+            int64_t br = z[2*mirror];
+            int64_t bi = -z[2*mirror + 1];
+            int64_t odd_re = ai - bi;
+            int64_t odd_im = br - ar;
+            int64_t c = Spectrum_Cos((uint16_t)(k << shift));
+            int64_t s = Spectrum_Sin((uint16_t)(k << shift));
+            int64_t re = (((ar + br) << 15) + c*odd_re + s*odd_im + (1L << 16)) >> 17;
+            int64_t im = (((ai + bi) << 15) + c*odd_im - s*odd_re + (1L << 16)) >> 17;
+
+            //Amplitude 4 |X[k]| / N, from Q8 mg to mg/16
+            uint32_t magnitude = (Spectrum_Sqrt((uint64_t)(re*re + im*im)) + 2) >> 2;
+            spectrum->magnitude[axis][k] = (uint16_t)(magnitude > 0xFFFF ? 0xFFFF : magnitude);
+        }
+    }
+
+    void Spectrum_Compute(Spectrum* spectrum)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            Spectrum_Axis(spectrum, axis);
+        }
+    }
+
+    static uint8_t* Spectrum_Put16(uint8_t* p, uint16_t value)
+    {
+        p[0] = (uint8_t)(value & 0xFF);
+        p[1] = (uint8_t)(value >> 8);
+        return p + 2;
+    }
+
+    uint8_t Spectrum_ReportBins(const Spectrum* spectrum, uint8_t config, uint8_t axis,
+                                uint16_t first_bin, uint8_t* payload)
+    {
+        uint16_t last_bin = spectrum->points/2;
+        uint16_t count = first_bin <= last_bin ? (uint16_t)(last_bin + 1 - first_bin) : 0;
+        if (count > SPECTRUM_BINS_PER_FRAME)
+        {
+            count = SPECTRUM_BINS_PER_FRAME;
+        }
+        uint8_t* p = payload;
+        *p++ = config;
+        *p++ = spectrum->log2_points;
+        *p++ = axis;
+        p = Spectrum_Put16(p, first_bin);
+        *p++ = (uint8_t)count;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            p = Spectrum_Put16(p, spectrum->magnitude[axis][first_bin + i]);
+        }
+        return (uint8_t)SPECTRUM_BINS_SIZE(count);
+    }
+
+    uint8_t Spectrum_ReportPeaks(const Spectrum* spectrum, uint8_t config, uint8_t peaks,
+                                 uint8_t* payload)
+    {
+        uint16_t last_bin = spectrum->points/2;
+        if (peaks < 1)
+        {
+            peaks = 1;
+        }
+        if (peaks > SPECTRUM_MAX_PEAKS)
+        {
+            peaks = SPECTRUM_MAX_PEAKS;
+        }
+        uint8_t* p = payload;
+        *p++ = config;
+        *p++ = spectrum->log2_points;
+        *p++ = peaks;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            const uint16_t* magnitude = spectrum->magnitude[axis];
+            uint16_t bins[SPECTRUM_MAX_PEAKS] = { 0 };
+            uint16_t values[SPECTRUM_MAX_PEAKS] = { 0 };
+
+            //Local maxima above the previous bin and not below the next, highest first
+            for (uint16_t k = 1; k <= last_bin; k++)
+            {
+                uint16_t value = magnitude[k];
+                if (value == 0 || value <= magnitude[k - 1] ||
+                    (k < last_bin && value < magnitude[k + 1]) || value <= values[peaks - 1])
+                {
+                    continue;
+                }
+                uint8_t slot = (uint8_t)(peaks - 1);
+                while (slot > 0 && values[slot - 1] < value)
+                {
+                    bins[slot] = bins[slot - 1];
+                    values[slot] = values[slot - 1];
+                    slot--;
+                }
+                bins[slot] = k;
+                values[slot] = value;
+            }
+            for (uint8_t i = 0; i < peaks; i++)
+            {
+                p = Spectrum_Put16(p, bins[i]);
+                p = Spectrum_Put16(p, values[i]);
+            }
+        }
+        return (uint8_t)SPECTRUM_PEAKS_SIZE(peaks);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,148 @@
+/**
+*   \file Spectrum.h
+*   \brief Fixed-point amplitude spectrum of the samples, per axis.
+*
+*   The stream is cut into tumbling windows of Spectrum.points samples
+*   (a power of two from 64 to 512). Once a window is complete
+*   Spectrum_Compute() takes, for each axis:
+*
+*       - the mean out (rounded, Q8 mg), so that gravity does not leak
+*         into the low bins through the window;
+*       - a periodic Hann window, w[n] = (1 - cos(2 pi n / N)) / 2;
+*       - a real FFT: the N/2-point complex radix-2 FFT of the even and
+*         odd samples packed as real and imaginary parts, split into the
+*         N/2 + 1 bins of the real signal;
+*       - the magnitude of every bin.
+*
+*   The data are int32 Q8 mg, the twiddles and the window Q15 from one
+*   quarter-wave sine table of 512 points (the device links no libm), and
+*   every butterfly stage halves its outputs (rounding half up), so that
+*   nothing can overflow and the result is X[k] / N. Magnitudes are
+*   scaled to the amplitude of a sinusoid centred on the bin under the
+*   Hann window, 4 |X[k]| / N, in 1/16 mg (SPECTRUM_MAGNITUDE_SCALE),
+*   saturated at 65535.
+*
+*   Bin k is the frequency k ODR / N; bin 0 (the mean, taken out) is not
+*   sent.
+*
+*   Bins payload (FRAME_TYPE_SPECTRUM, little-endian), written by
+*   Spectrum_ReportBins(), SPECTRUM_BINS_PER_FRAME bins at most:
+*
+*       offset  size  field
+*       0       1     configuration byte of the sensor (see FRAME_CONFIG)
+*       1       1     log2 N
+*       2       1     axis (0 x, 1 y, 2 z)
+*       3       2     first bin k0 (uint16), 1 or more
+*       5       1     number of bins B
+*       6       2 B   magnitudes of bins k0 .. k0 + B - 1 (uint16)
+*
+*   Peaks payload (FRAME_TYPE_PEAKS), written by Spectrum_ReportPeaks():
+*   the K highest local maxima of the magnitudes of each axis, highest
+*   first; slots without a peak have bin and magnitude 0.
+*
+*       offset  size  field
+*       0       1     configuration byte of the sensor (see FRAME_CONFIG)
+*       1       1     log2 N
+*       2       1     peaks per axis K
+*       3       4 K   x: bin (uint16), magnitude (uint16), per peak
+*       3+4K    4 K   y, as x
+*       3+8K    4 K   z, as x
+*/
+#ifndef SPECTRUM_H
+    #define SPECTRUM_H
+
+    #include "cytypes.h"
+
+    /** \brief Points of the transform: 64, 128, 256 or 512. */
+    #ifndef SPECTRUM_POINTS
+        #define SPECTRUM_POINTS 256u
+    #endif
+
+    /** \brief Peaks per axis of the FRAME_TYPE_PEAKS frames, 1 to SPECTRUM_MAX_PEAKS. */
+    #ifndef SPECTRUM_PEAKS
+        #define SPECTRUM_PEAKS 4u
+    #endif
+
+    #define SPECTRUM_MIN_POINTS 64
+    #define SPECTRUM_MAX_POINTS 512
+    #define SPECTRUM_MAX_PEAKS 8
+
+    /** \brief Units of the magnitudes per mg. */
+    #define SPECTRUM_MAGNITUDE_SCALE 16
+
+    /** \brief Most bins in a FRAME_TYPE_SPECTRUM frame. */
+    #define SPECTRUM_BINS_PER_FRAME 64
+
+    /** \brief Bytes of a FRAME_TYPE_SPECTRUM payload of count bins. */
+    #define SPECTRUM_BINS_SIZE(count) (6 + 2*(count))
+
+    /** \brief Bytes of the FRAME_TYPE_PEAKS payload with peaks per axis. */
+    #define SPECTRUM_PEAKS_SIZE(peaks) (3 + 12*(peaks))
+
+    /**
+    *   \brief Window of samples and magnitudes of its last transform.
+    */
+    typedef struct {
+        int16_t samples[3][SPECTRUM_MAX_POINTS];    ///< Window, per axis [mg]
+        int32_t work[SPECTRUM_MAX_POINTS];          ///< N/2 complex points, real and imaginary parts
+        uint16_t magnitude[3][SPECTRUM_MAX_POINTS/2 + 1];   ///< Bins 0 .. N/2 [mg/16]
+        uint16_t points;                ///< N
+        uint8_t log2_points;
+        uint16_t filled;                ///< Samples in the window
+        uint8_t ready;                  ///< The window is complete
+    } Spectrum;
+
+    /**
+    *   \brief Set the points of the transform and start from an empty window.
+    *
+    *   \param points Rounded down to a power of two, SPECTRUM_MIN_POINTS to
+    *                 SPECTRUM_MAX_POINTS.
+    */
+    void Spectrum_Configure(Spectrum* spectrum, uint16_t points);
+
+    /**
+    *   \brief Collect samples up to the end of the window.
+    *
+    *   \param samples x, y, z in mg, oldest first.
+    *   \param count Number of samples.
+    *   \retval Samples consumed: call again with the rest after checking
+    *           Spectrum_IsReady().
+    */
+    uint8_t Spectrum_Add(Spectrum* spectrum, const int16_t (*samples)[3], uint8_t count);
+
+    /**
+    *   \brief Non-zero if a window has just been completed by the last Spectrum_Add().
+    */
+    uint8_t Spectrum_IsReady(const Spectrum* spectrum);
+
+    /**
+    *   \brief Transform the complete window: Spectrum.magnitude of the three axes.
+    *
+    *   The next Spectrum_Add() starts a new window.
+    */
+    void Spectrum_Compute(Spectrum* spectrum);
+
+    /**
+    *   \brief Write a FRAME_TYPE_SPECTRUM payload with the bins of an axis from first_bin.
+    *
+    *   \param config Configuration byte of the sensor (see FRAME_CONFIG).
+    *   \param first_bin 1 to N/2.
+    *   \param payload Destination, SPECTRUM_BINS_SIZE(SPECTRUM_BINS_PER_FRAME) bytes.
+    *   \retval Payload length: the bins up to N/2, SPECTRUM_BINS_PER_FRAME at most.
+    */
+    uint8_t Spectrum_ReportBins(const Spectrum* spectrum, uint8_t config, uint8_t axis,
+                                uint16_t first_bin, uint8_t* payload);
+
+    /**
+    *   \brief Write the FRAME_TYPE_PEAKS payload.
+    *
+    *   \param config Configuration byte of the sensor (see FRAME_CONFIG).
+    *   \param peaks Peaks per axis, 1 to SPECTRUM_MAX_PEAKS.
+    *   \param payload Destination, SPECTRUM_PEAKS_SIZE(peaks) bytes.
+    *   \retval SPECTRUM_PEAKS_SIZE(peaks).
+    */
+    uint8_t Spectrum_ReportPeaks(const Spectrum* spectrum, uint8_t config, uint8_t peaks,
+                                 uint8_t* payload);
+
+#endif // SPECTRUM_H
+/* [] END OF FILE */
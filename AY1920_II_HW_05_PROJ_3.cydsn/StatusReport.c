@@ -0,0 +1,96 @@
+/*
+* This file includes the source code of the status frames with the
+* loss and error counters.
+*/
+#include "StatusReport.h"
+#include "Command.h"
+#include "EventQueue.h"
+#include "Frame.h"
+#include "I2C_Interface.h"
+#include "LowPower.h"
+#include "UART_Stream.h"
+#include "CyLib.h"
+
+// Counters updated by the I2C interrupt
+static volatile uint32_t sensor_overruns = 0;
+static volatile uint32_t samples_lost = 0;
+
+static uint32_t samples_dropped = 0;
+
+// Start of the current period [us] and overruns already reported
+static uint32_t period_start = 0;
+static uint32_t reported_overruns = 0;
+
+    void StatusReport_Reset(uint32_t now)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        sensor_overruns = 0;
+        samples_lost = 0;
+        CyExitCriticalSection(interrupts);
+        samples_dropped = 0;
+        period_start = now;
+        reported_overruns = 0;
+    }
+
+    void StatusReport_SensorOverrun(uint32_t lost)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        sensor_overruns++;
+        samples_lost += lost;
+        CyExitCriticalSection(interrupts);
+    }
+
+    void StatusReport_SamplesDropped(uint32_t count)
+    {
+        samples_dropped += count;
+    }
+
+    uint8_t StatusReport_IsDue(uint32_t now)
+    {
+        return (now - period_start) >= 1000u*STATUS_REPORT_PERIOD_MS ||
+               sensor_overruns != reported_overruns;
+    }
+
+    static uint8_t* StatusReport_Put32(uint8_t* p, uint32_t value)
+    {
+        p[0] = (uint8_t)(value & 0xFF);
+        p[1] = (uint8_t)(value >> 8);
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 24);
+        return p + 4;
+    }
+
+    ErrorCode StatusReport_Send(uint32_t now)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        uint32_t overruns = sensor_overruns;
+        uint32_t lost = samples_lost;
+        CyExitCriticalSection(interrupts);
+        EventQueue_Stats events = EventQueue_GetStats();
+        I2C_Peripheral_Stats i2c = I2C_Peripheral_GetStats();
+        LowPower_Stats power = LowPower_GetStats();
+
+        uint8_t payload[STATUS_REPORT_PAYLOAD_SIZE];
+        uint8_t* p = payload;
+        p = StatusReport_Put32(p, overruns);
+        p = StatusReport_Put32(p, lost);
+        p = StatusReport_Put32(p, samples_dropped);
+        p = StatusReport_Put32(p, events.dropped);
+        p = StatusReport_Put32(p, UART_Stream_GetDropCount());
+        p = StatusReport_Put32(p, i2c.transactions);
+        p = StatusReport_Put32(p, i2c.errors);
+        p = StatusReport_Put32(p, i2c.naks);
+        p = StatusReport_Put32(p, i2c.arbitration_lost);
+        p = StatusReport_Put32(p, i2c.bus_errors);
+        p = StatusReport_Put32(p, Command_GetErrorCount());
+        p = StatusReport_Put32(p, i2c.retries);
+        p = StatusReport_Put32(p, i2c.recoveries);
+        p = StatusReport_Put32(p, power.duty_cycle_ppm);
+        p = StatusReport_Put32(p, power.current_ua);
+
+        period_start = now;
+        reported_overruns = overruns;
+        return Frame_Send(FRAME_TYPE_STATUS, now, payload, STATUS_REPORT_PAYLOAD_SIZE);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,83 @@
+/**
+*   \file StatusReport.h
+*   \brief Loss and error counters sent in the stream as FRAME_TYPE_STATUS frames.
+*
+*   A status frame is sent every STATUS_REPORT_PERIOD_MS and, as soon as
+*   samples have been lost in the sensor, right before the samples frame
+*   of the batch that follows the gap. Counters are cumulative since
+*   boot, so a status frame that is itself lost costs nothing but the
+*   position of the gap. Not sent in the bridge output format. Payload,
+*   little-endian uint32:
+*
+*       offset  field
+*       0       sensor overruns (batches read with OVRN_FIFO or ZYXOR set)
+*       4       samples lost in the sensor (estimate, see StatusReport_SensorOverrun())
+*       8       samples in frames UART_Stream had no room for
+*       12      DataReady_ISR events dropped by the full EventQueue
+*       16      frames dropped by UART_Stream (TX buffer full)
+*       20      I2C transactions
+*       24      I2C transactions failed
+*       28      I2C NAKs
+*       32      I2C arbitration losses
+*       36      I2C bus errors (busy, not ready, transfer refused)
+*       40      commands rejected (bad CRC, length or value)
+*       44      I2C transactions retried
+*       48      I2C bus recoveries
+*       52      CPU duty cycle [ppm] (see LowPower.h)
+*       56      estimated average current [uA]
+*
+*   Frames lost on the line show up as gaps in the sequence numbers;
+*   the counters of the next status frame tell what they carried.
+*/
+#ifndef STATUS_REPORT_H
+    #define STATUS_REPORT_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    /** \brief Period of the status frames [ms]. */
+    #ifndef STATUS_REPORT_PERIOD_MS
+        #define STATUS_REPORT_PERIOD_MS 1000
+    #endif
+
+    /** \brief Size of the FRAME_TYPE_STATUS payload. */
+    #define STATUS_REPORT_PAYLOAD_SIZE 60
+
+    /**
+    *   \brief Clear the counters and start the period at \p now [us].
+    */
+    void StatusReport_Reset(uint32_t now);
+
+    /**
+    *   \brief Record a batch read with the sensor overrun flag set.
+    *
+    *   Safe to call from interrupts.
+    *   \param samples_lost Samples overwritten before being read, estimated
+    *                       from the time since the previous read and the ODR.
+    */
+    void StatusReport_SensorOverrun(uint32_t samples_lost);
+
+    /**
+    *   \brief Record the samples of a frame UART_Stream could not queue.
+    */
+    void StatusReport_SamplesDropped(uint32_t count);
+
+    /**
+    *   \brief Check if a status frame has to be sent.
+    *
+    *   \param now Timestamp_Now() [us].
+    *   \retval Returns true (>0) when the period is over or samples have
+    *           been lost in the sensor since the last status frame.
+    */
+    uint8_t StatusReport_IsDue(uint32_t now);
+
+    /**
+    *   \brief Send a status frame and start a new period.
+    *
+    *   \param now Timestamp_Now() [us], also the timestamp of the frame.
+    *   \retval ERROR if the frame has been dropped.
+    */
+    ErrorCode StatusReport_Send(uint32_t now);
+
+#endif // STATUS_REPORT_H
+/* [] END OF FILE */
@@ -0,0 +1,178 @@
+/*
+* This file includes the source code of the cycle counter tracing of
+* the sample path.
+*/
+#include "Trace.h"
+#include "Frame.h"
+#include "Timestamp.h"
+#include "UART_Stream.h"
+
+// Statistics per stage: the first two are updated by the I2C interrupt, the others by the main loop
+static Trace_Stats stats[TRACE_STAGE_COUNT];
+
+// Batch being traced, from Trace_Begin() to TRACE_STAGE_ENQUEUE
+static volatile uint8_t trace_active = 0;
+static uint32_t trace_isr;
+static uint32_t trace_last;
+
+// Batches queued on UART_Stream, waiting for their last byte to be sent
+typedef struct {
+    uint32_t end;           ///< UART_Stream byte count at the end of the frame
+    uint32_t isr;           ///< Cycle count at ISR entry
+    uint32_t queued;        ///< Cycle count when the frame was queued
+} Trace_Pending;
+
+static Trace_Pending pending[TRACE_PENDING];
+static uint8_t pending_head = 0;
+static uint8_t pending_tail = 0;
+
+    static void Trace_Clear(Trace_Stage stage)
+    {
+        stats[stage] = (Trace_Stats){ .min = 0xFFFFFFFF };
+    }
+
+    static void Trace_Record(Trace_Stage stage, uint32_t cycles)
+    {
+        Trace_Stats* s = &stats[stage];
+        s->count++;
+        s->sum += cycles;
+        if (cycles < s->min)
+        {
+            s->min = cycles;
+        }
+        if (cycles > s->max)
+        {
+            s->max = cycles;
+        }
+
+        // Integer base-2 logarithm: a single CLZ instruction on the Cortex-M3
+        uint8_t bin = cycles > 1 ? (uint8_t)(31 - __builtin_clz(cycles)) : 0;
+        s->histogram[bin < TRACE_HISTOGRAM_BINS ? bin : TRACE_HISTOGRAM_BINS - 1]++;
+    }
+
+    void Trace_Start(void)
+    {
+        // The DWT unit is clocked only with trace enabled in the debug monitor register
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+        trace_active = 0;
+        pending_head = 0;
+        pending_tail = 0;
+        for (uint8_t stage = 0; stage < TRACE_STAGE_COUNT; stage++)
+        {
+            Trace_Clear(stage);
+        }
+    }
+
+    void Trace_Begin(uint32_t isr_cycles)
+    {
+        trace_isr = isr_cycles;
+        trace_last = isr_cycles;
+        trace_active = 1;
+    }
+
+    void Trace_Mark(Trace_Stage stage)
+    {
+        if (!trace_active)
+        {
+            return;
+        }
+        uint32_t now = Trace_Now();
+        // Unsigned difference: right across the counter wrap (179 s at 24 MHz)
+        Trace_Record(stage, now - trace_last);
+        trace_last = now;
+
+        if (stage == TRACE_STAGE_ENQUEUE)
+        {
+            trace_active = 0;
+            // The oldest batch is given up if the stream is that far behind
+            if ((uint8_t)(pending_head - pending_tail) == TRACE_PENDING)
+            {
+                pending_tail++;
+            }
+            Trace_Pending* p = &pending[pending_head++ % TRACE_PENDING];
+            p->end = UART_Stream_GetWrittenCount();
+            p->isr = trace_isr;
+            p->queued = now;
+        }
+    }
+
+    void Trace_Abort(void)
+    {
+        trace_active = 0;
+    }
+
+    void Trace_Poll(void)
+    {
+        if (pending_tail == pending_head)
+        {
+            return;
+        }
+        uint32_t sent = UART_Stream_GetSentCount();
+        uint32_t now = Trace_Now();
+        while (pending_tail != pending_head)
+        {
+            Trace_Pending* p = &pending[pending_tail % TRACE_PENDING];
+            // Byte counts wrap too: the batch is out once sent has reached its end
+            if ((int32_t)(sent - p->end) < 0)
+            {
+                break;
+            }
+            Trace_Record(TRACE_STAGE_TX, now - p->queued);
+            Trace_Record(TRACE_STAGE_TOTAL, now - p->isr);
+            pending_tail++;
+        }
+    }
+
+    Trace_Stats Trace_GetStats(Trace_Stage stage)
+    {
+        // The I2C interrupt updates the first stages: copy them in one go
+        uint8 interrupts = CyEnterCriticalSection();
+        Trace_Stats copy = stats[stage];
+        CyExitCriticalSection(interrupts);
+        return copy;
+    }
+
+    static uint8_t* Trace_Put32(uint8_t* p, uint32_t value)
+    {
+        p[0] = (uint8_t)(value & 0xFF);
+        p[1] = (uint8_t)(value >> 8);
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 24);
+        return p + 4;
+    }
+
+    ErrorCode Trace_Send(uint8_t query)
+    {
+        uint8_t stage = query & ~TRACE_QUERY_CLEAR;
+        if (stage >= TRACE_STAGE_COUNT)
+        {
+            return ERROR;
+        }
+
+        Trace_Stats s = Trace_GetStats(stage);
+        uint8_t payload[TRACE_PAYLOAD_SIZE];
+        uint8_t* p = payload;
+        *p++ = stage;
+        *p++ = (uint8_t)(BCLK__BUS_CLK__HZ / 1000000u);
+        p = Trace_Put32(p, s.count);
+        p = Trace_Put32(p, s.count ? s.min : 0);
+        p = Trace_Put32(p, s.max);
+        p = Trace_Put32(p, s.count ? (uint32_t)(s.sum / s.count) : 0);
+        for (uint8_t bin = 0; bin < TRACE_HISTOGRAM_BINS; bin++)
+        {
+            p = Trace_Put32(p, s.histogram[bin]);
+        }
+
+        if (query & TRACE_QUERY_CLEAR)
+        {
+            uint8 interrupts = CyEnterCriticalSection();
+            Trace_Clear(stage);
+            CyExitCriticalSection(interrupts);
+        }
+        return Frame_Send(FRAME_TYPE_TRACE, Timestamp_Now(), payload, TRACE_PAYLOAD_SIZE);
+    }
+
+/* [] END OF FILE */
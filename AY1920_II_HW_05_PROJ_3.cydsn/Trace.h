@@ -0,0 +1,128 @@
+/**
+*   \file Trace.h
+*   \brief Per-stage latency of the sample path, timed with the DWT cycle counter.
+*
+*   Every batch is stamped with DWT->CYCCNT at six points: DataReady_ISR
+*   entry, end of the STATUS (FIFO SOURCE) REGISTER read, end of the
+*   OUT_X_L burst, end of the conversion, frame queued on UART_Stream and
+*   TX complete (last byte of the batch handed to the UART TX FIFO, a few
+*   byte times before it leaves the line). Each stage is the interval
+*   between a point and the previous one; TRACE_STAGE_TOTAL spans the
+*   whole path. A status read that finds no new data ends its batch after
+*   the first stage.
+*
+*   Every stage keeps count, minimum, maximum and sum of its durations in
+*   cycles and a histogram of their base-2 logarithm. The host reads them
+*   with a FRAME_TYPE_TRACE_QUERY command (see Command.h); the answer is a
+*   FRAME_TYPE_TRACE frame with the payload (little-endian):
+*
+*       offset  size  field
+*       0       1     stage (Trace_Stage)
+*       1       1     cycle counter frequency [MHz]
+*       2       4     count
+*       6       4     minimum [cycles]
+*       10      4     maximum [cycles]
+*       14      4     mean [cycles]
+*       18      4*B   histogram, B = TRACE_HISTOGRAM_BINS
+*
+*   Bin k counts the durations from 2^k to 2^(k+1)-1 cycles (bin 0 also
+*   counts 0), the last bin everything above.
+*/
+#ifndef TRACE_H
+    #define TRACE_H
+
+    #include "cytypes.h"
+    #include "CyLib.h"
+    #include "ErrorCodes.h"
+
+    /** \brief Histogram bins: the last one starts at 2^23 cycles (350 ms at 24 MHz). */
+    #define TRACE_HISTOGRAM_BINS    24
+
+    /** \brief Size of the FRAME_TYPE_TRACE payload. */
+    #define TRACE_PAYLOAD_SIZE      (18 + 4*TRACE_HISTOGRAM_BINS)
+
+    /** \brief Query flag: clear the stage once it has been reported. */
+    #define TRACE_QUERY_CLEAR       0x80
+
+    /** \brief Batches waiting for the end of their transmission. */
+    #define TRACE_PENDING           4
+
+    /**
+    *   \brief Stages of the sample path, each ending at the named point.
+    */
+    typedef enum {
+        TRACE_STAGE_STATUS,         ///< ISR entry to STATUS (FIFO SOURCE) REGISTER read
+        TRACE_STAGE_BURST,          ///< Status read to end of the OUT_X_L burst
+        TRACE_STAGE_CONVERT,        ///< Burst to end of the conversion (main loop pickup included)
+        TRACE_STAGE_ENQUEUE,        ///< Conversion to frame queued on UART_Stream
+        TRACE_STAGE_TX,             ///< Queued to last byte handed to the UART
+        TRACE_STAGE_TOTAL,          ///< ISR entry to last byte handed to the UART
+        TRACE_STAGE_COUNT
+    } Trace_Stage;
+
+    /**
+    *   \brief Statistics of a stage.
+    */
+    typedef struct {
+        uint32_t count;                             ///< Durations recorded
+        uint32_t min;                               ///< Shortest [cycles]
+        uint32_t max;                               ///< Longest [cycles]
+        uint64_t sum;                               ///< Sum [cycles]
+        uint32_t histogram[TRACE_HISTOGRAM_BINS];   ///< Durations per power of two
+    } Trace_Stats;
+
+    /**
+    *   \brief Current value of the cycle counter.
+    *
+    *   Cheap enough for interrupt entry: a single register read.
+    */
+    #define Trace_Now()             (DWT->CYCCNT)
+
+    /**
+    *   \brief Enable the DWT cycle counter and clear the statistics.
+    */
+    void Trace_Start(void);
+
+    /**
+    *   \brief Start tracing a batch.
+    *
+    *   \param isr_cycles Trace_Now() at the entry of the interrupt that triggered it.
+    */
+    void Trace_Begin(uint32_t isr_cycles);
+
+    /**
+    *   \brief Close \p stage of the batch being traced at the current cycle count.
+    *
+    *   Does nothing if no batch is being traced. TRACE_STAGE_ENQUEUE hands
+    *   the batch over to Trace_Poll(), with the end of the frame in the
+    *   UART_Stream byte count.
+    */
+    void Trace_Mark(Trace_Stage stage);
+
+    /**
+    *   \brief Stop tracing the current batch (no new data, bus error, dropped frame).
+    */
+    void Trace_Abort(void);
+
+    /**
+    *   \brief Close the stages of the batches whose last byte has been sent.
+    *
+    *   To be called from the main loop.
+    */
+    void Trace_Poll(void);
+
+    /**
+    *   \brief Copy of the statistics of \p stage.
+    */
+    Trace_Stats Trace_GetStats(Trace_Stage stage);
+
+    /**
+    *   \brief Send the statistics of a stage in a FRAME_TYPE_TRACE frame.
+    *
+    *   \param query Stage, ORed with TRACE_QUERY_CLEAR to clear it afterwards.
+    *   \retval ERROR if the stage does not exist or the frame has been dropped.
+    */
+    ErrorCode Trace_Send(uint8_t query);
+
+#endif // TRACE_H
+/* [] END OF FILE */
@@ -0,0 +1,168 @@
+/*
+* This file includes the source code to stream frames over UART_Debug,
+* through the TX DMA when UART_STREAM_USE_DMA is set.
+*/
+#include "UART_Stream.h"
+#include "project.h"
+
+#if UART_STREAM_USE_DMA && !defined(DMA_UART_TX__TD_TERMOUT_EN)
+    #error "UART_STREAM_USE_DMA needs DMA_UART_TX and ISR_DMA_TX in TopDesign (see UART_Stream.h), or build with UART_STREAM_USE_DMA=0"
+#endif
+
+static volatile uint32_t drop_count = 0;
+
+// Bytes accepted by UART_Stream_Write() (and, with the DMA, handed to the UART)
+static volatile uint32_t written_count = 0;
+
+#if UART_STREAM_USE_DMA
+
+// Ping-pong buffers: aligned so that both share the upper 16 address bits
+static uint8_t stream_buffer[2][UART_STREAM_BUFFER_SIZE] __attribute__((aligned(2 * UART_STREAM_BUFFER_SIZE)));
+// One TD per buffer, with its source address set once at start
+static uint8_t stream_td[2];
+static uint8_t stream_channel;
+
+// Buffer being filled by the firmware and its length
+static volatile uint8_t fill_index = 0;
+static volatile uint16_t fill_length = 0;
+// Non-zero while the other buffer is being transmitted, and its length
+static volatile uint8_t dma_busy = 0;
+static volatile uint16_t dma_length = 0;
+static volatile uint32_t sent_count = 0;
+
+    // Hand the buffer being filled to the DMA (interrupts masked)
+    static void UART_Stream_Kick(void)
+    {
+        uint8_t index = fill_index;
+
+        CyDmaTdSetConfiguration(stream_td[index], fill_length, CY_DMA_DISABLE_TD,
+                                TD_INC_SRC_ADR | DMA_UART_TX__TD_TERMOUT_EN);
+        CyDmaChSetInitialTd(stream_channel, stream_td[index]);
+        CyDmaChEnable(stream_channel, 1);
+
+        dma_busy = 1;
+        dma_length = fill_length;
+        fill_index = index ^ 1;
+        fill_length = 0;
+    }
+
+    static CY_ISR(UART_Stream_DmaDone_ISR)
+    {
+        dma_busy = 0;
+        sent_count += dma_length;
+        // Whatever has been queued in the meantime goes out at once
+        if (fill_length > 0)
+        {
+            UART_Stream_Kick();
+        }
+    }
+
+    void UART_Stream_Start(void)
+    {
+        UART_Debug_Start();
+
+        fill_index = 0;
+        fill_length = 0;
+        dma_busy = 0;
+        drop_count = 0;
+        written_count = 0;
+        sent_count = 0;
+
+        // One byte per request, moved whenever the TX FIFO is not full
+        stream_channel = DMA_UART_TX_DmaInitialize(1, 1, HI16(stream_buffer),
+                                                   HI16(UART_Debug_TXDATA_PTR));
+        for (uint8_t i = 0; i < 2; i++)
+        {
+            stream_td[i] = CyDmaTdAllocate();
+            CyDmaTdSetAddress(stream_td[i], LO16(stream_buffer[i]),
+                              LO16(UART_Debug_TXDATA_PTR));
+        }
+        ISR_DMA_TX_StartEx(UART_Stream_DmaDone_ISR);
+    }
+
+    ErrorCode UART_Stream_Write(const uint8_t* data, uint16_t length)
+    {
+        ErrorCode error = NO_ERROR;
+        uint8 interrupt_state = CyEnterCriticalSection();
+
+        if (fill_length + length > UART_STREAM_BUFFER_SIZE)
+        {
+            drop_count++;
+            error = ERROR;
+        }
+        else
+        {
+            uint8_t* destination = &stream_buffer[fill_index][fill_length];
+            for (uint16_t i = 0; i < length; i++)
+            {
+                destination[i] = data[i];
+            }
+            fill_length += length;
+            written_count += length;
+            if (!dma_busy)
+            {
+                UART_Stream_Kick();
+            }
+        }
+
+        CyExitCriticalSection(interrupt_state);
+        return error;
+    }
+
+    uint8_t UART_Stream_IsBusy(void)
+    {
+        return dma_busy;
+    }
+
+    uint32_t UART_Stream_GetSentCount(void)
+    {
+        return sent_count;
+    }
+
+#else
+
+    void UART_Stream_Start(void)
+    {
+        UART_Debug_Start();
+        drop_count = 0;
+        written_count = 0;
+    }
+
+    ErrorCode UART_Stream_Write(const uint8_t* data, uint16_t length)
+    {
+        written_count += length;
+        // Blocks while the UART_Debug software buffer is full
+        while (length > 0)
+        {
+            uint8_t chunk = length > 0xFF ? 0xFF : (uint8_t)length;
+            UART_Debug_PutArray(data, chunk);
+            data += chunk;
+            length -= chunk;
+        }
+        return NO_ERROR;
+    }
+
+    uint8_t UART_Stream_IsBusy(void)
+    {
+        return UART_Debug_GetTxBufferSize() > 0;
+    }
+
+    uint32_t UART_Stream_GetSentCount(void)
+    {
+        // Whatever is no longer in the software buffer is in the UART
+        return written_count - UART_Debug_GetTxBufferSize();
+    }
+
+#endif
+
+    uint32_t UART_Stream_GetDropCount(void)
+    {
+        return drop_count;
+    }
+
+    uint32_t UART_Stream_GetWrittenCount(void)
+    {
+        return written_count;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,85 @@
+/**
+*   \file UART_Stream.h
+*   \brief Non-blocking UART transmission of output frames.
+*
+*   When the design contains a DMA component named DMA_UART_TX (request
+*   on the UART_Debug TX FIFO-not-full signal, termination output wired
+*   to an interrupt named ISR_DMA_TX, UART_Debug TX buffer size 4) frames
+*   are copied into one of two ping-pong buffers and shifted out by the
+*   DMA: while one buffer is on the line the firmware fills the other.
+*   With UART_STREAM_USE_DMA set to 0 the module uses UART_Debug_PutArray().
+*
+*   DMA_UART_TX and ISR_DMA_TX are not in the schematic of this project
+*   yet: until they are added in PSoC Creator the DMA path is exercised
+*   by the host build only, and the target has to be built with
+*   UART_STREAM_USE_DMA=0.
+*/
+#ifndef UART_STREAM_H
+    #define UART_STREAM_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    /**
+    *   \brief Non-zero to send through the DMA_UART_TX channel.
+    */
+    #ifndef UART_STREAM_USE_DMA
+        #define UART_STREAM_USE_DMA 1
+    #endif
+
+    /**
+    *   \brief Size of each ping-pong buffer in bytes.
+    *
+    *   Holds the frames of a whole FIFO batch (32 samples of 8 bytes) or
+    *   one batched frame of the largest size. Must be a power of two.
+    */
+    #ifndef UART_STREAM_BUFFER_SIZE
+        #define UART_STREAM_BUFFER_SIZE 512
+    #endif
+
+    /**
+    *   \brief Start the UART and, if enabled, the TX DMA channel.
+    */
+    void UART_Stream_Start(void);
+
+    /**
+    *   \brief Queue bytes for transmission.
+    *
+    *   With the DMA the call never waits for the line: the bytes are
+    *   copied and the function returns. The frame is dropped if the
+    *   buffer being filled has no room for it.
+    *   \param data Bytes to be sent.
+    *   \param length Number of bytes (at most UART_STREAM_BUFFER_SIZE).
+    *   \retval ERROR if the frame has been dropped.
+    */
+    ErrorCode UART_Stream_Write(const uint8_t* data, uint16_t length);
+
+    /**
+    *   \brief Check if bytes are still waiting to be handed to the UART.
+    *
+    *   \retval Returns true (>0) while a buffer is being transmitted.
+    */
+    uint8_t UART_Stream_IsBusy(void);
+
+    /**
+    *   \brief Number of frames dropped since UART_Stream_Start().
+    */
+    uint32_t UART_Stream_GetDropCount(void);
+
+    /**
+    *   \brief Bytes accepted by UART_Stream_Write() since UART_Stream_Start().
+    *
+    *   Dropped frames are not counted. The count wraps around.
+    */
+    uint32_t UART_Stream_GetWrittenCount(void);
+
+    /**
+    *   \brief Bytes handed to the UART (its TX FIFO) since UART_Stream_Start().
+    *
+    *   Trails UART_Stream_GetWrittenCount() by the bytes still queued;
+    *   with the DMA it moves a whole buffer at a time.
+    */
+    uint32_t UART_Stream_GetSentCount(void);
+
+#endif // UART_STREAM_H
+/* [] END OF FILE */
@@ -16,6 +16,10 @@
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
 
+    /* Asynchronous transaction engine of I2C_Interface.c */
+    #define I2C_Master_ISR_EXIT_CALLBACK
+    void I2C_Master_ISR_ExitCallback(void);
+
     
 #endif /* CYAPICALLBACKS_H */   
 /* [] */
@@ -5,178 +5,1481 @@
  * a LIS3DH tri-axial accelerometer in High Resolution
  * Mode at 100 Hz. 
  * 
- * Output data is converted in mg units, while
- * the conversion in m/s^2 units is perfomed
- * in the Bridge Control Panel Variable Setting
- * feature ( see HW_05_PALMIERI_MARTINA.ini for
- * details).
+ * The samples of every LIS3DH on the bus are read in
+ * bursts from the sensor FIFO, converted in mg units,
+ * filtered and sent in frames with sequence number,
+ * timestamp and CRC (see Frame.h), with periodic
+ * status frames. The configuration can be switched
+ * at runtime by commands on the UART RX line (see
+ * Command.h).
+ *
+ * Configuration macros:
+ * - OUTPUT_FORMAT: bridge (A0..C0 frames for the
+ *   Bridge Control Panel, see
+ *   HW_05_PALMIERI_MARTINA.ini), batched (default),
+ *   compressed, features, spectrum or events;
+ * - ACTIVITY_GATED: stream only while the board moves;
+ * - FLASH_LOG: keep the stream in a ring log in flash;
+ * - FAST_BOOT, SENSOR_ADDRESS_COUNT.
+ * The batches are announced on the LIS3DH INT1 line:
+ * the target needs Pin_INT1 in TopDesign (see
+ * InterruptRoutines.h).
  *
  * ========================================
 */
 
 // Include header files
 #include "I2C_Interface.h"
+#include "Activity.h"
+#include "Boot.h"
+#include "BusManager.h"
+#include "Command.h"
+#include "DeltaCodec.h"
+#include "EventQueue.h"
+#include "Events.h"
+#include "Features.h"
+#include "Filter.h"
+#include "FlashLog.h"
+#include "Frame.h"
 #include "InterruptRoutines.h"
+#include "LIS3DH.h"
+#include "LIS3DH_Convert.h"
+#include "LowPower.h"
+#include "Spectrum.h"
+#include "StatusReport.h"
+#include "Timestamp.h"
+#include "Trace.h"
+#include "UART_Stream.h"
 #include "project.h"
 #include "stdio.h"
 
-//Brief slave device address
-#define LIS3DH_DEVICE_ADDRESS 0x18
+/*Brief FIFO watermark level (FIFO_CTRL_REG[4:0]=FTH[4:0]): the batch is read
+once the FIFO holds this many samples, the 32-level depth leaves room for
+the reading latency */
+#define LIS3DH_FIFO_WATERMARK 24
+
+/*Brief 1 to collect samples through the sensor FIFO, 0 to read one sample
+per STATUS REGISTER poll */
+#ifndef LIS3DH_USE_FIFO
+    #define LIS3DH_USE_FIFO 1
+#endif
+
+/*Brief 1 to poll WHO_AM_I until the sensor is out of its boot (LIS3DH_WaitBoot), 0
+for the fixed 5 ms wait of the datasheet: a PSoC reset alone leaves the sensor up */
+#ifndef FAST_BOOT
+    #define FAST_BOOT 1
+#endif
+
+/*Brief 1 to stream only while the board moves: after ACTIVITY_TIMEOUT_MS without
+motion the sensors wait in low-power mode, the CPU sleeps (see Activity.h).
+The wake-up comes on INT1, so the target needs Pin_INT1 (InterruptRoutines.h) */
+#ifndef ACTIVITY_GATED
+    #define ACTIVITY_GATED 0
+#endif
+
+#if ACTIVITY_GATED
+#if !DATA_READY_FROM_INT1 || !LIS3DH_USE_FIFO
+    #error "ACTIVITY_GATED needs DATA_READY_FROM_INT1 (Pin_INT1 in TopDesign, see InterruptRoutines.h) and LIS3DH_USE_FIFO"
+#endif
+
+/*Brief deviation from the running mean [mg] that counts as motion, in the samples of
+the stream and for the IA1 generator (a whole INT1_THS step at +- 2 and 4 g) */
+#ifndef ACTIVITY_THRESHOLD_MG
+    #define ACTIVITY_THRESHOLD_MG 128
+#endif
+
+//Brief time without motion after which the stream stops [ms]
+#ifndef ACTIVITY_TIMEOUT_MS
+    #define ACTIVITY_TIMEOUT_MS 10000
+#endif
+
+/*Brief ODR while the stream is off, in low-power mode: the FIFO in stream mode keeps
+the last 32 samples (3.2 s at 10 Hz) as the history before the motion */
+#ifndef ACTIVITY_IDLE_ODR
+    #define ACTIVITY_IDLE_ODR LIS3DH_ODR_10_HZ
+#endif
+
+//Brief samples beyond the threshold before IA1 fires (INT1_DURATION)
+#define ACTIVITY_DURATION 1
+
+/*Brief longest Sleep while the stream is off [us]: a 128 ms CTW interval and the wake-up.
+INT1 is latched (LIR_INT1), so the motion waits for the next wake-up */
+#define ACTIVITY_POLL_US (128000u + LOW_POWER_SLEEP_WAKEUP_US)
+#endif
+
+/*Brief output formats: one A0..C0 frame per sample, one frame per batch (Frame.h),
+one delta compressed frame per batch (DeltaCodec.h), one statistics frame per
+window (Features.h), the spectrum of every window (Spectrum.h), or one frame
+per click or free fall detected by the sensor (Events.h, on INT1: the target
+needs Pin_INT1, see InterruptRoutines.h) */
+#define OUTPUT_FORMAT_BRIDGE 0
+#define OUTPUT_FORMAT_BATCHED 1
+#define OUTPUT_FORMAT_COMPRESSED 2
+#define OUTPUT_FORMAT_FEATURES 3
+#define OUTPUT_FORMAT_SPECTRUM 4
+#define OUTPUT_FORMAT_EVENTS 5
+
+#ifndef OUTPUT_FORMAT
+    #define OUTPUT_FORMAT OUTPUT_FORMAT_BATCHED
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+#if !DATA_READY_FROM_INT1 || !LIS3DH_USE_FIFO
+    #error "OUTPUT_FORMAT_EVENTS needs DATA_READY_FROM_INT1 (Pin_INT1 in TopDesign, see InterruptRoutines.h) and LIS3DH_USE_FIFO"
+#endif
+#if ACTIVITY_GATED
+    #error "ACTIVITY_GATED and OUTPUT_FORMAT_EVENTS both need the IA1 generator"
+#endif
+
+/*Brief click threshold [mg], on high-pass filtered data: above the 1 g step of a
+free fall, below a tap on the board */
+#ifndef EVENTS_CLICK_THRESHOLD_MG
+    #define EVENTS_CLICK_THRESHOLD_MG 1200
+#endif
+
+//Brief longest click [ms] (TIME_LIMIT), and dead time after one [ms] (TIME_LATENCY)
+#ifndef EVENTS_CLICK_LIMIT_MS
+    #define EVENTS_CLICK_LIMIT_MS 20
+#endif
+#ifndef EVENTS_CLICK_LATENCY_MS
+    #define EVENTS_CLICK_LATENCY_MS 100
+#endif
+
+/*Brief magnitude [mg] under which every axis must be (INT1_THS) for EVENTS_FREE_FALL_MS
+(INT1_DURATION) to be a free fall: about 5 cm of drop */
+#ifndef EVENTS_FREE_FALL_MG
+    #define EVENTS_FREE_FALL_MG 350
+#endif
+#ifndef EVENTS_FREE_FALL_MS
+    #define EVENTS_FREE_FALL_MS 100
+#endif
+
+/*Brief period [ms] of the check that the sensor still runs: with no samples read
+its FIFO is looked at instead (see CheckSensor()) */
+#define EVENTS_CHECK_MS 1000
+#endif
+
+/*Brief 1 to keep the frames in a ring log in flash for offline capture (see FlashLog.h).
+Only for the formats the flash can keep up with: every page costs a row erase */
+#ifndef FLASH_LOG
+    #define FLASH_LOG 0
+#endif
+
+#if FLASH_LOG && OUTPUT_FORMAT != OUTPUT_FORMAT_COMPRESSED && \
+    OUTPUT_FORMAT != OUTPUT_FORMAT_FEATURES && OUTPUT_FORMAT != OUTPUT_FORMAT_EVENTS
+    #error "FLASH_LOG needs the compressed, features or events output format"
+#endif
+
+//Brief operating mode and full scale at boot, shared by the configuration and the conversion
+#define SENSOR_MODE LIS3DH_MODE_HIGH_RESOLUTION
+#define SENSOR_FULL_SCALE LIS3DH_FULL_SCALE_4G
+
+//Brief ODR at boot: the click engine needs a few samples of a tap, 400 Hz
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    #define SENSOR_ODR LIS3DH_ODR_400_HZ
+#else
+    #define SENSOR_ODR LIS3DH_ODR_100_HZ
+#endif
+
+/*Brief sensor configuration: High Resolution mode at 100 Hz, +- 4.0 g FSR,
+BDU, FIFO in stream mode with its watermark on INT1 (data ready on INT1
+without the FIFO). In the events format the click engine, on high-pass data,
+and the IA1 generator are latched on INT1 instead. ODR, mode and full scale
+change with the configuration commands */
+static LIS3DH_Config lis3dh_config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = SENSOR_ODR,
+    .mode = SENSOR_MODE,
+    .full_scale = SENSOR_FULL_SCALE,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+#if LIS3DH_USE_FIFO
+    .fifo_mode = LIS3DH_FIFO_STREAM,
+    .fifo_watermark = LIS3DH_FIFO_WATERMARK,
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    .int1 = LIS3DH_INT1_CLICK | LIS3DH_INT1_IA1,
+    .int1_latch = 1,
+    .click_highpass = 1,
+#else
+    .int1 = LIS3DH_INT1_WTM,
+#endif
+#else
+    .int1 = LIS3DH_INT1_ZYXDA,
+#endif
+};
+
+//Brief formats whose samples go through the filter chain (see Filter.h)
+#define OUTPUT_FILTERED (OUTPUT_FORMAT == OUTPUT_FORMAT_BATCHED || \
+                         OUTPUT_FORMAT == OUTPUT_FORMAT_COMPRESSED)
+
+/*Brief addresses probed for sensors at boot, from LIS3DH_DEVICE_ADDRESS (the sensor
+with INT1 wired): 0x18 and 0x19 through SA0, more behind address translators. The
+samples path keeps a state per sensor; the A0..C0 frames have no room for a device
+ID, so the bridge format reads one sensor only, as does the events format: the
+engines of the others could not reach the CPU */
+#ifndef SENSOR_ADDRESS_COUNT
+    #define SENSOR_ADDRESS_COUNT 2
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_BRIDGE || OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    #define SENSOR_MAX_DEVICES 1
+#else
+    #define SENSOR_MAX_DEVICES SENSOR_ADDRESS_COUNT
+#endif
+
+/*Brief 1 to send every magnitude bin of the spectra (FRAME_TYPE_SPECTRUM), 0 for
+the SPECTRUM_PEAKS highest peaks per axis only (FRAME_TYPE_PEAKS) */
+#ifndef SPECTRUM_SEND_BINS
+    #define SPECTRUM_SEND_BINS 0
+#endif
+
+/*Brief FRAME_TYPE_SPECTRUM frames sent per batch: the bins of a transform are
+spread over the next batches, the UART buffers would not hold them at once */
+#define SPECTRUM_FRAMES_PER_BATCH 2
+
+//Brief FRAME_TYPE_SPECTRUM frames of an axis: bins 1 .. N/2
+#define SPECTRUM_AXIS_FRAMES ((SPECTRUM_POINTS/2 + SPECTRUM_BINS_PER_FRAME - 1)/SPECTRUM_BINS_PER_FRAME)
+
+//Brief configuration byte of the samples frames (LIS3DH_Mode values match Frame_Mode)
+#define FRAME_CONFIG_SENSOR FRAME_CONFIG(lis3dh_config.odr, lis3dh_config.mode, \
+                                         lis3dh_config.full_scale)
+
+/*Brief conversion of output blocks into mg: one set of functions per mode and full
+scale with the sensitivity built in, Converters[mode][full_scale] (see LIS3DH_Convert.h) */
+LIS3DH_DEFINE_MG_CONVERTER_TABLE(Converters)
+
+//Brief converter of the current configuration, switched together with the sensor
+static const LIS3DH_Converter* converter = &Converters[SENSOR_MODE][SENSOR_FULL_SCALE];
+
+#if !DATA_READY_FROM_INT1
+/*Brief frequency of the clock counted by the 8-bit Timer_LISD3H: a period of
+100 counts gives the 100 Hz reading rate of the boot configuration */
+#ifndef TIMER_LISD3H_CLOCK_HZ
+    #define TIMER_LISD3H_CLOCK_HZ 10000
+#endif
+#endif
+
+//Brief STATUS (or FIFO SOURCE) REGISTER and output registers filled by the I2C interrupt
+static uint8_t status_reg;
+static uint8_t AccelerationData[6*LIS3DH_FIFO_LENGTH];
+
+//Brief set by the I2C interrupt to the number of samples held in AccelerationData
+static volatile uint8_t samples_ready = 0;
+
+//Brief sensors on the bus, and the one whose FIFO is being drained into AccelerationData
+static BusManager bus;
+static volatile uint8_t drain_device = 0;
+
+/*Brief timestamp [us] of the INT1 event that started the batch in AccelerationData (the
+time the watermark was due for a sensor without INT1), and cycles of the last INT1 event */
+static uint32_t batch_timestamp = 0;
+static uint32_t event_cycles = 0;
+
+/*Brief batch periods without samples after which the sensor is considered lost,
+and lower bound [us] of that timeout for the fastest rates */
+#define SENSOR_STALL_BATCHES 3
+#define SENSOR_STALL_MIN_US 20000
+
+//Brief consecutive failed reads of the sample path and time [us] of the last one
+static volatile uint8_t read_failures = 0;
+static volatile uint32_t failure_timestamp = 0;
+
+//Brief time [us] of the last bus recovery
+static uint32_t recover_timestamp = 0;
+
+#if ACTIVITY_GATED
+//Brief motion gate, and the configuration of the stream while the sensors wait for motion
+static Activity activity;
+static LIS3DH_Config stream_config;
+
+//Brief failed wake-up, tried again without waiting for INT1
+static uint8_t wake_due = 0;
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+//Brief CLICK_SRC and INT1_SRC read but not sent yet, kept across a failed read
+static uint8_t click_source = 0;
+static uint8_t free_fall_source = 0;
+
+/*Brief free fall reported: the IA1 generator watches for its end (any axis above the
+threshold) instead of another free fall, which it would report at every sample */
+static uint8_t falling = 0;
+
+//Brief IA1 switched by a read that failed later, falling not toggled yet
+static uint8_t switched = 0;
+
+//Brief time [us] of the last look at the sensor FIFO
+static uint32_t check_timestamp = 0;
+#endif
+
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE
+//Brief FRAME_TYPE_BOOT frame still to send, once the first batch is out
+static uint8_t boot_report_due = 1;
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_BRIDGE
+//Brief A0..C0 frames of the batch
+static uint8_t OutArray[LIS3DH_BRIDGE_FRAME_SIZE*LIS3DH_FIFO_LENGTH];
+#else
+//Brief payload of the batched frame: configuration byte + samples
+static uint8_t Payload[1 + FRAME_SAMPLE_SIZE*LIS3DH_FIFO_LENGTH];
+#endif
+
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE
+//Brief samples of the batch in mg, filtered and decimated in place
+static int16_t Samples[LIS3DH_FIFO_LENGTH][3];
+#endif
+
+#if OUTPUT_FILTERED
+/*Brief filter chain of every sensor, designed for the current ODR, and the
+FRAME_TYPE_FILTER frame still to send (the same parameters for all) */
+static Filter filters[SENSOR_MAX_DEVICES];
+static uint8_t filter_report_due = 0;
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_COMPRESSED
+//Brief state of the delta encoder of every sensor
+static DeltaCodec_Encoder Encoders[SENSOR_MAX_DEVICES];
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_FEATURES
+//Brief panes of the current statistics window of every sensor
+static Features features[SENSOR_MAX_DEVICES];
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_SPECTRUM
+/*Brief window of samples and spectrum of the last one of every sensor, with its
+frames still to send, the timestamp of the batch that completed it and the
+configuration it was sampled with */
+static Spectrum spectra[SENSOR_MAX_DEVICES];
+static uint8_t spectrum_frame[SENSOR_MAX_DEVICES];
+static uint8_t spectrum_frames[SENSOR_MAX_DEVICES];
+static uint32_t spectrum_timestamp[SENSOR_MAX_DEVICES];
+static uint8_t spectrum_config[SENSOR_MAX_DEVICES];
+#endif
+
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_EVENTS
+static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+
+//Brief asynchronous reading of STATUS REGISTER (FIFO SOURCE REGISTER in FIFO mode)
+static I2C_Peripheral_Transaction status_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+#if LIS3DH_USE_FIFO
+    .register_address = LIS3DH_FIFO_SRC_REG,
+#else
+    .register_address = LIS3DH_STATUS_REG,
+#endif
+    .register_count = 1,
+    .data = &status_reg,
+    .callback = StatusRead_Done
+};
+
+//Brief asynchronous multiple register reading starting from OUT_X_L
+static I2C_Peripheral_Transaction data_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_OUT_X_L,
+    .register_count = 6,
+    .data = AccelerationData,
+    .callback = DataRead_Done
+};
+#endif
+
+/*Brief account for an overrun of the drained sensor seen in status_reg
+(FIFO_SRC_REG[6]=OVRN_FIFO, STATUS_REG[7]=ZYXOR without the FIFO) before it is
+emptied of count samples. The samples lost are those produced since the previous
+read beyond what the sensor holds */
+static void CheckOverrun(uint8_t count)
+{
+    uint32_t now = Timestamp_Now();
+    uint32_t elapsed = now - bus.devices[drain_device].drain_timestamp;
+#if LIS3DH_USE_FIFO
+    uint8_t overrun = (status_reg & 0x40) > 0;
+    uint32_t capacity = LIS3DH_FIFO_LENGTH;
+#else
+    uint8_t overrun = (status_reg & 0x80) > 0;
+    uint32_t capacity = 1;
+#endif
+#if ACTIVITY_GATED
+    //While the stream is off the FIFOs keep the last samples only, by design
+    overrun = overrun && !activity.idle;
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    //The FIFO keeps the snapshot of the next event only, by design
+    overrun = 0;
+#endif
+    if (overrun)
+    {
+        uint64_t odr_hz = LIS3DH_OdrHz(lis3dh_config.odr, lis3dh_config.mode);
+        uint32_t produced = (uint32_t)(((uint64_t)elapsed*odr_hz + 500000u)/1000000u);
+        StatusReport_SensorOverrun(produced > capacity ? produced - capacity : 0);
+    }
+    BusManager_Drained(&bus, drain_device, now, count);
+}
+
+//Brief failed read of the sample path: the main loop tries again after the backoff
+static void ReadFailed(void)
+{
+    Trace_Abort();
+    failure_timestamp = Timestamp_Now();
+    if (read_failures < 0xFF)
+    {
+        read_failures++;
+    }
+}
+
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_EVENTS
+static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+{
+    if (error != NO_ERROR)
+    {
+        ReadFailed();
+        return;
+    }
+    read_failures = 0;
+    Trace_Mark(TRACE_STAGE_STATUS);
+    uint8_t wired = bus.devices[drain_device].wired;
+#if LIS3DH_USE_FIFO
+    // FIFO_SRC_REG[6]=OVRN_FIFO=1 means all 32 levels are full,
+    // otherwise FIFO_SRC_REG[4:0]=FSS[4:0] is the number of unread samples
+    uint8_t count = (status_reg & 0x40) ? LIS3DH_FIFO_LENGTH : (status_reg & 0x1F);
+    // Check if the watermark has been reached (FIFO_SRC_REG[7]=WTM=1); a sensor
+    // without INT1 is drained of whatever it holds when its watermark is due
+    if ((status_reg & 0x80) > 0 || (!wired && count > 0))
+    {
+        CheckOverrun(count);
+        // The whole batch in one burst: reads wrap from OUT_Z_H to OUT_X_L
+        data_read.register_count = 6*count;
+        if (I2C_Peripheral_Submit(&data_read) != NO_ERROR)
+        {
+            ReadFailed();
+        }
+        return;
+    }
+#else
+    // Check if new data is available (STATUS_REG[3]=ZYXDA=1)
+    if ((status_reg & 0x08) > 0)
+    {
+        CheckOverrun(1);
+        // Chain the burst read without going back to the main loop
+        if (I2C_Peripheral_Submit(&data_read) != NO_ERROR)
+        {
+            ReadFailed();
+        }
+        return;
+    }
+#endif
+    //No new data: the batch ends here, an empty sensor without INT1 is due a period later
+    if (!wired)
+    {
+        BusManager_Drained(&bus, drain_device, Timestamp_Now(), 0);
+    }
+    Trace_Abort();
+}
+
+static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+{
+    if (error == NO_ERROR)
+    {
+        Trace_Mark(TRACE_STAGE_BURST);
+        samples_ready = transaction->register_count/6;
+    }
+    else
+    {
+        ReadFailed();
+    }
+}
+#endif
+
+#if OUTPUT_FILTERED
+/*Brief whole batch in AccelerationData converted into Samples, filtered and decimated by
+the chain of the sensor: returns the number of samples left, 0 if the decimator keeps none of this batch */
+static uint8_t FilterBatch(uint8_t device, uint8_t count)
+{
+    converter->to_samples(AccelerationData, Samples, count);
+    return Filter_Process(&filters[device], Samples, count);
+}
+#endif
+
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE
+//Brief frame of a sensor, named first by a FRAME_TYPE_DEVICE frame when needed
+static ErrorCode SendFrom(uint8_t device, uint8_t type, uint32_t timestamp,
+                          const uint8_t* payload, uint8_t length)
+{
+    return Frame_SendFrom(device, bus.devices[device].address, type, timestamp, payload, length);
+}
+#endif
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_SPECTRUM
+/*Brief frame of the last spectrum of a sensor: the bins of an axis from a multiple
+of 64, or the peaks */
+static ErrorCode SendSpectrum(uint8_t device, uint8_t frame)
+{
+    uint8_t length;
+#if SPECTRUM_SEND_BINS
+    length = Spectrum_ReportBins(&spectra[device], spectrum_config[device], frame/SPECTRUM_AXIS_FRAMES,
+                                 (uint16_t)(1 + (frame % SPECTRUM_AXIS_FRAMES)*SPECTRUM_BINS_PER_FRAME),
+                                 Payload);
+    return SendFrom(device, FRAME_TYPE_SPECTRUM, spectrum_timestamp[device], Payload, length);
+#else
+    length = Spectrum_ReportPeaks(&spectra[device], spectrum_config[device], SPECTRUM_PEAKS, Payload);
+    return SendFrom(device, FRAME_TYPE_PEAKS, spectrum_timestamp[device], Payload, length);
+#endif
+}
+#endif
+
+/*Brief whole batch of a sensor in AccelerationData converted in one pass, straight
+into the output format */
+static void SendBatch(uint8_t device, uint8_t count, uint32_t timestamp)
+{
+    ErrorCode error;
+#if OUTPUT_FILTERED
+    if (filter_report_due)
+    {
+        //Ahead of the samples it applies to
+        uint8_t report[FILTER_REPORT_SIZE];
+        Filter_Report(&filters[0], FRAME_CONFIG_SENSOR, report);
+        filter_report_due = Frame_Send(FRAME_TYPE_FILTER, timestamp, report, FILTER_REPORT_SIZE) != NO_ERROR;
+    }
+#endif
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_BRIDGE
+    //Frames are queued for the TX DMA: the loop does not wait for the UART
+    converter->to_bridge(AccelerationData, OutArray, count);
+    Trace_Mark(TRACE_STAGE_CONVERT);
+    error = UART_Stream_Write(OutArray, LIS3DH_BRIDGE_FRAME_SIZE*count);
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_FEATURES
+    //Summaries of the windows the batch completes, stamped with its INT1 event
+    converter->to_samples(AccelerationData, Samples, count);
+    Trace_Mark(TRACE_STAGE_CONVERT);
+    uint8_t summaries = 0;
+    error = NO_ERROR;
+    Features* window = &features[device];
+    for (uint8_t i = 0; i < count; )
+    {
+        i += Features_Add(window, &Samples[i], count - i);
+        if (Features_IsReady(window))
+        {
+            Features_Report(window, FRAME_CONFIG_SENSOR, Payload);
+            summaries++;
+            if (SendFrom(device, FRAME_TYPE_FEATURES, timestamp, Payload, FEATURES_REPORT_SIZE) != NO_ERROR)
+            {
+                //The samples of a lost window
+                StatusReport_SamplesDropped((uint32_t)window->pane_count*window->pane_samples);
+                error = ERROR;
+            }
+        }
+    }
+    if (summaries == 0 || error != NO_ERROR)
+    {
+        //Nothing to wait for on the UART
+        Trace_Abort();
+        return;
+    }
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_SPECTRUM
+    //Transform of the windows the batch completes, stamped with its INT1 event
+    converter->to_samples(AccelerationData, Samples, count);
+    Trace_Mark(TRACE_STAGE_CONVERT);
+    Spectrum* spectrum = &spectra[device];
+    for (uint8_t i = 0; i < count; )
+    {
+        i += Spectrum_Add(spectrum, &Samples[i], count - i);
+        if (Spectrum_IsReady(spectrum))
+        {
+            if (spectrum_frame[device] < spectrum_frames[device])
+            {
+                //The UART has not kept up with the previous transform
+                StatusReport_SamplesDropped(spectrum->points);
+            }
+            Spectrum_Compute(spectrum);
+            spectrum_frame[device] = 0;
+            spectrum_frames[device] = SPECTRUM_SEND_BINS ? 3*SPECTRUM_AXIS_FRAMES : 1;
+            spectrum_timestamp[device] = timestamp;
+            spectrum_config[device] = FRAME_CONFIG_SENSOR;
+        }
+    }
+    uint8_t sent = 0;
+    error = NO_ERROR;
+    while (sent < SPECTRUM_FRAMES_PER_BATCH && spectrum_frame[device] < spectrum_frames[device])
+    {
+        sent++;
+        if (SendSpectrum(device, spectrum_frame[device]++) != NO_ERROR)
+        {
+            //The rest of a transform with a frame lost is not worth sending
+            StatusReport_SamplesDropped(spectrum->points);
+            spectrum_frame[device] = spectrum_frames[device];
+            error = ERROR;
+        }
+    }
+    if (sent == 0 || error != NO_ERROR)
+    {
+        //Nothing to wait for on the UART
+        Trace_Abort();
+        return;
+    }
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    //No samples frames: what is left in the FIFO at a configuration switch is dropped
+    Trace_Abort();
+    return;
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_COMPRESSED
+    uint8_t PayloadType;
+    count = FilterBatch(device, count);
+    if (count == 0)
+    {
+        Trace_Abort();
+        return;
+    }
+    uint8_t PayloadLength = DeltaCodec_Encode(&Encoders[device], FRAME_CONFIG_SENSOR,
+                                              Samples, count,
+                                              Payload, &PayloadType);
+    Trace_Mark(TRACE_STAGE_CONVERT);
+    //A dropped frame breaks the delta chain: restart from a keyframe
+    error = SendFrom(device, PayloadType, timestamp, Payload, PayloadLength);
+    if (error != NO_ERROR)
+    {
+        DeltaCodec_Reset(&Encoders[device]);
+    }
+#else
+    //Samples appended to the configuration byte, little-endian x, y, z
+    Payload[0] = FRAME_CONFIG_SENSOR;
+    if (Filter_IsBypassed(&filters[device]))
+    {
+        converter->to_payload(AccelerationData, &Payload[1], count);
+    }
+    else
+    {
+        count = FilterBatch(device, count);
+        if (count == 0)
+        {
+            Trace_Abort();
+            return;
+        }
+        for (uint8_t i = 0; i < count; i++)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                Payload[1 + 6*i + 2*axis] = (uint8_t)(Samples[i][axis] & 0xFF);
+                Payload[2 + 6*i + 2*axis] = (uint8_t)((uint16_t)Samples[i][axis] >> 8);
+            }
+        }
+    }
+    Trace_Mark(TRACE_STAGE_CONVERT);
+    //Whole batch in one frame, stamped with the INT1 event that started it
+    error = SendFrom(device, FRAME_TYPE_SAMPLES, timestamp, Payload, 1 + FRAME_SAMPLE_SIZE*count);
+#endif
+    if (error == NO_ERROR)
+    {
+        Trace_Mark(TRACE_STAGE_ENQUEUE);
+    }
+    else
+    {
+        Trace_Abort();
+        StatusReport_SamplesDropped(count);
+    }
+}
+
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE
+//Brief FRAME_TYPE_BOOT frame: times of the boot phases, little-endian
+static ErrorCode SendBootReport(void)
+{
+    uint8_t report[FRAME_BOOT_SIZE];
+    Boot_Mark(BOOT_DIAGNOSTICS);
+    for (uint8_t phase = 0; phase < BOOT_PHASES; phase++)
+    {
+        uint32_t time = Boot_Time((Boot_Phase)phase);
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            report[4*phase + i] = (uint8_t)(time >> (8*i));
+        }
+    }
+    return Frame_Send(FRAME_TYPE_BOOT, Timestamp_Now(), report, FRAME_BOOT_SIZE);
+}
+#endif
+
+#if !DATA_READY_FROM_INT1
+/*Brief Timer_LISD3H period for the current ODR: the FIFO is polled before the
+samples past the watermark can fill it (every sample without the FIFO), and
+at least at the 100 Hz of boot */
+static uint8_t TimerPeriod(void)
+{
+    uint32_t odr_hz = LIS3DH_OdrHz(lis3dh_config.odr, lis3dh_config.mode);
+#if LIS3DH_USE_FIFO
+    uint32_t counts = TIMER_LISD3H_CLOCK_HZ*(LIS3DH_FIFO_LENGTH - LIS3DH_FIFO_WATERMARK)/odr_hz;
+#else
+    uint32_t counts = TIMER_LISD3H_CLOCK_HZ/odr_hz;
+#endif
+    if (counts > TIMER_LISD3H_CLOCK_HZ/100)
+    {
+        counts = TIMER_LISD3H_CLOCK_HZ/100;
+    }
+    //The timer counts period + 1 clocks
+    return (uint8_t)(counts > 1 ? counts - 1 : 0);
+}
+#endif
+
+/*Brief time [us] for a FIFO to fill up to the watermark at the current ODR (one
+sample without the FIFO): the batch period */
+static uint32_t DrainPeriod(void)
+{
+    uint32_t odr_hz = LIS3DH_OdrHz(lis3dh_config.odr, lis3dh_config.mode);
+#if LIS3DH_USE_FIFO
+    return (uint32_t)(1000000ull*LIS3DH_FIFO_WATERMARK/odr_hz);
+#else
+    return 1000000u/odr_hz;
+#endif
+}
+
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+//Brief samples of a time [ms] at the ODR of a configuration, rounded up, at most max
+static uint8_t EventSamples(const LIS3DH_Config* config, uint32_t ms, uint8_t max)
+{
+    uint32_t samples = (ms*LIS3DH_OdrHz(config->odr, config->mode) + 999u)/1000u;
+    return (uint8_t)(samples > max ? max : samples);
+}
+
+/*Brief click engine and free-fall generator of a sensor, after its configuration: the
+thresholds follow the full scale, the times the ODR */
+static ErrorCode ConfigureEvents(uint8_t address, const LIS3DH_Config* config)
+{
+    falling = 0;
+    switched = 0;
+    ErrorCode error = LIS3DH_ConfigureClick(address, config->full_scale, EVENTS_CLICK_THRESHOLD_MG,
+                                            EventSamples(config, EVENTS_CLICK_LIMIT_MS, 0x7F),
+                                            EventSamples(config, EVENTS_CLICK_LATENCY_MS, 0xFF), 1);
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_ConfigureFreeFall(address, config->full_scale, EVENTS_FREE_FALL_MG,
+                                         EventSamples(config, EVENTS_FREE_FALL_MS, 0x7F));
+    }
+    return error;
+}
+#endif
+
+/*Brief write a configuration to every sensor of the bus, from its own address: all
+are tried, the first error is returned */
+static ErrorCode ConfigureSensors(const LIS3DH_Config* config)
+{
+    LIS3DH_Config sensor = *config;
+    ErrorCode error = NO_ERROR;
+    for (uint8_t device = 0; device < bus.count; device++)
+    {
+        sensor.device_address = bus.devices[device].address;
+        ErrorCode result = LIS3DH_Configure(&sensor);
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+        if (result == NO_ERROR)
+        {
+            result = ConfigureEvents(sensor.device_address, &sensor);
+        }
+#endif
+        if (error == NO_ERROR)
+        {
+            error = result;
+        }
+    }
+    return error;
+}
+
+/*Brief last batch of the old configuration of a sensor in power-down: what is left
+in its FIFO (output registers without the FIFO) read with blocking transfers and
+sent with the old conversion */
+static ErrorCode DrainSensor(uint8_t device)
+{
+    uint8_t address = bus.devices[device].address;
+    drain_device = device;
+#if LIS3DH_USE_FIFO
+    //Unread samples: FIFO_SRC_REG[6]=OVRN_FIFO or FIFO_SRC_REG[4:0]=FSS[4:0]
+    ErrorCode error = I2C_Peripheral_ReadRegister(address, LIS3DH_FIFO_SRC_REG, &status_reg);
+    uint8_t count = (status_reg & 0x40) ? LIS3DH_FIFO_LENGTH : (status_reg & 0x1F);
+#else
+    //Unread sample: STATUS_REG[3]=ZYXDA
+    ErrorCode error = I2C_Peripheral_ReadRegister(address, LIS3DH_STATUS_REG, &status_reg);
+    uint8_t count = (status_reg & 0x08) ? 1 : 0;
+#endif
+    if (error != NO_ERROR || count == 0)
+    {
+        return error;
+    }
+    CheckOverrun(count);
+    error = I2C_Peripheral_ReadRegisterMulti(address, LIS3DH_OUT_X_L, 6*count, AccelerationData);
+    if (error == NO_ERROR)
+    {
+        uint32_t now = Timestamp_Now();
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE
+        if (StatusReport_IsDue(now))
+        {
+            StatusReport_Send(now);
+        }
+#endif
+        SendBatch(device, count, now);
+    }
+    return error;
+}
 
-//Brief WHO AM I register address
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
+/*Brief switch every sensor to a new configuration, with no I2C transaction in flight
+and AccelerationData free. The sensors are put in power-down first, so that the FIFOs
+only hold samples of the old configuration: they are read and sent with the old
+conversion, then the registers of the new configuration that differ from the shadow
+(CTRL_REG1 at least, out of power-down) are written and the conversion, the
+configuration byte of the frames and the timer follow it. No sample is lost, the
+sensors just produce none during the switch */
+static ErrorCode ApplyConfig(const LIS3DH_Config* config)
+{
+    LIS3DH_Config next = *config;
+    
+    //Power-down mode (CTRL_REG1[7:4]=ODR=0000): a single write, CTRL_REG1 is shadowed
+    ErrorCode error = NO_ERROR;
+    for (uint8_t device = 0; device < bus.count && error == NO_ERROR; device++)
+    {
+        error = LIS3DH_UpdateRegister(bus.devices[device].address, LIS3DH_CTRL_REG1, 0xF0,
+                                      LIS3DH_ODR_POWER_DOWN << 4);
+    }
+    for (uint8_t device = 0; device < bus.count && error == NO_ERROR; device++)
+    {
+        error = DrainSensor(device);
+    }
+    if (error == NO_ERROR)
+    {
+        error = ConfigureSensors(&next);
+    }
+    if (error != NO_ERROR)
+    {
+        //Sampling resumes with the old configuration
+        ConfigureSensors(&lis3dh_config);
+        return error;
+    }
+    
+    lis3dh_config = next;
+    converter = &Converters[next.mode][next.full_scale];
+    for (uint8_t device = 0; device < bus.count; device++)
+    {
+#if OUTPUT_FILTERED
+        //Filters designed again for the new ODR, starting from the next sample
+        Filter_Configure(&filters[device], LIS3DH_OdrHz(next.odr, next.mode));
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_FEATURES
+        //Windows sized for the new ODR: the partial one of the old ODR is dropped
+        Features_Configure(&features[device], LIS3DH_OdrHz(next.odr, next.mode), FEATURES_WINDOW_MS,
+                           FEATURES_PANES, FEATURES_HYSTERESIS_MG);
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_SPECTRUM
+        //The partial window of the old ODR is dropped, the frames of its last spectrum still go
+        Spectrum_Configure(&spectra[device], SPECTRUM_POINTS);
+#endif
+    }
+#if OUTPUT_FILTERED
+    filter_report_due = 1;
+#endif
+#if ACTIVITY_GATED
+    Activity_SetScale(&activity, next.mode, next.full_scale);
+#endif
+    //The sensors start again from empty FIFOs
+    BusManager_Start(&bus, DrainPeriod(), Timestamp_Now());
+#if !DATA_READY_FROM_INT1
+    Timer_LISD3H_WritePeriod(TimerPeriod());
+#endif
+    return NO_ERROR;
+}
 
-//Brief STATUS REGISTER address
-#define LIS3DH_STATUS_REG 0x27
+/*Brief switch to the configuration byte of a FRAME_TYPE_CONFIG command (see Command.h).
+A byte with no valid mode or ODR is counted as a rejected command; a switch failed on
+the bus (the old configuration written back) is a failed read, retried and recovered
+like one */
+static void SwitchConfig(uint8_t config)
+{
+    LIS3DH_Config next = lis3dh_config;
+    next.odr = (LIS3DH_Odr)(config >> 4);
+    next.mode = (LIS3DH_Mode)((config >> 2) & 0x03);
+    next.full_scale = (LIS3DH_FullScale)(config & 0x03);
+    if (next.mode > LIS3DH_MODE_HIGH_RESOLUTION || LIS3DH_OdrHz(next.odr, next.mode) == 0)
+    {
+        Command_Reject();
+        return;
+    }
+    if (ApplyConfig(&next) != NO_ERROR)
+    {
+        ReadFailed();
+    }
+}
 
-//Brieg CONTROL REGISTER 1 address
-#define LIS3DH_CTRL_REG1 0x20
 
-/*Brief HEX value for CONTROL REGISTER 1: High resolution mode at 100 Hz
-CTRL_REG1[3]=LPen=0 (HR mode);
-CTRL_REG1[7:4]=ODR[3:0]=0101 (100 Hz)*/
-#define LIS3DH_NORMAL_MODE_100_HZ_CTRL_REG1 0x57
+/*Brief time [us] without batches after which the sensors are recovered: a few batch
+periods, SENSOR_STALL_MIN_US at least */
+static uint32_t StallTimeout(void)
+{
+    uint32_t timeout = SENSOR_STALL_BATCHES*DrainPeriod();
+    return timeout > SENSOR_STALL_MIN_US ? timeout : SENSOR_STALL_MIN_US;
+}
 
+/*Brief bring the bus back to idle (SCL clocked until SDA is released, I2C_Master
+restarted) and write the whole configuration again from lis3dh_config to every
+sensor: a sensor reset by a brown-out is back in power-down with its FIFO and INT1
+off. The samples left in the FIFOs are read with the next batches, their loss
+estimated as usual */
+static void RecoverSensor(void)
+{
+    Trace_Abort();
+    recover_timestamp = Timestamp_Now();
+    ErrorCode error = I2C_Peripheral_Recover();
+    if (error == NO_ERROR)
+    {
+        //The register shadow is empty: every register is written
+        error = ConfigureSensors(&lis3dh_config);
+    }
+    //A failed recovery starts a new round of retries
+    read_failures = error == NO_ERROR ? 0 : 1;
+    failure_timestamp = Timestamp_Now();
+}
 
-//Brief CONTROL REGISTER 4 address
-#define LIS3DH_CTRL_REG4 0x23
-/*Brief HEX value for CONTROL REGISTER 4: +- 4.0 g FSR
-CTRL_REG4[3]=1 (High resolution enabled)
-CTRL_REG4[5:4]=FS[1:0]=01 (4.0 g FSR) */
-#define LIS3DH_CTRL_REG4_2g 0x98
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+/*Brief period [us] of the check of the sensor: EVENTS_CHECK_MS, or the stall timeout of
+the slowest rates, which fill the FIFO slowly */
+static uint32_t CheckPeriod(void)
+{
+    uint32_t period = (uint32_t)EVENTS_CHECK_MS*1000u;
+    return StallTimeout() > period ? StallTimeout() : period;
+}
 
-//Brief OUT_X_L register address (x-axis output LSB)
-#define LIS3DH_OUT_X_L 0x28
+/*Brief event latched on INT1, with no I2C transaction in flight: CLICK_SRC and INT1_SRC
+are read, which releases the latches and INT1, then the FIFO with the samples that led to
+the event, with blocking transfers (events are rare). After a free fall the IA1 generator
+is switched to its end, then back. One FRAME_TYPE_EVENT frame goes out per source that has
+fired, stamped with the INT1 event, after the status frame if one is due: nothing else is
+sent. A failed read is tried again after the backoff */
+static void ReadEvents(uint32_t timestamp)
+{
+    uint8_t source;
+    uint8_t count = 0;
+    Trace_Begin(event_cycles);
+    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CLICK_SRC, &source);
+    if (error == NO_ERROR)
+    {
+        click_source |= source;
+        error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_INT1_SRC, &source);
+    }
+    if (error == NO_ERROR)
+    {
+        free_fall_source |= source;
+        Trace_Mark(TRACE_STAGE_STATUS);
+    }
+    if (error == NO_ERROR && (free_fall_source & LIS3DH_SRC_IA) && !switched)
+    {
+        /*IA1 from free fall to its end (any axis back above the threshold) and back; what it
+        latched in between under the old condition is dropped */
+        uint8_t duration = EventSamples(&lis3dh_config, EVENTS_FREE_FALL_MS, 0x7F);
+        error = falling ?
+            LIS3DH_ConfigureFreeFall(LIS3DH_DEVICE_ADDRESS, lis3dh_config.full_scale,
+                                     EVENTS_FREE_FALL_MG, duration) :
+            LIS3DH_ConfigureMotion(LIS3DH_DEVICE_ADDRESS, lis3dh_config.full_scale,
+                                   EVENTS_FREE_FALL_MG, duration);
+        if (error == NO_ERROR)
+        {
+            switched = 1;
+            error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_INT1_SRC, &source);
+        }
+    }
+    if (error == NO_ERROR)
+    {
+        error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_FIFO_SRC_REG, &status_reg);
+        count = (status_reg & 0x40) ? LIS3DH_FIFO_LENGTH : (status_reg & 0x1F);
+    }
+    //Start of a free fall, or the end of the one reported, which is not sent
+    uint8_t fall = (free_fall_source & LIS3DH_SRC_IA) && !falling;
+    uint8_t fired = (click_source & LIS3DH_SRC_IA) || fall;
+    if (error == NO_ERROR && fired && count > 0)
+    {
+        //The snapshot: the whole FIFO in one burst
+        error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_OUT_X_L, 6*count,
+                                                 AccelerationData);
+    }
+    if (error != NO_ERROR)
+    {
+        ReadFailed();
+        return;
+    }
+    read_failures = 0;
+    check_timestamp = Timestamp_Now();
+    if (switched)
+    {
+        falling = !falling;
+        switched = 0;
+    }
+    if (!fired)
+    {
+        //Edge of an event already served, or the end of a free fall
+        free_fall_source = 0;
+        Trace_Abort();
+        return;
+    }
+    Trace_Mark(TRACE_STAGE_BURST);
+    if (count > 0)
+    {
+        converter->to_samples(AccelerationData, Samples, count);
+    }
+    Trace_Mark(TRACE_STAGE_CONVERT);
+    
+    uint32_t now = Timestamp_Now();
+    if (StatusReport_IsDue(now))
+    {
+        StatusReport_Send(now);
+    }
+    if (click_source & LIS3DH_SRC_IA)
+    {
+        Events_Report(EVENTS_CLICK, Events_ClickAxes(click_source), FRAME_CONFIG_SENSOR, Samples, count, Payload);
+        error = SendFrom(0, FRAME_TYPE_EVENT, timestamp, Payload, EVENTS_REPORT_SIZE);
+    }
+    if (fall)
+    {
+        Events_Report(EVENTS_FREE_FALL, Events_FreeFallAxes(free_fall_source), FRAME_CONFIG_SENSOR,
+                      Samples, count, Payload);
+        if (SendFrom(0, FRAME_TYPE_EVENT, timestamp, Payload, EVENTS_REPORT_SIZE) != NO_ERROR)
+        {
+            error = ERROR;
+        }
+    }
+    click_source = 0;
+    free_fall_source = 0;
+    if (error == NO_ERROR)
+    {
+        Trace_Mark(TRACE_STAGE_ENQUEUE);
+    }
+    else
+    {
+        Trace_Abort();
+    }
+}
 
-//Brief OUT_Y_L register address (y-axis output LSB)
-#define LIS3DH_OUT_Y_L 0x2A
+/*Brief no samples come out to show that the sensor runs: its FIFO, in stream mode, must
+have samples a check period after the last read. An empty one (FIFO_SRC_REG[5]=EMPTY)
+is a sensor reset by a brown-out, back in power-down with its FIFO and engines off */
+static void CheckSensor(void)
+{
+    check_timestamp = Timestamp_Now();
+    if (I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_FIFO_SRC_REG, &status_reg) != NO_ERROR)
+    {
+        ReadFailed();
+    }
+    else if (status_reg & 0x20)
+    {
+        RecoverSensor();
+    }
+}
+#endif
 
-//Brief OUT_Z_L register address (z-axis output LSB)
-#define LIS3DH_OUT_Z_L 0x2C
+#if ACTIVITY_GATED
+/*Brief stop the stream, with no I2C transaction in flight: the last samples go out and
+the sensors drop to low-power mode at ACTIVITY_IDLE_ODR, the FIFOs in stream mode. The
+IA1 generator of the sensor with INT1 is started on high-pass data (REFERENCE read
+restarts the filter from the current acceleration) and latched on INT1. On an error
+the stream goes on for another timeout */
+static void IdleSensors(void)
+{
+    LIS3DH_Config idle = lis3dh_config;
+    idle.odr = ACTIVITY_IDLE_ODR;
+    idle.mode = LIS3DH_MODE_LOW_POWER;
+    idle.int1 = LIS3DH_INT1_IA1;
+    idle.int1_latch = 1;
+    idle.int1_highpass = 1;
+    
+    stream_config = lis3dh_config;
+    ErrorCode error = ApplyConfig(&idle);
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_ConfigureMotion(LIS3DH_DEVICE_ADDRESS, idle.full_scale,
+                                       ACTIVITY_THRESHOLD_MG, ACTIVITY_DURATION);
+    }
+    if (error == NO_ERROR)
+    {
+        uint8_t reference;
+        error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_REFERENCE, &reference);
+    }
+    if (error != NO_ERROR)
+    {
+        Activity_Wake(&activity, Timestamp_Now());
+        return;
+    }
+    Activity_Sleep(&activity);
+}
 
-//Brief HEADER and FOOTER values for UART communication
-#define HEADER 0xA0
-#define FOOTER 0xC0
+/*Brief motion (or a command): the IA1 generator is stopped and its latch released
+(INT1_SRC read while LIR_INT1 is still set), then the stream configuration comes back,
+the history held by the FIFOs sent first with the low-power conversion. On an error
+the bus is recovered and the wake-up tried again after the next Sleep */
+static void WakeSensors(void)
+{
+    uint8_t source;
+    ErrorCode error = LIS3DH_ConfigureMotion(LIS3DH_DEVICE_ADDRESS, lis3dh_config.full_scale, 0, 0);
+    if (error == NO_ERROR)
+    {
+        error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_INT1_SRC, &source);
+    }
+    if (error == NO_ERROR)
+    {
+        error = ApplyConfig(&stream_config);
+    }
+    wake_due = error != NO_ERROR;
+    if (wake_due)
+    {
+        RecoverSensor();
+        return;
+    }
+    Activity_Wake(&activity, Timestamp_Now());
+}
+#endif
 
-//Brief value of sensitivity in High Resolution mode (2 mg/digit)
-#define HR_SENSITIVITY 2;
+/*Brief time [us] the CPU can stay halted, called with interrupts disabled: 0 with
+work waiting, until the retry of a failed read or the next sensor without INT1 is
+due, or no deadline. The INT1, I2C, UART
+and SysTick interrupts wake it, so status frames and the stall watchdog are checked
+every millisecond at least. While the stream is off (ACTIVITY_GATED) INT1 is
+checked every ACTIVITY_POLL_US, the CPU sleeping in between (see CanSleep()) */
+static uint32_t IdleTime(void)
+{
+    if (samples_ready > 0)
+    {
+        return 0;
+    }
+    if (I2C_Peripheral_IsBusy())
+    {
+        //The completion interrupt brings the next step
+        return LOW_POWER_NO_DEADLINE;
+    }
+#if FLASH_LOG
+    if (FlashLog_IsPending() || (FlashLog_IsDumping() && !UART_Stream_IsBusy()))
+    {
+        return 0;
+    }
+#endif
+    if (UART_Debug_GetRxBufferSize() > 0 || !EventQueue_IsEmpty() ||
+        read_failures > I2C_PERIPHERAL_RETRIES)
+    {
+        return 0;
+    }
+    if (read_failures > 0)
+    {
+        uint32_t waited = Timestamp_Now() - failure_timestamp;
+        uint32_t backoff = (uint32_t)I2C_PERIPHERAL_BACKOFF_US << read_failures;
+        return waited < backoff ? backoff - waited : 0;
+    }
+#if DATA_READY_FROM_INT1
+    if (Pin_INT1_Read())
+    {
+        return 0;
+    }
+#endif
+#if ACTIVITY_GATED
+    if (activity.idle)
+    {
+        //No drain is due: only the latched IA1 (or a failed wake-up) ends the wait
+        return wake_due ? 0 : ACTIVITY_POLL_US;
+    }
+#endif
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    //Only INT1 and the next check of the sensor
+    uint32_t waited = Timestamp_Now() - check_timestamp;
+    return waited < CheckPeriod() ? CheckPeriod() - waited : 0;
+#else
+    return BusManager_TimeToDue(&bus, Timestamp_Now());
+#endif
+}
 
-extern uint8_t flag;
+/*Brief the clocks can be stopped (Sleep mode), called with interrupts disabled: only
+while the stream is off, with the bus idle and the last byte shifted out of the UART.
+TX_STS_COMPLETE is cleared on read, so it is latched until the next frame. Otherwise
+no Sleep: SysTick stamps the samples and commands come in on the UART RX line, and
+are lost while the CPU sleeps */
+static uint8_t CanSleep(void)
+{
+#if ACTIVITY_GATED
+    static uint32_t written = 0;
+    static uint8_t uart_done = 1;
+    uint32_t count = UART_Stream_GetWrittenCount();
+    if (count != written)
+    {
+        written = count;
+        uart_done = 0;
+    }
+    if (!uart_done && !UART_Stream_IsBusy())
+    {
+        uart_done = (UART_Debug_ReadTxStatus() & UART_Debug_TX_STS_COMPLETE) != 0;
+    }
+    return activity.idle && uart_done && !I2C_Peripheral_IsBusy();
+#else
+    return 0;
+#endif
+}
 
 int main(void)
 {
     CyGlobalIntEnable; 
     
     //Initialization
+    Timestamp_Start();
+    Boot_Reset();
+    LowPower_Start();
+    Trace_Start();
+    EventQueue_Reset();
+#if !DATA_READY_FROM_INT1
     Timer_LISD3H_Start();
+#endif
     I2C_Peripheral_Start();
-    UART_Debug_Start();
+    UART_Stream_Start();
     ISR_DataReady_StartEx(DataReady_ISR);
     
+#if FAST_BOOT
+    /*Sensor with INT1 polled until it answers and sampling first, the others looked
+    for afterwards. One still booting after the timeout is left to the stall recovery */
+    if (LIS3DH_WaitBoot(LIS3DH_DEVICE_ADDRESS, LIS3DH_BOOT_TIMEOUT_US) == NO_ERROR)
+    {
+        Boot_Mark(BOOT_SENSOR_READY);
+        LIS3DH_Configure(&lis3dh_config);
+        Boot_Mark(BOOT_CONFIGURED);
+    }
+#else
     //"The boot procedure is complete about 5 milliseconds after device power-up."
     CyDelay(5); 
+#endif
    
-    //Reading CONTROL REGISTER 1
-    uint8_t ctrl_reg1; 
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
-    //Writing CONTROL REGISTER 1
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_100_HZ_CTRL_REG1)
-    {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_100_HZ_CTRL_REG1;
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);  
-    }
-   
-    // Reading CONTROL REGISTER 4   
-    uint8_t ctrl_reg4;
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4); 
-    // Writing CONTROL REGISTER 4
-    if (ctrl_reg4 != LIS3DH_CTRL_REG4_2g)
-    {
-        ctrl_reg4 = LIS3DH_CTRL_REG4_2g;
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_CTRL_REG4,
-                                         ctrl_reg4);
+    //Sensors answering WHO_AM_I on the bus (see BusManager.h)
+    if (BusManager_Discover(&bus, LIS3DH_DEVICE_ADDRESS, SENSOR_MAX_DEVICES, LIS3DH_DEVICE_ADDRESS) > 0)
+    {
+        Boot_Mark(BOOT_SENSOR_READY);
     }
     
-     //Brief output acceleration data variables:
-    uint8_t AccelerationData[6];
-   
-    //x-axis
-    int16_t X_Out;
-    int16_t X_Out_mg;
-    //y-axis
-    int16_t Y_Out;
-    int16_t Y_Out_mg;
-    //z-axis
-    int16_t Z_Out;
-    int16_t Z_Out_mg;
+    //Whole sensor configuration in one burst per sensor (see LIS3DH.h), none for one already written
+    ConfigureSensors(&lis3dh_config);
+    Boot_Mark(BOOT_CONFIGURED);
     
-    uint8_t OutArray[8];
+    for (uint8_t device = 0; device < bus.count; device++)
+    {
+#if OUTPUT_FILTERED
+        Filter_Configure(&filters[device], LIS3DH_OdrHz(lis3dh_config.odr, lis3dh_config.mode));
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_FEATURES
+        Features_Configure(&features[device], LIS3DH_OdrHz(lis3dh_config.odr, lis3dh_config.mode),
+                           FEATURES_WINDOW_MS, FEATURES_PANES, FEATURES_HYSTERESIS_MG);
+#elif OUTPUT_FORMAT == OUTPUT_FORMAT_SPECTRUM
+        Spectrum_Configure(&spectra[device], SPECTRUM_POINTS);
+#endif
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_COMPRESSED
+        DeltaCodec_Reset(&Encoders[device]);
+#endif
+    }
+#if OUTPUT_FILTERED
+    filter_report_due = 1;
+#endif
+    Command_Reset();
+#if FLASH_LOG
+    //The log goes on after its newest page in flash, with every frame from now on
+    FlashLog_Start();
+    Frame_SetTap(FlashLog_Append);
+#endif
+    uint32_t boot_timestamp = Timestamp_Now();
+    BusManager_Start(&bus, DrainPeriod(), boot_timestamp);
+    recover_timestamp = boot_timestamp;
+    StatusReport_Reset(boot_timestamp);
+#if ACTIVITY_GATED
+    //Streaming first, until the board has been still for a whole timeout
+    Activity_Start(&activity, lis3dh_config.mode, lis3dh_config.full_scale, ACTIVITY_THRESHOLD_MG,
+                   (uint32_t)ACTIVITY_TIMEOUT_MS*1000u, boot_timestamp);
+#endif
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+    //No samples to wait for: the events are watched from now on
+    check_timestamp = boot_timestamp;
+    Boot_Mark(BOOT_STREAMING);
+#endif
     
+    //Brief event taken from the DataReady_ISR queue
+    EventQueue_Event event;
     
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_EVENTS
+    //Brief next sensor to drain
+    uint8_t device;
+#endif
     
-    //Header and footer for communication w/ Bridge Control Panel
-    OutArray[0]=HEADER;
-    OutArray[7]=FOOTER;
+    //Brief command received on the UART RX line
+    Command command;
     
     for(;;)
     {
-        if (flag == 1){
-            //Reading STATUS REGISTER to check for data availability
-            uint8_t status_reg;
-            error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_STATUS_REG,
-                                        &status_reg);
-            if (error == NO_ERROR)
+        if (samples_ready == 0 && !I2C_Peripheral_IsBusy())
+        {
+#if ACTIVITY_GATED
+            if (activity.idle)
+            {
+                //Motion latched on INT1, or a command to serve: the stream comes back
+                if (wake_due || Pin_INT1_Read() || !EventQueue_IsEmpty() || UART_Debug_GetRxBufferSize() > 0)
+                {
+                    while (EventQueue_Pop(&event))
+                    {
+                    }
+                    WakeSensors();
+                }
+            }
+            else
+#endif
+            if (Command_Poll(&command))
+            {
+                //Between two batches: the configuration switch has the bus to itself
+                if (command.type == FRAME_TYPE_CONFIG && command.length == 1)
+                {
+                    SwitchConfig(command.payload[0]);
+                }
+                else if (command.type == FRAME_TYPE_TRACE_QUERY && command.length == 1)
+                {
+                    Trace_Send(command.payload[0]);
+                }
+#if FLASH_LOG
+                else if (command.type == FRAME_TYPE_LOG_DUMP)
+                {
+                    FlashLog_StartDump();
+                }
+#endif
+            }
+            else if (read_failures > I2C_PERIPHERAL_RETRIES)
+            {
+                //The bus or the sensor does not recover by itself
+                RecoverSensor();
+            }
+            else if (read_failures > 0)
             {
-                // Check if new data is available (STATUS_REG[3]=ZYXDA=1)
-                if ((status_reg & 0x08) > 0)
+                //Failed read tried again after the backoff, the INT1 events wait
+                if (Timestamp_Now() - failure_timestamp >= (uint32_t)I2C_PERIPHERAL_BACKOFF_US << read_failures)
                 {
-                    //Multiple register reading starting from OUT_X_L
-                    error=I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-												LIS3DH_OUT_X_L, 6,
-												AccelerationData); 
-                    if (error == NO_ERROR)
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+                    event_cycles = Trace_Now();
+                    ReadEvents(Timestamp_Now());
+#else
+                    Trace_Begin(Trace_Now());
+                    if (I2C_Peripheral_Submit(&status_read) != NO_ERROR)
                     {
-                    
-                        // Conversion of output data into right-justified 16 bit int (x-axis)
-                        X_Out=(int16)(AccelerationData[0] | (AccelerationData[1] << 8)) >> 4;
-                        //Data * sensitivity (HR mode) = [mg] (x-axis)
-                        X_Out_mg= X_Out*HR_SENSITIVITY;
-                        //MSB (x-axis)
-                        OutArray[1]=(uint8_t)(X_Out_mg >> 8);
-                        //LSB (x-axis)
-                        OutArray[2]=(uint8_t)(X_Out_mg & 0xFF);
-                        
-                        // Conversion of output data into right-justified 16 bit int (y-axis)
-                        Y_Out=(int16)(AccelerationData[2] | (AccelerationData[3] << 8)) >> 4;
-                        //Data * sensitivity (HR mode) = [mg] (x-axis)
-                        Y_Out_mg=Y_Out*HR_SENSITIVITY;
-                        //MSB (x-axis)
-                        OutArray[3]=(uint8_t)(Y_Out_mg >> 8);
-                        //LSB (x-axis)
-                        OutArray[4]=(uint8_t)(Y_Out_mg & 0xFF);
-                        
-                        // Conversion of output data into right-justified 16 bit int (z-axis)
-                        Z_Out=(int16)(AccelerationData[4] | (AccelerationData[5] << 8)) >> 4;
-                        //Data * sensitivity (HR mode) = [mg] (x-axis)
-                        Z_Out_mg=Z_Out*HR_SENSITIVITY;
-                        //MSB (x-axis)
-                        OutArray[5]=(uint8_t)(Z_Out_mg >> 8);
-                        //LSB (x-axis)
-                        OutArray[6]=(uint8_t)(Z_Out_mg & 0xFF);
-                    
-                        UART_Debug_PutArray(OutArray,8);
+                        ReadFailed();
                     }
-                }   
-            } 
+#endif
+                }
+            }
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+            else if (Timestamp_Now() - check_timestamp >= CheckPeriod())
+            {
+                //No batches to show that the sensor runs: its FIFO is looked at instead
+                CheckSensor();
+            }
+#else
+            else if (BusManager_SilentFor(&bus, Timestamp_Now()) > StallTimeout() &&
+                     Timestamp_Now() - recover_timestamp > StallTimeout())
+            {
+                //No batch for a few periods: a sensor has lost its configuration
+                RecoverSensor();
+            }
+#endif
+#if ACTIVITY_GATED
+            else if (Activity_IsIdleDue(&activity, Timestamp_Now()))
+            {
+                //No motion for the whole timeout: the sensors wait for the next one
+                IdleSensors();
+            }
+#endif
+#if OUTPUT_FORMAT == OUTPUT_FORMAT_EVENTS
+            else if (EventQueue_Pop(&event))
+            {
+                //Click or free fall latched on INT1
+                event_cycles = event.cycles;
+                ReadEvents(event.timestamp);
+            }
+            else if (Pin_INT1_Read())
+            {
+                //Latched before the interrupt was enabled, or left by a failed read
+                event_cycles = Trace_Now();
+                ReadEvents(Timestamp_Now());
+            }
+#else
+            else
+            {
+                if (EventQueue_Pop(&event))
+                {
+                    BusManager_Signal(&bus, event.timestamp);
+                    event_cycles = event.cycles;
+                }
+#if DATA_READY_FROM_INT1
+                else if (Pin_INT1_Read())
+                {
+                    //INT1 is still high after the last burst (samples came in while
+                    //reading): no rising edge will follow, so serve the level
+                    BusManager_Signal(&bus, Timestamp_Now());
+                    event_cycles = Trace_Now();
+                }
+#endif
+                //The due sensors in turn, the bus is not left idle while one has data
+                device = BusManager_Next(&bus, Timestamp_Now());
+                if (device != BUS_MANAGER_NONE)
+                {
+                    drain_device = device;
+                    batch_timestamp = bus.devices[device].due_timestamp;
+                    Trace_Begin(bus.devices[device].wired ? event_cycles : Trace_Now());
+                    //Reading STATUS (FIFO SOURCE) REGISTER in background: the I2C
+                    //interrupt chains the OUT_X_L burst when new data is available
+                    status_read.device_address = bus.devices[device].address;
+                    data_read.device_address = bus.devices[device].address;
+                    //BusManager_Next() has taken the INT1 event: a refused read is tried again
+                    //on this sensor after the backoff
+                    if (I2C_Peripheral_Submit(&status_read) != NO_ERROR)
+                    {
+                        ReadFailed();
+                    }
+                }
+            }
+#endif
+        }
+        
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE && OUTPUT_FORMAT != OUTPUT_FORMAT_EVENTS
+        //Periodic status frame, or the gap in front of a batch after a sensor overrun
+        uint32_t now = Timestamp_Now();
+        if (StatusReport_IsDue(now))
+        {
+            StatusReport_Send(now);
+#if OUTPUT_FILTERED
+            //Repeated, for receivers that have missed the last one
+            filter_report_due = 1;
+#endif
+        }
+#endif
+        
+        if (samples_ready > 0)
+        {
+#if ACTIVITY_GATED
+            Activity_Update(&activity, drain_device, AccelerationData, samples_ready, Timestamp_Now());
+#endif
+            SendBatch(drain_device, samples_ready, batch_timestamp);
+            Boot_Mark(BOOT_STREAMING);
+            //AccelerationData can be reused by the next burst; one ending after the
+            //check above is served on the next pass
+            samples_ready = 0;
+        }
+#if OUTPUT_FORMAT != OUTPUT_FORMAT_BRIDGE
+        else if (boot_report_due && Boot_Time(BOOT_STREAMING) != BOOT_NOT_REACHED)
+        {
+            //Deferred until the stream runs, tried again after a drop
+            boot_report_due = SendBootReport() != NO_ERROR;
+        }
+#endif
+        
+        //Batches whose last byte has left UART_Stream
+        Trace_Poll();
+        
+#if FLASH_LOG
+        //A full page written with the bus idle, the dump sent a page at a time while the UART is free
+        if (!I2C_Peripheral_IsBusy())
+        {
+            FlashLog_Poll();
+        }
+        if (FlashLog_IsDumping() && !UART_Stream_IsBusy())
+        {
+            FlashLog_DumpNext(Timestamp_Now());
+        }
+#endif
+        
+        //Nothing to do before the next interrupt: halt the CPU
+        CyGlobalIntDisable;
+        uint32_t idle = IdleTime();
+        if (idle > 0)
+        {
+            LowPower_Idle(idle, CanSleep());
         }
+        CyGlobalIntEnable;
     }
 }
 
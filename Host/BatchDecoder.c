@@ -0,0 +1,788 @@
+/**
+*   \file BatchDecoder.c
+*   \brief Decoder of whole UART captures into structure-of-arrays buffers.
+*/
+#include "BatchDecoder.h"
+
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define BATCH_DECODER_X86 1
+#else
+    #define BATCH_DECODER_X86 0
+#endif
+
+#define BRIDGE_FRAME_SIZE   8
+#define BRIDGE_HEADER       0xA0
+#define BRIDGE_FOOTER       0xC0
+// Footer of a frame followed by the header of the next one, as a byte-swapped word
+#define BRIDGE_MARKERS      ((short)0xC0A0)
+
+static int kernel = -1;
+// crc_table[k][b]: CRC of byte b followed by k zero bytes
+static uint16_t crc_table[8][256];
+
+    BatchDecoder_Kernel BatchDecoder_BestKernel(void)
+    {
+#if BATCH_DECODER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return BATCH_DECODER_AVX2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return BATCH_DECODER_SSE2;
+        }
+#endif
+        return BATCH_DECODER_SCALAR;
+    }
+
+    BatchDecoder_Kernel BatchDecoder_SetKernel(BatchDecoder_Kernel selected)
+    {
+        BatchDecoder_Kernel best = BatchDecoder_BestKernel();
+        kernel = selected > best ? best : selected;
+        return (BatchDecoder_Kernel)kernel;
+    }
+
+    static BatchDecoder_Kernel Kernel(void)
+    {
+        if (kernel < 0)
+        {
+            kernel = BatchDecoder_BestKernel();
+        }
+        return (BatchDecoder_Kernel)kernel;
+    }
+
+    /*
+    *   CRC-16/CCITT-FALSE, eight bytes per step: the CRC so far is folded
+    *   into the first two, and each byte is looked up in the table of its
+    *   distance from the end of the step, so the lookups are independent.
+    */
+    static uint16_t Crc16(const uint8_t* data, size_t length)
+    {
+        uint16_t crc = 0xFFFF;
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            const uint8_t* b = data + i;
+            crc = (uint16_t)(crc_table[7][b[0] ^ (crc >> 8)] ^ crc_table[6][b[1] ^ (crc & 0xFF)] ^
+                             crc_table[5][b[2]] ^ crc_table[4][b[3]] ^
+                             crc_table[3][b[4]] ^ crc_table[2][b[5]] ^
+                             crc_table[1][b[6]] ^ crc_table[0][b[7]]);
+        }
+        for (; i < length; i++)
+        {
+            crc = (uint16_t)((crc << 8) ^ crc_table[0][(crc >> 8) ^ data[i]]);
+        }
+        return crc;
+    }
+
+    static void AppendSamples(const FrameDecoder_Frame* frame, void* context)
+    {
+        BatchDecoder_Samples* out = ((BatchDecoder*)context)->output;
+        for (uint8_t i = 0; frame->samples != NULL && i < frame->sample_count; i++)
+        {
+            out->x[out->count] = frame->samples[i][0];
+            out->y[out->count] = frame->samples[i][1];
+            out->z[out->count] = frame->samples[i][2];
+            out->count++;
+        }
+    }
+
+    void BatchDecoder_Init(BatchDecoder* decoder, FrameDecoder_Format format,
+                           BatchDecoder_Samples* output)
+    {
+        FrameDecoder_Init(&decoder->frames, format, AppendSamples, decoder);
+        decoder->output = output;
+        if (crc_table[0][1] == 0)
+        {
+            for (unsigned n = 0; n < 256; n++)
+            {
+                uint16_t crc = (uint16_t)(n << 8);
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+                }
+                crc_table[0][n] = crc;
+            }
+            for (unsigned k = 1; k < 8; k++)
+            {
+                for (unsigned n = 0; n < 256; n++)
+                {
+                    uint16_t crc = crc_table[k - 1][n];
+                    crc_table[k][n] = (uint16_t)((crc << 8) ^ crc_table[0][crc >> 8]);
+                }
+            }
+        }
+    }
+
+    // First position from start holding byte0 followed by byte1 at distance, or the first one that cannot be checked
+    static size_t FindScalar(const uint8_t* data, size_t start, size_t length,
+                             uint8_t byte0, uint8_t byte1, size_t distance)
+    {
+        size_t p = start;
+        for (; p + distance < length; p++)
+        {
+            if (data[p] == byte0 && data[p + distance] == byte1)
+            {
+                return p;
+            }
+        }
+        return p < start ? start : p;
+    }
+
+#if BATCH_DECODER_X86
+
+    __attribute__((target("sse2")))
+    static size_t Find_Sse2(const uint8_t* data, size_t start, size_t length,
+                            uint8_t byte0, uint8_t byte1, size_t distance)
+    {
+        const __m128i first = _mm_set1_epi8((char)byte0);
+        const __m128i second = _mm_set1_epi8((char)byte1);
+        size_t p = start;
+        for (; p + 16 + distance <= length; p += 16)
+        {
+            __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + p)), first);
+            __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + p + distance)), second);
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(a, b));
+            if (mask != 0)
+            {
+                return p + (size_t)__builtin_ctz(mask);
+            }
+        }
+        return FindScalar(data, p, length, byte0, byte1, distance);
+    }
+
+    __attribute__((target("avx2")))
+    static size_t Find_Avx2(const uint8_t* data, size_t start, size_t length,
+                            uint8_t byte0, uint8_t byte1, size_t distance)
+    {
+        const __m256i first = _mm256_set1_epi8((char)byte0);
+        const __m256i second = _mm256_set1_epi8((char)byte1);
+        size_t p = start;
+        for (; p + 32 + distance <= length; p += 32)
+        {
+            __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + p)), first);
+            __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + p + distance)),
+                                          second);
+            unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+            if (mask != 0)
+            {
+                return p + (size_t)__builtin_ctz(mask);
+            }
+        }
+        return Find_Sse2(data, p, length, byte0, byte1, distance);
+    }
+
+    /*
+    *   Eight bridge frames from p (p[0] is an A0 header). Loading from
+    *   p + 1 puts xH xL yH yL zH zL C0 A0 in the four words of a frame:
+    *   after the byte swap they read x, y, z and the marker pair, and
+    *   two 16-bit transposes gather the same word of every frame.
+    */
+    __attribute__((target("sse2")))
+    static int Bridge8_Sse2(const uint8_t* p, BatchDecoder_Samples* out)
+    {
+        __m128i v[4];
+        for (int i = 0; i < 4; i++)
+        {
+            v[i] = _mm_loadu_si128((const __m128i*)(p + 1 + 16 * i));
+            v[i] = _mm_or_si128(_mm_slli_epi16(v[i], 8), _mm_srli_epi16(v[i], 8));
+        }
+        // x0 x2 y0 y2 z0 z2 m0 m2 | x1 x3 y1 y3 z1 z3 m1 m3 (frames 0..3), same for 4..7
+        __m128i t0 = _mm_unpacklo_epi16(v[0], v[1]);
+        __m128i t1 = _mm_unpackhi_epi16(v[0], v[1]);
+        __m128i t2 = _mm_unpacklo_epi16(v[2], v[3]);
+        __m128i t3 = _mm_unpackhi_epi16(v[2], v[3]);
+        // x0..x3 y0..y3 | z0..z3 m0..m3, same for 4..7
+        __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+        __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+        __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+        __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+
+        __m128i markers = _mm_unpackhi_epi64(u1, u3);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(markers, _mm_set1_epi16(BRIDGE_MARKERS))) != 0xFFFF)
+        {
+            return 0;
+        }
+        _mm_storeu_si128((__m128i*)(out->x + out->count), _mm_unpacklo_epi64(u0, u2));
+        _mm_storeu_si128((__m128i*)(out->y + out->count), _mm_unpackhi_epi64(u0, u2));
+        _mm_storeu_si128((__m128i*)(out->z + out->count), _mm_unpacklo_epi64(u1, u3));
+        out->count += 8;
+        return 1;
+    }
+
+    /*
+    *   Sixteen bridge frames, as Bridge8_Sse2() in each 128-bit lane: the
+    *   lanes hold frames {0,1,4,5,...} and {2,3,6,7,...}, put back in
+    *   order by a 32-bit permutation.
+    */
+    __attribute__((target("avx2")))
+    static int Bridge16_Avx2(const uint8_t* p, BatchDecoder_Samples* out)
+    {
+        const __m256i swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                              1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        __m256i v[4];
+        for (int i = 0; i < 4; i++)
+        {
+            v[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(p + 1 + 32 * i)), swap);
+        }
+        __m256i t0 = _mm256_unpacklo_epi16(v[0], v[1]);
+        __m256i t1 = _mm256_unpackhi_epi16(v[0], v[1]);
+        __m256i t2 = _mm256_unpacklo_epi16(v[2], v[3]);
+        __m256i t3 = _mm256_unpackhi_epi16(v[2], v[3]);
+        __m256i u0 = _mm256_unpacklo_epi16(t0, t1);
+        __m256i u1 = _mm256_unpackhi_epi16(t0, t1);
+        __m256i u2 = _mm256_unpacklo_epi16(t2, t3);
+        __m256i u3 = _mm256_unpackhi_epi16(t2, t3);
+
+        __m256i markers = _mm256_unpackhi_epi64(u1, u3);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(markers, _mm256_set1_epi16(BRIDGE_MARKERS))) != -1)
+        {
+            return 0;
+        }
+        _mm256_storeu_si256((__m256i*)(out->x + out->count),
+                            _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(u0, u2), order));
+        _mm256_storeu_si256((__m256i*)(out->y + out->count),
+                            _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(u0, u2), order));
+        _mm256_storeu_si256((__m256i*)(out->z + out->count),
+                            _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(u1, u3), order));
+        out->count += 16;
+        return 1;
+    }
+
+    /*
+    *   Three-way split of 24 interleaved words into x0..x7, y0..y7 and
+    *   z0..z7: each round of unpacks takes every third word of the
+    *   previous one, three rounds put them in order. The same operations
+    *   split each 128-bit lane of AVX2 registers.
+    */
+    #define DEINTERLEAVE3(type, lo16, hi64, a, b, c)                         \
+        do {                                                                \
+            type t0 = lo16(a, hi64(b, b));                                  \
+            type t1 = lo16(hi64(a, a), c);                                  \
+            type t2 = lo16(b, hi64(c, c));                                  \
+            type u0 = lo16(t0, hi64(t1, t1));                               \
+            type u1 = lo16(hi64(t0, t0), t2);                               \
+            type u2 = lo16(t1, hi64(t2, t2));                               \
+            a = lo16(u0, hi64(u1, u1));                                     \
+            b = lo16(hi64(u0, u0), u2);                                     \
+            c = lo16(u1, hi64(u2, u2));                                     \
+        } while (0)
+
+    // Eight little-endian x, y, z samples at a time; returns the samples done
+    __attribute__((target("sse2")))
+    static size_t Plain_Sse2(const uint8_t* p, size_t count, int16_t* x, int16_t* y, int16_t* z)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(p + 6 * i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(p + 6 * i + 16));
+            __m128i c = _mm_loadu_si128((const __m128i*)(p + 6 * i + 32));
+            DEINTERLEAVE3(__m128i, _mm_unpacklo_epi16, _mm_unpackhi_epi64, a, b, c);
+            _mm_storeu_si128((__m128i*)(x + i), a);
+            _mm_storeu_si128((__m128i*)(y + i), b);
+            _mm_storeu_si128((__m128i*)(z + i), c);
+        }
+        return i;
+    }
+
+    // Running sum of eight deltas on top of carry, which becomes the last value
+    __attribute__((target("sse2")))
+    static __m128i Accumulate_Sse2(__m128i delta, __m128i* carry)
+    {
+        __m128i sum = _mm_add_epi16(delta, _mm_slli_si128(delta, 2));
+        sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 4));
+        sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 8));
+        sum = _mm_add_epi16(sum, *carry);
+        __m128i last = _mm_shufflehi_epi16(sum, 0xFF);
+        *carry = _mm_unpackhi_epi64(last, last);
+        return sum;
+    }
+
+    /*
+    *   Eight samples of one-byte zig-zag deltas at a time, added up from
+    *   reference, which is left at the last sample; returns the samples
+    *   done.
+    */
+    __attribute__((target("sse2")))
+    static size_t Deltas_Sse2(const uint8_t* p, size_t count, int16_t reference[3],
+                              int16_t* x, int16_t* y, int16_t* z)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        __m128i carry_x = _mm_set1_epi16(reference[0]);
+        __m128i carry_y = _mm_set1_epi16(reference[1]);
+        __m128i carry_z = _mm_set1_epi16(reference[2]);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(p + 3 * i));
+            __m128i v[3] = {
+                _mm_unpacklo_epi8(bytes, zero),
+                _mm_unpackhi_epi8(bytes, zero),
+                _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + 3 * i + 16)), zero)
+            };
+            for (int k = 0; k < 3; k++)
+            {
+                v[k] = _mm_xor_si128(_mm_srli_epi16(v[k], 1),
+                                     _mm_sub_epi16(zero, _mm_and_si128(v[k], one)));
+            }
+            DEINTERLEAVE3(__m128i, _mm_unpacklo_epi16, _mm_unpackhi_epi64, v[0], v[1], v[2]);
+            _mm_storeu_si128((__m128i*)(x + i), Accumulate_Sse2(v[0], &carry_x));
+            _mm_storeu_si128((__m128i*)(y + i), Accumulate_Sse2(v[1], &carry_y));
+            _mm_storeu_si128((__m128i*)(z + i), Accumulate_Sse2(v[2], &carry_z));
+        }
+        reference[0] = (int16_t)_mm_cvtsi128_si32(carry_x);
+        reference[1] = (int16_t)_mm_cvtsi128_si32(carry_y);
+        reference[2] = (int16_t)_mm_cvtsi128_si32(carry_z);
+        return i;
+    }
+
+    /*
+    *   Sixteen samples at a time: the three loads are regrouped so that
+    *   each 128-bit lane holds eight whole samples, split as in
+    *   Plain_Sse2(). The caller finishes with Plain_Sse2(): called from
+    *   here, the switch from AVX to SSE code costs more than it saves.
+    */
+    __attribute__((target("avx2")))
+    static size_t Plain_Avx2(const uint8_t* p, size_t count, int16_t* x, int16_t* y, int16_t* z)
+    {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i r0 = _mm256_loadu_si256((const __m256i*)(p + 6 * i));
+            __m256i r1 = _mm256_loadu_si256((const __m256i*)(p + 6 * i + 32));
+            __m256i r2 = _mm256_loadu_si256((const __m256i*)(p + 6 * i + 64));
+            __m256i a = _mm256_permute2x128_si256(r0, r1, 0x30);
+            __m256i b = _mm256_permute2x128_si256(r0, r2, 0x21);
+            __m256i c = _mm256_permute2x128_si256(r1, r2, 0x30);
+            DEINTERLEAVE3(__m256i, _mm256_unpacklo_epi16, _mm256_unpackhi_epi64, a, b, c);
+            _mm256_storeu_si256((__m256i*)(x + i), a);
+            _mm256_storeu_si256((__m256i*)(y + i), b);
+            _mm256_storeu_si256((__m256i*)(z + i), c);
+        }
+        return i;
+    }
+
+    // Running sum of sixteen deltas: per lane, then the low lane total carried into the high one
+    __attribute__((target("avx2")))
+    static __m256i Accumulate_Avx2(__m256i delta, __m256i* carry)
+    {
+        __m256i sum = _mm256_add_epi16(delta, _mm256_slli_si256(delta, 2));
+        sum = _mm256_add_epi16(sum, _mm256_slli_si256(sum, 4));
+        sum = _mm256_add_epi16(sum, _mm256_slli_si256(sum, 8));
+        __m256i last = _mm256_shufflehi_epi16(sum, 0xFF);
+        last = _mm256_unpackhi_epi64(last, last);
+        sum = _mm256_add_epi16(sum, _mm256_permute2x128_si256(last, last, 0x08));
+        sum = _mm256_add_epi16(sum, *carry);
+        *carry = _mm256_permute4x64_epi64(_mm256_shufflehi_epi16(sum, 0xFF), 0xFF);
+        return sum;
+    }
+
+    // As Deltas_Sse2(), sixteen samples at a time (lanes as in Plain_Avx2())
+    __attribute__((target("avx2")))
+    static size_t Deltas_Avx2(const uint8_t* p, size_t count, int16_t reference[3],
+                              int16_t* x, int16_t* y, int16_t* z)
+    {
+        const __m256i one = _mm256_set1_epi16(1);
+        __m256i carry_x = _mm256_set1_epi16(reference[0]);
+        __m256i carry_y = _mm256_set1_epi16(reference[1]);
+        __m256i carry_z = _mm256_set1_epi16(reference[2]);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i r[3];
+            for (int k = 0; k < 3; k++)
+            {
+                r[k] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 3 * i + 16 * k)));
+                r[k] = _mm256_xor_si256(_mm256_srli_epi16(r[k], 1),
+                                        _mm256_sub_epi16(_mm256_setzero_si256(),
+                                                         _mm256_and_si256(r[k], one)));
+            }
+            __m256i a = _mm256_permute2x128_si256(r[0], r[1], 0x30);
+            __m256i b = _mm256_permute2x128_si256(r[0], r[2], 0x21);
+            __m256i c = _mm256_permute2x128_si256(r[1], r[2], 0x30);
+            DEINTERLEAVE3(__m256i, _mm256_unpacklo_epi16, _mm256_unpackhi_epi64, a, b, c);
+            _mm256_storeu_si256((__m256i*)(x + i), Accumulate_Avx2(a, &carry_x));
+            _mm256_storeu_si256((__m256i*)(y + i), Accumulate_Avx2(b, &carry_y));
+            _mm256_storeu_si256((__m256i*)(z + i), Accumulate_Avx2(c, &carry_z));
+        }
+        reference[0] = (int16_t)_mm256_extract_epi16(carry_x, 0);
+        reference[1] = (int16_t)_mm256_extract_epi16(carry_y, 0);
+        reference[2] = (int16_t)_mm256_extract_epi16(carry_z, 0);
+        return i;
+    }
+
+    // Non-zero if a byte has its MSB set, i.e. the start of a multi-byte varint
+    __attribute__((target("sse2")))
+    static int HighBits_Sse2(const uint8_t* p, size_t length)
+    {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16)
+        {
+            if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p + i))) != 0)
+            {
+                return 1;
+            }
+        }
+        for (; i < length; i++)
+        {
+            if (p[i] & 0x80)
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    __attribute__((target("sse2")))
+    static size_t ToFloat_Sse2(const int16_t* input, float* output, size_t count, float scale)
+    {
+        const __m128 factor = _mm_set1_ps(scale);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(input + i));
+            // Sign extension: each value in the upper half of a 32-bit lane, shifted down
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), factor));
+            _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), factor));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t ToFloat_Avx2(const int16_t* input, float* output, size_t count, float scale)
+    {
+        const __m256 factor = _mm256_set1_ps(scale);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(input + i)));
+            __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(input + i + 8)));
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), factor));
+            _mm256_storeu_ps(output + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), factor));
+        }
+        return i;
+    }
+
+#endif
+
+    static size_t Find(BatchDecoder_Kernel selected, const uint8_t* data, size_t start,
+                       size_t length, uint8_t byte0, uint8_t byte1, size_t distance)
+    {
+#if BATCH_DECODER_X86
+        if (selected == BATCH_DECODER_AVX2)
+        {
+            return Find_Avx2(data, start, length, byte0, byte1, distance);
+        }
+        if (selected == BATCH_DECODER_SSE2)
+        {
+            return Find_Sse2(data, start, length, byte0, byte1, distance);
+        }
+#endif
+        return FindScalar(data, start, length, byte0, byte1, distance);
+    }
+
+    static int HighBits(BatchDecoder_Kernel selected, const uint8_t* p, size_t length)
+    {
+#if BATCH_DECODER_X86
+        if (selected != BATCH_DECODER_SCALAR)
+        {
+            return HighBits_Sse2(p, length);
+        }
+#endif
+        uint8_t bits = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            bits |= p[i];
+        }
+        return (bits & 0x80) != 0;
+    }
+
+    // Plain samples (x, y, z little-endian) appended to the output
+    static void ExpandPlain(BatchDecoder_Kernel selected, const uint8_t* p, size_t count,
+                            BatchDecoder_Samples* out)
+    {
+        int16_t* x = out->x + out->count;
+        int16_t* y = out->y + out->count;
+        int16_t* z = out->z + out->count;
+        size_t i = 0;
+#if BATCH_DECODER_X86
+        if (selected == BATCH_DECODER_AVX2)
+        {
+            i = Plain_Avx2(p, count, x, y, z);
+            i += Plain_Sse2(p + 6 * i, count - i, x + i, y + i, z + i);
+        }
+        else if (selected == BATCH_DECODER_SSE2)
+        {
+            i = Plain_Sse2(p, count, x, y, z);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            x[i] = (int16_t)(p[6 * i] | (p[6 * i + 1] << 8));
+            y[i] = (int16_t)(p[6 * i + 2] | (p[6 * i + 3] << 8));
+            z[i] = (int16_t)(p[6 * i + 4] | (p[6 * i + 5] << 8));
+        }
+        out->count += count;
+    }
+
+    // One-byte zig-zag deltas added up from reference and appended to the output
+    static void ExpandDeltas(BatchDecoder_Kernel selected, const uint8_t* p, size_t count,
+                             int16_t reference[3], BatchDecoder_Samples* out)
+    {
+        int16_t* xyz[3] = { out->x + out->count, out->y + out->count, out->z + out->count };
+        size_t i = 0;
+#if BATCH_DECODER_X86
+        if (selected == BATCH_DECODER_AVX2)
+        {
+            i = Deltas_Avx2(p, count, reference, xyz[0], xyz[1], xyz[2]);
+            i += Deltas_Sse2(p + 3 * i, count - i, reference, xyz[0] + i, xyz[1] + i, xyz[2] + i);
+        }
+        else if (selected == BATCH_DECODER_SSE2)
+        {
+            i = Deltas_Sse2(p, count, reference, xyz[0], xyz[1], xyz[2]);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                uint8_t zigzag = p[3 * i + axis];
+                reference[axis] = (int16_t)(reference[axis] + ((zigzag >> 1) ^ -(zigzag & 1)));
+                xyz[axis][i] = reference[axis];
+            }
+        }
+        out->count += count;
+    }
+
+    /*
+    *   Samples in a samples frame the decoder expands itself: plain, or
+    *   delta frames whose varints are all one byte long (steps below 64
+    *   units). -1 for any other frame, which goes to FrameDecoder_Accept().
+    */
+    static int SamplesLayout(BatchDecoder_Kernel selected, const FrameDecoder_Frame* frame)
+    {
+        const uint8_t* p = frame->payload;
+        if (frame->type == FRAME_DECODER_TYPE_SAMPLES)
+        {
+            return frame->length >= 1 && (frame->length - 1) % 6 == 0 ? (frame->length - 1) / 6 : -1;
+        }
+        if ((frame->type != FRAME_DECODER_TYPE_DELTA_KEY && frame->type != FRAME_DECODER_TYPE_DELTA) ||
+            frame->length < 2)
+        {
+            return -1;
+        }
+        unsigned key = frame->type == FRAME_DECODER_TYPE_DELTA_KEY;
+        unsigned count = p[1];
+        unsigned offset = 2 + 6 * key;
+        if (count > FRAME_DECODER_MAX_SAMPLES || count < key || frame->length != offset + 3 * (count - key) ||
+            HighBits(selected, p + offset, frame->length - offset))
+        {
+            return -1;
+        }
+        return (int)count;
+    }
+
+    /*
+    *   A frame accepted by SamplesLayout(), written straight into the
+    *   output arrays with the sequence check, delta chains and counters
+    *   of FrameDecoder_Accept().
+    */
+    static void ExpandFrame(BatchDecoder* decoder, BatchDecoder_Kernel selected,
+                            const FrameDecoder_Frame* frame, size_t count)
+    {
+        FrameDecoder* frames = &decoder->frames;
+        BatchDecoder_Samples* out = decoder->output;
+        const uint8_t* p = frame->payload;
+        size_t first = out->count;
+
+        FrameDecoder_CheckSequence(frames, frame->sequence);
+        frames->stats.frames++;
+
+        // Delta chain of the device; none outlives the frame while the device is unknown
+        int16_t unknown_reference[3];
+        uint8_t unknown_have_reference = 0;
+        uint8_t known = frames->device < FRAME_DECODER_MAX_DEVICES;
+        int16_t* reference = known ? frames->reference[frames->device] : unknown_reference;
+        uint8_t* have_reference = known ? &frames->have_reference[frames->device] : &unknown_have_reference;
+
+        if (frame->type == FRAME_DECODER_TYPE_SAMPLES)
+        {
+            ExpandPlain(selected, p + 1, count, out);
+            if (count > 0)
+            {
+                // Plain samples are a valid start for the following delta frames
+                reference[0] = out->x[out->count - 1];
+                reference[1] = out->y[out->count - 1];
+                reference[2] = out->z[out->count - 1];
+                *have_reference = 1;
+            }
+        }
+        else
+        {
+            p += 2;
+            if (frame->type == FRAME_DECODER_TYPE_DELTA_KEY)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    reference[axis] = (int16_t)(p[2 * axis] | (p[2 * axis + 1] << 8));
+                }
+                *have_reference = 1;
+                ExpandPlain(BATCH_DECODER_SCALAR, p, 1, out);
+                p += 6;
+                count--;
+            }
+            else if (!*have_reference)
+            {
+                frames->stats.frames_undecodable++;
+                return;
+            }
+            ExpandDeltas(selected, p, count, reference, out);
+        }
+        frames->stats.samples += out->count - first;
+    }
+
+    static size_t DecodeBridge(BatchDecoder* decoder, const uint8_t* data, size_t length)
+    {
+        BatchDecoder_Samples* out = decoder->output;
+        FrameDecoder_Stats* stats = &decoder->frames.stats;
+        BatchDecoder_Kernel selected = Kernel();
+        size_t first = out->count;
+        size_t i = 0;
+
+        while (length - i >= BRIDGE_FRAME_SIZE && out->count < out->capacity)
+        {
+            const uint8_t* p = data + i;
+            if (p[0] != BRIDGE_HEADER || p[BRIDGE_FRAME_SIZE - 1] != BRIDGE_FOOTER)
+            {
+                // Resynchronise on the next A0 with a C0 seven bytes later
+                size_t next = Find(selected, data, i + 1, length, BRIDGE_HEADER, BRIDGE_FOOTER,
+                                   BRIDGE_FRAME_SIZE - 1);
+                stats->bytes_skipped += next - i;
+                i = next;
+                continue;
+            }
+#if BATCH_DECODER_X86
+            // A group also checks the header of the frame after it, hence the extra byte
+            size_t room = out->capacity - out->count;
+            if (selected == BATCH_DECODER_AVX2 && room >= 16 && length - i > 16 * BRIDGE_FRAME_SIZE &&
+                Bridge16_Avx2(p, out))
+            {
+                i += 16 * BRIDGE_FRAME_SIZE;
+                continue;
+            }
+            if (selected != BATCH_DECODER_SCALAR && room >= 8 && length - i > 8 * BRIDGE_FRAME_SIZE &&
+                Bridge8_Sse2(p, out))
+            {
+                i += 8 * BRIDGE_FRAME_SIZE;
+                continue;
+            }
+#endif
+            out->x[out->count] = (int16_t)((p[1] << 8) | p[2]);
+            out->y[out->count] = (int16_t)((p[3] << 8) | p[4]);
+            out->z[out->count] = (int16_t)((p[5] << 8) | p[6]);
+            out->count++;
+            i += BRIDGE_FRAME_SIZE;
+        }
+        // One sample per frame
+        stats->frames += out->count - first;
+        stats->samples += out->count - first;
+        stats->bytes += i;
+        return i;
+    }
+
+    static size_t DecodeBatched(BatchDecoder* decoder, const uint8_t* data, size_t length)
+    {
+        FrameDecoder_Stats* stats = &decoder->frames.stats;
+        BatchDecoder_Kernel selected = Kernel();
+        size_t i = 0;
+
+        while (length - i >= 2)
+        {
+            const uint8_t* b = data + i;
+            if (b[0] != FRAME_DECODER_SYNC_0 || b[1] != FRAME_DECODER_SYNC_1)
+            {
+                size_t next = Find(selected, data, i + 1, length, FRAME_DECODER_SYNC_0,
+                                   FRAME_DECODER_SYNC_1, 1);
+                stats->bytes_skipped += next - i;
+                i = next;
+                continue;
+            }
+            if (length - i < FRAME_DECODER_HEADER_SIZE)
+            {
+                break;
+            }
+            size_t size = FRAME_DECODER_HEADER_SIZE + b[3] + FRAME_DECODER_CRC_SIZE;
+            if (length - i < size ||
+                decoder->output->capacity - decoder->output->count < FRAME_DECODER_MAX_SAMPLES)
+            {
+                break;
+            }
+            if (Crc16(b + 2, size - 4) != (uint16_t)(b[size - 2] | (b[size - 1] << 8)))
+            {
+                // Corrupted frame or a sync pattern inside data: look further
+                stats->crc_errors++;
+                stats->bytes_skipped++;
+                i++;
+                continue;
+            }
+            FrameDecoder_Frame frame = {
+                .type = b[2],
+                .length = b[3],
+                .sequence = (uint16_t)(b[4] | (b[5] << 8)),
+                .timestamp = (uint32_t)b[6] | ((uint32_t)b[7] << 8) |
+                             ((uint32_t)b[8] << 16) | ((uint32_t)b[9] << 24),
+                .payload = b + FRAME_DECODER_HEADER_SIZE
+            };
+            int count = SamplesLayout(selected, &frame);
+            if (count < 0)
+            {
+                FrameDecoder_Accept(&decoder->frames, &frame);
+            }
+            else
+            {
+                ExpandFrame(decoder, selected, &frame, (size_t)count);
+            }
+            i += size;
+        }
+        stats->bytes += i;
+        return i;
+    }
+
+    size_t BatchDecoder_Decode(BatchDecoder* decoder, const uint8_t* data, size_t length)
+    {
+        if (decoder->frames.format == FRAME_DECODER_BRIDGE)
+        {
+            return DecodeBridge(decoder, data, length);
+        }
+        return DecodeBatched(decoder, data, length);
+    }
+
+    void BatchDecoder_ToFloat(const int16_t* input, float* output, size_t count, float scale)
+    {
+        size_t i = 0;
+#if BATCH_DECODER_X86
+        BatchDecoder_Kernel selected = Kernel();
+        if (selected == BATCH_DECODER_AVX2)
+        {
+            i = ToFloat_Avx2(input, output, count, scale);
+        }
+        else if (selected == BATCH_DECODER_SSE2)
+        {
+            i = ToFloat_Sse2(input, output, count, scale);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            output[i] = (float)input[i] * scale;
+        }
+    }
+
+/* [] END OF FILE */
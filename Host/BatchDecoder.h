@@ -0,0 +1,94 @@
+/**
+*   \file BatchDecoder.h
+*   \brief Decoder of whole UART captures into structure-of-arrays buffers.
+*
+*   Meant for ingesting long recordings: the capture is handed over in
+*   large blocks and the samples come out as separate x, y and z arrays,
+*   ready for vector processing. Accepted frames, counters and the
+*   handling of garbage are those of FrameDecoder (the same stream gives
+*   the same samples and the same FrameDecoder_Stats); only the speed
+*   differs.
+*
+*   Bridge streams (A0 xH xL yH yL zH zL C0, PROJ_2 10-bit digits or
+*   PROJ_3 mg) are decoded 8 frames at a time with SSE2 or 16 at a time
+*   with AVX2: one unaligned load per 2 (4) frames, a byte swap, a 16-bit
+*   transpose into x, y, z and a check of every C0/A0 marker pair in the
+*   same registers. After garbage the next A0..C0 pair is searched 16 or
+*   32 positions at a time. Batched streams (Frame.h) use the vector
+*   search for the sync bytes and a CRC eight bytes per step. Samples
+*   frames are expanded straight into the arrays: plain samples by a
+*   three-way 16-bit split, delta frames with one-byte varints (steps
+*   below 64 units) by a zig-zag decode and running sum per axis in the
+*   same registers, 8 (16) samples at a time. Other frames, e.g. deltas
+*   with longer varints, go through FrameDecoder_Accept().
+*
+*   The kernel is picked at run time from what the CPU supports; the
+*   scalar kernel is used on other architectures.
+*/
+#ifndef BATCH_DECODER_H
+    #define BATCH_DECODER_H
+
+    #include "FrameDecoder.h"
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    /** \brief Decoding kernels. */
+    typedef enum {
+        BATCH_DECODER_SCALAR,
+        BATCH_DECODER_SSE2,
+        BATCH_DECODER_AVX2
+    } BatchDecoder_Kernel;
+
+    /**
+    *   \brief Output buffers, provided by the caller.
+    *
+    *   Values are in the unit of the stream: mg for PROJ_3 streams,
+    *   digits for PROJ_2 (see BatchDecoder_ToFloat()).
+    */
+    typedef struct {
+        int16_t* x;
+        int16_t* y;
+        int16_t* z;
+        size_t capacity;                ///< Room of each array (samples)
+        size_t count;                   ///< Samples stored so far
+    } BatchDecoder_Samples;
+
+    /** \brief State of a decoder. */
+    typedef struct {
+        FrameDecoder frames;            ///< Sequence and delta state, counters
+        BatchDecoder_Samples* output;
+    } BatchDecoder;
+
+    /** \brief Prepare \p decoder for a new stream written to \p output. */
+    void BatchDecoder_Init(BatchDecoder* decoder, FrameDecoder_Format format,
+                           BatchDecoder_Samples* output);
+
+    /**
+    *   \brief Decode as much of \p data as possible.
+    *
+    *   Stops at an incomplete frame at the end of the block or when the
+    *   output is full (a batched frame needs room for
+    *   FRAME_DECODER_MAX_SAMPLES). The bytes not consumed have to be
+    *   passed again, followed by the next block.
+    *   \retval Number of bytes consumed.
+    */
+    size_t BatchDecoder_Decode(BatchDecoder* decoder, const uint8_t* data, size_t length);
+
+    /**
+    *   \brief Scale int16 values into floats (e.g. 0.004 for PROJ_2 digits to g).
+    */
+    void BatchDecoder_ToFloat(const int16_t* input, float* output, size_t count, float scale);
+
+    /**
+    *   \brief Select the kernel; one the CPU lacks falls back to the best it has.
+    *
+    *   \retval The kernel now in use.
+    */
+    BatchDecoder_Kernel BatchDecoder_SetKernel(BatchDecoder_Kernel kernel);
+
+    /** \brief Best kernel the CPU supports. */
+    BatchDecoder_Kernel BatchDecoder_BestKernel(void);
+
+#endif // BATCH_DECODER_H
+/* [] END OF FILE */
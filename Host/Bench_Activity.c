@@ -0,0 +1,272 @@
+/**
+*   \file Bench_Activity.c
+*   \brief Samples transmitted per hour of a mostly-idle trace, activity-gated versus always streaming.
+*
+*   The board lies still but for BURST_S of handling in the middle of
+*   every PERIOD_S, for one simulated hour. The loop is the ACTIVITY_GATED
+*   one of PROJ_3 main.c: the sensor streams in HR mode at 100 Hz with
+*   its FIFO watermark on INT1 and every batch goes through
+*   Activity_Update(); once nothing has moved for the timeout it drops to
+*   low-power mode at 10 Hz, its FIFO still in stream mode, with the IA1
+*   generator latched on INT1 (LIS3DH_ConfigureMotion()), and the CPU
+*   sleeps (LowPower_Idle(), CTW wake-ups). When INT1 is found high the
+*   FIFO is drained (the history before the motion) and streaming
+*   starts again.
+*
+*   For a few timeouts the benchmark prints the samples sent per hour
+*   next to the 360000 of the continuous stream, the wake-up latency
+*   from the start of a burst to the stream back at full rate, and the
+*   history samples sent with each wake-up. It fails if a burst does not
+*   wake the stream, if a wake-up comes before its burst (no motion),
+*   takes longer than MAX_WAKE_MS or brings no history, or if the gated
+*   stream sends more than a quarter of the continuous one.
+*/
+#include "Activity.h"
+#include "EventQueue.h"
+#include "I2C_Interface.h"
+#include "InterruptRoutines.h"
+#include "LIS3DH.h"
+#include "LowPower.h"
+#include "Timestamp.h"
+#include "project.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+#include "Pin_INT1_Sim.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#define LIS3DH_FIFO_WATERMARK   24
+
+// PROJ_3 ACTIVITY_THRESHOLD_MG, ACTIVITY_DURATION and ACTIVITY_POLL_US
+#define THRESHOLD_MG            128
+#define DURATION                1
+#define POLL_US                 (128000u + LOW_POWER_SLEEP_WAKEUP_US)
+
+// Trace: one hour, handled for BURST_S in the middle of every PERIOD_S
+#define TRACE_S                 3600
+#define PERIOD_S                300
+#define BURST_S                 10
+#define BURSTS                  (TRACE_S / PERIOD_S)
+
+// Longest time from the start of a burst to the stream at full rate
+#define MAX_WAKE_MS             500
+
+static Activity activity;
+static uint32_t timeout_us;
+static uint8_t acceleration[6 * LIS3DH_FIFO_LENGTH];
+
+// Samples sent, and per wake-up its time and the history sent with it
+static uint64_t sent;
+static uint8_t wakes;
+static uint64_t wake_ns[BURSTS + 1];
+static uint8_t history[BURSTS + 1];
+
+static const LIS3DH_Config stream_config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = LIS3DH_ODR_100_HZ,
+    .mode = LIS3DH_MODE_HIGH_RESOLUTION,
+    .full_scale = LIS3DH_FULL_SCALE_4G,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+    .fifo_mode = LIS3DH_FIFO_STREAM,
+    .fifo_watermark = LIS3DH_FIFO_WATERMARK,
+    .int1 = LIS3DH_INT1_WTM
+};
+
+static const LIS3DH_Config idle_config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = LIS3DH_ODR_10_HZ,
+    .mode = LIS3DH_MODE_LOW_POWER,
+    .full_scale = LIS3DH_FULL_SCALE_4G,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+    .fifo_mode = LIS3DH_FIFO_STREAM,
+    .fifo_watermark = LIS3DH_FIFO_WATERMARK,
+    .int1 = LIS3DH_INT1_IA1,
+    .int1_latch = 1,
+    .int1_highpass = 1
+};
+
+    // Board still on a table, picked up and turned around during the bursts
+    static void TraceSource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        (void)context;
+        double t = (double)t_ns * 1e-9;
+        double phase = fmod(t, PERIOD_S) - PERIOD_S / 2.0;
+        mg[0] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[1] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[2] = 1000 + (int32_t)(HostSim_Random() % 9u) - 4;
+        if (phase >= 0.0 && phase < BURST_S)
+        {
+            mg[0] += (int32_t)lround(400.0 * sin(2.0 * M_PI * 1.3 * phase));
+            mg[1] += (int32_t)lround(250.0 * sin(2.0 * M_PI * 2.1 * phase));
+            mg[2] += (int32_t)lround(200.0 * sin(2.0 * M_PI * 0.7 * phase));
+        }
+    }
+
+    // Samples left in the FIFO, read with blocking transfers like DrainSensor()
+    static uint8_t Drain(void)
+    {
+        uint8_t fifo_src;
+        I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_FIFO_SRC_REG, &fifo_src);
+        uint8_t count = (fifo_src & 0x40) ? LIS3DH_FIFO_LENGTH : (fifo_src & 0x1F);
+        if (count > 0)
+        {
+            I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_OUT_X_L, 6 * count, acceleration);
+            sent += count;
+        }
+        return count;
+    }
+
+    // Configuration switch of SwitchConfig(): power-down, last samples, new configuration
+    static uint8_t Switch(const LIS3DH_Config* config)
+    {
+        LIS3DH_UpdateRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, 0xF0, LIS3DH_ODR_POWER_DOWN << 4);
+        uint8_t count = Drain();
+        LIS3DH_Configure(config);
+        Activity_SetScale(&activity, config->mode, config->full_scale);
+        return count;
+    }
+
+    static int Gate_Main(void)
+    {
+        EventQueue_Event event;
+        uint8_t source;
+        uint8_t reference;
+        Activity_Start(&activity, stream_config.mode, stream_config.full_scale, THRESHOLD_MG, timeout_us,
+                       Timestamp_Now());
+        for (;;)
+        {
+            if (activity.idle)
+            {
+                if (Pin_INT1_Read() || !EventQueue_IsEmpty())
+                {
+                    while (EventQueue_Pop(&event))
+                    {
+                    }
+                    // WakeSensors(): generator off and latch released, then the history
+                    LIS3DH_ConfigureMotion(LIS3DH_DEVICE_ADDRESS, idle_config.full_scale, 0, 0);
+                    I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_INT1_SRC, &source);
+                    uint8_t count = Switch(&stream_config);
+                    Activity_Wake(&activity, Timestamp_Now());
+                    if (wakes <= BURSTS)
+                    {
+                        wake_ns[wakes] = HostSim_Now();
+                        history[wakes] = count;
+                    }
+                    wakes++;
+                    continue;
+                }
+                CyGlobalIntDisable;
+                LowPower_Idle(POLL_US, 1);
+                CyGlobalIntEnable;
+                continue;
+            }
+            if (Activity_IsIdleDue(&activity, Timestamp_Now()))
+            {
+                // IdleSensors(): the last samples, low-power mode, then the generator
+                Switch(&idle_config);
+                LIS3DH_ConfigureMotion(LIS3DH_DEVICE_ADDRESS, idle_config.full_scale, THRESHOLD_MG, DURATION);
+                I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_REFERENCE, &reference);
+                Activity_Sleep(&activity);
+                continue;
+            }
+            if (EventQueue_Pop(&event) || Pin_INT1_Read())
+            {
+                uint8_t count = Drain();
+                Activity_Update(&activity, 0, acceleration, count, Timestamp_Now());
+                continue;
+            }
+            // Woken by the INT1 or SysTick interrupts, like LowPower_Idle() in Alternate Active
+            HostSim_WaitForEvent();
+        }
+        return 0;
+    }
+
+    // Returns the number of failed checks
+    static unsigned Scenario(uint32_t timeout_ms)
+    {
+        static LIS3DH_Model sensor;
+        unsigned failures = 0;
+
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        LIS3DH_Model_SetSource(&sensor, TraceSource, NULL);
+        I2C_Master_Sim_Attach(&sensor);
+        Pin_INT1_Sim_Connect(&sensor);
+        Timestamp_Start();
+        LowPower_Start();
+        EventQueue_Reset();
+        I2C_Peripheral_Start();
+        ISR_DataReady_StartEx(DataReady_ISR);
+        CyGlobalIntEnable;
+        LIS3DH_Configure(&stream_config);
+
+        timeout_us = timeout_ms * 1000u;
+        sent = 0;
+        wakes = 0;
+        uint64_t elapsed = HostSim_Run(Gate_Main, TRACE_S * 1000000000ull);
+
+        double hours = (double)elapsed * 1e-9 / 3600.0;
+        double continuous = 3600.0 * LIS3DH_OdrHz(stream_config.odr, stream_config.mode);
+        double worst_wake_ms = 0.0;
+        unsigned least_history = LIS3DH_FIFO_LENGTH;
+        for (uint8_t i = 0; i < wakes && i < BURSTS; i++)
+        {
+            // The burst the wake-up belongs to
+            uint64_t burst_ns = ((uint64_t)PERIOD_S * i + PERIOD_S / 2) * 1000000000ull;
+            double wake_ms = ((double)wake_ns[i] - (double)burst_ns) * 1e-6;
+            if (wake_ms < 0.0)
+            {
+                printf("  wake-up %u at %.3f s, before its burst\n", (unsigned)i, (double)wake_ns[i] * 1e-9);
+                failures++;
+            }
+            worst_wake_ms = wake_ms > worst_wake_ms ? wake_ms : worst_wake_ms;
+            least_history = history[i] < least_history ? history[i] : least_history;
+        }
+        LowPower_Stats power = LowPower_GetStats();
+        printf("%7u ms %10.0f %9.1f %% %6u/%u %9.1f ms %8u %9.2f %% %7lu uA\n", (unsigned)timeout_ms,
+               (double)sent / hours, 100.0 * (double)sent / hours / continuous, (unsigned)wakes, BURSTS,
+               worst_wake_ms, least_history, 100.0 * power.time_ms[LOW_POWER_SLEEP] / ((double)elapsed * 1e-6),
+               (unsigned long)power.current_ua);
+
+        if (wakes != BURSTS)
+        {
+            printf("  %u wake-ups for %u bursts\n", (unsigned)wakes, BURSTS);
+            failures++;
+        }
+        if (worst_wake_ms > MAX_WAKE_MS || least_history == 0)
+        {
+            printf("  wake-up after %.1f ms, %u history samples\n", worst_wake_ms, least_history);
+            failures++;
+        }
+        if ((double)sent / hours > continuous / 4.0)
+        {
+            printf("  %.0f samples per hour, gating saves too little\n", (double)sent / hours);
+            failures++;
+        }
+        return failures;
+    }
+
+int main(void)
+{
+    static const uint32_t timeouts_ms[] = { 2000, 10000, 30000 };
+    unsigned failures = 0;
+
+    printf("One hour, %u s of handling every %u s; threshold %u mg, idle at 10 Hz in low-power mode\n\n",
+           BURST_S, PERIOD_S, THRESHOLD_MG);
+    printf("timeout   smp/hour  of 100 Hz  wake-ups  worst wake  history     sleep  current\n");
+    for (unsigned i = 0; i < sizeof(timeouts_ms) / sizeof(timeouts_ms[0]); i++)
+    {
+        failures += Scenario(timeouts_ms[i]);
+    }
+    printf("\n%s\n", failures ? "activity gating check FAILED" : "every burst woke the stream, with its history");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
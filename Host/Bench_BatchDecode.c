@@ -0,0 +1,361 @@
+/**
+*   \file Bench_BatchDecode.c
+*   \brief Throughput of the host decoders on long recordings.
+*
+*   bridge: 2M PROJ_2 frames (A0 x y z C0, big-endian digits) with a few
+*   garbage bytes every 997 frames and a broken footer every 1499.
+*   batched: a PROJ_3 recording of 24-sample FIFO batches, delta
+*   compressed by DeltaCodec with every fourth frame plain and a few
+*   steps too large for one-byte deltas, framed by Frame_Encode, with
+*   garbage, corrupted CRCs and dropped frames.
+*
+*   Each stream is decoded by FrameDecoder_Feed() in 4 KB chunks, the
+*   reference, and by BatchDecoder_Decode() with every kernel the CPU
+*   has. All of them must deliver the same samples and end with the same
+*   FrameDecoder_Stats, also when the input comes in odd-sized blocks
+*   into a small output that has to be drained; any difference makes the
+*   benchmark fail. Throughput is in GB/s of input, best of five trials.
+*   BatchDecoder_ToFloat() is checked against the scalar result and
+*   timed on the decoded x axis.
+*/
+#include "DeltaCodec.h"
+#include "Frame.h"
+
+#include "BatchDecoder.h"
+#include "FrameDecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BRIDGE_FRAMES   2000000
+#define BATCH           24
+#define TRIALS          5
+#define FEED_CHUNK      4096
+#define STREAM_SIZE     (BRIDGE_FRAMES * 8 + BRIDGE_FRAMES / 100)
+#define MAX_SAMPLES     BRIDGE_FRAMES
+
+typedef struct {
+    int16_t* x;
+    int16_t* y;
+    int16_t* z;
+    size_t count;
+} SampleArrays;
+
+static const char* kernel_names[] = { "scalar", "sse2", "avx2" };
+
+static uint8_t stream[STREAM_SIZE];
+static int16_t trace[MAX_SAMPLES][3];
+static SampleArrays reference;
+static FrameDecoder_Stats reference_stats;
+static unsigned failures;
+
+    static void Allocate(SampleArrays* arrays)
+    {
+        arrays->x = malloc(MAX_SAMPLES * sizeof(int16_t));
+        arrays->y = malloc(MAX_SAMPLES * sizeof(int16_t));
+        arrays->z = malloc(MAX_SAMPLES * sizeof(int16_t));
+        arrays->count = 0;
+        if (arrays->x == NULL || arrays->y == NULL || arrays->z == NULL)
+        {
+            perror("malloc");
+            exit(1);
+        }
+    }
+
+    static double Seconds(const struct timespec* start, const struct timespec* end)
+    {
+        return (double)(end->tv_sec - start->tv_sec) + 1e-9 * (double)(end->tv_nsec - start->tv_nsec);
+    }
+
+    static void Garbage(size_t* length, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            stream[(*length)++] = (uint8_t)rand();
+        }
+    }
+
+    static size_t BridgeStream(void)
+    {
+        size_t length = 0;
+        srand(11);
+        for (size_t n = 0; n < BRIDGE_FRAMES; n++)
+        {
+            // 10-bit digits, as PROJ_2 sends them
+            int16_t xyz[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                xyz[axis] = (int16_t)(rand() % 1024 - 512);
+            }
+            if (n % 997 == 500)
+            {
+                Garbage(&length, 1 + n % 5);
+            }
+            uint8_t* f = &stream[length];
+            f[0] = 0xA0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                f[1 + 2 * axis] = (uint8_t)((uint16_t)xyz[axis] >> 8);
+                f[2 + 2 * axis] = (uint8_t)(xyz[axis] & 0xFF);
+            }
+            f[7] = n % 1499 == 700 ? 0x00 : 0xC0;
+            length += 8;
+        }
+        return length;
+    }
+
+    static size_t BatchedStream(void)
+    {
+        DeltaCodec_Encoder encoder;
+        uint8_t payload[1 + FRAME_SAMPLE_SIZE * FRAME_MAX_SAMPLES];
+        const uint8_t config = FRAME_CONFIG(0x9, FRAME_MODE_HIGH_RESOLUTION, 0x1);
+        size_t samples = MAX_SAMPLES / BATCH * BATCH;
+        size_t length = 0;
+        uint16_t sequence = 0;
+
+        // Random walk in 2 mg steps, as HR mode at +-4 g, with a knock now and then
+        srand(13);
+        for (size_t n = 0; n < samples; n++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int16_t previous = n ? trace[n - 1][axis] : (axis == 2 ? 1000 : 0);
+                int16_t step = (int16_t)(2 * (rand() % 31 - 15));
+                if (n % 1733 == 0 && n > 0)
+                {
+                    // Outside the one-byte deltas: the frame takes the generic path
+                    step = (int16_t)(step + (axis == 1 ? 400 : -400));
+                }
+                trace[n][axis] = (int16_t)(previous + step);
+            }
+        }
+        DeltaCodec_Reset(&encoder);
+        for (size_t n = 0; n < samples && length + FRAME_MAX_SIZE + 8 < STREAM_SIZE; n += BATCH)
+        {
+            uint8_t type = FRAME_TYPE_SAMPLES;
+            uint8_t size;
+            size_t frame = n / BATCH;
+            if (frame % 4 == 3)
+            {
+                payload[0] = config;
+                for (uint8_t i = 0; i < BATCH; i++)
+                {
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        payload[1 + 6 * i + 2 * axis] = (uint8_t)(trace[n + i][axis] & 0xFF);
+                        payload[2 + 6 * i + 2 * axis] = (uint8_t)((uint16_t)trace[n + i][axis] >> 8);
+                    }
+                }
+                size = 1 + 6 * BATCH;
+            }
+            else
+            {
+                size = DeltaCodec_Encode(&encoder, config, &trace[n], BATCH, payload, &type);
+            }
+            if (frame % 811 == 400)
+            {
+                // Dropped by the UART queue: the receiver sees a sequence gap
+                sequence++;
+                DeltaCodec_Reset(&encoder);
+                continue;
+            }
+            if (frame % 613 == 300)
+            {
+                Garbage(&length, 7);
+            }
+            size_t start = length;
+            length += Frame_Encode(&stream[length], type, sequence++, (uint32_t)n, payload, size);
+            if (frame % 1009 == 500)
+            {
+                stream[start + FRAME_HEADER_SIZE]++;
+            }
+        }
+        return length;
+    }
+
+    static void Collect(const FrameDecoder_Frame* frame, void* context)
+    {
+        SampleArrays* arrays = context;
+        for (uint8_t i = 0; frame->samples != NULL && i < frame->sample_count; i++)
+        {
+            arrays->x[arrays->count] = frame->samples[i][0];
+            arrays->y[arrays->count] = frame->samples[i][1];
+            arrays->z[arrays->count] = frame->samples[i][2];
+            arrays->count++;
+        }
+    }
+
+    static double Reference(FrameDecoder_Format format, size_t length)
+    {
+        static FrameDecoder decoder;
+        double best = 0.0;
+        for (int trial = 0; trial < TRIALS; trial++)
+        {
+            struct timespec start, end;
+            reference.count = 0;
+            FrameDecoder_Init(&decoder, format, Collect, &reference);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (size_t i = 0; i < length; i += FEED_CHUNK)
+            {
+                FrameDecoder_Feed(&decoder, &stream[i], length - i < FEED_CHUNK ? length - i : FEED_CHUNK);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double seconds = Seconds(&start, &end);
+            if (trial == 0 || seconds < best)
+            {
+                best = seconds;
+            }
+        }
+        reference_stats = decoder.stats;
+        return best;
+    }
+
+    /*
+    *   Decode the stream in blocks of block bytes into an output of
+    *   capacity samples, moved to arrays whenever it fills up.
+    */
+    static void Decode(FrameDecoder_Format format, size_t length, size_t block, size_t capacity,
+                       SampleArrays* arrays, FrameDecoder_Stats* stats)
+    {
+        static BatchDecoder decoder;
+        BatchDecoder_Samples output = { arrays->x, arrays->y, arrays->z, capacity, 0 };
+        size_t position = 0;
+
+        arrays->count = 0;
+        BatchDecoder_Init(&decoder, format, &output);
+        while (position < length)
+        {
+            size_t size = length - position < block ? length - position : block;
+            size_t consumed = BatchDecoder_Decode(&decoder, &stream[position], size);
+            position += consumed;
+            if (capacity - output.count < FRAME_DECODER_MAX_SAMPLES)
+            {
+                arrays->count += output.count;
+                output.x = arrays->x + arrays->count;
+                output.y = arrays->y + arrays->count;
+                output.z = arrays->z + arrays->count;
+                output.count = 0;
+            }
+            else if (consumed == 0 && size == length - position)
+            {
+                // Incomplete frame at the end of the stream
+                break;
+            }
+        }
+        arrays->count += output.count;
+        *stats = decoder.frames.stats;
+    }
+
+    static void Compare(const char* name, const SampleArrays* arrays, const FrameDecoder_Stats* stats)
+    {
+        size_t bytes = arrays->count * sizeof(int16_t);
+        if (arrays->count != reference.count || memcmp(arrays->x, reference.x, bytes) != 0 ||
+            memcmp(arrays->y, reference.y, bytes) != 0 || memcmp(arrays->z, reference.z, bytes) != 0)
+        {
+            printf("  %s: samples differ from FrameDecoder (%zu, expected %zu)\n", name,
+                   arrays->count, reference.count);
+            failures++;
+        }
+        if (memcmp(stats, &reference_stats, sizeof(*stats)) != 0)
+        {
+            printf("  %s: counters differ from FrameDecoder\n", name);
+            failures++;
+        }
+    }
+
+    static void Scenario(const char* name, FrameDecoder_Format format, size_t length)
+    {
+        static SampleArrays arrays;
+        FrameDecoder_Stats stats;
+        double reference_seconds = Reference(format, length);
+
+        if (arrays.x == NULL)
+        {
+            Allocate(&arrays);
+        }
+        printf("%-8s %-9s %8.3f %7.2fx\n", name, "feed", (double)length / reference_seconds * 1e-9, 1.0);
+        for (int kernel = BATCH_DECODER_SCALAR; kernel <= (int)BatchDecoder_BestKernel(); kernel++)
+        {
+            char label[32];
+            BatchDecoder_SetKernel((BatchDecoder_Kernel)kernel);
+            snprintf(label, sizeof(label), "%s/%s", name, kernel_names[kernel]);
+
+            // Odd blocks and a small output: frames straddle blocks, the output fills up
+            Decode(format, length, 1021, 1000, &arrays, &stats);
+            Compare(label, &arrays, &stats);
+
+            double best = 0.0;
+            for (int trial = 0; trial < TRIALS; trial++)
+            {
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                Decode(format, length, 1 << 20, MAX_SAMPLES, &arrays, &stats);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                double seconds = Seconds(&start, &end);
+                if (trial == 0 || seconds < best)
+                {
+                    best = seconds;
+                }
+            }
+            Compare(label, &arrays, &stats);
+            printf("%-8s %-9s %8.3f %7.2fx\n", name, kernel_names[kernel],
+                   (double)length / best * 1e-9, reference_seconds / best);
+        }
+        printf("         %llu frames, %llu samples, %llu bytes skipped, %llu CRC errors, %llu gaps\n",
+               (unsigned long long)reference_stats.frames, (unsigned long long)reference_stats.samples,
+               (unsigned long long)reference_stats.bytes_skipped,
+               (unsigned long long)reference_stats.crc_errors,
+               (unsigned long long)reference_stats.sequence_gaps);
+    }
+
+    static void ToFloat(void)
+    {
+        static float expected[MAX_SAMPLES];
+        static float output[MAX_SAMPLES];
+        // Odd count: the vector kernels leave a scalar tail
+        size_t count = reference.count - 3;
+
+        BatchDecoder_SetKernel(BATCH_DECODER_SCALAR);
+        BatchDecoder_ToFloat(reference.x, expected, count, 0.001f);
+        for (int kernel = BATCH_DECODER_SCALAR; kernel <= (int)BatchDecoder_BestKernel(); kernel++)
+        {
+            double best = 0.0;
+            BatchDecoder_SetKernel((BatchDecoder_Kernel)kernel);
+            for (int trial = 0; trial < TRIALS; trial++)
+            {
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                BatchDecoder_ToFloat(reference.x, output, count, 0.001f);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                double seconds = Seconds(&start, &end);
+                if (trial == 0 || seconds < best)
+                {
+                    best = seconds;
+                }
+            }
+            if (memcmp(output, expected, count * sizeof(float)) != 0)
+            {
+                printf("  tofloat/%s: values differ from the scalar kernel\n", kernel_names[kernel]);
+                failures++;
+            }
+            printf("%-8s %-9s %8.3f\n", "tofloat", kernel_names[kernel],
+                   (double)(count * sizeof(int16_t)) / best * 1e-9);
+        }
+    }
+
+int main(void)
+{
+    Allocate(&reference);
+    printf("Best kernel on this CPU: %s\n\n", kernel_names[BatchDecoder_BestKernel()]);
+    printf("stream   decoder      GB/s  vs feed\n");
+    Scenario("bridge", FRAME_DECODER_BRIDGE, BridgeStream());
+    Scenario("batched", FRAME_DECODER_BATCHED, BatchedStream());
+    // mg of the batched recording to g
+    ToFloat();
+    printf("\n%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,217 @@
+/**
+*   \file Bench_BurstWrite.c
+*   \brief I2C cost of register-by-register writes versus burst writes.
+*
+*   Two register sets are written: the LIS3DH_Configure() set
+*   (TEMP_CFG_REG..CTRL_REG6 plus FIFO_CTRL_REG) and the interrupt, click
+*   and activity engines (INT1_CFG..ACT_DUR, skipping the read-only
+*   source registers). single: one I2C_Peripheral_WriteRegister() per
+*   register, as the projects did before. list: the same entries through
+*   I2C_Peripheral_WriteRegisterList(), which merges contiguous runs.
+*   shuffled: the list out of address order, where only the adjacent
+*   entries that still follow each other can be merged.
+*
+*   The register shadow is turned off so that every write reaches the
+*   bus. After each write the register file of the sensor model is
+*   compared with the expected values; a difference, or a transaction
+*   count other than the one expected, makes the benchmark fail.
+*/
+#include "I2C_Interface.h"
+#include "LIS3DH.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+
+#include <stdio.h>
+
+static LIS3DH_Model sensor;
+static unsigned failures;
+
+static const I2C_Peripheral_RegisterWrite config_writes[] = {
+    { LIS3DH_TEMP_CFG_REG, 0xC0 },
+    { LIS3DH_CTRL_REG1, 0x57 },
+    { LIS3DH_CTRL_REG2, 0x00 },
+    { LIS3DH_CTRL_REG3, 0x04 },
+    { LIS3DH_CTRL_REG4, 0x98 },
+    { LIS3DH_CTRL_REG5, 0x40 },
+    { LIS3DH_CTRL_REG6, 0x00 },
+    { LIS3DH_FIFO_CTRL_REG, 0x98 },
+};
+
+static const I2C_Peripheral_RegisterWrite engine_writes[] = {
+    { LIS3DH_INT1_CFG, 0x95 },
+    { LIS3DH_INT1_THS, 0x10 },
+    { LIS3DH_INT1_DURATION, 0x02 },
+    { LIS3DH_INT2_CFG, 0x2A },
+    { LIS3DH_INT2_THS, 0x20 },
+    { LIS3DH_INT2_DURATION, 0x05 },
+    { LIS3DH_CLICK_CFG, 0x15 },
+    { LIS3DH_CLICK_THS, 0x28 },
+    { LIS3DH_TIME_LIMIT, 0x0A },
+    { LIS3DH_TIME_LATENCY, 0x14 },
+    { LIS3DH_TIME_WINDOW, 0x3C },
+    { LIS3DH_ACT_THS, 0x08 },
+    { LIS3DH_ACT_DUR, 0x32 },
+};
+
+// Engine registers out of order: CLICK_THS..ACT_DUR and INT1_THS..INT2_CFG still follow each other
+static const I2C_Peripheral_RegisterWrite engine_shuffled[] = {
+    { LIS3DH_CLICK_THS, 0x28 },
+    { LIS3DH_TIME_LIMIT, 0x0A },
+    { LIS3DH_TIME_LATENCY, 0x14 },
+    { LIS3DH_TIME_WINDOW, 0x3C },
+    { LIS3DH_ACT_THS, 0x08 },
+    { LIS3DH_ACT_DUR, 0x32 },
+    { LIS3DH_INT2_DURATION, 0x05 },
+    { LIS3DH_INT1_CFG, 0x95 },
+    { LIS3DH_CLICK_CFG, 0x15 },
+    { LIS3DH_INT2_THS, 0x20 },
+    { LIS3DH_INT1_THS, 0x10 },
+    { LIS3DH_INT1_DURATION, 0x02 },
+    { LIS3DH_INT2_CFG, 0x2A },
+};
+
+#define COUNT(array) ((uint8_t)(sizeof(array) / sizeof(array[0])))
+
+    static void Setup(void)
+    {
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        I2C_Master_Sim_Attach(&sensor);
+        I2C_Peripheral_Start();
+        I2C_Peripheral_SetCacheMode(I2C_CACHE_OFF);
+    }
+
+    static void Check(const char* name, ErrorCode error, uint64_t expected_transactions,
+                      const I2C_Peripheral_RegisterWrite* writes, uint8_t count)
+    {
+        uint8_t ok = error == NO_ERROR && I2C_Master_Sim_stats.transactions == expected_transactions;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (sensor.regs[writes[i].register_address] != writes[i].value)
+            {
+                printf("  %s: register 0x%02X is 0x%02X, expected 0x%02X\n", name,
+                       writes[i].register_address, sensor.regs[writes[i].register_address],
+                       writes[i].value);
+                ok = 0;
+            }
+        }
+        if (!ok)
+        {
+            failures++;
+        }
+    }
+
+    static void Report(const char* set, const char* method, uint64_t baseline_ns)
+    {
+        printf("%-8s %-9s %6llu %6llu %9.1f %7.1f %%\n", set, method,
+               (unsigned long long)I2C_Master_Sim_stats.transactions,
+               (unsigned long long)I2C_Master_Sim_stats.bytes,
+               (double)I2C_Master_Sim_stats.bus_busy_ns / 1000.0,
+               baseline_ns ? 100.0 * (double)I2C_Master_Sim_stats.bus_busy_ns / (double)baseline_ns : 100.0);
+    }
+
+    static void Scenario(const char* set, const I2C_Peripheral_RegisterWrite* writes, uint8_t count,
+                         const I2C_Peripheral_RegisterWrite* shuffled, uint64_t runs,
+                         uint64_t shuffled_runs)
+    {
+        Setup();
+        ErrorCode error = NO_ERROR;
+        for (uint8_t i = 0; i < count && error == NO_ERROR; i++)
+        {
+            error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, writes[i].register_address,
+                                                 writes[i].value);
+        }
+        uint64_t baseline_ns = I2C_Master_Sim_stats.bus_busy_ns;
+        Check("single", error, count, writes, count);
+        Report(set, "single", baseline_ns);
+
+        Setup();
+        error = I2C_Peripheral_WriteRegisterList(LIS3DH_DEVICE_ADDRESS, writes, count);
+        Check("list", error, runs, writes, count);
+        Report(set, "list", baseline_ns);
+
+        if (shuffled != NULL)
+        {
+            Setup();
+            error = I2C_Peripheral_WriteRegisterList(LIS3DH_DEVICE_ADDRESS, shuffled, count);
+            Check("shuffled", error, shuffled_runs, shuffled, count);
+            Report(set, "shuffled", baseline_ns);
+        }
+    }
+
+    static void EdgeCases(void)
+    {
+        uint8_t data[LIS3DH_CONFIG_REG_COUNT] = { 0x80, 0x27, 0x00, 0x10, 0x08, 0x00, 0x00 };
+        I2C_Peripheral_RegisterWrite long_run[32];
+
+        // Single register through the burst writer: no auto-increment, one data byte
+        Setup();
+        ErrorCode error = I2C_Peripheral_WriteRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1,
+                                                            1, &data[1]);
+        if (error != NO_ERROR || I2C_Master_Sim_stats.bytes != 3 || sensor.regs[LIS3DH_CTRL_REG1] != 0x27)
+        {
+            printf("  burst of one register failed\n");
+            failures++;
+        }
+
+        // Whole configuration block in one transaction
+        Setup();
+        error = I2C_Peripheral_WriteRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_CONFIG_FIRST_REG,
+                                                  LIS3DH_CONFIG_REG_COUNT, data);
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_REG_COUNT; i++)
+        {
+            if (sensor.regs[LIS3DH_CONFIG_FIRST_REG + i] != data[i])
+            {
+                error = ERROR;
+            }
+        }
+        if (error != NO_ERROR || I2C_Master_Sim_stats.transactions != 1)
+        {
+            printf("  configuration burst failed\n");
+            failures++;
+        }
+
+        // Runs longer than I2C_PERIPHERAL_MAX_BURST are split (read-only registers ignore the writes)
+        Setup();
+        for (uint8_t i = 0; i < 32; i++)
+        {
+            long_run[i].register_address = LIS3DH_CTRL_REG1 + i;
+            long_run[i].value = sensor.regs[LIS3DH_CTRL_REG1 + i];
+        }
+        error = I2C_Peripheral_WriteRegisterList(LIS3DH_DEVICE_ADDRESS, long_run, 32);
+        if (error != NO_ERROR || I2C_Master_Sim_stats.transactions !=
+            (32 + I2C_PERIPHERAL_MAX_BURST - 1) / I2C_PERIPHERAL_MAX_BURST)
+        {
+            printf("  long run failed\n");
+            failures++;
+        }
+
+        // A device that does not answer fails the first run, once retried, and stops the list
+        Setup();
+        error = I2C_Peripheral_WriteRegisterList(LIS3DH_DEVICE_ADDRESS + 1, config_writes,
+                                                 COUNT(config_writes));
+        if (error != ERROR_I2C_NAK || I2C_Master_Sim_stats.transactions != 1 + I2C_PERIPHERAL_RETRIES)
+        {
+            printf("  missing device not reported\n");
+            failures++;
+        }
+    }
+
+int main(void)
+{
+    printf("I2C at 400 kHz, register shadow off; bus time relative to single writes\n\n");
+    printf("set      method     xfers  bytes  bus (us)  vs single\n");
+    // TEMP_CFG_REG..CTRL_REG6 and FIFO_CTRL_REG: two runs
+    Scenario("config", config_writes, COUNT(config_writes), NULL, 2, 0);
+    // INT1_CFG, INT1_THS..INT2_CFG, INT2_THS..CLICK_CFG, CLICK_THS..ACT_DUR
+    Scenario("engines", engine_writes, COUNT(engine_writes), engine_shuffled, 4, 6);
+    EdgeCases();
+    printf("\n%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
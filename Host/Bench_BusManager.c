@@ -0,0 +1,236 @@
+/**
+*   \file Bench_BusManager.c
+*   \brief Aggregate sample rate of several LIS3DH sensors drained in turn on one bus.
+*
+*   1 to 8 sensor models sit on the bus from 0x18 on, followed (while
+*   0x1F is free) by a device that acknowledges but is no LIS3DH
+*   (WHO_AM_I changed), which BusManager_Discover() must reject. They run in stream mode with the
+*   PROJ_3 watermark; only 0x18 has INT1 wired (DataReady_ISR and the
+*   event queue), the others are drained when their watermark is due
+*   (BusManager.h). The loop is that of PROJ_3 main.c: as soon as the bus
+*   is free the next due sensor gets its FIFO_SRC_REG read, chained to the
+*   burst of its samples.
+*
+*   For every ODR the aggregate rate read grows with the number of
+*   sensors until the bus saturates; from there on the FIFOs overrun and
+*   "lost" counts the samples overwritten in the sensors. The benchmark
+*   fails if discovery goes wrong, or if samples are lost or the rate
+*   read falls short of N x ODR while the bus still has room.
+*/
+#include "BusManager.h"
+#include "EventQueue.h"
+#include "I2C_Interface.h"
+#include "InterruptRoutines.h"
+#include "LIS3DH.h"
+#include "Timestamp.h"
+#include "project.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+#include "Pin_INT1_Sim.h"
+
+#include <stdio.h>
+
+#define LIS3DH_FIFO_WATERMARK   24
+
+// Bus utilisation below which every sample must be read
+#define ROOM_BUS_BUSY           0.85
+
+static BusManager bus;
+static uint8_t drain_device;
+static volatile uint8_t samples_ready;
+static uint64_t drains;
+
+static uint8_t status_reg;
+static uint8_t acceleration[6 * LIS3DH_FIFO_LENGTH];
+
+static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+
+static I2C_Peripheral_Transaction status_read = {
+    .register_address = LIS3DH_FIFO_SRC_REG,
+    .register_count = 1,
+    .data = &status_reg,
+    .callback = StatusRead_Done
+};
+
+static I2C_Peripheral_Transaction data_read = {
+    .register_address = LIS3DH_OUT_X_L,
+    .data = acceleration,
+    .callback = DataRead_Done
+};
+
+    static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        uint8_t wired = bus.devices[drain_device].wired;
+        uint8_t count = (status_reg & 0x40) ? LIS3DH_FIFO_LENGTH : (status_reg & 0x1F);
+        if (error == NO_ERROR && ((status_reg & 0x80) || (!wired && count > 0)))
+        {
+            BusManager_Drained(&bus, drain_device, Timestamp_Now(), count);
+            data_read.register_count = 6 * count;
+            I2C_Peripheral_Submit(&data_read);
+        }
+        else if (!wired)
+        {
+            BusManager_Drained(&bus, drain_device, Timestamp_Now(), 0);
+        }
+    }
+
+    static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        drains++;
+        samples_ready = 1;
+    }
+
+    static int Manager_Main(void)
+    {
+        EventQueue_Event event;
+        for (;;)
+        {
+            samples_ready = 0;
+            if (!I2C_Peripheral_IsBusy())
+            {
+                if (EventQueue_Pop(&event))
+                {
+                    BusManager_Signal(&bus, event.timestamp);
+                }
+                else if (Pin_INT1_Read())
+                {
+                    BusManager_Signal(&bus, Timestamp_Now());
+                }
+                uint8_t device = BusManager_Next(&bus, Timestamp_Now());
+                if (device != BUS_MANAGER_NONE)
+                {
+                    drain_device = device;
+                    status_read.device_address = bus.devices[device].address;
+                    data_read.device_address = bus.devices[device].address;
+                    I2C_Peripheral_Submit(&status_read);
+                    continue;
+                }
+            }
+            // Woken by the I2C, INT1 or SysTick interrupts, like LowPower_Idle()
+            if (I2C_Peripheral_IsBusy() || BusManager_TimeToDue(&bus, Timestamp_Now()) > 0)
+            {
+                HostSim_WaitForEvent();
+            }
+        }
+        return 0;
+    }
+
+    // Returns the number of failed checks
+    static unsigned Scenario(LIS3DH_Odr odr, uint8_t sensor_count)
+    {
+        static LIS3DH_Model sensors[BUS_MANAGER_MAX_DEVICES];
+        static LIS3DH_Model foreign;
+        unsigned failures = 0;
+
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+
+        for (uint8_t i = 0; i < sensor_count; i++)
+        {
+            LIS3DH_Model_Init(&sensors[i], (uint8_t)(LIS3DH_DEVICE_ADDRESS + i));
+            I2C_Master_Sim_Attach(&sensors[i]);
+        }
+        uint8_t foreigners = sensor_count < BUS_MANAGER_MAX_DEVICES;
+        if (foreigners)
+        {
+            LIS3DH_Model_Init(&foreign, (uint8_t)(LIS3DH_DEVICE_ADDRESS + sensor_count));
+            foreign.regs[LIS3DH_WHO_AM_I_REG_ADDR] = 0x44;
+            I2C_Master_Sim_Attach(&foreign);
+        }
+        Pin_INT1_Sim_Connect(&sensors[0]);
+        Timestamp_Start();
+        EventQueue_Reset();
+        I2C_Peripheral_Start();
+        ISR_DataReady_StartEx(DataReady_ISR);
+        CyGlobalIntEnable;
+
+        uint8_t found = BusManager_Discover(&bus, LIS3DH_DEVICE_ADDRESS, BUS_MANAGER_MAX_DEVICES,
+                                            LIS3DH_DEVICE_ADDRESS);
+        if (found != sensor_count || bus.rejected != foreigners || !bus.devices[0].wired)
+        {
+            printf("discovery: %u sensors, %u rejected, expected %u and %u\n", (unsigned)found,
+                   (unsigned)bus.rejected, (unsigned)sensor_count, (unsigned)foreigners);
+            return 1;
+        }
+
+        LIS3DH_Config config = {
+            .odr = odr,
+            .mode = LIS3DH_MODE_HIGH_RESOLUTION,
+            .full_scale = LIS3DH_FULL_SCALE_4G,
+            .axes = LIS3DH_AXES_XYZ,
+            .block_data_update = 1,
+            .fifo_mode = LIS3DH_FIFO_STREAM,
+            .fifo_watermark = LIS3DH_FIFO_WATERMARK,
+            .int1 = LIS3DH_INT1_WTM
+        };
+        for (uint8_t i = 0; i < bus.count; i++)
+        {
+            config.device_address = bus.devices[i].address;
+            LIS3DH_Configure(&config);
+        }
+        uint32_t odr_hz = LIS3DH_OdrHz(odr, config.mode);
+        BusManager_Start(&bus, (uint32_t)(1000000ull * LIS3DH_FIFO_WATERMARK / odr_hz), Timestamp_Now());
+
+        HostSim_stats = (HostSim_Stats){ 0 };
+        I2C_Master_Sim_stats = (I2C_Master_Sim_Stats){ 0 };
+        for (uint8_t i = 0; i < sensor_count; i++)
+        {
+            sensors[i].stats = (LIS3DH_Model_Stats){ 0 };
+        }
+        drains = 0;
+
+        uint64_t duration = 1000000000ull;
+        uint64_t start = HostSim_Now();
+        uint64_t elapsed = HostSim_Run(Manager_Main, duration) - start;
+
+        uint64_t generated = 0;
+        uint64_t read = 0;
+        uint64_t lost = 0;
+        uint64_t slowest = UINT64_MAX;
+        for (uint8_t i = 0; i < sensor_count; i++)
+        {
+            generated += sensors[i].stats.samples_generated;
+            read += sensors[i].stats.samples_read;
+            lost += sensors[i].stats.samples_overrun;
+            slowest = sensors[i].stats.samples_read < slowest ? sensors[i].stats.samples_read : slowest;
+        }
+        double seconds = (double)elapsed * 1e-9;
+        double bus_busy = (double)I2C_Master_Sim_stats.bus_busy_ns / (double)elapsed;
+        printf("%5u Hz  %2u %9.0f %9.0f %6llu %8.0f %9.2f %8.2f %% %8.2f %%\n",
+               (unsigned)odr_hz, (unsigned)sensor_count, (double)sensor_count * odr_hz, (double)read / seconds,
+               (unsigned long long)lost, (double)slowest / seconds, read ? (double)drains * LIS3DH_FIFO_WATERMARK / read : 0.0,
+               100.0 * bus_busy, 100.0 * (double)HostSim_stats.cpu_idle_ns / (double)elapsed);
+
+        // The FIFOs still hold less than a watermark each when the run stops
+        if (bus_busy < ROOM_BUS_BUSY &&
+            (lost > 0 || read + (uint64_t)sensor_count * LIS3DH_FIFO_LENGTH < generated))
+        {
+            printf("  samples lost with the bus %.1f %% busy\n", 100.0 * bus_busy);
+            failures++;
+        }
+        return failures;
+    }
+
+int main(void)
+{
+    static const LIS3DH_Odr rates[] = { LIS3DH_ODR_100_HZ, LIS3DH_ODR_400_HZ, LIS3DH_ODR_1344_HZ };
+    unsigned failures = 0;
+
+    printf("I2C at 400 kHz, HR mode, FIFO watermark %u; INT1 wired on 0x18 only\n\n", LIS3DH_FIFO_WATERMARK);
+    printf("  ODR     N    N x ODR  smp/s read  lost  slowest  drain/WTM  bus busy   CPU idle\n");
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        for (uint8_t count = 1; count <= BUS_MANAGER_MAX_DEVICES; count++)
+        {
+            failures += Scenario(rates[i], count);
+        }
+    }
+    printf("\n%s\n", failures ? "bus manager check FAILED" : "no sample lost while the bus had room");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
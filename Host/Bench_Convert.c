@@ -0,0 +1,254 @@
+/**
+*   \file Bench_Convert.c
+*   \brief Cost of the sample conversion: per-axis code versus the
+*          LIS3DH_Convert.h kernel.
+*
+*   legacy: the former PROJ_3 loop, one axis at a time (>> 4, then
+*   * HR_SENSITIVITY) with the bytes stored one by one into the frame.
+*   The kernel rows use the functions that LIS3DH_DEFINE_MG_CONVERTER()
+*   generates for HR mode at +-4 g. Every variant converts FIFO batches
+*   of 24 samples; TSC cycles and host nanoseconds are per sample, best
+*   of seven trials. The firmware flags apply (-Og, as the PSoC Creator
+*   Debug configuration).
+*
+*   Before timing, the converters of all twelve (mode, full scale) pairs
+*   are checked against (word >> shift) * sensitivity on random outputs
+*   with the unused low bits cleared, as the sensor delivers them; any
+*   difference makes the benchmark fail.
+*/
+#include "LIS3DH_Convert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define READ_CYCLES() __rdtsc()
+#else
+    #define READ_CYCLES() 0ull
+#endif
+
+#define BATCH       24
+#define BATCHES     256
+#define REPEAT      100
+#define TRIALS      7
+
+LIS3DH_DEFINE_MG_CONVERTER(Lp2, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_2G)
+LIS3DH_DEFINE_MG_CONVERTER(Lp4, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_4G)
+LIS3DH_DEFINE_MG_CONVERTER(Lp8, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_8G)
+LIS3DH_DEFINE_MG_CONVERTER(Lp16, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_16G)
+LIS3DH_DEFINE_MG_CONVERTER(Normal2, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_2G)
+LIS3DH_DEFINE_MG_CONVERTER(Normal4, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_4G)
+LIS3DH_DEFINE_MG_CONVERTER(Normal8, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_8G)
+LIS3DH_DEFINE_MG_CONVERTER(Normal16, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_16G)
+LIS3DH_DEFINE_MG_CONVERTER(Hr2, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_2G)
+LIS3DH_DEFINE_MG_CONVERTER(Hr4, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_4G)
+LIS3DH_DEFINE_MG_CONVERTER(Hr8, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_8G)
+LIS3DH_DEFINE_MG_CONVERTER(Hr16, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_16G)
+
+typedef struct {
+    LIS3DH_Mode mode;
+    LIS3DH_FullScale full_scale;
+    void (*to_samples)(const uint8_t*, int16_t (*)[3], uint8_t);
+    void (*to_payload)(const uint8_t*, uint8_t*, uint8_t);
+    void (*to_bridge)(const uint8_t*, uint8_t*, uint8_t);
+} Converter;
+
+#define CONVERTER(name, mode, full_scale) \
+    { mode, full_scale, name##_ToSamples, name##_ToPayload, name##_ToBridge }
+
+static const Converter converters[] = {
+    CONVERTER(Lp2, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_2G),
+    CONVERTER(Lp4, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_4G),
+    CONVERTER(Lp8, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_8G),
+    CONVERTER(Lp16, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_16G),
+    CONVERTER(Normal2, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_2G),
+    CONVERTER(Normal4, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_4G),
+    CONVERTER(Normal8, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_8G),
+    CONVERTER(Normal16, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_16G),
+    CONVERTER(Hr2, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_2G),
+    CONVERTER(Hr4, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_4G),
+    CONVERTER(Hr8, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_8G),
+    CONVERTER(Hr16, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_16G),
+};
+
+#define HR_SENSITIVITY 2
+
+static uint8_t raw[BATCHES][LIS3DH_SAMPLE_SIZE * BATCH];
+static uint8_t output[BATCHES][LIS3DH_BRIDGE_FRAME_SIZE * BATCH];
+
+    // Random outputs of a mode: left-justified words with the unused low bits at zero
+    static void Fill(LIS3DH_Mode mode)
+    {
+        uint16_t mask = (uint16_t)(0xFFFF << LIS3DH_OUTPUT_SHIFT(mode));
+        for (unsigned b = 0; b < BATCHES; b++)
+        {
+            for (unsigned i = 0; i < LIS3DH_SAMPLE_SIZE * BATCH; i += 2)
+            {
+                uint16_t word = (uint16_t)rand() & mask;
+                // Full-scale extremes in the first sample of each batch
+                if (i < 6)
+                {
+                    word = (i == 0) ? 0x8000 : (i == 2) ? mask & 0x7FFF : 0;
+                }
+                raw[b][i] = (uint8_t)(word & 0xFF);
+                raw[b][i + 1] = (uint8_t)(word >> 8);
+            }
+        }
+    }
+
+    static int16_t Reference(const uint8_t* axis, LIS3DH_Mode mode, LIS3DH_FullScale full_scale)
+    {
+        int16_t digits = (int16_t)(axis[0] | (axis[1] << 8)) >> LIS3DH_OUTPUT_SHIFT(mode);
+        return (int16_t)(digits * LIS3DH_SensitivityMg(mode, full_scale));
+    }
+
+    static unsigned Check(const Converter* converter)
+    {
+        int16_t samples[BATCH][3];
+        uint8_t payload[LIS3DH_SAMPLE_SIZE * BATCH];
+        uint8_t frames[LIS3DH_BRIDGE_FRAME_SIZE * BATCH];
+        unsigned errors = 0;
+
+        Fill(converter->mode);
+        for (unsigned b = 0; b < BATCHES; b++)
+        {
+            converter->to_samples(raw[b], samples, BATCH);
+            converter->to_payload(raw[b], payload, BATCH);
+            converter->to_bridge(raw[b], frames, BATCH);
+            for (unsigned i = 0; i < BATCH; i++)
+            {
+                uint8_t* frame = &frames[LIS3DH_BRIDGE_FRAME_SIZE * i];
+                errors += frame[0] != LIS3DH_BRIDGE_HEADER || frame[7] != LIS3DH_BRIDGE_FOOTER;
+                for (unsigned axis = 0; axis < 3; axis++)
+                {
+                    unsigned k = 3 * i + axis;
+                    int16_t expected = Reference(&raw[b][2 * k], converter->mode,
+                                                 converter->full_scale);
+                    int16_t little = (int16_t)(payload[2 * k] | (payload[2 * k + 1] << 8));
+                    int16_t big = (int16_t)((frame[1 + 2 * axis] << 8) | frame[2 + 2 * axis]);
+                    errors += samples[i][axis] != expected || little != expected || big != expected;
+                }
+            }
+        }
+        return errors;
+    }
+
+    // Former PROJ_3 conversion of a batch into the samples frame payload
+    static void Legacy_ToPayload(const uint8_t* data, uint8_t* payload, uint8_t count)
+    {
+        int16_t X_Out, Y_Out, Z_Out;
+        int16_t X_Out_mg, Y_Out_mg, Z_Out_mg;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const uint8_t* Sample = &data[6 * i];
+            X_Out = (int16_t)(Sample[0] | (Sample[1] << 8)) >> 4;
+            X_Out_mg = X_Out * HR_SENSITIVITY;
+            Y_Out = (int16_t)(Sample[2] | (Sample[3] << 8)) >> 4;
+            Y_Out_mg = Y_Out * HR_SENSITIVITY;
+            Z_Out = (int16_t)(Sample[4] | (Sample[5] << 8)) >> 4;
+            Z_Out_mg = Z_Out * HR_SENSITIVITY;
+            uint8_t* Out = &payload[6 * i];
+            Out[0] = (uint8_t)(X_Out_mg & 0xFF);
+            Out[1] = (uint8_t)(X_Out_mg >> 8);
+            Out[2] = (uint8_t)(Y_Out_mg & 0xFF);
+            Out[3] = (uint8_t)(Y_Out_mg >> 8);
+            Out[4] = (uint8_t)(Z_Out_mg & 0xFF);
+            Out[5] = (uint8_t)(Z_Out_mg >> 8);
+        }
+    }
+
+    // Former PROJ_3 bridge output: one 8-byte frame per sample
+    static void Legacy_ToBridge(const uint8_t* data, uint8_t* frames, uint8_t count)
+    {
+        int16_t X_Out, Y_Out, Z_Out;
+        int16_t X_Out_mg, Y_Out_mg, Z_Out_mg;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const uint8_t* Sample = &data[6 * i];
+            uint8_t* OutArray = &frames[8 * i];
+            X_Out = (int16_t)(Sample[0] | (Sample[1] << 8)) >> 4;
+            X_Out_mg = X_Out * HR_SENSITIVITY;
+            Y_Out = (int16_t)(Sample[2] | (Sample[3] << 8)) >> 4;
+            Y_Out_mg = Y_Out * HR_SENSITIVITY;
+            Z_Out = (int16_t)(Sample[4] | (Sample[5] << 8)) >> 4;
+            Z_Out_mg = Z_Out * HR_SENSITIVITY;
+            OutArray[0] = 0xA0;
+            OutArray[1] = (uint8_t)(X_Out_mg >> 8);
+            OutArray[2] = (uint8_t)(X_Out_mg & 0xFF);
+            OutArray[3] = (uint8_t)(Y_Out_mg >> 8);
+            OutArray[4] = (uint8_t)(Y_Out_mg & 0xFF);
+            OutArray[5] = (uint8_t)(Z_Out_mg >> 8);
+            OutArray[6] = (uint8_t)(Z_Out_mg & 0xFF);
+            OutArray[7] = 0xC0;
+        }
+    }
+
+    static void Samples_Adapter(const uint8_t* data, uint8_t* out, uint8_t count)
+    {
+        Hr4_ToSamples(data, (int16_t (*)[3])(void*)out, count);
+    }
+
+    static double Time(const char* name, void (*convert)(const uint8_t*, uint8_t*, uint8_t),
+                       double baseline)
+    {
+        double samples = (double)REPEAT * BATCHES * BATCH;
+        double ns = 0.0;
+        double per_sample = 0.0;
+
+        // Best of several trials, to keep other host activity out of the figures
+        for (unsigned trial = 0; trial < TRIALS; trial++)
+        {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            uint64_t cycles = READ_CYCLES();
+            for (unsigned r = 0; r < REPEAT; r++)
+            {
+                for (unsigned b = 0; b < BATCHES; b++)
+                {
+                    convert(raw[b], output[b], BATCH);
+                }
+            }
+            cycles = READ_CYCLES() - cycles;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double trial_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / samples;
+            if (trial == 0 || trial_ns < ns)
+            {
+                ns = trial_ns;
+                per_sample = (double)cycles / samples;
+            }
+        }
+        printf("%-16s %8.2f %8.2f %8.2fx\n", name, ns, per_sample,
+               baseline > 0.0 && per_sample > 0.0 ? baseline / per_sample : 1.0);
+        return per_sample;
+    }
+
+int main(void)
+{
+    unsigned failures = 0;
+
+    for (unsigned c = 0; c < sizeof(converters) / sizeof(converters[0]); c++)
+    {
+        unsigned errors = Check(&converters[c]);
+        if (errors)
+        {
+            printf("mode %u, full scale %u: %u wrong outputs\n", (unsigned)converters[c].mode,
+                   (unsigned)converters[c].full_scale, errors);
+            failures++;
+        }
+    }
+    printf("%s\n\n", failures ? "conversion check FAILED" : "12 converters match the reference");
+
+    Fill(LIS3DH_MODE_HIGH_RESOLUTION);
+    printf("HR +-4 g, batches of %u samples; speed-up against the legacy row above it\n\n", BATCH);
+    printf("variant            ns/smp  cyc/smp  speed-up\n");
+    double legacy = Time("legacy payload", Legacy_ToPayload, 0.0);
+    Time("kernel payload", Hr4_ToPayload, legacy);
+    Time("kernel samples", Samples_Adapter, legacy);
+    legacy = Time("legacy bridge", Legacy_ToBridge, 0.0);
+    Time("kernel bridge", Hr4_ToBridge, legacy);
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,388 @@
+/**
+*   \file Bench_Events.c
+*   \brief Clicks and free falls of the sensor engines against the software detector.
+*
+*   The board lies still but for, every PERIOD_S: a tap (a half-sine of
+*   TAP_MG over TAP_MS, on x, y and z in turn, towards the positive side
+*   one round and the negative the next), a soft tap on z below the click
+*   threshold, and a drop (DROP_MS weightless), caught every other round
+*   with a landing impact on z. The loop is the events format of PROJ_3
+*   main.c: the sensor runs at 400 Hz in HR mode at +-4 g, its FIFO in
+*   stream mode, with the click engine (LIS3DH_ConfigureClick(), on
+*   high-pass data) and the free-fall generator (LIS3DH_ConfigureFreeFall())
+*   latched on INT1. On INT1 CLICK_SRC and INT1_SRC are read, IA1 is
+*   switched between free fall and its end, the FIFO is read and
+*   Events_Report() writes the frame, which goes through Frame_Encode()
+*   and FrameDecoder like on the UART.
+*
+*   Every sample the sensor model generates also goes through
+*   EventDetector, the software detector decode_stream -e runs on a
+*   captured stream. Each expected event must be found once by both, with
+*   the same axes and sign, within MAX_LATENCY_MS of the motion; the soft
+*   taps and the rest of the trace must give nothing. The UART bytes of
+*   the event frames are printed next to those of the batched stream.
+*/
+#include "Events.h"
+#include "EventQueue.h"
+#include "Frame.h"
+#include "I2C_Interface.h"
+#include "InterruptRoutines.h"
+#include "LIS3DH.h"
+#include "LIS3DH_Convert.h"
+#include "Timestamp.h"
+#include "project.h"
+
+#include "EventDetector.h"
+#include "FrameDecoder.h"
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+#include "Pin_INT1_Sim.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// PROJ_3 EVENTS_* defaults at 400 Hz, times in samples rounded up
+#define ODR_HZ                  400
+#define CLICK_THRESHOLD_MG      EVENT_DETECTOR_CLICK_THRESHOLD_MG
+#define CLICK_LIMIT             8
+#define CLICK_LATENCY           40
+#define FREE_FALL_MG            EVENT_DETECTOR_FREE_FALL_MG
+#define FREE_FALL_DURATION      40
+
+// Trace: taps, soft taps and drops every PERIOD_S
+#define TRACE_S                 24
+#define PERIOD_S                1
+#define TAP_MG                  2500
+#define TAP_MS                  10
+#define SOFT_TAP_MG             800
+#define DROP_MS                 300
+#define IMPACT_MG               2000
+#define ROUNDS                  (TRACE_S / PERIOD_S)
+
+// Longest time from the start of the motion to the event
+#define MAX_LATENCY_MS          150
+
+// Expected events per round: tap, free fall, landing impact every other round
+#define MAX_EVENTS              (3 * ROUNDS)
+
+// Event found by the sensor (from the decoded frame) or by the detector
+typedef struct {
+    uint8_t kind;
+    uint8_t axes;
+    uint64_t at_ns;
+    int16_t snapshot[3];
+} Found;
+
+typedef struct {
+    Found events[2 * MAX_EVENTS];
+    unsigned count;
+} FoundList;
+
+LIS3DH_DEFINE_MG_CONVERTER(Hr4, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_4G)
+
+static const LIS3DH_Config config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = LIS3DH_ODR_400_HZ,
+    .mode = LIS3DH_MODE_HIGH_RESOLUTION,
+    .full_scale = LIS3DH_FULL_SCALE_4G,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+    .fifo_mode = LIS3DH_FIFO_STREAM,
+    .fifo_watermark = 24,
+    .int1 = LIS3DH_INT1_CLICK | LIS3DH_INT1_IA1,
+    .int1_latch = 1,
+    .click_highpass = 1
+};
+
+static EventDetector detector;
+static FoundList device;
+static FoundList software;
+static uint8_t acceleration[6 * LIS3DH_FIFO_LENGTH];
+static int16_t samples[LIS3DH_FIFO_LENGTH][3];
+static uint64_t uart_bytes;
+
+    // Half-sine pulse of peak mg over ms, t from its start [s]
+    static int32_t Pulse(double t, double peak, double ms)
+    {
+        return t >= 0.0 && t < ms * 1e-3 ? (int32_t)lround(peak * sin(M_PI * t / (ms * 1e-3))) : 0;
+    }
+
+    // Board still on a table, tapped and dropped every round; every sample also goes to the detector
+    static void TraceSource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        (void)context;
+        double t = (double)t_ns * 1e-9;
+        unsigned round = (unsigned)(t / PERIOD_S);
+        double phase = t - round * PERIOD_S;
+        double drop = phase - 0.6 * PERIOD_S;
+        mg[0] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[1] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[2] = 1000 + (int32_t)(HostSim_Random() % 9u) - 4;
+        int32_t tap = Pulse(phase - 0.2 * PERIOD_S, TAP_MG, TAP_MS);
+        mg[round % 3] += (round / 3) % 2 ? -tap : tap;
+        mg[2] += Pulse(phase - 0.4 * PERIOD_S, SOFT_TAP_MG, TAP_MS);
+        if (drop >= 0.0 && drop < DROP_MS * 1e-3)
+        {
+            mg[2] -= 1000;
+        }
+        if (round % 2)
+        {
+            mg[2] += Pulse(drop - DROP_MS * 1e-3, IMPACT_MG, TAP_MS);
+        }
+
+        int16_t sample[3] = { (int16_t)mg[0], (int16_t)mg[1], (int16_t)mg[2] };
+        EventDetector_Event events[2];
+        int count = EventDetector_Add(&detector, sample, events);
+        for (int i = 0; i < count && software.count < 2 * MAX_EVENTS; i++)
+        {
+            Found* found = &software.events[software.count++];
+            found->kind = events[i].kind;
+            found->axes = events[i].axes;
+            found->at_ns = t_ns;
+        }
+    }
+
+    // Event frame through the encoder and the decoder, like on the UART
+    static void FrameReceived(const FrameDecoder_Frame* frame, void* context)
+    {
+        (void)context;
+        FrameDecoder_Event event;
+        if (FrameDecoder_ParseEvent(frame, &event) && device.count < 2 * MAX_EVENTS)
+        {
+            Found* found = &device.events[device.count++];
+            found->kind = event.kind;
+            found->axes = event.axes;
+            found->at_ns = HostSim_Now();
+            for (int axis = 0; axis < 3; axis++)
+            {
+                found->snapshot[axis] = event.snapshot[axis];
+            }
+        }
+    }
+
+    static FrameDecoder decoder;
+
+    static void Send(Events_Kind kind, uint8_t axes, uint8_t count)
+    {
+        static uint16_t sequence;
+        uint8_t payload[EVENTS_REPORT_SIZE];
+        uint8_t frame[FRAME_HEADER_SIZE + EVENTS_REPORT_SIZE + FRAME_CRC_SIZE];
+        Events_Report(kind, axes, 0x79, (const int16_t (*)[3])samples, count, payload);
+        uint16_t size = Frame_Encode(frame, FRAME_TYPE_EVENT, sequence++, Timestamp_Now(), payload,
+                                     EVENTS_REPORT_SIZE);
+        uart_bytes += size;
+        FrameDecoder_Feed(&decoder, frame, size);
+    }
+
+    // ReadEvents() of PROJ_3 with blocking transfers
+    static void ReadEvents(uint8_t* falling)
+    {
+        uint8_t click_source;
+        uint8_t free_fall_source;
+        uint8_t stale;
+        uint8_t fifo_src;
+        I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CLICK_SRC, &click_source);
+        I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_INT1_SRC, &free_fall_source);
+        if (free_fall_source & LIS3DH_SRC_IA)
+        {
+            if (*falling)
+            {
+                LIS3DH_ConfigureFreeFall(LIS3DH_DEVICE_ADDRESS, config.full_scale, FREE_FALL_MG,
+                                         FREE_FALL_DURATION);
+            }
+            else
+            {
+                LIS3DH_ConfigureMotion(LIS3DH_DEVICE_ADDRESS, config.full_scale, FREE_FALL_MG,
+                                       FREE_FALL_DURATION);
+            }
+            I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_INT1_SRC, &stale);
+        }
+        uint8_t fall = (free_fall_source & LIS3DH_SRC_IA) && !*falling;
+        if (free_fall_source & LIS3DH_SRC_IA)
+        {
+            *falling = !*falling;
+        }
+        if (!(click_source & LIS3DH_SRC_IA) && !fall)
+        {
+            return;
+        }
+        I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_FIFO_SRC_REG, &fifo_src);
+        uint8_t count = (fifo_src & 0x40) ? LIS3DH_FIFO_LENGTH : (fifo_src & 0x1F);
+        if (count > 0)
+        {
+            I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_OUT_X_L, 6 * count, acceleration);
+            Hr4_ToSamples(acceleration, samples, count);
+        }
+        if (click_source & LIS3DH_SRC_IA)
+        {
+            Send(EVENTS_CLICK, Events_ClickAxes(click_source), count);
+        }
+        if (fall)
+        {
+            Send(EVENTS_FREE_FALL, Events_FreeFallAxes(free_fall_source), count);
+        }
+    }
+
+    static int Events_Main(void)
+    {
+        EventQueue_Event event;
+        uint8_t falling = 0;
+        for (;;)
+        {
+            if (EventQueue_Pop(&event) || Pin_INT1_Read())
+            {
+                ReadEvents(&falling);
+                continue;
+            }
+            HostSim_WaitForEvent();
+        }
+        return 0;
+    }
+
+    // Finds the event of a list matching an expected one, marks it used; returns its latency [ms] or -1
+    static double Match(FoundList* list, uint8_t used[], uint8_t kind, uint8_t axes, uint64_t start_ns)
+    {
+        for (unsigned i = 0; i < list->count; i++)
+        {
+            const Found* found = &list->events[i];
+            if (!used[i] && found->kind == kind && found->at_ns >= start_ns &&
+                found->at_ns < start_ns + MAX_LATENCY_MS * 1000000ull)
+            {
+                used[i] = 1;
+                return found->axes == axes ? (double)(found->at_ns - start_ns) * 1e-6 : -1.0;
+            }
+        }
+        return -1.0;
+    }
+
+int main(void)
+{
+    static LIS3DH_Model sensor;
+    static uint8_t device_used[2 * MAX_EVENTS];
+    static uint8_t software_used[2 * MAX_EVENTS];
+    unsigned failures = 0;
+
+    HostSim_Reset();
+    I2C_Master_Sim_Reset();
+    HostSim_config.i2c_bus_khz = 400;
+    LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+    LIS3DH_Model_SetSource(&sensor, TraceSource, NULL);
+    I2C_Master_Sim_Attach(&sensor);
+    Pin_INT1_Sim_Connect(&sensor);
+    Timestamp_Start();
+    EventQueue_Reset();
+    I2C_Peripheral_Start();
+    ISR_DataReady_StartEx(DataReady_ISR);
+    CyGlobalIntEnable;
+
+    EventDetector_Config detector_config;
+    EventDetector_Defaults(&detector_config, ODR_HZ);
+    EventDetector_Init(&detector, &detector_config);
+    FrameDecoder_Init(&decoder, FRAME_DECODER_BATCHED, FrameReceived, NULL);
+    LIS3DH_Configure(&config);
+    LIS3DH_ConfigureClick(LIS3DH_DEVICE_ADDRESS, config.full_scale, CLICK_THRESHOLD_MG, CLICK_LIMIT,
+                          CLICK_LATENCY, 1);
+    LIS3DH_ConfigureFreeFall(LIS3DH_DEVICE_ADDRESS, config.full_scale, FREE_FALL_MG, FREE_FALL_DURATION);
+    uint64_t elapsed = HostSim_Run(Events_Main, (uint64_t)TRACE_S * 1000000000ull);
+
+    printf("%u s, every %u s a tap of %u mg, a soft tap of %u mg and a drop of %u ms; 400 Hz HR +-4 g\n\n",
+           TRACE_S, PERIOD_S, TAP_MG, SOFT_TAP_MG, DROP_MS);
+    printf("event       axes  expected  sensor   latency  software   latency\n");
+    unsigned expected[2] = { 0, 0 };
+    unsigned found[2][2] = { { 0, 0 }, { 0, 0 } };
+    double worst[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+    for (unsigned round = 0; round < ROUNDS; round++)
+    {
+        uint64_t round_ns = (uint64_t)(round * PERIOD_S * 1e9);
+        uint64_t drop_ns = round_ns + (uint64_t)(0.6 * PERIOD_S * 1e9);
+        struct {
+            uint8_t kind;
+            uint8_t axes;
+            uint64_t start_ns;
+        } events[3] = {
+            { EVENT_DETECTOR_CLICK, (uint8_t)(((round / 3) % 2 ? EVENT_DETECTOR_NEGATIVE : 0) | (1u << (round % 3))),
+              round_ns + (uint64_t)(0.2 * PERIOD_S * 1e9) },
+            { EVENT_DETECTOR_FREE_FALL, 0x07, drop_ns },
+            { EVENT_DETECTOR_CLICK, 0x04, drop_ns + DROP_MS * 1000000ull }
+        };
+        for (unsigned i = 0; i < (round % 2 ? 3u : 2u); i++)
+        {
+            if (events[i].start_ns + MAX_LATENCY_MS * 1000000ull > elapsed)
+            {
+                continue;
+            }
+            unsigned kind = events[i].kind - 1;
+            double latency[2] = {
+                Match(&device, device_used, events[i].kind, events[i].axes, events[i].start_ns),
+                Match(&software, software_used, events[i].kind, events[i].axes, events[i].start_ns)
+            };
+            expected[kind]++;
+            for (int source = 0; source < 2; source++)
+            {
+                if (latency[source] < 0.0)
+                {
+                    printf("  %s %s at %.3f s missed or on the wrong axis\n", source ? "software" : "sensor",
+                           kind ? "free fall" : "click", (double)events[i].start_ns * 1e-9);
+                    failures++;
+                    continue;
+                }
+                found[kind][source]++;
+                worst[kind][source] = latency[source] > worst[kind][source] ? latency[source] : worst[kind][source];
+            }
+        }
+    }
+    for (unsigned kind = 0; kind < 2; kind++)
+    {
+        printf("%-10s  %4s  %8u  %6u  %5.1f ms  %8u  %5.1f ms\n", kind ? "free fall" : "click",
+               kind ? "xyz" : "all", expected[kind], found[kind][0], worst[kind][0], found[kind][1],
+               worst[kind][1]);
+    }
+
+    // Anything not matched is a false event (the soft taps, the end of a fall)
+    for (unsigned i = 0; i < device.count; i++)
+    {
+        if (!device_used[i] && device.events[i].at_ns + MAX_LATENCY_MS * 1000000ull <= elapsed)
+        {
+            printf("  sensor: unexpected kind %u axes 0x%02X at %.3f s\n", (unsigned)device.events[i].kind,
+                   (unsigned)device.events[i].axes, (double)device.events[i].at_ns * 1e-9);
+            failures++;
+        }
+    }
+    for (unsigned i = 0; i < software.count; i++)
+    {
+        if (!software_used[i] && software.events[i].at_ns + MAX_LATENCY_MS * 1000000ull <= elapsed)
+        {
+            printf("  software: unexpected kind %u axes 0x%02X at %.3f s\n", (unsigned)software.events[i].kind,
+                   (unsigned)software.events[i].axes, (double)software.events[i].at_ns * 1e-9);
+            failures++;
+        }
+    }
+
+    // A tap snapshot is the peak of its axis in its direction
+    for (unsigned i = 0; i < device.count; i++)
+    {
+        const Found* event = &device.events[i];
+        uint8_t axis = (event->axes & 0x02) ? 1 : (event->axes & 0x04) ? 2 : 0;
+        int32_t rest = axis == 2 ? 1000 : 0;
+        int32_t swing = event->snapshot[axis] - rest;
+        if (event->kind == EVENT_DETECTOR_CLICK && (event->axes & EVENT_DETECTOR_NEGATIVE ? -swing : swing) < CLICK_THRESHOLD_MG)
+        {
+            printf("  sensor: click at %.3f s with snapshot %d/%d/%d mg\n", (double)event->at_ns * 1e-9,
+                   event->snapshot[0], event->snapshot[1], event->snapshot[2]);
+            failures++;
+        }
+    }
+
+    double seconds = (double)elapsed * 1e-9;
+    printf("\nUART: %.1f bytes/s of event frames, %.0f bytes/s for the batched stream at 400 Hz; "
+           "I2C %.1f transactions/s, %.0f %% of the samples never leave the sensor\n",
+           (double)uart_bytes / seconds,
+           (double)ODR_HZ * 6.0 + (double)ODR_HZ / 24 * (FRAME_HEADER_SIZE + FRAME_CRC_SIZE),
+           (double)I2C_Master_Sim_stats.transactions / seconds,
+           100.0 - 100.0 * (double)sensor.stats.samples_read / (double)sensor.stats.samples_generated);
+    printf("\n%s\n", failures ? "event detection check FAILED" : "sensor and software found every event, and only those");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,330 @@
+/**
+*   \file Bench_Features.c
+*   \brief Windowed statistics of the features format (PROJ_3 Features.h).
+*
+*   Every trace (rest, machine vibration, random shocks, full-scale noise
+*   with the int16 extremes) is fed to Features_Add() in batches of 1 to
+*   32 samples, as the FIFO delivers them; every summary is framed by
+*   Frame_Encode(), decoded by FrameDecoder and compared field by field
+*   with a reference computed from the stored samples of the window: two
+*   passes, the variance from the deviations from the exact mean in
+*   128-bit integers, the crossings from a sample-by-sample dead band
+*   comparator over the whole trace. Windows from one sample to 65535
+*   (the limit of the count), tumbling and sliding. Any difference, or a
+*   summary missing or in excess, makes the benchmark fail.
+*
+*   Then the UART traffic of the features format against the batched
+*   samples (FIFO batches of 24) and the cost per sample of Features_Add()
+*   and of the summaries, in host nanoseconds and TSC cycles, best of
+*   seven trials with the firmware flags (-Og).
+*/
+#include "Features.h"
+#include "Frame.h"
+
+#include "FrameDecoder.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define READ_CYCLES() __rdtsc()
+#else
+    #define READ_CYCLES() 0ull
+#endif
+
+#define MAX_SAMPLES     400000
+#define MAX_SUMMARIES   4096
+#define TRIALS          7
+
+typedef struct {
+    const char* name;
+    uint32_t odr_hz;
+    uint16_t window_ms;
+    uint8_t panes;
+    uint16_t hysteresis_mg;
+    int trace;
+    size_t samples;
+} Case;
+
+enum { TRACE_REST, TRACE_VIBRATION, TRACE_SHOCKS, TRACE_FULL_SCALE };
+
+static const Case cases[] = {
+    { "100 Hz, 1 s tumbling",        100,  1000, 1, 16, TRACE_REST,       3000 },
+    { "100 Hz, 1 s / 4 sliding",     100,  1000, 4, 16, TRACE_SHOCKS,     3000 },
+    { "1344 Hz, 1 s tumbling",       1344, 1000, 1, 16, TRACE_VIBRATION,  40000 },
+    { "1344 Hz, 1 s / 8 sliding",    1344, 1000, 8, 16, TRACE_VIBRATION,  40000 },
+    { "400 Hz, 250 ms / 3 sliding",  400,  250,  3, 0,  TRACE_SHOCKS,     20000 },
+    { "1 Hz, 1 ms (1 sample)",       1,    1,    1, 16, TRACE_SHOCKS,     500 },
+    { "5376 Hz, 65535 samples",      5376, 13000, 1, 16, TRACE_FULL_SCALE, 3 * 65535 + 17 },
+    { "5376 Hz, 8 x 8191 sliding",   5376, 13000, 8, 200, TRACE_FULL_SCALE, 2 * 65535 },
+};
+
+static int16_t trace[MAX_SAMPLES][3];
+static FrameDecoder_Features decoded[MAX_SUMMARIES];
+static size_t decoded_count;
+
+    static double Noise(double sigma)
+    {
+        double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+        return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+
+    static int16_t Clamp(double mg)
+    {
+        long value = lrint(mg);
+        return (int16_t)(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+    }
+
+    static void Synthesize(int kind, uint32_t odr_hz, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            double t = (double)i / odr_hz;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                double gravity = axis == 2 ? 1000.0 : 0.0;
+                double mg = 0.0;
+                switch (kind)
+                {
+                    case TRACE_REST:
+                        mg = gravity + Noise(4.0);
+                        break;
+                    case TRACE_VIBRATION:
+                        mg = gravity + 300.0 * sin(2.0 * M_PI * (50.0 + 20.0 * axis) * t) + Noise(8.0);
+                        break;
+                    case TRACE_SHOCKS:
+                        mg = gravity + Noise(8.0) + (rand() % 50 == 0 ? Noise(3000.0) : 0.0);
+                        break;
+                    default:
+                        mg = (double)(int16_t)(rand() & 0xFFFF);
+                        mg = (i % 1000 == 0) ? -32768.0 : (i % 1000 == 1) ? 32767.0 : mg;
+                        break;
+                }
+                trace[i][axis] = Clamp(mg);
+            }
+        }
+    }
+
+    static void Collect(const FrameDecoder_Frame* frame, void* context)
+    {
+        if (decoded_count < MAX_SUMMARIES && FrameDecoder_ParseFeatures(frame, &decoded[decoded_count]))
+        {
+            decoded_count++;
+        }
+    }
+
+    // Device side: random batches, every summary framed and decoded
+    static void RunDevice(const Case* test, Features* features)
+    {
+        static FrameDecoder decoder;
+        uint8_t payload[FEATURES_REPORT_SIZE];
+        uint8_t frame[FRAME_MAX_SIZE];
+        uint16_t sequence = 0;
+
+        decoded_count = 0;
+        FrameDecoder_Init(&decoder, FRAME_DECODER_BATCHED, Collect, NULL);
+        Features_Configure(features, test->odr_hz, test->window_ms, test->panes, test->hysteresis_mg);
+        for (size_t start = 0; start < test->samples; )
+        {
+            size_t left = test->samples - start;
+            uint8_t batch = (uint8_t)(1 + rand() % 32);
+            batch = left < batch ? (uint8_t)left : batch;
+            for (uint8_t i = 0; i < batch; )
+            {
+                i += Features_Add(features, (const int16_t (*)[3])&trace[start + i], batch - i);
+                if (Features_IsReady(features))
+                {
+                    uint8_t length = Features_Report(features, 0x99, payload);
+                    uint16_t size = Frame_Encode(frame, FRAME_TYPE_FEATURES, sequence++, 0, payload, length);
+                    FrameDecoder_Feed(&decoder, frame, size);
+                }
+            }
+            start += batch;
+        }
+    }
+
+    // Reference: straight from the samples of each window
+    static unsigned Check(const Case* test, uint16_t pane_samples)
+    {
+        static uint8_t flips[MAX_SAMPLES][3];
+        size_t window = (size_t)test->panes * pane_samples;
+        int16_t level[3];
+        int side[3] = { 0, 0, 0 };
+        size_t next_summary = window;
+        size_t summaries = 0;
+        unsigned errors = 0;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            level[axis] = trace[0][axis];
+        }
+        for (size_t i = 0; i < test->samples; i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int x = trace[i][axis];
+                int now = x > level[axis] + test->hysteresis_mg ? 1 :
+                          x < level[axis] - test->hysteresis_mg ? -1 : side[axis];
+                flips[i][axis] = side[axis] != 0 && now != side[axis];
+                side[axis] = now;
+            }
+            if (i + 1 != next_summary)
+            {
+                continue;
+            }
+
+            // Window [i + 1 - window, i]
+            size_t first = i + 1 - window;
+            FrameDecoder_Features expected;
+            expected.samples = (uint16_t)window;
+            __int128 magnitude = 0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                __int128 sum = 0;
+                __int128 squares = 0;
+                int min = 32767, max = -32768;
+                unsigned crossings = 0;
+                for (size_t k = first; k <= i; k++)
+                {
+                    int x = trace[k][axis];
+                    sum += x;
+                    squares += (__int128)x * x;
+                    min = x < min ? x : min;
+                    max = x > max ? x : max;
+                    crossings += flips[k][axis];
+                    magnitude += x < 0 ? -x : x;
+                }
+                __int128 deviations = 0;
+                for (size_t k = first; k <= i; k++)
+                {
+                    __int128 d = (__int128)window * trace[k][axis] - sum;
+                    deviations += d * d;
+                }
+                __int128 n3 = (__int128)window * window * window;
+                expected.mean[axis] = (int16_t)floor(((double)sum + window / 2.0) / (double)window);
+                expected.variance[axis] = (uint32_t)((2 * deviations + n3) / (2 * n3));
+                uint32_t mean_square = (uint32_t)(squares / window);
+                uint32_t rms = (uint32_t)sqrt((double)mean_square);
+                while ((uint64_t)rms * rms > mean_square) rms--;
+                while ((uint64_t)(rms + 1) * (rms + 1) <= mean_square) rms++;
+                expected.rms[axis] = (uint16_t)rms;
+                expected.peak_to_peak[axis] = (uint16_t)(max - min);
+                expected.crossings[axis] = (uint16_t)crossings;
+                level[axis] = expected.mean[axis];
+            }
+            expected.sma = (uint32_t)floor(((double)magnitude + window / 2.0) / (double)window);
+
+            if (summaries >= decoded_count)
+            {
+                errors++;
+            }
+            else
+            {
+                const FrameDecoder_Features* got = &decoded[summaries];
+                int same = got->samples == expected.samples && got->sma == expected.sma;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    same = same && got->mean[axis] == expected.mean[axis] &&
+                           got->variance[axis] == expected.variance[axis] &&
+                           got->rms[axis] == expected.rms[axis] &&
+                           got->peak_to_peak[axis] == expected.peak_to_peak[axis] &&
+                           got->crossings[axis] == expected.crossings[axis];
+                }
+                if (!same && errors == 0)
+                {
+                    printf("  first mismatch, summary %zu: mean %d/%d, variance %u/%u, rms %u/%u, "
+                           "p2p %u/%u, crossings %u/%u, sma %u/%u (device/reference, x)\n", summaries,
+                           got->mean[0], expected.mean[0], got->variance[0], expected.variance[0],
+                           got->rms[0], expected.rms[0], got->peak_to_peak[0], expected.peak_to_peak[0],
+                           got->crossings[0], expected.crossings[0], got->sma, expected.sma);
+                }
+                errors += !same;
+            }
+            summaries++;
+            next_summary += pane_samples;
+        }
+        return errors + (unsigned)(decoded_count > summaries ? decoded_count - summaries : 0);
+    }
+
+    static void Traffic(void)
+    {
+        static const uint32_t odrs[] = { 100, 400, 1344, 5376 };
+        printf("\nUART bytes per second, 1 s windows\n\n");
+        printf("  ODR    samples   tumbling  8 panes   ratio\n");
+        for (size_t k = 0; k < sizeof(odrs) / sizeof(odrs[0]); k++)
+        {
+            double samples = odrs[k] / 24.0 * (FRAME_HEADER_SIZE + FRAME_CRC_SIZE + 1 + 24.0 * FRAME_SAMPLE_SIZE);
+            double summary = FRAME_HEADER_SIZE + FRAME_CRC_SIZE + FEATURES_REPORT_SIZE;
+            printf("%5u %10.0f %10.0f %8.0f %7.0fx\n", (unsigned)odrs[k], samples, summary,
+                   8 * summary, samples / summary);
+        }
+    }
+
+    static void Cost(void)
+    {
+        static Features features;
+        size_t n = 40000;
+        double ns = 0.0, cycles = 0.0;
+
+        srand(7);
+        Synthesize(TRACE_VIBRATION, 1344, n);
+        for (unsigned trial = 0; trial < TRIALS; trial++)
+        {
+            uint8_t payload[FEATURES_REPORT_SIZE];
+            struct timespec start, end;
+            Features_Configure(&features, 1344, 1000, 8, 16);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            uint64_t tsc = READ_CYCLES();
+            for (size_t s = 0; s < n; s += 24)
+            {
+                for (uint8_t i = 0; i < 24; )
+                {
+                    i += Features_Add(&features, (const int16_t (*)[3])&trace[s + i], 24 - i);
+                    if (Features_IsReady(&features))
+                    {
+                        Features_Report(&features, 0x99, payload);
+                    }
+                }
+            }
+            tsc = READ_CYCLES() - tsc;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double trial_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / n;
+            if (trial == 0 || trial_ns < ns)
+            {
+                ns = trial_ns;
+                cycles = (double)tsc / n;
+            }
+        }
+        printf("\n1344 Hz, 1 s / 8 sliding, batches of 24: %.2f ns, %.2f cycles per sample "
+               "(summaries included)\n", ns, cycles);
+    }
+
+int main(void)
+{
+    static Features features;
+    unsigned failures = 0;
+
+    printf("case                          window  summaries  result\n");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        const Case* test = &cases[c];
+        srand(1 + (unsigned)c);
+        Synthesize(test->trace, test->odr_hz, test->samples);
+        RunDevice(test, &features);
+        unsigned errors = Check(test, features.pane_samples);
+        printf("%-28s %8u %10zu  %s\n", test->name, (unsigned)(features.pane_count * features.pane_samples),
+               decoded_count, errors ? "MISMATCH" : "bit-exact");
+        failures += errors != 0;
+    }
+    printf("%s\n", failures ? "features check FAILED" : "every summary matches the reference");
+
+    Traffic();
+    Cost();
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
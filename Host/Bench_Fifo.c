@@ -0,0 +1,205 @@
+/**
+*   \file Bench_Fifo.c
+*   \brief I2C cost of per-sample reads versus FIFO batch reads.
+*
+*   Per-sample: a tick at the ODR starts a STATUS_REG read, chained to the
+*   6-byte OUT_X_L burst when ZYXDA is set. FIFO: the sensor runs in stream
+*   mode with a watermark; a slower tick polls FIFO_SRC_REG and, once WTM
+*   is set, every unread sample is read in one auto-incremented burst
+*   (up to 192 bytes). The poll period leaves half of the FIFO headroom
+*   above the watermark as margin, so no sample should be lost.
+*
+*   Each poll and each burst is one I2C transaction; "ovh B/smp" counts
+*   every byte on the bus that is not acceleration data.
+*/
+#include "I2C_Interface.h"
+#include "project.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+
+#include <stdio.h>
+
+#define LIS3DH_DEVICE_ADDRESS   0x18
+#define LIS3DH_CTRL_REG1        0x20
+#define LIS3DH_CTRL_REG4        0x23
+#define LIS3DH_CTRL_REG5        0x24
+#define LIS3DH_STATUS_REG       0x27
+#define LIS3DH_OUT_X_L          0x28
+#define LIS3DH_FIFO_CTRL_REG    0x2E
+#define LIS3DH_FIFO_SRC_REG     0x2F
+#define LIS3DH_FIFO_LENGTH      32
+
+static volatile uint8_t tick;
+static uint32_t samples;
+static uint32_t polls;
+static uint32_t bursts;
+
+static uint8_t status_reg;
+static uint8_t acceleration[6 * LIS3DH_FIFO_LENGTH];
+
+static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+static void FifoSrcRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+
+static I2C_Peripheral_Transaction status_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_STATUS_REG,
+    .register_count = 1,
+    .data = &status_reg,
+    .callback = StatusRead_Done
+};
+
+static I2C_Peripheral_Transaction fifo_src_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_FIFO_SRC_REG,
+    .register_count = 1,
+    .data = &status_reg,
+    .callback = FifoSrcRead_Done
+};
+
+static I2C_Peripheral_Transaction data_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_OUT_X_L,
+    .register_count = 6,
+    .data = acceleration,
+    .callback = DataRead_Done
+};
+
+    static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        if (error == NO_ERROR && (status_reg & 0x08))
+        {
+            data_read.register_count = 6;
+            I2C_Peripheral_Submit(&data_read);
+        }
+    }
+
+    static void FifoSrcRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        if (error == NO_ERROR && (status_reg & 0x80))
+        {
+            uint8_t count = (status_reg & 0x40) ? LIS3DH_FIFO_LENGTH : (status_reg & 0x1F);
+            data_read.register_count = 6 * count;
+            I2C_Peripheral_Submit(&data_read);
+        }
+    }
+
+    static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        if (error == NO_ERROR)
+        {
+            samples += transaction->register_count / 6;
+            bursts++;
+        }
+    }
+
+    static CY_ISR(Tick_ISR)
+    {
+        Timer_LISD3H_ReadStatusRegister();
+        tick = 1;
+    }
+
+    static void Loop(I2C_Peripheral_Transaction* poll)
+    {
+        for (;;)
+        {
+            while (!tick)
+            {
+                HostSim_WaitForEvent();
+            }
+            tick = 0;
+            if (!I2C_Peripheral_IsBusy())
+            {
+                polls++;
+                I2C_Peripheral_Submit(poll);
+            }
+        }
+    }
+
+    static int PerSample_Main(void)
+    {
+        Loop(&status_read);
+        return 0;
+    }
+
+    static int Fifo_Main(void)
+    {
+        Loop(&fifo_src_read);
+        return 0;
+    }
+
+    static void Scenario(uint32_t odr_hz, uint8_t ctrl_reg1, uint8_t watermark)
+    {
+        static LIS3DH_Model sensor;
+
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        uint64_t sample_ns = 1000000000ull / odr_hz;
+        // Per-sample: tick at the ODR; FIFO: half the headroom above the watermark
+        HostSim_config.timer_period_ns = watermark ?
+            sample_ns * ((LIS3DH_FIFO_LENGTH - watermark) / 2) : sample_ns;
+
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        I2C_Master_Sim_Attach(&sensor);
+        I2C_Peripheral_Start();
+        I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, ctrl_reg1);
+        I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG4, 0x88);
+        if (watermark)
+        {
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_FIFO_CTRL_REG,
+                                         0x80 | watermark);
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG5, 0x40);
+        }
+
+        tick = 0;
+        samples = 0;
+        polls = 0;
+        bursts = 0;
+        Timer_LISD3H_Start();
+        ISR_DataReady_StartEx(Tick_ISR);
+        CyGlobalIntEnable;
+        HostSim_stats = (HostSim_Stats){ 0 };
+        I2C_Master_Sim_stats = (I2C_Master_Sim_Stats){ 0 };
+        sensor.stats = (LIS3DH_Model_Stats){ 0 };
+
+        uint64_t duration = 1000000000ull;
+        uint64_t start = HostSim_Now();
+        uint64_t elapsed = HostSim_Run(watermark ? Fifo_Main : PerSample_Main, duration) - start;
+
+        double per_sample = samples ? 1.0 / samples : 0.0;
+        double overhead = (double)I2C_Master_Sim_stats.bytes - 6.0 * samples;
+        char name[16];
+        snprintf(name, sizeof(name), watermark ? "fifo/%u" : "sample", (unsigned)watermark);
+        printf("%5u Hz  %-8s %7u %6u %9.3f %9.3f %9.2f %9.2f %% %9.2f %%\n",
+               (unsigned)odr_hz, name, (unsigned)samples, (unsigned)sensor.stats.samples_overrun,
+               polls * per_sample, bursts * per_sample, overhead * per_sample,
+               100.0 * (double)I2C_Master_Sim_stats.bus_busy_ns / (double)elapsed,
+               100.0 * (double)HostSim_stats.cpu_idle_ns / (double)elapsed);
+    }
+
+int main(void)
+{
+    static const struct {
+        uint32_t odr_hz;
+        uint8_t ctrl_reg1;
+    } rates[] = {
+        { 100, 0x57 },
+        { 400, 0x77 },
+        { 1344, 0x97 },
+    };
+
+    printf("I2C at 400 kHz, HR mode; fifo/N = stream mode with watermark N\n\n");
+    printf("  ODR     mode     samples   lost polls/smp burst/smp ovh B/smp  bus busy   CPU idle\n");
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, 0);
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, 24);
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, 28);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,345 @@
+/**
+*   \file Bench_FlashLog.c
+*   \brief Flash wear of the ring log against a write per frame.
+*
+*   The stream of the compressed format at 50 Hz: a delta frame of 16
+*   samples (DELTA_MIN..DELTA_MAX bytes of payload) every 320 ms and a
+*   status frame every STATUS_FRAMES of them. TRACE_H hours of it go
+*   through FlashLog_Append(), with FlashLog_Poll() after every frame as
+*   in the PROJ_3 main loop, then through one Cy_Em_EEPROM_Write() per
+*   frame at the next offset of the same area (the naive log). Reported:
+*   flash rows programmed, bytes of flash erased per byte of stream, the
+*   erases of the most worn row and the years to ENDURANCE_CYCLES at that
+*   rate, and the CPU time spent in the blocking writes per hour.
+*
+*   Then the device is reset twice in the middle of a page (FlashLog_Start()
+*   again, the image kept) and the log is dumped through UART_Stream, as
+*   on a FRAME_TYPE_LOG_DUMP command. The captured FRAME_TYPE_LOG frames
+*   go through FrameDecoder like decode_stream -l: every frame must come
+*   back intact, but for the ones of the pages lost by the resets, each
+*   seen by the host as a gap in the page numbers.
+*/
+#include "FlashLog.h"
+#include "Frame.h"
+#include "UART_Stream.h"
+#include "project.h"
+
+#include "FrameDecoder.h"
+#include "HostSim.h"
+#include "UART_Debug_Sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stream of the compressed format at 50 Hz, 16 samples per frame
+#define FRAME_PERIOD_MS     320
+#define DELTA_MIN           24
+#define DELTA_MAX           70
+#define STATUS_FRAMES       3
+#define STATUS_SIZE         24
+#define TRACE_H             12
+
+// Rated erase cycles of a PSoC 5LP flash row
+#define ENDURANCE_CYCLES    100000
+
+// Frames logged around each reset of the power-cycle check
+#define CYCLE_FRAMES        150
+#define CYCLES              2
+
+typedef struct {
+    uint16_t next;              // Sequence number of the next frame expected
+    uint32_t frames;
+    uint32_t mismatches;
+} Check;
+
+static uint16_t frame_sequence;
+static uint32_t frame_count;
+static uint64_t stream_bytes;
+static uint32_t naive_offset;
+static cy_stc_eeprom_config_t naive_config;
+static cy_stc_eeprom_context_t naive_context;
+
+    // Payload of a frame, rebuilt by the check from its sequence number
+    static uint8_t Payload(uint16_t sequence, uint8_t* payload, uint8_t* type)
+    {
+        uint8_t length;
+        if (sequence % (STATUS_FRAMES + 1) == STATUS_FRAMES)
+        {
+            *type = FRAME_TYPE_STATUS;
+            length = STATUS_SIZE;
+        }
+        else
+        {
+            *type = FRAME_TYPE_DELTA;
+            length = (uint8_t)(DELTA_MIN + (sequence * 37u) % (DELTA_MAX - DELTA_MIN + 1));
+        }
+        for (uint8_t i = 0; i < length; i++)
+        {
+            payload[i] = (uint8_t)(sequence * 7u + i);
+        }
+        return length;
+    }
+
+    // Next frame of the stream, with its timestamp
+    static uint16_t NextFrame(uint8_t* frame)
+    {
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        uint8_t type;
+        uint8_t length = Payload(frame_sequence, payload, &type);
+        uint16_t size = Frame_Encode(frame, type, frame_sequence, frame_count * FRAME_PERIOD_MS * 1000u,
+                                     payload, length);
+        frame_sequence++;
+        frame_count++;
+        stream_bytes += size;
+        return size;
+    }
+
+    static void LogFrames(uint32_t frames)
+    {
+        uint8_t frame[FRAME_MAX_SIZE];
+        for (uint32_t n = 0; n < frames; n++)
+        {
+            uint16_t size = NextFrame(frame);
+            FlashLog_Append(frame, size);
+            FlashLog_Poll();
+        }
+    }
+
+    static int RingMain(void)
+    {
+        FlashLog_Start();
+        LogFrames(TRACE_H * 3600u * 1000u / FRAME_PERIOD_MS);
+        return 0;
+    }
+
+    // Every frame written on its own at the next offset, split at the end of the area
+    static int NaiveMain(void)
+    {
+        uint8_t frame[FRAME_MAX_SIZE];
+        naive_config = (cy_stc_eeprom_config_t){
+            .eepromSize = FLASH_LOG_SIZE, .wearLevelingFactor = 1u, .blockingWrite = 1u };
+        Cy_Em_EEPROM_Init(&naive_config, &naive_context);
+        naive_offset = 0;
+        for (uint32_t n = 0; n < TRACE_H * 3600u * 1000u / FRAME_PERIOD_MS; n++)
+        {
+            uint16_t size = NextFrame(frame);
+            uint16_t done = 0;
+            while (done < size)
+            {
+                uint16_t chunk = size - done;
+                if (chunk > FLASH_LOG_SIZE - naive_offset)
+                {
+                    chunk = (uint16_t)(FLASH_LOG_SIZE - naive_offset);
+                }
+                Cy_Em_EEPROM_Write(naive_offset, &frame[done], chunk, &naive_context);
+                done += chunk;
+                naive_offset = (naive_offset + chunk) % FLASH_LOG_SIZE;
+            }
+        }
+        return 0;
+    }
+
+    // Logged, then lost to a reset in the middle of a page, CYCLES times
+    static int CycleMain(void)
+    {
+        for (int cycle = 0; cycle < CYCLES; cycle++)
+        {
+            LogFrames(CYCLE_FRAMES);
+            FlashLog_Start();
+        }
+        LogFrames(CYCLE_FRAMES);
+        return 0;
+    }
+
+    static int DumpMain(void)
+    {
+        UART_Stream_Start();
+        CyGlobalIntEnable;
+        FlashLog_StartDump();
+        while (FlashLog_IsDumping() || UART_Stream_IsBusy())
+        {
+            if (FlashLog_IsDumping() && !UART_Stream_IsBusy())
+            {
+                FlashLog_DumpNext((uint32_t)(HostSim_Now() / 1000u));
+            }
+            else
+            {
+                HostSim_WaitForEvent();
+            }
+        }
+        return 0;
+    }
+
+    static void CheckFrame(const FrameDecoder_Frame* frame, void* context)
+    {
+        Check* check = context;
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        uint8_t type;
+        uint8_t length = Payload(frame->sequence, payload, &type);
+
+        check->frames++;
+        check->next = (uint16_t)(frame->sequence + 1);
+        if (frame->type != type || frame->length != length || memcmp(frame->payload, payload, length) != 0)
+        {
+            check->mismatches++;
+        }
+    }
+
+    static void ReadLog(const FrameDecoder_Frame* frame, void* context)
+    {
+        FrameDecoder_Log log;
+        if (FrameDecoder_ParseLog(frame, &log))
+        {
+            FrameDecoder_FeedLog(context, &log);
+        }
+    }
+
+    static uint32_t MostWorn(void)
+    {
+        uint32_t most = 0;
+        for (uint32_t row = 0; row < Em_EEPROM_Sim_RowCount(); row++)
+        {
+            if (Em_EEPROM_Sim_RowErases(row) > most)
+            {
+                most = Em_EEPROM_Sim_RowErases(row);
+            }
+        }
+        return most;
+    }
+
+    static uint32_t LeastWorn(void)
+    {
+        uint32_t least = UINT32_MAX;
+        for (uint32_t row = 0; row < Em_EEPROM_Sim_RowCount(); row++)
+        {
+            if (Em_EEPROM_Sim_RowErases(row) < least)
+            {
+                least = Em_EEPROM_Sim_RowErases(row);
+            }
+        }
+        return least;
+    }
+
+    // Rows programmed and wear of a run; returns the most worn row
+    static uint32_t Report(const char* name)
+    {
+        uint32_t most = MostWorn();
+        double hours = TRACE_H;
+        double years = (double)ENDURANCE_CYCLES / (most / hours) / (24.0 * 365.0);
+        printf("%-6s %9llu %8llu %7.2f %6u %6u %9.1f %8.1f s\n", name,
+               (unsigned long long)Em_EEPROM_Sim_stats.writes,
+               (unsigned long long)Em_EEPROM_Sim_stats.rows_programmed,
+               (double)Em_EEPROM_Sim_stats.rows_programmed * CY_EM_EEPROM_FLASH_SIZEOF_ROW / (double)stream_bytes,
+               (unsigned)LeastWorn(), (unsigned)most, years,
+               (double)HostSim_stats.cpu_busy_ns * 1e-9 / hours);
+        return most;
+    }
+
+int main(void)
+{
+    unsigned failures = 0;
+    uint64_t elapsed;
+    uint64_t logged_bytes;
+    FlashLog_Stats stats;
+
+    printf("%u h of the compressed stream at 50 Hz, %u bytes of log (%u pages of %u bytes, %u of frames)\n\n",
+           (unsigned)TRACE_H, (unsigned)FLASH_LOG_SIZE, (unsigned)FLASH_LOG_PAGES,
+           (unsigned)FLASH_LOG_PAGE_SIZE, (unsigned)FLASH_LOG_DATA_SIZE);
+    printf("log       writes     rows  flash/B  least   most years to %uk  CPU/h\n",
+           (unsigned)(ENDURANCE_CYCLES / 1000));
+
+    // Ring of pages
+    HostSim_Reset();
+    Em_EEPROM_Sim_Erase();
+    frame_sequence = 0;
+    frame_count = 0;
+    stream_bytes = 0;
+    HostSim_Run(RingMain, (uint64_t)TRACE_H * 3600u * 1000000000ull);
+    FlashLog_GetStats(&stats);
+    uint32_t ring_most = Report("ring");
+    uint64_t ring_rows = Em_EEPROM_Sim_stats.rows_programmed;
+    logged_bytes = stream_bytes;
+    if (stats.bytes_logged != logged_bytes || stats.bytes_lost != 0 || stats.write_errors != 0 ||
+        stats.pages_written != ring_rows)
+    {
+        printf("ring: %llu bytes logged of %llu, %u lost, %u write errors, %u pages for %llu rows\n",
+               (unsigned long long)stats.bytes_logged, (unsigned long long)logged_bytes,
+               (unsigned)stats.bytes_lost, (unsigned)stats.write_errors, (unsigned)stats.pages_written,
+               (unsigned long long)ring_rows);
+        failures++;
+    }
+    if (ring_most - LeastWorn() > 1)
+    {
+        printf("ring: uneven wear, rows erased %u to %u times\n", (unsigned)LeastWorn(), (unsigned)ring_most);
+        failures++;
+    }
+    // A page per row: the flash holds the header and the unused half row on top of the frames
+    if (ring_rows * FLASH_LOG_DATA_SIZE > logged_bytes + FLASH_LOG_DATA_SIZE)
+    {
+        printf("ring: %llu rows for %llu bytes\n", (unsigned long long)ring_rows, (unsigned long long)logged_bytes);
+        failures++;
+    }
+
+    // A write per frame
+    HostSim_Reset();
+    Em_EEPROM_Sim_Erase();
+    frame_sequence = 0;
+    frame_count = 0;
+    stream_bytes = 0;
+    HostSim_Run(NaiveMain, (uint64_t)TRACE_H * 3600u * 1000000000ull);
+    uint32_t naive_most = Report("frame");
+    printf("\nthe ring erases %.1fx fewer rows, the most worn %.1fx less\n",
+           (double)Em_EEPROM_Sim_stats.rows_programmed / (double)ring_rows, (double)naive_most / ring_most);
+    // A frame touches one or two rows, a row holds a couple of frames in the ring
+    if (Em_EEPROM_Sim_stats.rows_programmed < 2 * ring_rows)
+    {
+        printf("ring: not half the rows of a write per frame\n");
+        failures++;
+    }
+
+    // Resets in the middle of a page, then the dump
+    HostSim_Reset();
+    UART_Debug_Sim_Reset();
+    Em_EEPROM_Sim_Erase();
+    frame_sequence = 0;
+    frame_count = 0;
+    stream_bytes = 0;
+    HostSim_Run(CycleMain, 3600ull * 1000000000ull);
+    uint64_t start = HostSim_Now();
+    elapsed = HostSim_Run(DumpMain, 3600ull * 1000000000ull) - start;
+    FlashLog_GetStats(&stats);
+
+    size_t length;
+    const uint8_t* capture = UART_Debug_Sim_Capture(&length);
+    Check check = { 0 };
+    FrameDecoder decoder;
+    FrameDecoder log_decoder;
+    FrameDecoder_Init(&log_decoder, FRAME_DECODER_BATCHED, CheckFrame, &check);
+    FrameDecoder_Init(&decoder, FRAME_DECODER_BATCHED, ReadLog, &log_decoder);
+    FrameDecoder_Feed(&decoder, capture, length);
+
+    printf("\n%u resets in %u frames, dump: %u pages in %.1f s at %u baud, %llu frames back "
+           "(%llu lost), %llu pages lost, %llu CRC errors\n",
+           (unsigned)CYCLES, (unsigned)frame_count, (unsigned)stats.pages_dumped, (double)elapsed * 1e-9,
+           (unsigned)HostSim_config.uart_baud, (unsigned long long)log_decoder.stats.frames,
+           (unsigned long long)log_decoder.stats.frames_lost, (unsigned long long)log_decoder.stats.log_pages_lost,
+           (unsigned long long)log_decoder.stats.crc_errors);
+    // The newest frames all come back, the ones cut by a reset go with the page of their start
+    uint32_t lost_most = CYCLES * (FLASH_LOG_DATA_SIZE / (FRAME_HEADER_SIZE + DELTA_MIN + FRAME_CRC_SIZE) + 2);
+    if (check.mismatches != 0 || check.next != frame_sequence || log_decoder.stats.crc_errors != 0 ||
+        decoder.stats.crc_errors != 0 || log_decoder.stats.log_pages_lost != CYCLES ||
+        log_decoder.stats.sequence_gaps != CYCLES || log_decoder.stats.frames_lost > lost_most ||
+        check.frames + log_decoder.stats.frames_lost != frame_count)
+    {
+        printf("dump: %u mismatches, last frame %u of %u, %llu gaps\n", (unsigned)check.mismatches,
+               (unsigned)(check.next - 1), (unsigned)(frame_sequence - 1),
+               (unsigned long long)log_decoder.stats.sequence_gaps);
+        failures++;
+    }
+
+    printf("\n%s\n", failures ? "flash log check FAILED" : "the ring wears the flash evenly and the dump brings every logged frame back");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,178 @@
+/**
+*   \file Bench_Framing.c
+*   \brief Bridge Control Panel frames versus batched frames with CRC.
+*
+*   Line cost: bytes on the wire per sample, share of them that is
+*   acceleration data, and the highest sample rate the UART sustains at
+*   8N1. bridge is the original A0 x y z C0 frame; batched/N packs N
+*   samples in one frame (Frame.h).
+*
+*   Integrity: a stream of frames built by the firmware Frame_Encode() is
+*   decoded by FrameDecoder in random-sized chunks, then again with random
+*   bit flips on the line. Every sample carries a self-check (y = ~x,
+*   z = 3x), so samples that decode but are wrong can be counted: the
+*   bridge format delivers them silently, the batched format rejects the
+*   frame and reports the loss through the sequence numbers.
+*/
+#include "Frame.h"
+
+#include "FrameDecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_SAMPLES  240000
+#define BATCH_SAMPLES   24
+
+typedef struct {
+    uint64_t samples;
+    uint64_t wrong;
+    uint32_t next_x;
+} Check;
+
+static uint8_t stream[STREAM_SAMPLES * 8 + 4096];
+
+    static void SampleFor(uint32_t index, int16_t* xyz)
+    {
+        xyz[0] = (int16_t)(index & 0x7FFF);
+        xyz[1] = (int16_t)~xyz[0];
+        xyz[2] = (int16_t)(3 * xyz[0]);
+    }
+
+    static void CheckFrame(const FrameDecoder_Frame* frame, void* context)
+    {
+        Check* check = context;
+        const int16_t (*xyz)[3] = frame->samples;
+        for (size_t i = 0; xyz != NULL && i < frame->sample_count; i++)
+        {
+            check->samples++;
+            if (xyz[i][1] != (int16_t)~xyz[i][0] || xyz[i][2] != (int16_t)(3 * xyz[i][0]))
+            {
+                check->wrong++;
+            }
+        }
+    }
+
+    static size_t BuildBridge(void)
+    {
+        size_t length = 0;
+        for (uint32_t n = 0; n < STREAM_SAMPLES; n++)
+        {
+            int16_t xyz[3];
+            SampleFor(n, xyz);
+            stream[length++] = 0xA0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                stream[length++] = (uint8_t)(xyz[axis] >> 8);
+                stream[length++] = (uint8_t)xyz[axis];
+            }
+            stream[length++] = 0xC0;
+        }
+        return length;
+    }
+
+    static size_t BuildBatched(uint8_t samples_per_frame)
+    {
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        size_t length = 0;
+        uint16_t sequence = 0;
+        for (uint32_t n = 0; n < STREAM_SAMPLES; n += samples_per_frame)
+        {
+            payload[0] = FRAME_CONFIG(0x5, FRAME_MODE_HIGH_RESOLUTION, 0x1);
+            for (uint8_t i = 0; i < samples_per_frame; i++)
+            {
+                int16_t xyz[3];
+                SampleFor(n + i, xyz);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    payload[1 + 6 * i + 2 * axis] = (uint8_t)xyz[axis];
+                    payload[2 + 6 * i + 2 * axis] = (uint8_t)(xyz[axis] >> 8);
+                }
+            }
+            length += Frame_Encode(&stream[length], FRAME_TYPE_SAMPLES, sequence++, n * 10000u,
+                                   payload, (uint8_t)(1 + 6 * samples_per_frame));
+        }
+        return length;
+    }
+
+    static void Decode(FrameDecoder_Format format, size_t length, double bit_error_rate,
+                       const char* name)
+    {
+        FrameDecoder decoder;
+        Check check = { 0 };
+        uint64_t flips = 0;
+
+        srand(1);
+        if (bit_error_rate > 0.0)
+        {
+            for (size_t i = 0; i < length * 8; i++)
+            {
+                if ((double)rand() / RAND_MAX < bit_error_rate)
+                {
+                    stream[i / 8] ^= (uint8_t)(1u << (i % 8));
+                    flips++;
+                }
+            }
+        }
+
+        FrameDecoder_Init(&decoder, format, CheckFrame, &check);
+        for (size_t offset = 0; offset < length; )
+        {
+            size_t chunk = 1 + (size_t)rand() % 64;
+            if (chunk > length - offset)
+            {
+                chunk = length - offset;
+            }
+            FrameDecoder_Feed(&decoder, &stream[offset], chunk);
+            offset += chunk;
+        }
+
+        printf("%-11s %8.0e %6llu %8llu %7llu %7llu %6llu %9llu %8llu\n", name, bit_error_rate,
+               (unsigned long long)flips, (unsigned long long)check.samples,
+               (unsigned long long)check.wrong, (unsigned long long)decoder.stats.crc_errors,
+               (unsigned long long)decoder.stats.sequence_gaps,
+               (unsigned long long)decoder.stats.frames_lost,
+               (unsigned long long)decoder.stats.bytes_skipped);
+    }
+
+    static void LineCost(const char* name, double bytes_per_sample, double data_per_sample)
+    {
+        printf("%-11s %9.2f %10.1f %% %10.0f %10.0f\n", name, bytes_per_sample,
+               100.0 * data_per_sample / bytes_per_sample,
+               115200.0 / 10.0 / bytes_per_sample, 921600.0 / 10.0 / bytes_per_sample);
+    }
+
+int main(void)
+{
+    static const uint8_t batches[] = { 1, 8, 24, 32, FRAME_MAX_SAMPLES };
+    char name[16];
+
+    // The encoder and the decoder use independent CRC implementations
+    uint8_t check_string[] = "123456789";
+    printf("CRC-16/CCITT-FALSE(\"123456789\"): firmware %04X, decoder %04X (expected 29B1)\n\n",
+           Frame_Crc16(0xFFFF, check_string, 9), FrameDecoder_Crc16(check_string, 9));
+
+    printf("format       B/sample  data share  max Hz@115k2  max Hz@921k6\n");
+    LineCost("bridge", 8.0, 6.0);
+    for (unsigned i = 0; i < sizeof(batches); i++)
+    {
+        uint8_t n = batches[i];
+        snprintf(name, sizeof(name), "batched/%u", (unsigned)n);
+        LineCost(name, (FRAME_HEADER_SIZE + FRAME_CRC_SIZE + 1.0 + FRAME_SAMPLE_SIZE * n) / n,
+                 FRAME_SAMPLE_SIZE);
+    }
+
+    printf("\n%u samples, decoded in random chunks of 1..64 bytes\n", STREAM_SAMPLES);
+    printf("format           BER  flips  samples   wrong crc err   gaps  fr. lost  skipped\n");
+    static const double rates[] = { 0.0, 1e-5, 1e-4 };
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        Decode(FRAME_DECODER_BRIDGE, BuildBridge(), rates[i], "bridge");
+        snprintf(name, sizeof(name), "batched/%u", BATCH_SAMPLES);
+        Decode(FRAME_DECODER_BATCHED, BuildBatched(BATCH_SAMPLES), rates[i], name);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,241 @@
+/**
+*   \file Bench_I2CAsync.c
+*   \brief CPU load of blocking versus interrupt-driven sample reads.
+*
+*   For each output data rate a timer tick at the ODR triggers a
+*   STATUS_REG read followed, when ZYXDA is set, by the 6-byte OUT_X_L
+*   burst. The blocking variant uses I2C_Peripheral_ReadRegister() and
+*   I2C_Peripheral_ReadRegisterMulti(); the asynchronous variant chains
+*   the same two transactions through I2C_Peripheral_Submit(). Between
+*   ticks the CPU waits for interrupts, so the idle percentage is the
+*   share of time the main loop would have for other work.
+*
+*   A last check NAKs the address phase until the asynchronous read gives
+*   up, which leaves the bus halted after the sub-address: the next
+*   blocking read and the next asynchronous read must both go through.
+*/
+#include "I2C_Interface.h"
+#include "project.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+
+#include <stdio.h>
+
+#define LIS3DH_DEVICE_ADDRESS   0x18
+#define LIS3DH_CTRL_REG1        0x20
+#define LIS3DH_CTRL_REG4        0x23
+#define LIS3DH_STATUS_REG       0x27
+#define LIS3DH_OUT_X_L          0x28
+
+static volatile uint8_t tick;
+static uint32_t samples;
+
+static uint8_t status_reg;
+static uint8_t acceleration[6];
+
+// Results of the NAK check: asynchronous read in the window, blocking and asynchronous after
+static ErrorCode nak_async = NO_ERROR;
+static ErrorCode nak_blocking = ERROR;
+static ErrorCode nak_resumed = ERROR;
+
+static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+
+static I2C_Peripheral_Transaction status_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_STATUS_REG,
+    .register_count = 1,
+    .data = &status_reg,
+    .callback = StatusRead_Done
+};
+
+static I2C_Peripheral_Transaction data_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_OUT_X_L,
+    .register_count = 6,
+    .data = acceleration,
+    .callback = DataRead_Done
+};
+
+    static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        if (error == NO_ERROR && (status_reg & 0x08))
+        {
+            I2C_Peripheral_Submit(&data_read);
+        }
+    }
+
+    static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        if (error == NO_ERROR)
+        {
+            samples++;
+        }
+    }
+
+    static void NakRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        *(ErrorCode*)transaction->context = error;
+    }
+
+    static CY_ISR(Tick_ISR)
+    {
+        Timer_LISD3H_ReadStatusRegister();
+        tick = 1;
+    }
+
+    static int Blocking_Main(void)
+    {
+        for (;;)
+        {
+            while (!tick)
+            {
+                HostSim_WaitForEvent();
+            }
+            tick = 0;
+            if (I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_STATUS_REG,
+                                            &status_reg) == NO_ERROR &&
+                (status_reg & 0x08) &&
+                I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_OUT_X_L, 6,
+                                                 acceleration) == NO_ERROR)
+            {
+                samples++;
+            }
+        }
+        return 0;
+    }
+
+    static int Async_Main(void)
+    {
+        for (;;)
+        {
+            while (!tick)
+            {
+                HostSim_WaitForEvent();
+            }
+            tick = 0;
+            if (!I2C_Peripheral_IsBusy())
+            {
+                I2C_Peripheral_Submit(&status_read);
+            }
+        }
+        return 0;
+    }
+
+    static void Scenario(uint32_t odr_hz, uint8_t ctrl_reg1, const char* name, int (*entry)(void))
+    {
+        static LIS3DH_Model sensor;
+
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        HostSim_config.timer_period_ns = 1000000000ull / odr_hz;
+
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        I2C_Master_Sim_Attach(&sensor);
+        I2C_Peripheral_Start();
+        I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, ctrl_reg1);
+        I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG4, 0x88);
+
+        tick = 0;
+        samples = 0;
+        Timer_LISD3H_Start();
+        ISR_DataReady_StartEx(Tick_ISR);
+        CyGlobalIntEnable;
+        HostSim_stats = (HostSim_Stats){ 0 };
+        I2C_Master_Sim_stats = (I2C_Master_Sim_Stats){ 0 };
+
+        uint64_t duration = 1000000000ull;
+        uint64_t start = HostSim_Now();
+        uint64_t elapsed = HostSim_Run(entry, duration) - start;
+
+        double idle = 100.0 * (double)HostSim_stats.cpu_idle_ns / (double)elapsed;
+        double busy_us = samples ? (double)HostSim_stats.cpu_busy_ns * 1e-3 / samples : 0.0;
+        printf("%5u Hz  %-9s %8u %10.2f %% %12.1f us %10.2f %%\n",
+               (unsigned)odr_hz, name, (unsigned)samples, idle, busy_us,
+               100.0 * (double)I2C_Master_Sim_stats.bus_busy_ns / (double)elapsed);
+    }
+
+    static int Nak_Main(void)
+    {
+        static I2C_Peripheral_Transaction read = {
+            .device_address = LIS3DH_DEVICE_ADDRESS,
+            .register_address = LIS3DH_CTRL_REG1,
+            .register_count = 1,
+            .data = &status_reg,
+            .callback = NakRead_Done
+        };
+        
+        read.context = &nak_async;
+        I2C_Peripheral_Submit(&read);
+        while (I2C_Peripheral_IsBusy())
+        {
+            HostSim_WaitForEvent();
+        }
+        CyDelay(2);
+        nak_blocking = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1,
+                                                   &status_reg);
+        
+        // Same again, with the asynchronous read first on the halted bus
+        read.context = &nak_async;
+        I2C_Master_Sim_NakFor(1000000);
+        I2C_Peripheral_Submit(&read);
+        while (I2C_Peripheral_IsBusy())
+        {
+            HostSim_WaitForEvent();
+        }
+        CyDelay(2);
+        read.context = &nak_resumed;
+        I2C_Peripheral_Submit(&read);
+        while (I2C_Peripheral_IsBusy())
+        {
+            HostSim_WaitForEvent();
+        }
+        return 0;
+    }
+
+    static int NakCheck(void)
+    {
+        static LIS3DH_Model sensor;
+
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        I2C_Master_Sim_Attach(&sensor);
+        I2C_Peripheral_Start();
+        CyGlobalIntEnable;
+        I2C_Master_Sim_NakFor(1000000);
+        HostSim_Run(Nak_Main, 100000000ull);
+
+        printf("\nNAK window: async %s, blocking after %s, async after %s\n",
+               nak_async != NO_ERROR ? "gave up" : "went through",
+               nak_blocking == NO_ERROR ? "ok" : "FAILED",
+               nak_resumed == NO_ERROR ? "ok" : "FAILED");
+        return nak_async != NO_ERROR && nak_blocking == NO_ERROR && nak_resumed == NO_ERROR ? 0 : 1;
+    }
+
+int main(void)
+{
+    static const struct {
+        uint32_t odr_hz;
+        uint8_t ctrl_reg1;
+    } rates[] = {
+        { 100, 0x57 },
+        { 400, 0x77 },
+        { 1344, 0x97 },
+    };
+
+    printf("I2C at 400 kHz, HR mode, one STATUS_REG read + 6-byte burst per sample\n\n");
+    printf("  ODR     mode       samples   CPU idle   CPU/sample   bus busy\n");
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, "blocking", Blocking_Main);
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, "async", Async_Main);
+    }
+    return NakCheck();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,223 @@
+/**
+*   \file Bench_Int1.c
+*   \brief Sample reads driven by a polled flag versus the LIS3DH INT1 line.
+*
+*   flag: the original PROJ_2/PROJ_3 loop, where the timer ISR sets a flag
+*   that is never cleared and STATUS_REG is read back to back.
+*   int1: CTRL_REG3 routes data ready to INT1; DataReady_ISR (the PROJ_3
+*   routine) queues a timestamped event and the main loop reads one
+*   sample per event. int1+fifo: the FIFO watermark is routed to INT1 and
+*   each event reads the whole batch. The "stale" column counts output
+*   reads that returned a sample already read; "lost" counts samples
+*   overwritten before being read.
+*/
+#include "EventQueue.h"
+#include "I2C_Interface.h"
+#include "InterruptRoutines.h"
+#include "Timestamp.h"
+#include "project.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+#include "Pin_INT1_Sim.h"
+
+#include <stdio.h>
+
+#define LIS3DH_DEVICE_ADDRESS   0x18
+#define LIS3DH_CTRL_REG1        0x20
+#define LIS3DH_CTRL_REG3        0x22
+#define LIS3DH_CTRL_REG4        0x23
+#define LIS3DH_CTRL_REG5        0x24
+#define LIS3DH_STATUS_REG       0x27
+#define LIS3DH_OUT_X_L          0x28
+#define LIS3DH_FIFO_CTRL_REG    0x2E
+#define LIS3DH_FIFO_SRC_REG     0x2F
+#define LIS3DH_FIFO_LENGTH      32
+#define LIS3DH_FIFO_WATERMARK   24
+
+static volatile uint8_t flag;
+static volatile uint8_t reading;
+
+static uint8_t status_reg;
+static uint8_t acceleration[6 * LIS3DH_FIFO_LENGTH];
+
+static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction);
+
+static I2C_Peripheral_Transaction status_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_count = 1,
+    .data = &status_reg,
+    .callback = StatusRead_Done
+};
+
+static I2C_Peripheral_Transaction data_read = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .register_address = LIS3DH_OUT_X_L,
+    .data = acceleration,
+    .callback = DataRead_Done
+};
+
+    static void StatusRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        uint8_t count = 0;
+        if (error == NO_ERROR && transaction->register_address == LIS3DH_FIFO_SRC_REG)
+        {
+            if (status_reg & 0x80)
+            {
+                count = (status_reg & 0x40) ? LIS3DH_FIFO_LENGTH : (status_reg & 0x1F);
+            }
+        }
+        else if (error == NO_ERROR && (status_reg & 0x08))
+        {
+            count = 1;
+        }
+        if (count > 0)
+        {
+            data_read.register_count = 6 * count;
+            I2C_Peripheral_Submit(&data_read);
+        }
+        else
+        {
+            reading = 0;
+        }
+    }
+
+    static void DataRead_Done(ErrorCode error, I2C_Peripheral_Transaction* transaction)
+    {
+        reading = 0;
+    }
+
+    static CY_ISR(Flag_ISR)
+    {
+        Timer_LISD3H_ReadStatusRegister();
+        flag = 1;
+    }
+
+    static int Flag_Main(void)
+    {
+        for (;;)
+        {
+            if (flag == 1 && !I2C_Peripheral_IsBusy())
+            {
+                I2C_Peripheral_Submit(&status_read);
+            }
+        }
+        return 0;
+    }
+
+    static int Int1_Main(void)
+    {
+        EventQueue_Event event;
+        for (;;)
+        {
+            if (!reading)
+            {
+                if (EventQueue_Pop(&event) || Pin_INT1_Read())
+                {
+                    reading = 1;
+                    I2C_Peripheral_Submit(&status_read);
+                    continue;
+                }
+            }
+            HostSim_WaitForEvent();
+        }
+        return 0;
+    }
+
+    typedef enum {
+        MODE_FLAG,
+        MODE_INT1,
+        MODE_INT1_FIFO
+    } Mode;
+
+    static void Scenario(uint32_t odr_hz, uint8_t ctrl_reg1, Mode mode)
+    {
+        static const char* names[] = { "flag", "int1", "int1+fifo" };
+        static LIS3DH_Model sensor;
+
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        HostSim_config.timer_period_ns = 10000000ull;
+
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        I2C_Master_Sim_Attach(&sensor);
+        Pin_INT1_Sim_Connect(&sensor);
+        Timestamp_Start();
+        EventQueue_Reset();
+        I2C_Peripheral_Start();
+        flag = 0;
+        reading = 0;
+
+        if (mode == MODE_FLAG)
+        {
+            Timer_LISD3H_Start();
+            ISR_DataReady_StartEx(Flag_ISR);
+        }
+        else
+        {
+            ISR_DataReady_StartEx(DataReady_ISR);
+        }
+        CyGlobalIntEnable;
+
+        I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, ctrl_reg1);
+        I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG4, 0x88);
+        status_read.register_address = LIS3DH_STATUS_REG;
+        if (mode == MODE_INT1_FIFO)
+        {
+            status_read.register_address = LIS3DH_FIFO_SRC_REG;
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_FIFO_CTRL_REG,
+                                         0x80 | LIS3DH_FIFO_WATERMARK);
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG5, 0x40);
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG3, 0x04);
+        }
+        else if (mode == MODE_INT1)
+        {
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG3, 0x10);
+        }
+
+        HostSim_stats = (HostSim_Stats){ 0 };
+        I2C_Master_Sim_stats = (I2C_Master_Sim_Stats){ 0 };
+        sensor.stats = (LIS3DH_Model_Stats){ 0 };
+
+        uint64_t duration = 1000000000ull;
+        uint64_t start = HostSim_Now();
+        uint64_t elapsed = HostSim_Run(mode == MODE_FLAG ? Flag_Main : Int1_Main, duration) - start;
+
+        EventQueue_Stats queue = EventQueue_GetStats();
+        uint64_t samples = sensor.stats.samples_read;
+        printf("%5u Hz  %-10s %7llu %5llu %6llu %9.2f %8.2f %% %8.2f %% %7u %5u %5u\n",
+               (unsigned)odr_hz, names[mode], (unsigned long long)samples,
+               (unsigned long long)sensor.stats.samples_overrun,
+               (unsigned long long)sensor.stats.samples_stale,
+               samples ? (double)I2C_Master_Sim_stats.transactions / (double)samples : 0.0,
+               100.0 * (double)I2C_Master_Sim_stats.bus_busy_ns / (double)elapsed,
+               100.0 * (double)HostSim_stats.cpu_idle_ns / (double)elapsed,
+               (unsigned)queue.pushed, (unsigned)queue.dropped, (unsigned)queue.high_water);
+    }
+
+int main(void)
+{
+    static const struct {
+        uint32_t odr_hz;
+        uint8_t ctrl_reg1;
+    } rates[] = {
+        { 100, 0x57 },
+        { 400, 0x77 },
+        { 1344, 0x97 },
+    };
+
+    printf("I2C at 400 kHz, HR mode, FIFO watermark %u\n\n", LIS3DH_FIFO_WATERMARK);
+    printf("  ODR     mode       samples  lost  stale xfers/smp  bus busy  CPU idle  events  drop  high\n");
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, MODE_FLAG);
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, MODE_INT1);
+        Scenario(rates[i].odr_hz, rates[i].ctrl_reg1, MODE_INT1_FIFO);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,178 @@
+/**
+*   \file Bench_RegisterCache.c
+*   \brief I2C transactions spent on configuration with and without the
+*          register shadow of the I2C interface.
+*
+*   legacy boot x2: the original PROJ_1 sequence (read CTRL_REG1,
+*   TEMP_CFG_REG and CTRL_REG4, write each one if it differs, read it
+*   back), run twice as after a soft restart. write+verify: PROJ_1 with
+*   LIS3DH_Configure() and LIS3DH_ReadConfig(). reconfig: boot, then 100
+*   ODR switches, each followed by reapplying the same configuration.
+*   rmw: 100 LIS3DH_UpdateRegister() calls on CTRL_REG1 alternating two
+*   ODRs. Every scenario is run with the cache off, in write-through and
+*   in verify mode; "xfers" are START conditions seen on the bus.
+*
+*   The last block changes registers behind the cache (as a sensor reset
+*   would) and shows verify mode counting the stale entries, then
+*   I2C_Peripheral_CacheInvalidate() restoring coherency.
+*/
+#include "I2C_Interface.h"
+#include "LIS3DH.h"
+
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH_Model.h"
+
+#include <stdio.h>
+
+static LIS3DH_Model sensor;
+
+static const LIS3DH_Config base_config = {
+    .device_address = LIS3DH_DEVICE_ADDRESS,
+    .odr = LIS3DH_ODR_100_HZ,
+    .mode = LIS3DH_MODE_HIGH_RESOLUTION,
+    .full_scale = LIS3DH_FULL_SCALE_4G,
+    .axes = LIS3DH_AXES_XYZ,
+    .block_data_update = 1,
+    .fifo_mode = LIS3DH_FIFO_STREAM,
+    .fifo_watermark = 24,
+    .int1 = LIS3DH_INT1_WTM,
+};
+
+    // Read a register and write it only if it differs, then read it back
+    static void Legacy_Update(uint8_t register_address, uint8_t value)
+    {
+        uint8_t reg;
+        I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, register_address, &reg);
+        if (reg != value)
+        {
+            I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS, register_address, value);
+        }
+        I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, register_address, &reg);
+    }
+
+    static void Legacy_Boot(void)
+    {
+        // Same registers as the other scenarios, declared one by one
+        I2C_Peripheral_CacheRegisters(LIS3DH_DEVICE_ADDRESS, LIS3DH_TEMP_CFG_REG, 1);
+        I2C_Peripheral_CacheRegisters(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, 1);
+        I2C_Peripheral_CacheRegisters(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG4, 1);
+        for (uint8_t i = 0; i < 2; i++)
+        {
+            Legacy_Update(LIS3DH_CTRL_REG1, 0x47);
+            Legacy_Update(LIS3DH_TEMP_CFG_REG, 0xC0);
+            Legacy_Update(LIS3DH_CTRL_REG4, 0x80);
+        }
+    }
+
+    static void WriteVerify(void)
+    {
+        uint8_t registers[LIS3DH_CONFIG_REG_COUNT];
+        LIS3DH_ReadConfig(LIS3DH_DEVICE_ADDRESS, registers);
+        LIS3DH_Configure(&base_config);
+        LIS3DH_ReadConfig(LIS3DH_DEVICE_ADDRESS, registers);
+    }
+
+    static void Reconfigure(void)
+    {
+        LIS3DH_Config config = base_config;
+        LIS3DH_Configure(&config);
+        for (uint8_t i = 0; i < 100; i++)
+        {
+            config.odr = (i & 1) ? LIS3DH_ODR_100_HZ : LIS3DH_ODR_400_HZ;
+            LIS3DH_Configure(&config);
+            LIS3DH_Configure(&config);
+        }
+    }
+
+    static void ReadModifyWrite(void)
+    {
+        LIS3DH_Configure(&base_config);
+        for (uint8_t i = 0; i < 100; i++)
+        {
+            // Only every other call changes the ODR
+            uint8_t odr = (i & 2) ? LIS3DH_ODR_400_HZ : LIS3DH_ODR_100_HZ;
+            LIS3DH_UpdateRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, 0xF0,
+                                  (uint8_t)(odr << 4));
+        }
+    }
+
+    static void Setup(I2C_Peripheral_CacheMode mode)
+    {
+        HostSim_Reset();
+        I2C_Master_Sim_Reset();
+        HostSim_config.i2c_bus_khz = 400;
+        LIS3DH_Model_Init(&sensor, LIS3DH_DEVICE_ADDRESS);
+        I2C_Master_Sim_Attach(&sensor);
+        I2C_Peripheral_Start();
+        I2C_Peripheral_SetCacheMode(mode);
+    }
+
+    static void Scenario(const char* name, void (*run)(void))
+    {
+        static const char* modes[] = { "off", "write-through", "verify" };
+        uint64_t baseline = 0;
+
+        for (I2C_Peripheral_CacheMode mode = I2C_CACHE_OFF; mode <= I2C_CACHE_VERIFY; mode++)
+        {
+            Setup(mode);
+            run();
+            I2C_Peripheral_Stats stats = I2C_Peripheral_GetStats();
+            if (mode == I2C_CACHE_OFF)
+            {
+                baseline = I2C_Master_Sim_stats.transactions;
+            }
+            printf("%-14s %-13s %6llu %6llu %6.1f %% %6u %7u %6u\n", name, modes[mode],
+                   (unsigned long long)I2C_Master_Sim_stats.transactions,
+                   (unsigned long long)I2C_Master_Sim_stats.bytes,
+                   baseline ? 100.0 * (double)I2C_Master_Sim_stats.transactions / (double)baseline : 0.0,
+                   (unsigned)stats.reads_served, (unsigned)stats.writes_skipped,
+                   (unsigned)stats.verify_mismatches);
+        }
+    }
+
+    static void Coherency(void)
+    {
+        uint8_t registers[LIS3DH_CONFIG_REG_COUNT];
+
+        Setup(I2C_CACHE_WRITE_THROUGH);
+        LIS3DH_Configure(&base_config);
+
+        // CTRL_REG1 and CTRL_REG4 back to their reset values behind the cache
+        sensor.regs[LIS3DH_CTRL_REG1] = 0x07;
+        sensor.regs[LIS3DH_CTRL_REG4] = 0x00;
+
+        LIS3DH_ReadConfig(LIS3DH_DEVICE_ADDRESS, registers);
+        printf("write-through read  CTRL_REG1 0x%02X (sensor 0x%02X)\n",
+               registers[LIS3DH_CTRL_REG1 - LIS3DH_CONFIG_FIRST_REG], sensor.regs[LIS3DH_CTRL_REG1]);
+
+        I2C_Peripheral_SetCacheMode(I2C_CACHE_VERIFY);
+        LIS3DH_ReadConfig(LIS3DH_DEVICE_ADDRESS, registers);
+        printf("verify read         CTRL_REG1 0x%02X, %u stale entries found\n",
+               registers[LIS3DH_CTRL_REG1 - LIS3DH_CONFIG_FIRST_REG],
+               (unsigned)I2C_Peripheral_GetStats().verify_mismatches);
+
+        // Forget the shadow, as after a sensor reset: reapplying the configuration rewrites it
+        I2C_Peripheral_SetCacheMode(I2C_CACHE_WRITE_THROUGH);
+        I2C_Peripheral_CacheInvalidate(LIS3DH_DEVICE_ADDRESS);
+        uint64_t before = I2C_Master_Sim_stats.transactions;
+        LIS3DH_Configure(&base_config);
+        printf("after invalidate    CTRL_REG1 0x%02X, reconfigured in %llu transactions\n",
+               sensor.regs[LIS3DH_CTRL_REG1],
+               (unsigned long long)(I2C_Master_Sim_stats.transactions - before));
+    }
+
+int main(void)
+{
+    printf("I2C at 400 kHz; %% = transactions relative to the cache off\n\n");
+    printf("scenario       mode           xfers  bytes  vs off  served skipped mismatch\n");
+    Scenario("legacy boot x2", Legacy_Boot);
+    Scenario("write+verify", WriteVerify);
+    Scenario("reconfig", Reconfigure);
+    Scenario("rmw", ReadModifyWrite);
+    printf("\n");
+    Coherency();
+    return 0;
+}
+
+/* [] END OF FILE */
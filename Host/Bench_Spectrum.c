@@ -0,0 +1,346 @@
+/**
+*   \file Bench_Spectrum.c
+*   \brief Fixed-point spectrum of the spectrum format (PROJ_3 Spectrum.h).
+*
+*   Every trace (tones over gravity and noise, full scale with the int16
+*   extremes, impulse and step) is fed to Spectrum_Add() in batches of 24
+*   samples, as the FIFO delivers them, for 64, 128, 256 and 512 points.
+*   The spectrum of every window is framed by Frame_Encode() in
+*   FRAME_TYPE_SPECTRUM and FRAME_TYPE_PEAKS frames, decoded by
+*   FrameDecoder and compared with a double-precision reference: the
+*   direct DFT of the same window minus its exact mean, with the same
+*   Hann window and scaling, saturated like the device. The bins must be
+*   within 0.2 mg + 0.05 % of the largest one; every peak must be a local
+*   maximum of the reference within that tolerance, and no local maximum
+*   of the reference above 1 mg and clearly higher than the lowest peak
+*   may be missing. A window missing or in excess fails too. The largest
+*   error and the SNR of the bins against the reference are printed.
+*
+*   Then the cost of a transform (one axis: mean, window, FFT, split and
+*   magnitudes) in host nanoseconds and TSC cycles, best of seven trials
+*   with the firmware flags (-Og).
+*/
+#include "Frame.h"
+#include "Spectrum.h"
+
+#include "FrameDecoder.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define READ_CYCLES() __rdtsc()
+#else
+    #define READ_CYCLES() 0ull
+#endif
+
+#define WINDOWS         2
+#define BATCH           24
+#define TRIALS          7
+#define TRANSFORMS      200
+#define PEAK_FLOOR_MG   1.0
+
+enum { TRACE_TONES, TRACE_FULL_SCALE, TRACE_IMPULSE, TRACE_COUNT };
+
+static const char* const trace_names[TRACE_COUNT] = { "tones + noise", "full scale", "impulse + step" };
+
+static int16_t trace[WINDOWS * SPECTRUM_MAX_POINTS + BATCH][3];
+
+// What came out of the frames of the last window
+static double bins[3][SPECTRUM_MAX_POINTS / 2 + 1];
+static unsigned bins_received;
+static FrameDecoder_Peaks peaks;
+static unsigned peaks_received;
+
+    static double Noise(double sigma)
+    {
+        double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+        return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+
+    static int16_t Clamp(double mg)
+    {
+        long value = lrint(mg);
+        return (int16_t)(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+    }
+
+    static void Synthesize(int kind, unsigned points, size_t count)
+    {
+        for (size_t n = 0; n < count; n++)
+        {
+            double t = (double)n / points;
+            switch (kind)
+            {
+                case TRACE_TONES:
+                    // On-bin and off-bin tones, a small one next to gravity
+                    trace[n][0] = Clamp(300.0 * sin(2.0 * M_PI * 5.0 * t) +
+                                        40.0 * sin(2.0 * M_PI * (points / 8 + 0.3) * t + 1.0) + Noise(2.0));
+                    trace[n][1] = Clamp(500.0 + 3.0 * cos(2.0 * M_PI * (points / 4 + 0.5) * t) + Noise(1.0));
+                    trace[n][2] = Clamp(1000.0 + 120.0 * sin(2.0 * M_PI * (points / 2 - 3) * t) + Noise(2.0));
+                    break;
+                case TRACE_FULL_SCALE:
+                    trace[n][0] = (n / 4) % 2 ? 32767 : -32768;
+                    trace[n][1] = (int16_t)(rand() % 65536 - 32768);
+                    trace[n][2] = Clamp(32767.0 * sin(2.0 * M_PI * (points / 4) * t));
+                    break;
+                default:
+                    trace[n][0] = n % points == points / 3 ? 10000 : 0;
+                    trace[n][1] = 1000;
+                    trace[n][2] = n % points < points / 2 ? -200 : 800;
+                    break;
+            }
+        }
+    }
+
+    // Amplitude 4 |X[k]| / N [mg] of the window minus its mean, Hann windowed, saturated as on the device
+    static void Reference(const int16_t (*window)[3], unsigned points, int axis, double* magnitude)
+    {
+        static double v[SPECTRUM_MAX_POINTS];
+        double mean = 0.0;
+        for (unsigned n = 0; n < points; n++)
+        {
+            mean += window[n][axis];
+        }
+        mean /= points;
+        for (unsigned n = 0; n < points; n++)
+        {
+            v[n] = (window[n][axis] - mean) * 0.5 * (1.0 - cos(2.0 * M_PI * n / points));
+        }
+        for (unsigned k = 0; k <= points / 2; k++)
+        {
+            double re = 0.0, im = 0.0;
+            for (unsigned n = 0; n < points; n++)
+            {
+                double angle = 2.0 * M_PI * (double)((k * n) % points) / points;
+                re += v[n] * cos(angle);
+                im -= v[n] * sin(angle);
+            }
+            double amplitude = 4.0 * sqrt(re * re + im * im) / points;
+            magnitude[k] = fmin(amplitude, 65535.0 / SPECTRUM_MAGNITUDE_SCALE);
+        }
+    }
+
+    static void Collect(const FrameDecoder_Frame* frame, void* context)
+    {
+        (void)context;
+        FrameDecoder_Spectrum spectrum;
+        if (FrameDecoder_ParseSpectrum(frame, &spectrum))
+        {
+            for (unsigned i = 0; i < spectrum.count; i++)
+            {
+                bins[spectrum.axis][spectrum.first_bin + i] =
+                    (double)spectrum.magnitude[i] / FRAME_DECODER_MAGNITUDE_SCALE;
+                bins_received++;
+            }
+        }
+        if (FrameDecoder_ParsePeaks(frame, &peaks))
+        {
+            peaks_received++;
+        }
+    }
+
+    // Every frame of the spectrum just computed through the encoder and the decoder
+    static void SendFrames(const Spectrum* spectrum, FrameDecoder* decoder, uint16_t* sequence)
+    {
+        uint8_t payload[255];
+        uint8_t frame[FRAME_HEADER_SIZE + 255 + FRAME_CRC_SIZE];
+        uint8_t length;
+        uint16_t size;
+
+        bins_received = 0;
+        peaks_received = 0;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            for (uint16_t first = 1; first <= spectrum->points / 2; first += SPECTRUM_BINS_PER_FRAME)
+            {
+                length = Spectrum_ReportBins(spectrum, 0x99, axis, first, payload);
+                size = Frame_Encode(frame, FRAME_TYPE_SPECTRUM, (*sequence)++, 0, payload, length);
+                FrameDecoder_Feed(decoder, frame, size);
+            }
+        }
+        length = Spectrum_ReportPeaks(spectrum, 0x99, SPECTRUM_PEAKS, payload);
+        size = Frame_Encode(frame, FRAME_TYPE_PEAKS, (*sequence)++, 0, payload, length);
+        FrameDecoder_Feed(decoder, frame, size);
+    }
+
+    /*
+    * Peaks of an axis against the reference, within the tolerance of the bins:
+    * every peak sent is a local maximum of the reference, and every local
+    * maximum of the reference above PEAK_FLOOR_MG that beats the lowest peak
+    * sent is among them, or another bin of its plateau
+    */
+    static unsigned CheckPeaks(const double* reference, unsigned points, int axis, double tolerance)
+    {
+        unsigned errors = 0;
+        double lowest = 0.0;
+        for (unsigned i = 0; i < peaks.count; i++)
+        {
+            unsigned k = peaks.bin[axis][i];
+            if (k == 0)
+            {
+                break;
+            }
+            errors += reference[k] + tolerance < reference[k - 1] ||
+                      (k < points / 2 && reference[k] + tolerance < reference[k + 1]);
+            lowest = i + 1 == peaks.count ? (double)peaks.magnitude[axis][i] / FRAME_DECODER_MAGNITUDE_SCALE : 0.0;
+        }
+        for (unsigned k = 1; k <= points / 2; k++)
+        {
+            if (reference[k] < PEAK_FLOOR_MG || reference[k] <= reference[k - 1] ||
+                (k < points / 2 && reference[k] < reference[k + 1]) || reference[k] <= lowest + tolerance)
+            {
+                continue;
+            }
+            // Any peak sent on the plateau of the maximum will do: ties go either way
+            unsigned low = k, high = k, found = 0;
+            while (low > 1 && reference[low - 1] + tolerance >= reference[k])
+            {
+                low--;
+            }
+            while (high < points / 2 && reference[high + 1] + tolerance >= reference[k])
+            {
+                high++;
+            }
+            for (unsigned i = 0; i < peaks.count; i++)
+            {
+                found |= peaks.bin[axis][i] >= low && peaks.bin[axis][i] <= high;
+            }
+            errors += !found;
+        }
+        return errors;
+    }
+
+    // Errors of one trace at one size; worst bin error and error energy accumulated for the summary
+    static unsigned RunCase(int kind, unsigned points, double* worst, double* signal, double* noise)
+    {
+        static Spectrum spectrum;
+        static FrameDecoder decoder;
+        static double reference[SPECTRUM_MAX_POINTS / 2 + 1];
+        uint16_t sequence = 0;
+        unsigned windows = 0, errors = 0;
+        size_t count = WINDOWS * points + BATCH / 2;
+
+        Synthesize(kind, points, count);
+        Spectrum_Configure(&spectrum, (uint16_t)points);
+        FrameDecoder_Init(&decoder, FRAME_DECODER_BATCHED, Collect, NULL);
+        for (size_t s = 0; s < count; s += BATCH)
+        {
+            uint8_t batch = (uint8_t)(count - s < BATCH ? count - s : BATCH);
+            for (uint8_t i = 0; i < batch; )
+            {
+                i += Spectrum_Add(&spectrum, (const int16_t (*)[3])&trace[s + i], batch - i);
+                if (!Spectrum_IsReady(&spectrum))
+                {
+                    continue;
+                }
+                Spectrum_Compute(&spectrum);
+                SendFrames(&spectrum, &decoder, &sequence);
+                errors += bins_received != 3 * points / 2 || peaks_received != 1 ||
+                          peaks.points != points || peaks.count != SPECTRUM_PEAKS;
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    Reference((const int16_t (*)[3])&trace[windows * points], points, axis, reference);
+                    double largest = 0.0;
+                    for (unsigned k = 1; k <= points / 2; k++)
+                    {
+                        largest = fmax(largest, reference[k]);
+                    }
+                    double tolerance = 0.2 + 5e-4 * largest;
+                    for (unsigned k = 1; k <= points / 2; k++)
+                    {
+                        double error = fabs(bins[axis][k] - reference[k]);
+                        *worst = fmax(*worst, error);
+                        *signal += reference[k] * reference[k];
+                        *noise += error * error;
+                        if (error > tolerance)
+                        {
+                            if (errors == 0)
+                            {
+                                printf("  first mismatch, window %u axis %d bin %u: %.4f mg, reference %.4f mg\n",
+                                       windows, axis, k, bins[axis][k], reference[k]);
+                            }
+                            errors++;
+                        }
+                    }
+                    unsigned wrong = CheckPeaks(reference, points, axis, tolerance);
+                    if (wrong > 0 && errors == 0)
+                    {
+                        printf("  peaks differ, window %u axis %d: first bin %u\n",
+                               windows, axis, (unsigned)peaks.bin[axis][0]);
+                    }
+                    errors += wrong;
+                }
+                windows++;
+            }
+        }
+        return errors + (windows != WINDOWS);
+    }
+
+    static void Cost(void)
+    {
+        static Spectrum spectrum;
+        printf("\npoints   ns/transform   cycles/transform   cycles/point\n");
+        for (unsigned points = SPECTRUM_MIN_POINTS; points <= SPECTRUM_MAX_POINTS; points *= 2)
+        {
+            double ns = 0.0, cycles = 0.0;
+            srand(7);
+            Synthesize(TRACE_TONES, points, points);
+            Spectrum_Configure(&spectrum, (uint16_t)points);
+            for (uint16_t i = 0; i < points; i += BATCH)
+            {
+                uint16_t batch = points - i < BATCH ? points - i : BATCH;
+                Spectrum_Add(&spectrum, (const int16_t (*)[3])&trace[i], (uint8_t)batch);
+            }
+            for (unsigned trial = 0; trial < TRIALS; trial++)
+            {
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                uint64_t tsc = READ_CYCLES();
+                for (unsigned t = 0; t < TRANSFORMS; t++)
+                {
+                    // Three axes per call
+                    Spectrum_Compute(&spectrum);
+                }
+                tsc = READ_CYCLES() - tsc;
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                double trial_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+                                  (3.0 * TRANSFORMS);
+                if (trial == 0 || trial_ns < ns)
+                {
+                    ns = trial_ns;
+                    cycles = (double)tsc / (3.0 * TRANSFORMS);
+                }
+            }
+            printf("%6u %14.0f %18.0f %14.1f\n", points, ns, cycles, cycles / points);
+        }
+    }
+
+int main(void)
+{
+    unsigned failures = 0;
+
+    printf("trace            points  max error [mg]  SNR [dB]  result\n");
+    for (int kind = 0; kind < TRACE_COUNT; kind++)
+    {
+        for (unsigned points = SPECTRUM_MIN_POINTS; points <= SPECTRUM_MAX_POINTS; points *= 2)
+        {
+            double worst = 0.0, signal = 0.0, noise = 0.0;
+            srand(1 + kind * 16 + points);
+            unsigned errors = RunCase(kind, points, &worst, &signal, &noise);
+            printf("%-16s %6u %15.4f %9.1f  %s\n", trace_names[kind], points, worst,
+                   noise > 0.0 ? 10.0 * log10(signal / noise) : INFINITY, errors ? "MISMATCH" : "ok");
+            failures += errors != 0;
+        }
+    }
+    printf("%s\n", failures ? "spectrum check FAILED" : "every window matches the double-precision reference");
+
+    Cost();
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,127 @@
+/**
+*   \file Bench_UartDma.c
+*   \brief CPU cost and throughput of UART_Debug_PutArray() versus the
+*   DMA ping-pong stream.
+*
+*   A timer tick at the frame rate asks the main loop for one 8-byte
+*   A0..C0 frame, which is sent either with UART_Debug_PutArray() or
+*   with UART_Stream_Write(). Between ticks the CPU waits for interrupts.
+*   Rates above the line capacity show how each path degrades: PutArray
+*   stalls the loop (ticks are missed), the stream drops whole frames.
+*   Frames and line usage count the bytes on the wire by the end of the
+*   second, not those still waiting in the UART buffers.
+*/
+#include "UART_Stream.h"
+#include "project.h"
+
+#include "HostSim.h"
+#include "UART_Debug_Sim.h"
+
+#include <stdio.h>
+
+#define FRAME_LENGTH 8
+
+static volatile uint8_t tick;
+static uint32_t frames;
+static uint8_t frame[FRAME_LENGTH] = { 0xA0, 1, 2, 3, 4, 5, 6, 0xC0 };
+
+    static CY_ISR(Tick_ISR)
+    {
+        Timer_LISD3H_ReadStatusRegister();
+        tick = 1;
+    }
+
+    static void WaitTick(void)
+    {
+        while (!tick)
+        {
+            HostSim_WaitForEvent();
+        }
+        tick = 0;
+        frames++;
+    }
+
+    static int PutArray_Main(void)
+    {
+        for (;;)
+        {
+            WaitTick();
+            UART_Debug_PutArray(frame, FRAME_LENGTH);
+        }
+        return 0;
+    }
+
+    static int Stream_Main(void)
+    {
+        for (;;)
+        {
+            WaitTick();
+            UART_Stream_Write(frame, FRAME_LENGTH);
+        }
+        return 0;
+    }
+
+    static void Scenario(uint32_t rate_hz, uint32_t baud, const char* name, int (*entry)(void))
+    {
+        HostSim_Reset();
+        UART_Debug_Sim_Reset();
+        HostSim_config.uart_baud = baud;
+        HostSim_config.timer_period_ns = 1000000000ull / rate_hz;
+
+        UART_Stream_Start();
+        tick = 0;
+        frames = 0;
+        Timer_LISD3H_Start();
+        ISR_DataReady_StartEx(Tick_ISR);
+        CyGlobalIntEnable;
+        HostSim_stats = (HostSim_Stats){ 0 };
+
+        uint64_t duration = 1000000000ull;
+        uint64_t start = HostSim_Now();
+        uint64_t end = HostSim_Run(entry, duration);
+        uint64_t elapsed = end - start;
+
+        // Only bytes whose stop bit is out by the end: the rest still waits in the UART
+        uint64_t byte_ns = UART_Debug_Sim_ByteNs();
+        uint64_t idle_at = UART_Debug_Sim_IdleAt();
+        uint64_t queued = idle_at > end ? (idle_at - end + byte_ns - 1) / byte_ns : 0;
+        uint64_t on_wire = UART_Debug_Sim_stats.bytes - queued;
+
+        uint32_t sent = (uint32_t)(on_wire / FRAME_LENGTH);
+        uint32_t missed = rate_hz > frames ? rate_hz - frames : 0;
+        uint32_t dropped = entry == Stream_Main ? UART_Stream_GetDropCount() : 0;
+        double idle = 100.0 * (double)HostSim_stats.cpu_idle_ns / (double)elapsed;
+        double busy_us = frames ? (double)HostSim_stats.cpu_busy_ns * 1e-3 / frames : 0.0;
+        double line = 100.0 * (double)on_wire * byte_ns / (double)elapsed;
+        printf("%6u %5u Hz  %-9s %7u %7u %7u %9.2f %% %9.1f us %8.2f %%\n",
+               (unsigned)baud, (unsigned)rate_hz, name, (unsigned)sent, (unsigned)missed,
+               (unsigned)dropped, idle, busy_us, line);
+    }
+
+int main(void)
+{
+    static const struct {
+        uint32_t baud;
+        uint32_t rate_hz;
+    } cases[] = {
+        { 115200, 100 },
+        { 115200, 400 },
+        { 115200, 1344 },
+        { 115200, 2000 },
+        { 921600, 1344 },
+        { 921600, 5000 },
+    };
+
+    HostSim_Reset();
+    printf("8-byte frames for one simulated second, UART_Debug software buffer %u bytes\n\n",
+           (unsigned)HostSim_config.uart_tx_buffer_size);
+    printf("  baud  rate     path         sent  missed dropped  CPU idle  CPU/frame     line\n");
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        Scenario(cases[i].rate_hz, cases[i].baud, "putarray", PutArray_Main);
+        Scenario(cases[i].rate_hz, cases[i].baud, "dma", Stream_Main);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
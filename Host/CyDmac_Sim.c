@@ -0,0 +1,176 @@
+/**
+*   \file CyDmac_Sim.c
+*   \brief Simulated DMA controller, DMA_UART_TX channel and ISR_DMA_TX.
+*
+*   A transaction descriptor whose destination is the UART_Debug TX data
+*   register is drained into the simulated UART at the line rate; the
+*   descriptor completes once its last byte has entered the hardware FIFO.
+*   Completion raises ISR_DMA_TX when the TD has its termination output
+*   enabled, then the channel follows the TD chain.
+*/
+#include "CyDmac.h"
+#include "DMA_UART_TX_dma.h"
+#include "ISR_DMA_TX.h"
+#include "UART_Debug.h"
+#include "UART_Debug_Sim.h"
+#include "HostSim.h"
+
+#include <stddef.h>
+
+#define CYDMAC_SIM_TD_COUNT 8
+
+typedef struct {
+    uint8_t allocated;
+    uint16_t count;
+    uint8_t next;
+    uint8_t configuration;
+    uint16_t source;
+    uint16_t destination;
+} CyDmac_Sim_Td;
+
+static CyDmac_Sim_Td tds[CYDMAC_SIM_TD_COUNT];
+static uint16_t upper_source;
+static uint16_t upper_destination;
+static uint8_t initial_td = CY_DMA_INVALID_TD;
+static uint8_t active_td = CY_DMA_INVALID_TD;
+static HostSim_Event done_event;
+static cyisraddress dma_tx_isr;
+
+    static void StartTd(uint8_t td)
+    {
+        CyDmac_Sim_Td* descriptor = &tds[td];
+        uint8_t* source = (uint8_t*)(uintptr_t)(((uint32_t)upper_source << 16) | descriptor->source);
+        uint8_t* destination = (uint8_t*)(uintptr_t)(((uint32_t)upper_destination << 16) |
+                                                     descriptor->destination);
+        uint64_t done = HostSim_Now();
+
+        if (destination == UART_Debug_TXDATA_PTR)
+        {
+            done = UART_Debug_Sim_DmaWrite(source, descriptor->count);
+        }
+        active_td = td;
+        HostSim_Arm(&done_event, done);
+    }
+
+    static void TdDone(HostSim_Event* event)
+    {
+        CyDmac_Sim_Td* descriptor = &tds[active_td];
+        uint8_t next = descriptor->next;
+
+        active_td = CY_DMA_INVALID_TD;
+        if ((descriptor->configuration & DMA_UART_TX__TD_TERMOUT_EN) && dma_tx_isr != NULL)
+        {
+            dma_tx_isr();
+        }
+        if (active_td == CY_DMA_INVALID_TD && next < CYDMAC_SIM_TD_COUNT)
+        {
+            StartTd(next);
+        }
+    }
+
+    uint8 DMA_UART_TX_DmaInitialize(uint8 BurstCount, uint8 ReqestPerBurst,
+                                    uint16 UpperSrcAddress, uint16 UpperDestAddress)
+    {
+        upper_source = UpperSrcAddress;
+        upper_destination = UpperDestAddress;
+        for (uint8_t i = 0; i < CYDMAC_SIM_TD_COUNT; i++)
+        {
+            tds[i].allocated = 0;
+        }
+        initial_td = CY_DMA_INVALID_TD;
+        active_td = CY_DMA_INVALID_TD;
+        done_event.fire = TdDone;
+        done_event.is_irq = 1;
+        HostSim_Register(&done_event);
+        HostSim_Disarm(&done_event);
+        return 0;
+    }
+
+    void DMA_UART_TX_DmaRelease(void)
+    {
+        CyDmaChDisable(0);
+    }
+
+    uint8 CyDmaTdAllocate(void)
+    {
+        for (uint8_t i = 0; i < CYDMAC_SIM_TD_COUNT; i++)
+        {
+            if (!tds[i].allocated)
+            {
+                tds[i] = (CyDmac_Sim_Td){ .allocated = 1, .next = CY_DMA_DISABLE_TD };
+                return i;
+            }
+        }
+        return CY_DMA_INVALID_TD;
+    }
+
+    void CyDmaTdFree(uint8 tdHandle)
+    {
+        if (tdHandle < CYDMAC_SIM_TD_COUNT)
+        {
+            tds[tdHandle].allocated = 0;
+        }
+    }
+
+    cystatus CyDmaTdSetConfiguration(uint8 tdHandle, uint16 transferCount, uint8 nextTd,
+                                     uint8 configuration)
+    {
+        if (tdHandle >= CYDMAC_SIM_TD_COUNT)
+        {
+            return CYRET_BAD_PARAM;
+        }
+        tds[tdHandle].count = transferCount;
+        tds[tdHandle].next = nextTd;
+        tds[tdHandle].configuration = configuration;
+        return CYRET_SUCCESS;
+    }
+
+    cystatus CyDmaTdSetAddress(uint8 tdHandle, uint16 source, uint16 destination)
+    {
+        if (tdHandle >= CYDMAC_SIM_TD_COUNT)
+        {
+            return CYRET_BAD_PARAM;
+        }
+        tds[tdHandle].source = source;
+        tds[tdHandle].destination = destination;
+        return CYRET_SUCCESS;
+    }
+
+    cystatus CyDmaChSetInitialTd(uint8 chHandle, uint8 startTd)
+    {
+        initial_td = startTd;
+        return CYRET_SUCCESS;
+    }
+
+    cystatus CyDmaChEnable(uint8 chHandle, uint8 preserveTds)
+    {
+        if (initial_td >= CYDMAC_SIM_TD_COUNT)
+        {
+            return CYRET_BAD_PARAM;
+        }
+        if (active_td == CY_DMA_INVALID_TD)
+        {
+            StartTd(initial_td);
+        }
+        return CYRET_SUCCESS;
+    }
+
+    cystatus CyDmaChDisable(uint8 chHandle)
+    {
+        // Bytes already handed to the UART are not taken back
+        active_td = CY_DMA_INVALID_TD;
+        HostSim_Disarm(&done_event);
+        return CYRET_SUCCESS;
+    }
+
+    void ISR_DMA_TX_StartEx(cyisraddress address)
+    {
+        dma_tx_isr = address;
+    }
+
+    void ISR_DMA_TX_Stop(void)
+    {
+        dma_tx_isr = NULL;
+    }
+
+/* [] END OF FILE */
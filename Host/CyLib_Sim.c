@@ -0,0 +1,188 @@
+/**
+*   \file CyLib_Sim.c
+*   \brief Host implementation of the CyLib functions used by the firmware.
+*
+*   SysTick is a periodic interrupt event; its counter value is derived
+*   from the simulated clock at BCLK__BUS_CLK__HZ, and so is the DWT
+*   cycle counter. Both freeze while the bus clock is stopped (Sleep).
+*/
+#include "CyLib.h"
+
+#define CYLIB_SIM_NS_PER_S 1000000000ull
+
+static HostSim_Event systick_event;
+static uint32 systick_reload;
+static uint64_t systick_reload_at;
+static cyisraddress systick_callbacks[CY_SYS_SYST_NUM_OF_CALLBACKS];
+static SCB_Type scb;
+static DWT_Type dwt;
+static CoreDebug_Type core_debug;
+// Bus clock stopped since clocks_stopped_at, and for how long in all before
+static uint8_t clocks_stopped;
+static uint64_t clocks_stopped_at;
+static uint64_t clocks_stopped_ns;
+// SysTick interrupt due when the clock stopped, and how far away it was
+static uint8_t systick_frozen;
+static uint64_t systick_left_ns;
+// DWT->CYCCNT as of the last access and the bus clock cycle it was taken at
+static uint32_t dwt_reported;
+static uint64_t dwt_last_cycles;
+
+    uint8 CyEnterCriticalSection(void)
+    {
+        uint8 saved = HostSim_GetGlobalInterrupts();
+        HostSim_SetGlobalInterrupts(0u);
+        return saved;
+    }
+
+    void CyExitCriticalSection(uint8 savedIntrStatus)
+    {
+        HostSim_SetGlobalInterrupts(savedIntrStatus);
+    }
+
+    void CyDelay(uint32 milliseconds)
+    {
+        HostSim_Busy((uint64_t)milliseconds * 1000000ull);
+    }
+
+    void CyDelayUs(uint16 microseconds)
+    {
+        HostSim_Busy((uint64_t)microseconds * 1000ull);
+    }
+
+    // Simulated time as seen by the bus clock [ns]
+    static uint64_t BusClockNs(void)
+    {
+        return (clocks_stopped ? clocks_stopped_at : HostSim_Now()) - clocks_stopped_ns;
+    }
+
+    static uint64_t SysTickPeriodNs(void)
+    {
+        return ((uint64_t)systick_reload + 1u) * CYLIB_SIM_NS_PER_S / BCLK__BUS_CLK__HZ;
+    }
+
+    static void SysTickInterrupt(HostSim_Event* event)
+    {
+        systick_reload_at = event->at - clocks_stopped_ns;
+        HostSim_Arm(event, event->at + SysTickPeriodNs());
+        for (uint32 i = 0; i < CY_SYS_SYST_NUM_OF_CALLBACKS; i++)
+        {
+            if (systick_callbacks[i] != NULL)
+            {
+                systick_callbacks[i]();
+            }
+        }
+    }
+
+    void CySysTickStart(void)
+    {
+        systick_reload = BCLK__BUS_CLK__HZ / 1000u - 1u;
+        systick_event.fire = SysTickInterrupt;
+        systick_event.is_irq = 1;
+        HostSim_Register(&systick_event);
+        systick_reload_at = BusClockNs();
+        HostSim_Arm(&systick_event, HostSim_Now() + SysTickPeriodNs());
+    }
+
+    void CySysTickStop(void)
+    {
+        HostSim_Disarm(&systick_event);
+    }
+
+    void CySysTickSetReload(uint32 value)
+    {
+        systick_reload = value & 0x00FFFFFFu;
+    }
+
+    uint32 CySysTickGetReload(void)
+    {
+        return systick_reload;
+    }
+
+    uint32 CySysTickGetValue(void)
+    {
+        if (!systick_event.armed && !systick_frozen)
+        {
+            return 0;
+        }
+        // The counter keeps running (and reloading) while the interrupt is pending
+        uint64_t cycles = (BusClockNs() - systick_reload_at) * BCLK__BUS_CLK__HZ / CYLIB_SIM_NS_PER_S;
+        return systick_reload - (uint32)(cycles % ((uint64_t)systick_reload + 1u));
+    }
+
+    cyisraddress CySysTickSetCallback(uint32 number, cyisraddress function)
+    {
+        cyisraddress previous = systick_callbacks[number];
+        systick_callbacks[number] = function;
+        return previous;
+    }
+
+    cyisraddress CySysTickGetCallback(uint32 number)
+    {
+        return systick_callbacks[number];
+    }
+
+    SCB_Type* CyLib_Sim_Scb(void)
+    {
+        scb.ICSR = 0;
+        if (systick_event.armed && systick_event.at <= HostSim_Now())
+        {
+            scb.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+        }
+        return &scb;
+    }
+
+    DWT_Type* CyLib_Sim_Dwt(void)
+    {
+        uint64_t cycles = BusClockNs() * BCLK__BUS_CLK__HZ / CYLIB_SIM_NS_PER_S;
+        uint32_t count = dwt.CYCCNT;
+        // Counting, unless the firmware has written a new value since the last
+        // access (or the simulator clock has been reset)
+        if ((core_debug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) &&
+            count == dwt_reported && cycles >= dwt_last_cycles)
+        {
+            count += (uint32_t)(cycles - dwt_last_cycles);
+        }
+        dwt.CYCCNT = count;
+        dwt_reported = count;
+        dwt_last_cycles = cycles;
+        return &dwt;
+    }
+
+    void CyLib_Sim_StopClocks(void)
+    {
+        if (clocks_stopped)
+        {
+            return;
+        }
+        clocks_stopped = 1;
+        clocks_stopped_at = HostSim_Now();
+        systick_frozen = systick_event.armed;
+        if (systick_frozen)
+        {
+            systick_left_ns = systick_event.at > clocks_stopped_at ? systick_event.at - clocks_stopped_at : 0;
+            HostSim_Disarm(&systick_event);
+        }
+    }
+
+    void CyLib_Sim_StartClocks(void)
+    {
+        if (!clocks_stopped)
+        {
+            return;
+        }
+        clocks_stopped = 0;
+        clocks_stopped_ns += HostSim_Now() - clocks_stopped_at;
+        if (systick_frozen)
+        {
+            systick_frozen = 0;
+            HostSim_Arm(&systick_event, HostSim_Now() + systick_left_ns);
+        }
+    }
+
+    CoreDebug_Type* CyLib_Sim_CoreDebug(void)
+    {
+        return &core_debug;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,54 @@
+/**
+*   \file CyPm_Sim.c
+*   \brief Host implementation of the power management API (see Stubs/cyPm.h).
+*/
+#include "cyPm.h"
+#include "CyLib.h"
+#include "HostSim.h"
+
+#define CYPM_SIM_NS_PER_MS 1000000ull
+
+CyPm_Sim_Stats CyPm_Sim_stats;
+
+    void CyPmSaveClocks(void)
+    {
+    }
+
+    void CyPmRestoreClocks(void)
+    {
+        // The CPU runs from the IMO while it waits for the PLL to lock
+        HostSim_Busy(HostSim_config.clock_restore_ns);
+    }
+
+    void CyPmAltAct(uint16 wakeupTime, uint16 wakeupSource)
+    {
+        (void)wakeupTime;
+        (void)wakeupSource;
+        CyPm_Sim_stats.alt_active_entries++;
+        HostSim_WaitForEvent();
+        HostSim_Idle(HostSim_config.alt_active_wakeup_ns);
+    }
+
+    void CyPmSleep(uint8 wakeupTime, uint16 wakeupSource)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        uint64_t start = HostSim_Now();
+        CyPm_Sim_stats.sleep_entries++;
+
+        CyLib_Sim_StopClocks();
+        if ((wakeupSource & PM_SLEEP_SRC_CTW) && wakeupTime != PM_SLEEP_TIME_NONE)
+        {
+            HostSim_Idle((CYPM_SIM_NS_PER_MS << wakeupTime) + HostSim_config.sleep_wakeup_ns);
+        }
+        else
+        {
+            // No wake-up source the simulator models: the device would sleep for ever
+            HostSim_Idle(UINT64_MAX - HostSim_Now());
+        }
+        CyLib_Sim_StartClocks();
+
+        CyPm_Sim_stats.sleep_ns += HostSim_Now() - start;
+        CyExitCriticalSection(interrupts);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,376 @@
+/**
+*   \file DecodeStream.c
+*   \brief Decodes a captured PROJ_3 UART stream to CSV.
+*
+*   Reads the bytes written by host_proj3 -o (or logged from the board)
+*   and prints one line per sample: sequence number, timestamp [us], x,
+*   y, z [mg]. Decoder counters go to stderr, with the device counters
+*   of the last status frame.
+*
+*   With -g the gaps of the timeline are marked with comment lines
+*   ('#') right before the first sample after them: frames missing from
+*   the sequence numbering and samples the device reports as lost in the
+*   sensor (status frames, see StatusReport.h in PROJ_3). Changes of the
+*   on-device filtering (filter frames, see Filter.h in PROJ_3) are marked
+*   the same way: the samples after them come at ODR / decimation.
+*
+*   With -f the statistics frames of the features format (Features.h in
+*   PROJ_3) are printed instead, one line per window: sequence number,
+*   timestamp, samples in the window, mean, variance, RMS, peak-to-peak
+*   and crossings of x, y and z, signal magnitude area.
+*
+*   With -s the frames of the spectrum format (Spectrum.h in PROJ_3) are
+*   printed instead, one line per bin or peak: sequence number,
+*   timestamp, axis (0 x, 1 y, 2 z), frequency [Hz], amplitude [mg].
+*
+*   With -e the events are printed instead, one line per event: source,
+*   sequence number, timestamp, kind (click, free_fall), axes (x, y, z,
+*   '-' for a click towards the negative side), snapshot x, y, z [mg].
+*   Event frames of the events format (Events.h in PROJ_3) come from the
+*   "device"; the samples frames of the other formats go through the
+*   software detector of EventDetector.h with the PROJ_3 defaults, at
+*   ODR / decimation, and its events come from "software", stamped with
+*   the time of the sample that completed them (no snapshot). Capturing
+*   the same motion in both formats checks the sensor against the samples;
+*   taps only survive the filter chain of the batched format with the
+*   low-pass and the decimation off.
+*
+*   With -d every line starts with the device ID of the sensor it comes
+*   from (device frames, see BusManager.h in PROJ_3), empty while a
+*   sequence gap leaves it unknown.
+*
+*   With -l the frames kept in the ring log of the device (FlashLog.h in
+*   PROJ_3) are decoded instead of the live ones: the log pages sent back
+*   on a dump command are put together again and their frames go through
+*   the options above. Decoder counters are those of the logged frames.
+*
+*   Usage: decode_stream [-b] [-g] [-f] [-s] [-e] [-d] [-l] [capture]   (-b: bridge A0..C0 stream)
+*/
+#include "EventDetector.h"
+#include "FrameDecoder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// What has been reported so far, to turn cumulative counters into gaps
+typedef struct {
+    const FrameDecoder* decoder;
+    int markers;
+    int features;                   ///< Print the statistics frames, not the samples
+    int spectrum;                   ///< Print the spectrum and peaks frames, not the samples
+    int events;                     ///< Print the device and software events, not the samples
+    int devices;                    ///< Start every line with the device ID
+    uint64_t frames_lost;
+    FrameDecoder_Status status;     ///< Last status frame (zero before the first: counted since boot)
+    int have_status;
+    uint32_t samples_lost;          ///< Lost in the sensor before the next samples frame
+    FrameDecoder_Filter filter;     ///< Last filter frame
+    int have_filter;
+    EventDetector detector;         ///< Software detector of the samples frames, with -e
+    uint32_t detector_rate_hz;      ///< Rate it has been set up for (0: not yet)
+} Timeline;
+
+    // Device column of a line, with -d
+    static void PrintDevice(const Timeline* timeline, const FrameDecoder_Frame* frame)
+    {
+        if (!timeline->devices)
+        {
+            return;
+        }
+        if (frame->device != FRAME_DECODER_DEVICE_UNKNOWN)
+        {
+            printf("%u", (unsigned)frame->device);
+        }
+        printf(",");
+    }
+
+    // Event line of -e, snapshot NULL for a software event
+    static void PrintEvent(const Timeline* timeline, const FrameDecoder_Frame* frame, const char* source,
+                           uint32_t timestamp, uint8_t kind, uint8_t axes, const int16_t* snapshot)
+    {
+        PrintDevice(timeline, frame);
+        printf("%s,%u,%lu,%s,%s", source, (unsigned)frame->sequence, (unsigned long)timestamp,
+               kind == FRAME_DECODER_EVENT_CLICK ? "click" : "free_fall",
+               (axes & FRAME_DECODER_EVENT_NEGATIVE) ? "-" : "");
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (axes & (1u << axis))
+            {
+                putchar("xyz"[axis]);
+            }
+        }
+        if (snapshot != NULL)
+        {
+            printf(",%d,%d,%d\n", snapshot[0], snapshot[1], snapshot[2]);
+        }
+        else
+        {
+            printf(",,,\n");
+        }
+    }
+
+    // Samples frame through the software detector, with -e
+    static void DetectEvents(Timeline* timeline, const FrameDecoder_Frame* frame)
+    {
+        uint8_t decimation = timeline->have_filter && timeline->filter.decimation > 0 ? timeline->filter.decimation : 1;
+        uint32_t rate_hz = FrameDecoder_OdrHz(frame->config) / decimation;
+        if (rate_hz == 0)
+        {
+            return;
+        }
+        if (rate_hz != timeline->detector_rate_hz)
+        {
+            // A new rate restarts the detector, like a configuration switch restarts the sensor
+            EventDetector_Config config;
+            EventDetector_Defaults(&config, rate_hz);
+            EventDetector_Init(&timeline->detector, &config);
+            timeline->detector_rate_hz = rate_hz;
+        }
+        for (uint8_t i = 0; i < frame->sample_count; i++)
+        {
+            EventDetector_Event events[2];
+            int count = EventDetector_Add(&timeline->detector, frame->samples[i], events);
+            // The frame is stamped with its last sample
+            uint32_t timestamp = frame->timestamp -
+                                 (uint32_t)((uint64_t)(frame->sample_count - 1 - i) * 1000000u / rate_hz);
+            for (int e = 0; e < count; e++)
+            {
+                PrintEvent(timeline, frame, "software", timestamp, events[e].kind, events[e].axes, NULL);
+            }
+        }
+    }
+
+    // Frame of the live stream with -l: the pages of the log feed the decoder of the logged frames
+    static void ReadLog(const FrameDecoder_Frame* frame, void* context)
+    {
+        FrameDecoder_Log log;
+        if (FrameDecoder_ParseLog(frame, &log))
+        {
+            FrameDecoder_FeedLog(context, &log);
+        }
+    }
+
+    static void PrintFrame(const FrameDecoder_Frame* frame, void* context)
+    {
+        Timeline* timeline = context;
+        if (timeline->markers && timeline->decoder->stats.frames_lost != timeline->frames_lost)
+        {
+            printf("# gap before sequence %u: %llu frames lost\n", (unsigned)frame->sequence,
+                   (unsigned long long)(timeline->decoder->stats.frames_lost - timeline->frames_lost));
+        }
+        timeline->frames_lost = timeline->decoder->stats.frames_lost;
+
+        FrameDecoder_Filter filter;
+        if (FrameDecoder_ParseFilter(frame, &filter))
+        {
+            // Repeated after every status frame: only the changes are marked
+            if (timeline->markers && (!timeline->have_filter ||
+                memcmp(&filter, &timeline->filter, sizeof(filter)) != 0))
+            {
+                printf("# filter from sequence %u: config 0x%02X, decimation %u, "
+                       "low-pass %u/%.3f Hz, high-pass %u/%.3f Hz\n",
+                       (unsigned)frame->sequence, (unsigned)filter.config, (unsigned)filter.decimation,
+                       (unsigned)filter.lowpass_order, filter.lowpass_mhz * 1e-3,
+                       (unsigned)filter.highpass_order, filter.highpass_mhz * 1e-3);
+            }
+            timeline->filter = filter;
+            timeline->have_filter = 1;
+            return;
+        }
+
+        FrameDecoder_Event event;
+        if (timeline->events && FrameDecoder_ParseEvent(frame, &event))
+        {
+            PrintEvent(timeline, frame, "device", frame->timestamp, event.kind, event.axes, event.snapshot);
+            return;
+        }
+        FrameDecoder_Features features;
+        if (timeline->features && FrameDecoder_ParseFeatures(frame, &features))
+        {
+            PrintDevice(timeline, frame);
+            printf("%u,%lu,%u", (unsigned)frame->sequence, (unsigned long)frame->timestamp,
+                   (unsigned)features.samples);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                printf(",%d,%lu,%u,%u,%u", features.mean[axis], (unsigned long)features.variance[axis],
+                       (unsigned)features.rms[axis], (unsigned)features.peak_to_peak[axis],
+                       (unsigned)features.crossings[axis]);
+            }
+            printf(",%lu\n", (unsigned long)features.sma);
+            return;
+        }
+
+        FrameDecoder_Spectrum spectrum;
+        if (timeline->spectrum && FrameDecoder_ParseSpectrum(frame, &spectrum))
+        {
+            double resolution = (double)FrameDecoder_OdrHz(spectrum.config) / spectrum.points;
+            for (int i = 0; i < spectrum.count; i++)
+            {
+                PrintDevice(timeline, frame);
+                printf("%u,%lu,%u,%.3f,%.4f\n", (unsigned)frame->sequence, (unsigned long)frame->timestamp,
+                       (unsigned)spectrum.axis, (spectrum.first_bin + i) * resolution,
+                       (double)spectrum.magnitude[i] / FRAME_DECODER_MAGNITUDE_SCALE);
+            }
+            return;
+        }
+        FrameDecoder_Peaks peaks;
+        if (timeline->spectrum && FrameDecoder_ParsePeaks(frame, &peaks))
+        {
+            double resolution = (double)FrameDecoder_OdrHz(peaks.config) / peaks.points;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (int i = 0; i < peaks.count && peaks.bin[axis][i] != 0; i++)
+                {
+                    PrintDevice(timeline, frame);
+                    printf("%u,%lu,%d,%.3f,%.4f\n", (unsigned)frame->sequence, (unsigned long)frame->timestamp,
+                           axis, peaks.bin[axis][i] * resolution,
+                           (double)peaks.magnitude[axis][i] / FRAME_DECODER_MAGNITUDE_SCALE);
+                }
+            }
+            return;
+        }
+
+        FrameDecoder_Status status;
+        if (FrameDecoder_ParseStatus(frame, &status))
+        {
+            uint32_t dropped = status.samples_dropped - timeline->status.samples_dropped;
+            if (timeline->markers && dropped > 0)
+            {
+                printf("# %lu samples were in frames dropped by the device\n", (unsigned long)dropped);
+            }
+            // Sent right before the batch that follows the overrun
+            timeline->samples_lost += status.samples_lost - timeline->status.samples_lost;
+            timeline->status = status;
+            timeline->have_status = 1;
+            return;
+        }
+        if (timeline->events)
+        {
+            if (frame->samples != NULL)
+            {
+                DetectEvents(timeline, frame);
+            }
+            return;
+        }
+        if (timeline->markers && frame->samples != NULL && timeline->samples_lost > 0)
+        {
+            printf("# gap before sequence %u at %lu us: %lu samples lost in the sensor\n",
+                   (unsigned)frame->sequence, (unsigned long)frame->timestamp,
+                   (unsigned long)timeline->samples_lost);
+            timeline->samples_lost = 0;
+        }
+        for (uint8_t i = 0; !timeline->features && !timeline->spectrum && frame->samples != NULL && i < frame->sample_count; i++)
+        {
+            PrintDevice(timeline, frame);
+            printf("%u,%lu,%d,%d,%d\n", (unsigned)frame->sequence, (unsigned long)frame->timestamp,
+                   frame->samples[i][0], frame->samples[i][1], frame->samples[i][2]);
+        }
+    }
+
+int main(int argc, char** argv)
+{
+    FrameDecoder_Format format = FRAME_DECODER_BATCHED;
+    static Timeline timeline;
+    int log = 0;
+    int option;
+    while ((option = getopt(argc, argv, "bgfsedl")) != -1)
+    {
+        switch (option)
+        {
+            case 'b': format = FRAME_DECODER_BRIDGE; break;
+            case 'g': timeline.markers = 1; break;
+            case 'f': timeline.features = 1; break;
+            case 's': timeline.spectrum = 1; break;
+            case 'e': timeline.events = 1; break;
+            case 'd': timeline.devices = 1; break;
+            case 'l': log = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-b] [-g] [-f] [-s] [-e] [-d] [-l] [capture]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    FILE* input = stdin;
+    if (optind < argc && (input = fopen(argv[optind], "rb")) == NULL)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    static FrameDecoder decoder;
+    static FrameDecoder log_decoder;
+    uint8_t chunk[4096];
+    size_t length;
+    if (log)
+    {
+        FrameDecoder_Init(&log_decoder, FRAME_DECODER_BATCHED, PrintFrame, &timeline);
+        FrameDecoder_Init(&decoder, format, ReadLog, &log_decoder);
+        timeline.decoder = &log_decoder;
+    }
+    else
+    {
+        FrameDecoder_Init(&decoder, format, PrintFrame, &timeline);
+        timeline.decoder = &decoder;
+    }
+    if (timeline.devices)
+    {
+        printf("device,");
+    }
+    if (timeline.features)
+    {
+        printf("sequence,timestamp_us,samples");
+        for (const char* axis = "xyz"; *axis != '\0'; axis++)
+        {
+            printf(",%c_mean_mg,%c_variance_mg2,%c_rms_mg,%c_peak_to_peak_mg,%c_crossings",
+                   *axis, *axis, *axis, *axis, *axis);
+        }
+        printf(",sma_mg\n");
+    }
+    else if (timeline.events)
+    {
+        printf("source,sequence,timestamp_us,kind,axes,x_mg,y_mg,z_mg\n");
+    }
+    else if (timeline.spectrum)
+    {
+        printf("sequence,timestamp_us,axis,frequency_hz,amplitude_mg\n");
+    }
+    else
+    {
+        printf("sequence,timestamp_us,x_mg,y_mg,z_mg\n");
+    }
+    while ((length = fread(chunk, 1, sizeof(chunk), input)) > 0)
+    {
+        FrameDecoder_Feed(&decoder, chunk, length);
+    }
+
+    const FrameDecoder_Stats* stats = &timeline.decoder->stats;
+    fprintf(stderr, "%llu bytes, %llu frames, %llu samples, %llu CRC errors, %llu bytes skipped, "
+            "%llu gaps (%llu frames lost), %llu undecodable\n",
+            (unsigned long long)stats->bytes, (unsigned long long)stats->frames,
+            (unsigned long long)stats->samples, (unsigned long long)stats->crc_errors,
+            (unsigned long long)stats->bytes_skipped, (unsigned long long)stats->sequence_gaps,
+            (unsigned long long)stats->frames_lost, (unsigned long long)stats->frames_undecodable);
+    if (log)
+    {
+        fprintf(stderr, "log: %llu pages lost\n", (unsigned long long)stats->log_pages_lost);
+    }
+    if (timeline.have_status)
+    {
+        const FrameDecoder_Status* status = &timeline.status;
+        fprintf(stderr, "device: %lu sensor overruns (%lu samples lost), %lu samples dropped, "
+                "%lu events dropped, %lu/%lu I2C errors (%lu NAKs, %lu arbitration, %lu bus), "
+                "%lu I2C retries, %lu bus recoveries, %lu commands rejected, "
+                "CPU duty cycle %.2f %%, %lu uA\n",
+                (unsigned long)status->sensor_overruns, (unsigned long)status->samples_lost,
+                (unsigned long)status->samples_dropped, (unsigned long)status->events_dropped,
+                (unsigned long)status->i2c_errors, (unsigned long)status->i2c_transactions,
+                (unsigned long)status->i2c_naks, (unsigned long)status->i2c_arbitration_lost,
+                (unsigned long)status->i2c_bus_errors, (unsigned long)status->i2c_retries,
+                (unsigned long)status->i2c_recoveries, (unsigned long)status->command_errors,
+                status->cpu_duty_ppm * 1e-4, (unsigned long)status->current_ua);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,133 @@
+/**
+*   \file Em_EEPROM_Sim.c
+*   \brief Host implementation of the Em_EEPROM middleware (see Stubs/cy_em_eeprom.h).
+*/
+#include "cy_em_eeprom.h"
+#include "HostSim.h"
+
+#include <string.h>
+
+// Logical bytes of a block: half a row, the other half holds header and history
+#define EM_EEPROM_SIM_BLOCK_SIZE (CY_EM_EEPROM_FLASH_SIZEOF_ROW / 2u)
+
+Em_EEPROM_Sim_Stats Em_EEPROM_Sim_stats;
+
+// Contents of the emulated EEPROM, blank (zero) like the storage array of a new device
+static uint8 image[EM_EEPROM_SIM_MAX_SIZE];
+
+// Erases of every row of the area, and writes of every block
+static uint32 row_erases[EM_EEPROM_SIM_MAX_ROWS];
+static uint32 block_writes[EM_EEPROM_SIM_MAX_ROWS];
+static uint32 row_count;
+
+    void Em_EEPROM_Sim_Erase(void)
+    {
+        memset(image, 0, sizeof(image));
+        memset(row_erases, 0, sizeof(row_erases));
+        memset(block_writes, 0, sizeof(block_writes));
+        memset(&Em_EEPROM_Sim_stats, 0, sizeof(Em_EEPROM_Sim_stats));
+    }
+
+    uint32 Em_EEPROM_Sim_RowCount(void)
+    {
+        return row_count;
+    }
+
+    uint32 Em_EEPROM_Sim_RowErases(uint32 row)
+    {
+        return row < row_count ? row_erases[row] : 0;
+    }
+
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Init(cy_stc_eeprom_config_t* config, cy_stc_eeprom_context_t* context)
+    {
+        if (config == NULL || context == NULL || config->eepromSize == 0 ||
+            config->eepromSize > EM_EEPROM_SIM_MAX_SIZE || config->wearLevelingFactor == 0 ||
+            config->redundantCopy > 1)
+        {
+            return CY_EM_EEPROM_BAD_PARAM;
+        }
+        uint32 rows = CY_EM_EEPROM_GET_PHYSICAL_SIZE(config->eepromSize, config->wearLevelingFactor,
+                                                     config->redundantCopy) / CY_EM_EEPROM_FLASH_SIZEOF_ROW;
+        if (rows > EM_EEPROM_SIM_MAX_ROWS)
+        {
+            return CY_EM_EEPROM_BAD_PARAM;
+        }
+        context->eepromSize = config->eepromSize;
+        context->numberOfRows = (config->eepromSize - 1u) / EM_EEPROM_SIM_BLOCK_SIZE + 1u;
+        context->wearLevelingFactor = config->wearLevelingFactor;
+        context->redundantCopy = config->redundantCopy;
+        context->blockingWrite = config->blockingWrite;
+        context->userFlashStartAddr = config->userFlashStartAddr;
+        context->ptrLastWrittenRow = NULL;
+
+        // Same area again after a restart: its wear is kept
+        row_count = rows;
+        return CY_EM_EEPROM_SUCCESS;
+    }
+
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Read(uint32 addr, void* eepromData, uint32 size,
+                                               cy_stc_eeprom_context_t* context)
+    {
+        if (eepromData == NULL || context == NULL || addr + size > context->eepromSize)
+        {
+            return CY_EM_EEPROM_BAD_PARAM;
+        }
+        Em_EEPROM_Sim_stats.reads++;
+        memcpy(eepromData, &image[addr], size);
+        return CY_EM_EEPROM_SUCCESS;
+    }
+
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Write(uint32 addr, void* eepromData, uint32 size,
+                                                cy_stc_eeprom_context_t* context)
+    {
+        if (eepromData == NULL || context == NULL || size == 0 || addr + size > context->eepromSize)
+        {
+            return CY_EM_EEPROM_BAD_PARAM;
+        }
+        /* One row per block touched, the next of the wearLevelingFactor rows of the block;
+        the redundant copy in the same row of the second half of the area */
+        uint32 first = addr / EM_EEPROM_SIM_BLOCK_SIZE;
+        uint32 last = (addr + size - 1u) / EM_EEPROM_SIM_BLOCK_SIZE;
+        uint32 copy_rows = context->numberOfRows * context->wearLevelingFactor;
+        uint32 rows = 0;
+        for (uint32 block = first; block <= last; block++)
+        {
+            uint32 row = block + context->numberOfRows * (block_writes[block]++ % context->wearLevelingFactor);
+            for (uint32 copy = 0; copy <= context->redundantCopy; copy++)
+            {
+                row_erases[row + copy * copy_rows]++;
+                rows++;
+            }
+        }
+        memcpy(&image[addr], eepromData, size);
+
+        Em_EEPROM_Sim_stats.writes++;
+        Em_EEPROM_Sim_stats.bytes_written += size;
+        Em_EEPROM_Sim_stats.rows_programmed += rows;
+        HostSim_Busy((uint64_t)rows * HostSim_config.flash_row_write_ns);
+        return CY_EM_EEPROM_SUCCESS;
+    }
+
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Erase(cy_stc_eeprom_context_t* context)
+    {
+        if (context == NULL)
+        {
+            return CY_EM_EEPROM_BAD_PARAM;
+        }
+        memset(image, 0, context->eepromSize);
+        for (uint32 row = 0; row < row_count; row++)
+        {
+            row_erases[row]++;
+        }
+        Em_EEPROM_Sim_stats.rows_programmed += row_count;
+        HostSim_Busy((uint64_t)row_count * HostSim_config.flash_row_write_ns);
+        return CY_EM_EEPROM_SUCCESS;
+    }
+
+    uint32 Cy_Em_EEPROM_NumWrites(cy_stc_eeprom_context_t* context)
+    {
+        (void)context;
+        return (uint32)Em_EEPROM_Sim_stats.writes;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,134 @@
+/**
+*   \file EventDetector.c
+*   \brief Software click and free-fall detector, run on a replayed sample stream.
+*/
+#include "EventDetector.h"
+
+#include <string.h>
+
+    // Samples of a time at a rate, rounded up, at most max
+    static uint8_t Samples(uint32_t ms, uint32_t rate_hz, uint8_t max)
+    {
+        uint32_t samples = (ms * rate_hz + 999u) / 1000u;
+        return (uint8_t)(samples > max ? max : samples);
+    }
+
+    void EventDetector_Defaults(EventDetector_Config* config, uint32_t rate_hz)
+    {
+        config->click_threshold_mg = EVENT_DETECTOR_CLICK_THRESHOLD_MG;
+        config->click_limit = Samples(EVENT_DETECTOR_CLICK_LIMIT_MS, rate_hz, 0x7F);
+        config->click_latency = Samples(EVENT_DETECTOR_CLICK_LATENCY_MS, rate_hz, 0xFF);
+        config->free_fall_mg = EVENT_DETECTOR_FREE_FALL_MG;
+        config->free_fall_duration = Samples(EVENT_DETECTOR_FREE_FALL_MS, rate_hz, 0x7F);
+    }
+
+    void EventDetector_Init(EventDetector* detector, const EventDetector_Config* config)
+    {
+        memset(detector, 0, sizeof(*detector));
+        detector->config = *config;
+    }
+
+    // Click of the sample, once its run has ended
+    static int Click(EventDetector* detector, const int16_t mg[3], EventDetector_Event* event)
+    {
+        int32_t threshold = detector->config.click_threshold_mg;
+        int above = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!detector->primed)
+            {
+                detector->reference[axis] = mg[axis];
+            }
+            int32_t value = mg[axis] - detector->reference[axis];
+            detector->reference[axis] += value / 8;
+            int32_t magnitude = value < 0 ? -value : value;
+            if (threshold == 0 || magnitude <= threshold)
+            {
+                continue;
+            }
+            above = 1;
+            int32_t peak = detector->click_peak < 0 ? -detector->click_peak : detector->click_peak;
+            if (detector->click_count == 0 || magnitude > peak)
+            {
+                detector->click_peak = value;
+                detector->click_axis = (uint8_t)axis;
+            }
+        }
+        detector->primed = 1;
+        if (detector->click_latency > 0)
+        {
+            detector->click_latency--;
+            detector->click_count = 0;
+            return 0;
+        }
+        if (above)
+        {
+            if (detector->click_count < 0xFF)
+            {
+                detector->click_count++;
+            }
+            return 0;
+        }
+        int clicked = detector->click_count > 0 && detector->click_count <= detector->config.click_limit;
+        detector->click_count = 0;
+        if (!clicked)
+        {
+            return 0;
+        }
+        event->kind = EVENT_DETECTOR_CLICK;
+        event->axes = (uint8_t)((detector->click_peak < 0 ? EVENT_DETECTOR_NEGATIVE : 0) |
+                                (1u << detector->click_axis));
+        detector->click_latency = detector->config.click_latency;
+        return 1;
+    }
+
+    // Free fall starting with the sample; its end is watched like the sensor does
+    static int FreeFall(EventDetector* detector, const int16_t mg[3], EventDetector_Event* event)
+    {
+        int32_t threshold = detector->config.free_fall_mg;
+        int low = threshold > 0;
+        for (int axis = 0; axis < 3 && low; axis++)
+        {
+            low = mg[axis] <= threshold && mg[axis] >= -threshold;
+        }
+        // Falling: samples off the condition count towards the end, otherwise towards the start
+        if (low != detector->falling)
+        {
+            if (detector->fall_count < 0xFF)
+            {
+                detector->fall_count++;
+            }
+        }
+        else
+        {
+            detector->fall_count = 0;
+        }
+        if (threshold == 0 || detector->fall_count <= detector->config.free_fall_duration)
+        {
+            return 0;
+        }
+        detector->fall_count = 0;
+        detector->falling = !detector->falling;
+        if (!detector->falling)
+        {
+            return 0;
+        }
+        event->kind = EVENT_DETECTOR_FREE_FALL;
+        event->axes = 0x07;
+        return 1;
+    }
+
+    int EventDetector_Add(EventDetector* detector, const int16_t mg[3], EventDetector_Event events[2])
+    {
+        int count = 0;
+        count += FreeFall(detector, mg, &events[count]);
+        count += Click(detector, mg, &events[count]);
+        for (int i = 0; i < count; i++)
+        {
+            events[i].sample = detector->samples;
+        }
+        detector->samples++;
+        return count;
+    }
+
+/* [] END OF FILE */
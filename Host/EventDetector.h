@@ -0,0 +1,95 @@
+/**
+*   \file EventDetector.h
+*   \brief Software click and free-fall detector, run on a replayed sample stream.
+*
+*   Validation of the events output format of PROJ_3 (Events.h): the
+*   detection of the sensor engines set up by LIS3DH_ConfigureClick() and
+*   LIS3DH_ConfigureFreeFall(), as LIS3DH_Model.h implements it, applied
+*   to the samples in mg of a batched capture (decode_stream -e) or of a
+*   simulation, so that the events the device sends can be checked
+*   against the motion that caused them.
+*
+*   Click: every axis goes through the first-order high-pass of the model
+*   (y = x - r, r += y / 8, primed with the first sample); a run of
+*   samples beyond the threshold on any axis that falls back below it
+*   within the limit is a click, on the axis of the peak of the run and
+*   in its sign; no run starts during the latency after it.
+*
+*   Free fall: every axis at or below the threshold, unfiltered, for more
+*   than the duration; one event, then none until any axis has been above
+*   the threshold for more than the duration (PROJ_3 switches the IA1
+*   generator to the end of the fall and back).
+*
+*   Thresholds are compared in mg; the sensor rounds them up to its
+*   INT1_THS / CLICK_THS step, so samples within a step of a threshold
+*   may be classified differently.
+*/
+#ifndef EVENT_DETECTOR_H
+    #define EVENT_DETECTOR_H
+
+    #include <stdint.h>
+
+    /** \brief Defaults of PROJ_3 main.c (EVENTS_*). */
+    #define EVENT_DETECTOR_CLICK_THRESHOLD_MG   1200
+    #define EVENT_DETECTOR_CLICK_LIMIT_MS       20
+    #define EVENT_DETECTOR_CLICK_LATENCY_MS     100
+    #define EVENT_DETECTOR_FREE_FALL_MG         350
+    #define EVENT_DETECTOR_FREE_FALL_MS         100
+
+    /** \brief Kinds of event, as in FRAME_DECODER_EVENT_*. */
+    #define EVENT_DETECTOR_CLICK        1
+    #define EVENT_DETECTOR_FREE_FALL    2
+
+    /** \brief Flag of the axes of a click towards the negative side. */
+    #define EVENT_DETECTOR_NEGATIVE     0x80
+
+    /** \brief Parameters, times in samples. */
+    typedef struct {
+        int32_t click_threshold_mg;     ///< 0: no click detection
+        uint8_t click_limit;            ///< Longest click (TIME_LIMIT)
+        uint8_t click_latency;          ///< Samples without clicks after one (TIME_LATENCY)
+        int32_t free_fall_mg;           ///< 0: no free-fall detection
+        uint8_t free_fall_duration;     ///< Samples the condition must hold beyond (INT1_DURATION)
+    } EventDetector_Config;
+
+    /** \brief A detected event. */
+    typedef struct {
+        uint8_t kind;                   ///< EVENT_DETECTOR_CLICK or EVENT_DETECTOR_FREE_FALL
+        uint8_t axes;                   ///< X, Y, Z in bits 0..2, EVENT_DETECTOR_NEGATIVE
+        uint64_t sample;                ///< Index of the sample that completed it
+    } EventDetector_Event;
+
+    /** \brief State of a detector. */
+    typedef struct {
+        EventDetector_Config config;
+        int32_t reference[3];           ///< High-pass state per axis [mg]
+        uint8_t primed;
+        uint8_t click_count;            ///< Samples of the current run beyond the threshold
+        int32_t click_peak;             ///< Largest high-passed value of the run [mg], signed
+        uint8_t click_axis;
+        uint8_t click_latency;          ///< Samples left before the next run can start
+        uint8_t falling;                ///< Free fall reported, its end not seen yet
+        uint8_t fall_count;             ///< Consecutive samples towards the start or the end of a fall
+        uint64_t samples;               ///< Samples added
+    } EventDetector;
+
+    /**
+    *   \brief Parameters of PROJ_3 at \p rate_hz samples per second: the
+    *          times rounded up to whole samples, like the firmware does.
+    */
+    void EventDetector_Defaults(EventDetector_Config* config, uint32_t rate_hz);
+
+    /** \brief Start \p detector with no history. */
+    void EventDetector_Init(EventDetector* detector, const EventDetector_Config* config);
+
+    /**
+    *   \brief Add the next sample.
+    *
+    *   \param mg x, y, z [mg].
+    *   \param events Receives the events the sample completes (2 at most).
+    *   \retval Number of events.
+    */
+    int EventDetector_Add(EventDetector* detector, const int16_t mg[3], EventDetector_Event events[2]);
+
+#endif // EVENT_DETECTOR_H
+/* [] END OF FILE */
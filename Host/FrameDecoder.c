@@ -0,0 +1,521 @@
+/**
+*   \file FrameDecoder.c
+*   \brief Host-side decoder of the PROJ_3 UART streams.
+*/
+#include "FrameDecoder.h"
+
+#include <string.h>
+
+#define BRIDGE_FRAME_SIZE   8
+#define BRIDGE_HEADER       0xA0
+#define BRIDGE_FOOTER       0xC0
+
+    void FrameDecoder_Init(FrameDecoder* decoder, FrameDecoder_Format format,
+                           FrameDecoder_Callback callback, void* context)
+    {
+        memset(decoder, 0, sizeof(*decoder));
+        decoder->format = format;
+        decoder->callback = callback;
+        decoder->context = context;
+    }
+
+    uint16_t FrameDecoder_Crc16(const uint8_t* data, size_t length)
+    {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < length; i++)
+        {
+            crc ^= (uint16_t)(data[i] << 8);
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    static void Consume(FrameDecoder* decoder, size_t count)
+    {
+        memmove(decoder->buffer, decoder->buffer + count, decoder->fill - count);
+        decoder->fill -= count;
+    }
+
+    static void Skip(FrameDecoder* decoder)
+    {
+        decoder->stats.bytes_skipped++;
+        Consume(decoder, 1);
+    }
+
+    static int16_t ReadInt16(const uint8_t* p)
+    {
+        return (int16_t)(p[0] | (p[1] << 8));
+    }
+
+    // Returns the number of samples, or -1 if the payload cannot be expanded
+    static int ExpandSamples(FrameDecoder* decoder, const FrameDecoder_Frame* frame)
+    {
+        const uint8_t* p = frame->payload;
+        const uint8_t* end = p + frame->length;
+        int16_t (*xyz)[3] = decoder->samples;
+        size_t count;
+        size_t i = 0;
+
+        // Delta chain of the device; none outlives the frame while the device is unknown
+        int16_t unknown_reference[3];
+        uint8_t unknown_have_reference = 0;
+        uint8_t known = decoder->device < FRAME_DECODER_MAX_DEVICES;
+        int16_t* reference = known ? decoder->reference[decoder->device] : unknown_reference;
+        uint8_t* have_reference = known ? &decoder->have_reference[decoder->device] : &unknown_have_reference;
+
+        if (frame->type == FRAME_DECODER_TYPE_SAMPLES)
+        {
+            if (frame->length < 1 || (frame->length - 1) % 6 != 0)
+            {
+                return -1;
+            }
+            count = (frame->length - 1u) / 6u;
+            for (i = 0; i < count; i++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    xyz[i][axis] = ReadInt16(p + 1 + 6 * i + 2 * axis);
+                }
+            }
+            if (count > 0)
+            {
+                // Plain samples are a valid start for the following delta frames
+                memcpy(reference, xyz[count - 1], sizeof(unknown_reference));
+                *have_reference = 1;
+            }
+            return (int)count;
+        }
+
+        if (frame->length < 2)
+        {
+            return -1;
+        }
+        count = p[1];
+        p += 2;
+        if (count > FRAME_DECODER_MAX_SAMPLES)
+        {
+            return -1;
+        }
+        if (frame->type == FRAME_DECODER_TYPE_DELTA_KEY)
+        {
+            if (count == 0 || end - p < 6)
+            {
+                return -1;
+            }
+            for (int axis = 0; axis < 3; axis++)
+            {
+                reference[axis] = ReadInt16(p + 2 * axis);
+            }
+            memcpy(xyz[0], reference, sizeof(unknown_reference));
+            *have_reference = 1;
+            p += 6;
+            i = 1;
+        }
+        else if (!*have_reference)
+        {
+            return -1;
+        }
+
+        for (; i < count; i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                uint32_t zigzag = 0;
+                for (int shift = 0; ; shift += 7)
+                {
+                    if (p == end || shift > 14)
+                    {
+                        *have_reference = 0;
+                        return -1;
+                    }
+                    zigzag |= (uint32_t)(*p & 0x7F) << shift;
+                    if ((*p++ & 0x80) == 0)
+                    {
+                        break;
+                    }
+                }
+                int16_t delta = (int16_t)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+                reference[axis] = (int16_t)(reference[axis] + delta);
+                xyz[i][axis] = reference[axis];
+            }
+        }
+        if (p != end)
+        {
+            *have_reference = 0;
+            return -1;
+        }
+        return (int)count;
+    }
+
+    static void Deliver(FrameDecoder* decoder, FrameDecoder_Frame* frame)
+    {
+        decoder->stats.frames++;
+        if (frame->type == FRAME_DECODER_TYPE_DEVICE && frame->length == FRAME_DECODER_DEVICE_SIZE)
+        {
+            decoder->device = frame->payload[0];
+            if (decoder->device < FRAME_DECODER_MAX_DEVICES)
+            {
+                decoder->devices_seen |= (uint8_t)(1u << decoder->device);
+            }
+        }
+        frame->device = decoder->device;
+        if (frame->type == FRAME_DECODER_TYPE_SAMPLES ||
+            frame->type == FRAME_DECODER_TYPE_DELTA_KEY ||
+            frame->type == FRAME_DECODER_TYPE_DELTA)
+        {
+            int count = ExpandSamples(decoder, frame);
+            if (count < 0)
+            {
+                decoder->stats.frames_undecodable++;
+            }
+            else
+            {
+                frame->config = frame->payload[0];
+                frame->sample_count = (uint8_t)count;
+                frame->samples = (const int16_t (*)[3])decoder->samples;
+                decoder->stats.samples += (uint64_t)count;
+            }
+        }
+        if (decoder->callback != NULL)
+        {
+            decoder->callback(frame, decoder->context);
+        }
+    }
+
+    void FrameDecoder_CheckSequence(FrameDecoder* decoder, uint16_t sequence)
+    {
+        if (decoder->have_sequence && sequence != decoder->next_sequence)
+        {
+            decoder->stats.sequence_gaps++;
+            decoder->stats.frames_lost += (uint16_t)(sequence - decoder->next_sequence);
+            // The delta chains are broken, and a device frame may be lost
+            memset(decoder->have_reference, 0, sizeof(decoder->have_reference));
+            if ((decoder->devices_seen & (decoder->devices_seen - 1)) != 0)
+            {
+                decoder->device = FRAME_DECODER_DEVICE_UNKNOWN;
+            }
+        }
+        decoder->have_sequence = 1;
+        decoder->next_sequence = (uint16_t)(sequence + 1);
+    }
+
+    static uint32_t ReadUint32(const uint8_t* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    int FrameDecoder_ParseStatus(const FrameDecoder_Frame* frame, FrameDecoder_Status* status)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_STATUS || frame->length != FRAME_DECODER_STATUS_SIZE)
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        status->sensor_overruns = ReadUint32(&p[0]);
+        status->samples_lost = ReadUint32(&p[4]);
+        status->samples_dropped = ReadUint32(&p[8]);
+        status->events_dropped = ReadUint32(&p[12]);
+        status->frames_dropped = ReadUint32(&p[16]);
+        status->i2c_transactions = ReadUint32(&p[20]);
+        status->i2c_errors = ReadUint32(&p[24]);
+        status->i2c_naks = ReadUint32(&p[28]);
+        status->i2c_arbitration_lost = ReadUint32(&p[32]);
+        status->i2c_bus_errors = ReadUint32(&p[36]);
+        status->command_errors = ReadUint32(&p[40]);
+        status->i2c_retries = ReadUint32(&p[44]);
+        status->i2c_recoveries = ReadUint32(&p[48]);
+        status->cpu_duty_ppm = ReadUint32(&p[52]);
+        status->current_ua = ReadUint32(&p[56]);
+        return 1;
+    }
+
+    int FrameDecoder_ParseFilter(const FrameDecoder_Frame* frame, FrameDecoder_Filter* filter)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_FILTER || frame->length != FRAME_DECODER_FILTER_SIZE)
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        filter->config = p[0];
+        filter->decimation = p[1];
+        filter->lowpass_order = p[2];
+        filter->lowpass_mhz = ReadUint32(&p[3]);
+        filter->highpass_order = p[7];
+        filter->highpass_mhz = ReadUint32(&p[8]);
+        return 1;
+    }
+
+    int FrameDecoder_ParseBoot(const FrameDecoder_Frame* frame, FrameDecoder_Boot* boot)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_BOOT || frame->length != FRAME_DECODER_BOOT_SIZE)
+        {
+            return 0;
+        }
+        for (int phase = 0; phase < FRAME_DECODER_BOOT_PHASES; phase++)
+        {
+            boot->times[phase] = ReadUint32(&frame->payload[4 * phase]);
+        }
+        return 1;
+    }
+
+    int FrameDecoder_ParseEvent(const FrameDecoder_Frame* frame, FrameDecoder_Event* event)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_EVENT || frame->length != FRAME_DECODER_EVENT_SIZE ||
+            (frame->payload[1] != FRAME_DECODER_EVENT_CLICK && frame->payload[1] != FRAME_DECODER_EVENT_FREE_FALL))
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        event->config = p[0];
+        event->kind = p[1];
+        event->axes = p[2];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            event->snapshot[axis] = (int16_t)(p[3 + 2 * axis] | (p[4 + 2 * axis] << 8));
+        }
+        return 1;
+    }
+
+    void FrameDecoder_FeedLog(FrameDecoder* decoder, const FrameDecoder_Log* log)
+    {
+        size_t start = 0;
+
+        if (decoder->have_page && log->sequence != decoder->next_page)
+        {
+            decoder->stats.log_pages_lost += (uint32_t)(log->sequence - decoder->next_page);
+        }
+        if (!decoder->have_page || log->sequence != decoder->next_page)
+        {
+            // The bytes before the first frame belong to one the decoder has not seen
+            decoder->fill = 0;
+            start = log->first == FRAME_DECODER_LOG_NO_FRAME ? log->length : log->first;
+        }
+        decoder->have_page = 1;
+        decoder->next_page = log->sequence + 1;
+        FrameDecoder_Feed(decoder, log->data + start, log->length - start);
+    }
+
+    int FrameDecoder_ParseLog(const FrameDecoder_Frame* frame, FrameDecoder_Log* log)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_LOG || frame->length < FRAME_DECODER_LOG_HEADER_SIZE)
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        log->sequence = ReadUint32(p);
+        log->first = p[4];
+        log->length = (uint8_t)(frame->length - FRAME_DECODER_LOG_HEADER_SIZE);
+        log->data = &p[FRAME_DECODER_LOG_HEADER_SIZE];
+        if (log->first != FRAME_DECODER_LOG_NO_FRAME && log->first >= log->length)
+        {
+            return 0;
+        }
+        return 1;
+    }
+
+    int FrameDecoder_ParseFeatures(const FrameDecoder_Frame* frame, FrameDecoder_Features* features)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_FEATURES || frame->length != FRAME_DECODER_FEATURES_SIZE)
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        features->config = p[0];
+        features->samples = (uint16_t)(p[1] | (p[2] << 8));
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const uint8_t* a = &p[3 + 12 * axis];
+            features->mean[axis] = (int16_t)(a[0] | (a[1] << 8));
+            features->variance[axis] = ReadUint32(&a[2]);
+            features->rms[axis] = (uint16_t)(a[6] | (a[7] << 8));
+            features->peak_to_peak[axis] = (uint16_t)(a[8] | (a[9] << 8));
+            features->crossings[axis] = (uint16_t)(a[10] | (a[11] << 8));
+        }
+        features->sma = ReadUint32(&p[39]);
+        return 1;
+    }
+
+    static uint16_t ReadUint16(const uint8_t* p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    int FrameDecoder_ParseSpectrum(const FrameDecoder_Frame* frame, FrameDecoder_Spectrum* spectrum)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_SPECTRUM || frame->length < 6)
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        if (p[1] > 15 || p[2] > 2 || p[5] > FRAME_DECODER_MAX_BINS || frame->length != 6 + 2 * p[5])
+        {
+            return 0;
+        }
+        spectrum->config = p[0];
+        spectrum->points = (uint16_t)(1u << p[1]);
+        spectrum->axis = p[2];
+        spectrum->first_bin = ReadUint16(&p[3]);
+        spectrum->count = p[5];
+        for (int i = 0; i < spectrum->count; i++)
+        {
+            spectrum->magnitude[i] = ReadUint16(&p[6 + 2 * i]);
+        }
+        return 1;
+    }
+
+    int FrameDecoder_ParsePeaks(const FrameDecoder_Frame* frame, FrameDecoder_Peaks* peaks)
+    {
+        if (frame->type != FRAME_DECODER_TYPE_PEAKS || frame->length < 3)
+        {
+            return 0;
+        }
+        const uint8_t* p = frame->payload;
+        if (p[1] > 15 || p[2] > FRAME_DECODER_MAX_PEAKS || frame->length != 3 + 12 * p[2])
+        {
+            return 0;
+        }
+        peaks->config = p[0];
+        peaks->points = (uint16_t)(1u << p[1]);
+        peaks->count = p[2];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (int i = 0; i < peaks->count; i++)
+            {
+                const uint8_t* a = &p[3 + 4 * (axis * peaks->count + i)];
+                peaks->bin[axis][i] = ReadUint16(&a[0]);
+                peaks->magnitude[axis][i] = ReadUint16(&a[2]);
+            }
+        }
+        return 1;
+    }
+
+    unsigned FrameDecoder_OdrHz(uint8_t config)
+    {
+        // CTRL_REG1 ODR codes, low-power mode (0) turning 1.344 kHz into 5.376 kHz and adding 1.6 kHz
+        static const unsigned odr_hz[] = { 0, 1, 10, 25, 50, 100, 200, 400, 0, 1344 };
+        unsigned odr = config >> 4;
+        unsigned mode = (config >> 2) & 0x03;
+        if (mode == 0 && odr == 8)
+        {
+            return 1600;
+        }
+        if (mode == 0 && odr == 9)
+        {
+            return 5376;
+        }
+        return odr < sizeof(odr_hz) / sizeof(odr_hz[0]) ? odr_hz[odr] : 0;
+    }
+
+    void FrameDecoder_Accept(FrameDecoder* decoder, FrameDecoder_Frame* frame)
+    {
+        // Bridge frames carry no sequence number, log frames one of their own
+        if (decoder->format == FRAME_DECODER_BATCHED && frame->type != FRAME_DECODER_TYPE_LOG)
+        {
+            FrameDecoder_CheckSequence(decoder, frame->sequence);
+        }
+        Deliver(decoder, frame);
+    }
+
+    // Returns 0 when more bytes are needed
+    static int DecodeBatched(FrameDecoder* decoder)
+    {
+        const uint8_t* b = decoder->buffer;
+        if (decoder->fill < 2)
+        {
+            return 0;
+        }
+        if (b[0] != FRAME_DECODER_SYNC_0 || b[1] != FRAME_DECODER_SYNC_1)
+        {
+            Skip(decoder);
+            return 1;
+        }
+        if (decoder->fill < FRAME_DECODER_HEADER_SIZE)
+        {
+            return 0;
+        }
+        size_t size = FRAME_DECODER_HEADER_SIZE + b[3] + FRAME_DECODER_CRC_SIZE;
+        if (decoder->fill < size)
+        {
+            return 0;
+        }
+        uint16_t crc = (uint16_t)(b[size - 2] | (b[size - 1] << 8));
+        if (FrameDecoder_Crc16(b + 2, size - 4) != crc)
+        {
+            // Corrupted frame or a sync pattern inside data: look further
+            decoder->stats.crc_errors++;
+            Skip(decoder);
+            return 1;
+        }
+        FrameDecoder_Frame frame = {
+            .type = b[2],
+            .length = b[3],
+            .sequence = (uint16_t)(b[4] | (b[5] << 8)),
+            .timestamp = (uint32_t)b[6] | ((uint32_t)b[7] << 8) |
+                         ((uint32_t)b[8] << 16) | ((uint32_t)b[9] << 24),
+            .payload = b + FRAME_DECODER_HEADER_SIZE
+        };
+        FrameDecoder_Accept(decoder, &frame);
+        Consume(decoder, size);
+        return 1;
+    }
+
+    static int DecodeBridge(FrameDecoder* decoder)
+    {
+        const uint8_t* b = decoder->buffer;
+        if (decoder->fill < BRIDGE_FRAME_SIZE)
+        {
+            return 0;
+        }
+        if (b[0] != BRIDGE_HEADER || b[BRIDGE_FRAME_SIZE - 1] != BRIDGE_FOOTER)
+        {
+            Skip(decoder);
+            return 1;
+        }
+        // Re-packed as a one-sample samples payload (little-endian)
+        uint8_t payload[7] = {
+            FRAME_DECODER_CONFIG_UNKNOWN, b[2], b[1], b[4], b[3], b[6], b[5]
+        };
+        FrameDecoder_Frame frame = {
+            .type = FRAME_DECODER_TYPE_SAMPLES,
+            .length = sizeof(payload),
+            .payload = payload
+        };
+        FrameDecoder_Accept(decoder, &frame);
+        Consume(decoder, BRIDGE_FRAME_SIZE);
+        return 1;
+    }
+
+    void FrameDecoder_Feed(FrameDecoder* decoder, const uint8_t* data, size_t length)
+    {
+        decoder->stats.bytes += length;
+        while (length > 0)
+        {
+            size_t chunk = sizeof(decoder->buffer) - decoder->fill;
+            if (chunk > length)
+            {
+                chunk = length;
+            }
+            memcpy(decoder->buffer + decoder->fill, data, chunk);
+            decoder->fill += chunk;
+            data += chunk;
+            length -= chunk;
+
+            if (decoder->format == FRAME_DECODER_BATCHED)
+            {
+                while (DecodeBatched(decoder))
+                {
+                }
+            }
+            else
+            {
+                while (DecodeBridge(decoder))
+                {
+                }
+            }
+        }
+    }
+
+/* [] END OF FILE */
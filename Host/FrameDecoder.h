@@ -0,0 +1,381 @@
+/**
+*   \file FrameDecoder.h
+*   \brief Host-side decoder of the PROJ_3 UART streams.
+*
+*   Two stream formats are understood:
+*   - batched: frames with sync, type, length, sequence number,
+*     timestamp and CRC-16 (see Frame.h in PROJ_3 for the layout);
+*   - bridge: the 8-byte A0 x y z C0 frames read by the Bridge Control
+*     Panel, big-endian, one sample per frame.
+*
+*   Bytes can be fed in chunks of any size. The decoder resynchronises
+*   after garbage or corrupted frames and keeps count of what it had to
+*   throw away and of the frames missing from the sequence numbering.
+*
+*   Samples frames, plain or delta compressed (DeltaCodec.h in PROJ_3),
+*   are expanded to mg values before being handed to the callback. After
+*   a sequence gap delta frames are undecodable until the next keyframe.
+*
+*   Every frame is attributed to the sensor named by the last device
+*   frame (PROJ_3 BusManager.h), each with its own delta chain; streams
+*   without device frames come from device 0. Once a stream has named two
+*   sensors, a sequence gap leaves the device unknown until the next
+*   device frame.
+*/
+#ifndef FRAME_DECODER_H
+    #define FRAME_DECODER_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #define FRAME_DECODER_SYNC_0        0xA5
+    #define FRAME_DECODER_SYNC_1        0x5A
+    #define FRAME_DECODER_HEADER_SIZE   10
+    #define FRAME_DECODER_CRC_SIZE      2
+    #define FRAME_DECODER_MAX_FRAME     (FRAME_DECODER_HEADER_SIZE + 255 + FRAME_DECODER_CRC_SIZE)
+
+    #define FRAME_DECODER_TYPE_SAMPLES  0x01
+    #define FRAME_DECODER_TYPE_DELTA_KEY 0x02
+    #define FRAME_DECODER_TYPE_DELTA    0x03
+
+    /** \brief Latency statistics of a stage of the sample path (PROJ_3 Trace.h). */
+    #define FRAME_DECODER_TYPE_TRACE    0x04
+
+    /** \brief Loss and error counters (PROJ_3 StatusReport.h), see FrameDecoder_ParseStatus(). */
+    #define FRAME_DECODER_TYPE_STATUS   0x05
+    #define FRAME_DECODER_STATUS_SIZE   60
+
+    /** \brief Filtering and decimation of the samples frames (PROJ_3 Filter.h), see FrameDecoder_ParseFilter(). */
+    #define FRAME_DECODER_TYPE_FILTER   0x06
+    #define FRAME_DECODER_FILTER_SIZE   12
+
+    /** \brief Statistics of a window of samples (PROJ_3 Features.h), see FrameDecoder_ParseFeatures(). */
+    #define FRAME_DECODER_TYPE_FEATURES 0x07
+    #define FRAME_DECODER_FEATURES_SIZE 43
+
+    /** \brief Magnitude bins of an axis (PROJ_3 Spectrum.h), see FrameDecoder_ParseSpectrum(). */
+    #define FRAME_DECODER_TYPE_SPECTRUM 0x08
+    #define FRAME_DECODER_MAX_BINS      64
+
+    /** \brief Highest spectral peaks per axis (PROJ_3 Spectrum.h), see FrameDecoder_ParsePeaks(). */
+    #define FRAME_DECODER_TYPE_PEAKS    0x09
+    #define FRAME_DECODER_MAX_PEAKS     8
+
+    /** \brief Sensor the next frames come from: device ID, I2C address (PROJ_3 BusManager.h). */
+    #define FRAME_DECODER_TYPE_DEVICE   0x0A
+    #define FRAME_DECODER_DEVICE_SIZE   2
+    #define FRAME_DECODER_MAX_DEVICES   8
+
+    /** \brief Times of the boot phases (Shared Boot.h), see FrameDecoder_ParseBoot(). */
+    #define FRAME_DECODER_TYPE_BOOT     0x0B
+    #define FRAME_DECODER_BOOT_PHASES   4
+    #define FRAME_DECODER_BOOT_SIZE     (4 * FRAME_DECODER_BOOT_PHASES)
+
+    /** \brief Click or free fall detected by the sensor (PROJ_3 Events.h), see FrameDecoder_ParseEvent(). */
+    #define FRAME_DECODER_TYPE_EVENT    0x0C
+    #define FRAME_DECODER_EVENT_SIZE    9
+
+    /** \brief Page of the ring log in flash (PROJ_3 FlashLog.h), see FrameDecoder_ParseLog(). */
+    #define FRAME_DECODER_TYPE_LOG      0x0D
+    #define FRAME_DECODER_LOG_HEADER_SIZE 5
+
+    /** \brief First frame offset of a log page in which no frame starts. */
+    #define FRAME_DECODER_LOG_NO_FRAME  0xFF
+
+    /** \brief Kinds of event. */
+    #define FRAME_DECODER_EVENT_CLICK       1
+    #define FRAME_DECODER_EVENT_FREE_FALL   2
+
+    /** \brief Flag of the axes of an event: a click towards the negative side. */
+    #define FRAME_DECODER_EVENT_NEGATIVE    0x80
+
+    /** \brief Time of a boot phase the device has not reached. */
+    #define FRAME_DECODER_BOOT_NOT_REACHED 0xFFFFFFFFu
+
+    /** \brief Device of the frames after a sequence gap, until the next device frame. */
+    #define FRAME_DECODER_DEVICE_UNKNOWN 0xFF
+
+    /** \brief Units of the spectral magnitudes per mg. */
+    #define FRAME_DECODER_MAGNITUDE_SCALE 16
+
+    /** \brief Command from the host: configuration byte to switch to (PROJ_3 Command.h). */
+    #define FRAME_DECODER_TYPE_CONFIG   0x10
+
+    /** \brief Command from the host: stage whose statistics are requested (PROJ_3 Command.h). */
+    #define FRAME_DECODER_TYPE_TRACE_QUERY 0x11
+
+    /** \brief Command from the host: send the ring log back (PROJ_3 Command.h), no payload. */
+    #define FRAME_DECODER_TYPE_LOG_DUMP 0x12
+
+    /** \brief Most samples a frame can carry (one-byte deltas). */
+    #define FRAME_DECODER_MAX_SAMPLES   84
+
+    /** \brief Configuration byte reported for bridge frames, which carry none. */
+    #define FRAME_DECODER_CONFIG_UNKNOWN 0xFF
+
+    /** \brief Stream formats. */
+    typedef enum {
+        FRAME_DECODER_BATCHED,          ///< Frames with sequence number and CRC
+        FRAME_DECODER_BRIDGE            ///< A0..C0 Bridge Control Panel frames
+    } FrameDecoder_Format;
+
+    /**
+    *   \brief A decoded frame.
+    *
+    *   Bridge frames are reported as samples frames with one sample, an
+    *   unknown configuration byte, no sequence number and no timestamp.
+    *   Payload and samples are only valid during the callback.
+    */
+    typedef struct {
+        uint8_t type;                   ///< Frame type
+        uint8_t length;                 ///< Payload length
+        uint16_t sequence;              ///< Sequence number
+        uint32_t timestamp;             ///< Timestamp [us]
+        const uint8_t* payload;         ///< Payload bytes
+        uint8_t config;                 ///< Configuration byte of a samples frame
+        uint8_t device;                 ///< Device ID of the sensor, or FRAME_DECODER_DEVICE_UNKNOWN
+        uint8_t sample_count;           ///< Samples in the frame
+        const int16_t (*samples)[3];    ///< x, y, z in mg; NULL if not a decodable samples frame
+    } FrameDecoder_Frame;
+
+    /** \brief Counters of a decoder. */
+    typedef struct {
+        uint64_t bytes;                 ///< Bytes fed
+        uint64_t frames;                ///< Valid frames
+        uint64_t crc_errors;            ///< Candidate frames rejected by the CRC
+        uint64_t bytes_skipped;         ///< Bytes discarded while looking for a frame
+        uint64_t sequence_gaps;         ///< Discontinuities of the sequence number
+        uint64_t frames_lost;           ///< Frames missing according to the sequence numbers
+        uint64_t frames_undecodable;    ///< Samples frames that could not be expanded
+        uint64_t samples;               ///< Samples delivered
+        uint64_t log_pages_lost;        ///< Log pages missing according to their sequence numbers
+    } FrameDecoder_Stats;
+
+    /**
+    *   \brief Counters of a status frame, cumulative since the device booted.
+    */
+    typedef struct {
+        uint32_t sensor_overruns;       ///< Batches read with the sensor overrun flag set
+        uint32_t samples_lost;          ///< Samples overwritten in the sensor (estimate)
+        uint32_t samples_dropped;       ///< Samples in frames the device could not queue
+        uint32_t events_dropped;        ///< Data ready events dropped by the device
+        uint32_t frames_dropped;        ///< Frames dropped with the TX buffer full
+        uint32_t i2c_transactions;
+        uint32_t i2c_errors;
+        uint32_t i2c_naks;
+        uint32_t i2c_arbitration_lost;
+        uint32_t i2c_bus_errors;
+        uint32_t command_errors;        ///< Commands rejected by the device
+        uint32_t i2c_retries;           ///< I2C transactions tried again after a failure
+        uint32_t i2c_recoveries;        ///< I2C bus recoveries (sensor configuration written again)
+        uint32_t cpu_duty_ppm;          ///< Share of the time the CPU has been running [ppm]
+        uint32_t current_ua;            ///< Estimated average current of the PSoC [uA]
+    } FrameDecoder_Status;
+
+    /**
+    *   \brief Parameters of a filter frame: the samples frames that follow come
+    *          at the ODR of \p config divided by \p decimation.
+    */
+    typedef struct {
+        uint8_t config;                 ///< Configuration byte of the sensor
+        uint8_t decimation;             ///< Sensor samples per samples frame sample
+        uint8_t lowpass_order;          ///< 0: no low-pass
+        uint32_t lowpass_mhz;           ///< Low-pass cutoff [mHz]
+        uint8_t highpass_order;         ///< 0: no high-pass
+        uint32_t highpass_mhz;          ///< High-pass cutoff [mHz]
+    } FrameDecoder_Filter;
+
+    /**
+    *   \brief Times [us] from the start of the firmware at which the boot
+    *          phases were reached: sensor ready, configured, first data
+    *          out, deferred diagnostics done.
+    */
+    typedef struct {
+        uint32_t times[FRAME_DECODER_BOOT_PHASES];  ///< FRAME_DECODER_BOOT_NOT_REACHED if not reached
+    } FrameDecoder_Boot;
+
+    /**
+    *   \brief Click or free fall, stamped with the INT1 event by the frame timestamp.
+    */
+    typedef struct {
+        uint8_t config;                 ///< Configuration byte of the sensor
+        uint8_t kind;                   ///< FRAME_DECODER_EVENT_CLICK or FRAME_DECODER_EVENT_FREE_FALL
+        uint8_t axes;                   ///< X, Y, Z in bits 0..2, FRAME_DECODER_EVENT_NEGATIVE
+        int16_t snapshot[3];            ///< Peak of a click, lowest magnitude of a free fall [mg]
+    } FrameDecoder_Event;
+
+    /**
+    *   \brief Page of the ring log: bytes of the frames logged in it, which
+    *          may start or end in the neighbouring pages.
+    */
+    typedef struct {
+        uint32_t sequence;              ///< Page sequence number, +1 for every page
+        uint8_t first;                  ///< Offset of the first frame starting in data, FRAME_DECODER_LOG_NO_FRAME for none
+        uint8_t length;                 ///< Bytes in data
+        const uint8_t* data;            ///< Logged bytes, valid during the callback
+    } FrameDecoder_Log;
+
+    /**
+    *   \brief Statistics of a window, per axis where indexed (definitions in PROJ_3 Features.h).
+    */
+    typedef struct {
+        uint8_t config;                 ///< Configuration byte of the sensor
+        uint16_t samples;               ///< Samples in the window
+        int16_t mean[3];                ///< [mg]
+        uint32_t variance[3];           ///< Population variance [mg^2]
+        uint16_t rms[3];                ///< [mg]
+        uint16_t peak_to_peak[3];       ///< [mg]
+        uint16_t crossings[3];          ///< Crossings of the level of the previous window
+        uint32_t sma;                   ///< Signal magnitude area: mean of |x| + |y| + |z| [mg]
+    } FrameDecoder_Features;
+
+    /**
+    *   \brief Magnitude bins of a spectrum frame: bin k is at k ODR / points Hz.
+    */
+    typedef struct {
+        uint8_t config;                 ///< Configuration byte of the sensor
+        uint16_t points;                ///< Points N of the transform
+        uint8_t axis;                   ///< 0 x, 1 y, 2 z
+        uint16_t first_bin;             ///< Bin of magnitude[0]
+        uint8_t count;                  ///< Bins in the frame
+        uint16_t magnitude[FRAME_DECODER_MAX_BINS];     ///< Sinusoid amplitude [mg/16]
+    } FrameDecoder_Spectrum;
+
+    /**
+    *   \brief Highest peaks of a spectrum per axis, highest first; bin 0 marks no peak.
+    */
+    typedef struct {
+        uint8_t config;                 ///< Configuration byte of the sensor
+        uint16_t points;                ///< Points N of the transform
+        uint8_t count;                  ///< Peaks per axis
+        uint16_t bin[3][FRAME_DECODER_MAX_PEAKS];
+        uint16_t magnitude[3][FRAME_DECODER_MAX_PEAKS];     ///< Sinusoid amplitude [mg/16]
+    } FrameDecoder_Peaks;
+
+    typedef void (*FrameDecoder_Callback)(const FrameDecoder_Frame* frame, void* context);
+
+    /** \brief State of a decoder. */
+    typedef struct {
+        FrameDecoder_Format format;
+        uint8_t buffer[FRAME_DECODER_MAX_FRAME];
+        size_t fill;
+        uint8_t have_sequence;
+        uint16_t next_sequence;
+        uint8_t device;                 ///< Device of the frames, FRAME_DECODER_DEVICE_UNKNOWN after a gap
+        uint8_t devices_seen;           ///< Bit mask of the devices named by device frames
+        uint8_t have_page;              ///< A log page has been fed
+        uint32_t next_page;             ///< Sequence number of the next log page
+        uint8_t have_reference[FRAME_DECODER_MAX_DEVICES];
+        int16_t reference[FRAME_DECODER_MAX_DEVICES][3];
+        int16_t samples[FRAME_DECODER_MAX_SAMPLES][3];
+        FrameDecoder_Callback callback;
+        void* context;
+        FrameDecoder_Stats stats;
+    } FrameDecoder;
+
+    /** \brief Prepare \p decoder for a new stream. */
+    void FrameDecoder_Init(FrameDecoder* decoder, FrameDecoder_Format format,
+                           FrameDecoder_Callback callback, void* context);
+
+    /** \brief Decode \p length bytes, invoking the callback for every valid frame. */
+    void FrameDecoder_Feed(FrameDecoder* decoder, const uint8_t* data, size_t length);
+
+    /**
+    *   \brief Decode the frames logged in a log page (see FrameDecoder_ParseLog()).
+    *
+    *   Pages are expected in sequence: after a gap the frame cut by it is
+    *   thrown away and decoding starts again from the first frame of the
+    *   page. The frames lost with the missing pages show up as a gap in
+    *   their own sequence numbers.
+    */
+    void FrameDecoder_FeedLog(FrameDecoder* decoder, const FrameDecoder_Log* log);
+
+    /**
+    *   \brief Hand over a frame located and checked by the caller.
+    *
+    *   For parsers that find frame boundaries and verify the CRC
+    *   themselves (see BatchDecoder.h): the frame goes through the same
+    *   sequence check, sample expansion, counters and callback as the
+    *   frames found by FrameDecoder_Feed(). Bridge frames must be given
+    *   as one-sample samples frames.
+    */
+    void FrameDecoder_Accept(FrameDecoder* decoder, FrameDecoder_Frame* frame);
+
+    /**
+    *   \brief Account for the sequence number of a batched frame.
+    *
+    *   The check done by FrameDecoder_Accept(), for parsers that expand
+    *   samples frames themselves: a gap is counted, breaks the delta
+    *   chains and may leave the device unknown.
+    */
+    void FrameDecoder_CheckSequence(FrameDecoder* decoder, uint16_t sequence);
+
+    /**
+    *   \brief Read the counters of a FRAME_DECODER_TYPE_STATUS frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a status frame.
+    */
+    int FrameDecoder_ParseStatus(const FrameDecoder_Frame* frame, FrameDecoder_Status* status);
+
+    /**
+    *   \brief Read the parameters of a FRAME_DECODER_TYPE_FILTER frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a filter frame.
+    */
+    int FrameDecoder_ParseFilter(const FrameDecoder_Frame* frame, FrameDecoder_Filter* filter);
+
+    /**
+    *   \brief Read the phase times of a FRAME_DECODER_TYPE_BOOT frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a boot frame.
+    */
+    int FrameDecoder_ParseBoot(const FrameDecoder_Frame* frame, FrameDecoder_Boot* boot);
+
+    /**
+    *   \brief Read a FRAME_DECODER_TYPE_EVENT frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a valid event frame.
+    */
+    int FrameDecoder_ParseEvent(const FrameDecoder_Frame* frame, FrameDecoder_Event* event);
+
+    /**
+    *   \brief Read a FRAME_DECODER_TYPE_LOG frame.
+    *
+    *   The logged bytes are a stream of frames of their own, to be fed to
+    *   another decoder; after a gap in the page sequence numbers that
+    *   decoder is better started again from \p log->first.
+    *   \retval Returns false (0) if \p frame is not a valid log frame.
+    */
+    int FrameDecoder_ParseLog(const FrameDecoder_Frame* frame, FrameDecoder_Log* log);
+
+    /**
+    *   \brief Read the statistics of a FRAME_DECODER_TYPE_FEATURES frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a features frame.
+    */
+    int FrameDecoder_ParseFeatures(const FrameDecoder_Frame* frame, FrameDecoder_Features* features);
+
+    /**
+    *   \brief Read the bins of a FRAME_DECODER_TYPE_SPECTRUM frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a valid spectrum frame.
+    */
+    int FrameDecoder_ParseSpectrum(const FrameDecoder_Frame* frame, FrameDecoder_Spectrum* spectrum);
+
+    /**
+    *   \brief Read the peaks of a FRAME_DECODER_TYPE_PEAKS frame.
+    *
+    *   \retval Returns false (0) if \p frame is not a valid peaks frame.
+    */
+    int FrameDecoder_ParsePeaks(const FrameDecoder_Frame* frame, FrameDecoder_Peaks* peaks);
+
+    /**
+    *   \brief ODR [Hz] of a configuration byte (LIS3DH CTRL_REG1 ODR and mode), 0 if not valid.
+    */
+    unsigned FrameDecoder_OdrHz(uint8_t config);
+
+    /** \brief CRC-16/CCITT-FALSE of \p length bytes (bit-wise reference implementation). */
+    uint16_t FrameDecoder_Crc16(const uint8_t* data, size_t length);
+
+#endif // FRAME_DECODER_H
+/* [] END OF FILE */
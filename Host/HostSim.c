@@ -0,0 +1,360 @@
+/**
+*   \file HostSim.c
+*   \brief Discrete-time simulator used to run the firmware on a host.
+*/
+#include "HostSim.h"
+
+#include <setjmp.h>
+#include <signal.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+HostSim_Config HostSim_config;
+HostSim_Stats  HostSim_stats;
+
+static uint64_t now;
+static HostSim_Event* events;
+static uint8_t irq_enabled;
+static uint8_t in_isr;
+static uint32_t rng_state;
+
+static uint8_t running;
+static uint64_t deadline;
+static sigjmp_buf exit_jmp;
+
+// Spin watchdog: detects firmware loops polling a variable that only an ISR changes
+static volatile sig_atomic_t in_sim;
+static volatile uint32_t progress;
+static uint32_t watchdog_progress;
+
+    void HostSim_Reset(void)
+    {
+        HostSim_config.cpu_call_ns = 500;
+        HostSim_config.i2c_bus_khz = 100;
+        HostSim_config.i2c_byte_overhead_ns = 1000;
+        HostSim_config.i2c_isr_overhead_ns = 3000;
+        HostSim_config.uart_baud = 9600;
+        HostSim_config.uart_tx_buffer_size = 64;
+        HostSim_config.uart_rx_buffer_size = 16;
+        HostSim_config.uart_putchar_ns = 2000;
+        HostSim_config.uart_isr_ns = 2500;
+        HostSim_config.timer_period_ns = 10000000ull;
+        HostSim_config.nak_rate_ppm = 0;
+        HostSim_config.alt_active_wakeup_ns = 250;
+        HostSim_config.sleep_wakeup_ns = 15000;
+        HostSim_config.clock_restore_ns = 250000;
+        HostSim_config.flash_row_write_ns = 15000000;
+        HostSim_config.seed = 1;
+
+        HostSim_stats.cpu_busy_ns = 0;
+        HostSim_stats.cpu_idle_ns = 0;
+        HostSim_stats.isr_count = 0;
+
+        // Drop every registered event: peripherals register again on start
+        while (events != NULL)
+        {
+            HostSim_Event* next = events->next;
+            events->armed = 0;
+            events->next = NULL;
+            events = next;
+        }
+        now = 0;
+        irq_enabled = 0;
+        in_isr = 0;
+        rng_state = 0;
+        running = 0;
+    }
+
+    uint64_t HostSim_Now(void)
+    {
+        progress++;
+        return now;
+    }
+
+    static void CheckDeadline(void)
+    {
+        if (running && now >= deadline)
+        {
+            siglongjmp(exit_jmp, 1);
+        }
+    }
+
+    static void AdvanceTo(uint64_t target, uint8_t idle)
+    {
+        if (target <= now)
+        {
+            return;
+        }
+        if (running && target > deadline)
+        {
+            target = deadline;
+        }
+        if (idle)
+        {
+            HostSim_stats.cpu_idle_ns += target - now;
+        }
+        else
+        {
+            HostSim_stats.cpu_busy_ns += target - now;
+        }
+        now = target;
+    }
+
+    static uint8_t CanFire(const HostSim_Event* event)
+    {
+        return !event->is_irq || (irq_enabled && !in_isr);
+    }
+
+    // Earliest armed event not later than limit that can be dispatched now
+    static HostSim_Event* Earliest(uint64_t limit)
+    {
+        HostSim_Event* best = NULL;
+        for (HostSim_Event* event = events; event != NULL; event = event->next)
+        {
+            if (event->armed && event->at <= limit && CanFire(event) &&
+                (best == NULL || event->at < best->at))
+            {
+                best = event;
+            }
+        }
+        return best;
+    }
+
+    static void Fire(HostSim_Event* event, uint8_t idle)
+    {
+        AdvanceTo(event->at, idle);
+        CheckDeadline();
+        event->armed = 0;
+        if (event->is_irq)
+        {
+            HostSim_stats.isr_count++;
+            in_isr = 1;
+            event->fire(event);
+            in_isr = 0;
+        }
+        else
+        {
+            event->fire(event);
+        }
+    }
+
+    static void Dispatch(uint64_t limit, uint8_t idle)
+    {
+        HostSim_Event* event;
+        while ((event = Earliest(limit)) != NULL)
+        {
+            Fire(event, idle);
+        }
+    }
+
+    void HostSim_Busy(uint64_t ns)
+    {
+        uint64_t target = now + ns;
+        in_sim++;
+        progress++;
+        Dispatch(target, 0);
+        AdvanceTo(target, 0);
+        in_sim--;
+        CheckDeadline();
+    }
+
+    // Earliest armed interrupt, dispatchable or not
+    static HostSim_Event* EarliestInterrupt(void)
+    {
+        HostSim_Event* best = NULL;
+        for (HostSim_Event* event = events; event != NULL; event = event->next)
+        {
+            if (event->armed && event->is_irq && (best == NULL || event->at < best->at))
+            {
+                best = event;
+            }
+        }
+        return best;
+    }
+
+    static void WaitForEvent(uint8_t idle)
+    {
+        for (;;)
+        {
+            // Anything already due (pending interrupts included) wakes the core at once
+            HostSim_Event* event = Earliest(now);
+            if (event == NULL)
+            {
+                event = Earliest(UINT64_MAX);
+            }
+            // A masked interrupt wakes a halted core but is left pending
+            HostSim_Event* masked = idle && !irq_enabled ? EarliestInterrupt() : NULL;
+            if (masked != NULL && (event == NULL || masked->at <= event->at))
+            {
+                AdvanceTo(masked->at, idle);
+                CheckDeadline();
+                return;
+            }
+            if (event == NULL)
+            {
+                // Nothing will ever wake the core: sleep until the deadline
+                if (running)
+                {
+                    AdvanceTo(deadline, idle);
+                    CheckDeadline();
+                }
+                return;
+            }
+            Fire(event, idle);
+            if (event->is_irq)
+            {
+                return;
+            }
+        }
+    }
+
+    void HostSim_WaitForEvent(void)
+    {
+        in_sim++;
+        progress++;
+        WaitForEvent(1);
+        in_sim--;
+    }
+
+    void HostSim_Idle(uint64_t ns)
+    {
+        uint64_t target = now + ns;
+        in_sim++;
+        progress++;
+        Dispatch(target, 1);
+        AdvanceTo(target, 1);
+        in_sim--;
+        CheckDeadline();
+    }
+
+    /*
+    *   A firmware loop that polls a flag set by an ISR never calls into the
+    *   simulator, so the clock would never reach the interrupt. When the
+    *   host CPU has been spinning inside the firmware for a whole watchdog
+    *   tick, the core is advanced (as busy time) to the next event.
+    */
+    static void SpinWatchdog(int signal_number)
+    {
+        (void)signal_number;
+        if (!running || in_sim || progress != watchdog_progress)
+        {
+            watchdog_progress = progress;
+            return;
+        }
+        in_sim++;
+        WaitForEvent(0);
+        in_sim--;
+        watchdog_progress = ++progress;
+    }
+
+    static void SetWatchdog(uint8_t enable)
+    {
+        struct itimerval tick = { { 0, 0 }, { 0, 0 } };
+        if (enable)
+        {
+            signal(SIGVTALRM, SpinWatchdog);
+            tick.it_interval.tv_usec = 1000;
+            tick.it_value.tv_usec = 1000;
+        }
+        setitimer(ITIMER_VIRTUAL, &tick, NULL);
+    }
+
+    void HostSim_Register(HostSim_Event* event)
+    {
+        for (HostSim_Event* e = events; e != NULL; e = e->next)
+        {
+            if (e == event)
+            {
+                return;
+            }
+        }
+        event->armed = 0;
+        event->next = events;
+        events = event;
+    }
+
+    void HostSim_Arm(HostSim_Event* event, uint64_t at)
+    {
+        event->at = at;
+        event->armed = 1;
+    }
+
+    void HostSim_Disarm(HostSim_Event* event)
+    {
+        event->armed = 0;
+    }
+
+    void HostSim_SetGlobalInterrupts(uint8_t enable)
+    {
+        irq_enabled = enable ? 1 : 0;
+        progress++;
+        if (irq_enabled && !in_sim)
+        {
+            // Interrupts that became pending while masked are taken now
+            in_sim++;
+            Dispatch(now, 0);
+            in_sim--;
+            CheckDeadline();
+        }
+    }
+
+    uint8_t HostSim_GetGlobalInterrupts(void)
+    {
+        return irq_enabled;
+    }
+
+    uint32_t HostSim_Random(void)
+    {
+        // xorshift32, seeded lazily so that the seed can be set after reset
+        if (rng_state == 0)
+        {
+            rng_state = HostSim_config.seed ? HostSim_config.seed : 1;
+        }
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+        return rng_state;
+    }
+
+    uint8_t HostSim_Chance(uint32_t ppm)
+    {
+        return ppm != 0 && (HostSim_Random() % 1000000u) < ppm;
+    }
+
+    /*
+    *   Entry hook of -finstrument-functions: charges the configured CPU
+    *   cost of a firmware function call while a run is in progress.
+    */
+    void __cyg_profile_func_enter(void* function, void* call_site)
+    {
+        (void)function;
+        (void)call_site;
+        if (running && HostSim_config.cpu_call_ns != 0)
+        {
+            HostSim_Busy(HostSim_config.cpu_call_ns);
+        }
+    }
+
+    void __cyg_profile_func_exit(void* function, void* call_site)
+    {
+        (void)function;
+        (void)call_site;
+    }
+
+    uint64_t HostSim_Run(int (*entry)(void), uint64_t duration_ns)
+    {
+        deadline = now + duration_ns;
+        running = 1;
+        if (sigsetjmp(exit_jmp, 1) == 0)
+        {
+            SetWatchdog(1);
+            entry();
+        }
+        SetWatchdog(0);
+        running = 0;
+        in_isr = 0;
+        in_sim = 0;
+        return now;
+    }
+
+/* [] END OF FILE */
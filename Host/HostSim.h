@@ -0,0 +1,134 @@
+/**
+*   \file HostSim.h
+*   \brief Discrete-time simulator used to run the firmware on a host.
+*
+*   The simulator owns a nanosecond clock that only advances when the
+*   firmware waits (blocking bus transfers, UART back-pressure, CyDelay()
+*   and so on) or does work: firmware sources are built with
+*   -finstrument-functions and every call is charged a fixed CPU cost, so
+*   polling loops see time go by. Peripherals arm events on the clock; interrupt events are
+*   dispatched whenever the clock moves past them and global interrupts
+*   are enabled, which mimics the way ISRs preempt the main loop on the
+*   Cortex-M3.
+*/
+#ifndef HOST_SIM_H
+    #define HOST_SIM_H
+
+    #include <stdint.h>
+
+    /**
+    *   \brief Simulator configuration.
+    *
+    *   Filled with defaults by HostSim_Reset() and changed by the runner
+    *   before the firmware is started.
+    */
+    typedef struct {
+        uint32_t cpu_call_ns;           ///< CPU time charged to every firmware function call
+        uint32_t i2c_bus_khz;           ///< I2C SCL frequency
+        uint32_t i2c_byte_overhead_ns;  ///< Firmware/controller gap added to every byte
+        uint32_t i2c_isr_overhead_ns;   ///< CPU time of one I2C_Master interrupt (buffer API)
+        uint32_t uart_baud;             ///< UART_Debug baud rate
+        uint32_t uart_tx_buffer_size;   ///< UART_Debug software TX buffer size
+        uint32_t uart_rx_buffer_size;   ///< UART_Debug software RX buffer size
+        uint32_t uart_putchar_ns;       ///< CPU time of one UART_Debug_PutChar() call
+        uint32_t uart_isr_ns;           ///< CPU time of the TX (or RX) interrupt moving one byte
+        uint64_t timer_period_ns;       ///< Timer_LISD3H terminal count period
+        uint32_t nak_rate_ppm;          ///< Probability of an injected address NAK
+        uint32_t alt_active_wakeup_ns;  ///< Alternate Active to Active wake-up
+        uint32_t sleep_wakeup_ns;       ///< Sleep to Active wake-up
+        uint32_t clock_restore_ns;      ///< PLL lock waited for by CyPmRestoreClocks()
+        uint32_t flash_row_write_ns;    ///< Erase and program of one flash row (Em_EEPROM)
+        uint32_t seed;                  ///< Seed of the simulator random generator
+    } HostSim_Config;
+
+    /**
+    *   \brief An event armed on the simulated clock.
+    *
+    *   When the clock reaches \p at the \p fire callback is invoked. Events
+    *   flagged as interrupts are held pending while global interrupts are
+    *   disabled or another interrupt is running.
+    */
+    typedef struct HostSim_Event {
+        uint64_t at;                    ///< Absolute firing time [ns]
+        void (*fire)(struct HostSim_Event* event);  ///< Callback run when the event fires
+        void* context;                  ///< Free for the owner of the event
+        uint8_t is_irq;                 ///< Non-zero if the event is an interrupt
+        uint8_t armed;                  ///< Non-zero while the event is scheduled
+        struct HostSim_Event* next;     ///< Registration list link
+    } HostSim_Event;
+
+    /**
+    *   \brief Time accounting collected during a run.
+    */
+    typedef struct {
+        uint64_t cpu_busy_ns;           ///< CPU time: blocking waits and charged function calls
+        uint64_t cpu_idle_ns;           ///< Time spent waiting for interrupts
+        uint64_t isr_count;             ///< Number of interrupt events dispatched
+    } HostSim_Stats;
+
+    extern HostSim_Config HostSim_config;
+    extern HostSim_Stats  HostSim_stats;
+
+    /** \brief Restore the default configuration and clear clock, events and statistics. */
+    void HostSim_Reset(void);
+
+    /** \brief Current simulated time [ns]. */
+    uint64_t HostSim_Now(void);
+
+    /**
+    *   \brief Let the CPU spin for \p ns nanoseconds.
+    *
+    *   The time is accounted as busy and every event falling inside the
+    *   interval is dispatched in order.
+    */
+    void HostSim_Busy(uint64_t ns);
+
+    /**
+    *   \brief Sleep until the next armed event and dispatch it.
+    *
+    *   The time is accounted as idle. Returns immediately if an interrupt
+    *   is already pending. With global interrupts disabled the interrupt
+    *   wakes the core without being dispatched, like WFI with PRIMASK set.
+    */
+    void HostSim_WaitForEvent(void);
+
+    /**
+    *   \brief Keep the core halted for \p ns nanoseconds (power mode wake-up).
+    *
+    *   The time is accounted as idle; events falling inside the interval
+    *   are dispatched, interrupts only if enabled.
+    */
+    void HostSim_Idle(uint64_t ns);
+
+    /** \brief Register an event with the simulator (once, before arming it). */
+    void HostSim_Register(HostSim_Event* event);
+
+    /** \brief Schedule \p event at absolute time \p at. */
+    void HostSim_Arm(HostSim_Event* event, uint64_t at);
+
+    /** \brief Remove \p event from the schedule. */
+    void HostSim_Disarm(HostSim_Event* event);
+
+    /** \brief Enable (1) or disable (0) interrupt dispatching. */
+    void HostSim_SetGlobalInterrupts(uint8_t enable);
+
+    /** \brief Read the global interrupt enable state. */
+    uint8_t HostSim_GetGlobalInterrupts(void);
+
+    /** \brief Pseudo-random 32-bit value from the simulator generator. */
+    uint32_t HostSim_Random(void);
+
+    /** \brief Return 1 with the given probability expressed in parts per million. */
+    uint8_t HostSim_Chance(uint32_t ppm);
+
+    /**
+    *   \brief Run a firmware entry point for \p duration_ns of simulated time.
+    *
+    *   Firmware main loops never return, so the simulator unwinds back to
+    *   the caller as soon as the clock passes the deadline.
+    *   \retval Simulated time at which the run stopped.
+    */
+    uint64_t HostSim_Run(int (*entry)(void), uint64_t duration_ns);
+
+#endif // HOST_SIM_H
+/* [] END OF FILE */
@@ -0,0 +1,427 @@
+/**
+*   \file I2C_Master_Sim.c
+*   \brief Simulated I2C bus behind the I2C_Master stand-in API.
+*/
+#include "I2C_Master_Sim.h"
+#include "I2C_Master.h"
+#include "SCL_1.h"
+#include "SDA_1.h"
+#include "HostSim.h"
+
+#include <stddef.h>
+
+I2C_Master_Sim_Stats I2C_Master_Sim_stats;
+
+static LIS3DH_Model* devices[I2C_MASTER_SIM_MAX_DEVICES];
+static uint8_t device_count;
+
+// Bus state of the manual master API
+static uint8_t started;
+static LIS3DH_Model* selected;
+
+// Buffer API transfer, advanced by one interrupt per byte
+static HostSim_Event xfer_event;
+static uint8_t xfer_active;
+static uint8_t xfer_read;
+static uint8_t xfer_mode;
+static uint8_t xfer_address;
+static uint8_t xfer_address_phase;
+static uint8* xfer_buffer;
+static uint8_t xfer_count;
+static uint8_t xfer_index;
+static uint8_t bus_held;
+static uint8 mstr_status;
+
+// Lines driven by the firmware while their bypass bit is clear (1 = released)
+reg8 I2C_Master_Sim_scl_bypass;
+reg8 I2C_Master_Sim_sda_bypass;
+static uint8_t scl_out;
+static uint8_t sda_out;
+
+// Injected faults: SCL clocks until a stuck slave releases SDA, end of the NAK window
+static uint8_t sda_stuck_clocks;
+static uint64_t nak_until_ns;
+
+// Defined by the firmware when I2C_Master_ISR_EXIT_CALLBACK is enabled
+extern void I2C_Master_ISR_ExitCallback(void) __attribute__((weak));
+
+    void I2C_Master_Sim_Reset(void)
+    {
+        device_count = 0;
+        started = 0;
+        selected = NULL;
+        xfer_active = 0;
+        bus_held = 0;
+        mstr_status = 0;
+        I2C_Master_Sim_scl_bypass = SCL_1_MASK;
+        I2C_Master_Sim_sda_bypass = SDA_1_MASK;
+        scl_out = 1;
+        sda_out = 1;
+        sda_stuck_clocks = 0;
+        nak_until_ns = 0;
+        I2C_Master_Sim_stats = (I2C_Master_Sim_Stats){ 0 };
+    }
+
+    void I2C_Master_Sim_StickSda(uint8_t clocks)
+    {
+        sda_stuck_clocks = clocks;
+    }
+
+    void I2C_Master_Sim_NakFor(uint64_t ns)
+    {
+        nak_until_ns = HostSim_Now() + ns;
+    }
+
+    uint8_t I2C_Master_Sim_IsSdaStuck(void)
+    {
+        return sda_stuck_clocks > 0;
+    }
+
+    void I2C_Master_Sim_Attach(LIS3DH_Model* device)
+    {
+        if (device_count < I2C_MASTER_SIM_MAX_DEVICES)
+        {
+            devices[device_count++] = device;
+        }
+    }
+
+    uint64_t I2C_Master_Sim_BitNs(void)
+    {
+        return 1000000ull / HostSim_config.i2c_bus_khz;
+    }
+
+    uint64_t I2C_Master_Sim_ByteNs(void)
+    {
+        return 9 * I2C_Master_Sim_BitNs() + HostSim_config.i2c_byte_overhead_ns;
+    }
+
+    static void BusTime(uint64_t ns)
+    {
+        I2C_Master_Sim_stats.bus_busy_ns += ns;
+        HostSim_Busy(ns);
+    }
+
+    // Bus time of a buffer transfer: the CPU is free meanwhile
+    static void ScheduleByte(uint64_t ns)
+    {
+        I2C_Master_Sim_stats.bus_busy_ns += ns;
+        HostSim_Arm(&xfer_event, HostSim_Now() + ns);
+    }
+
+    static LIS3DH_Model* Find(uint8_t address)
+    {
+        for (uint8_t i = 0; i < device_count; i++)
+        {
+            if (devices[i]->address == address)
+            {
+                return devices[i];
+            }
+        }
+        return NULL;
+    }
+
+    // Device acknowledging the address phase, NULL for a NAK (absent, booting or injected)
+    static LIS3DH_Model* Acknowledge(uint8_t address)
+    {
+        LIS3DH_Model* device = Find(address & 0x7F);
+        if (device == NULL || !LIS3DH_Model_IsReady(device) || HostSim_Now() < nak_until_ns ||
+            HostSim_Chance(HostSim_config.nak_rate_ppm))
+        {
+            I2C_Master_Sim_stats.address_naks++;
+            return NULL;
+        }
+        return device;
+    }
+
+    // Address phase shared by START and RESTART
+    static uint8 Address(uint8 slaveAddress, uint8 restart)
+    {
+        BusTime(I2C_Master_Sim_BitNs() + I2C_Master_Sim_ByteNs());
+        I2C_Master_Sim_stats.bytes++;
+
+        LIS3DH_Model* device = Acknowledge(slaveAddress);
+        if (device == NULL)
+        {
+            selected = NULL;
+            return I2C_Master_MSTR_ERR_LB_NAK;
+        }
+        if (!restart || selected != device)
+        {
+            LIS3DH_Model_BeginTransfer(device);
+        }
+        else
+        {
+            LIS3DH_Model_Sync(device);
+        }
+        selected = device;
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    void I2C_Master_Start(void)
+    {
+        started = 0;
+        selected = NULL;
+    }
+
+    void I2C_Master_Stop(void)
+    {
+        // Disabling the block aborts a buffer transfer and lets go of the bus
+        HostSim_Disarm(&xfer_event);
+        xfer_active = 0;
+        bus_held = 0;
+        mstr_status = 0;
+        started = 0;
+        selected = NULL;
+    }
+
+    // SDA held low by a stuck slave, or pins driven away from the controller
+    static uint8_t BusBlocked(void)
+    {
+        return sda_stuck_clocks > 0 || !(I2C_Master_Sim_scl_bypass & SCL_1_MASK) ||
+               !(I2C_Master_Sim_sda_bypass & SDA_1_MASK);
+    }
+
+    uint8 I2C_Master_MasterSendStart(uint8 slaveAddress, uint8 R_nW)
+    {
+        (void)R_nW;
+        if (started || xfer_active || bus_held || BusBlocked())
+        {
+            return I2C_Master_MSTR_BUS_BUSY;
+        }
+        started = 1;
+        I2C_Master_Sim_stats.transactions++;
+        return Address(slaveAddress, 0);
+    }
+
+    uint8 I2C_Master_MasterSendRestart(uint8 slaveAddress, uint8 R_nW)
+    {
+        (void)R_nW;
+        if (!started)
+        {
+            return I2C_Master_MSTR_NOT_READY;
+        }
+        return Address(slaveAddress, 1);
+    }
+
+    uint8 I2C_Master_MasterSendStop(void)
+    {
+        if (!started && !bus_held)
+        {
+            return I2C_Master_MSTR_NOT_READY;
+        }
+        BusTime(I2C_Master_Sim_BitNs());
+        started = 0;
+        bus_held = 0;
+        selected = NULL;
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    uint8 I2C_Master_MasterWriteByte(uint8 theByte)
+    {
+        if (!started)
+        {
+            return I2C_Master_MSTR_NOT_READY;
+        }
+        BusTime(I2C_Master_Sim_ByteNs());
+        I2C_Master_Sim_stats.bytes++;
+        if (selected == NULL)
+        {
+            return I2C_Master_MSTR_ERR_LB_NAK;
+        }
+        LIS3DH_Model_WriteByte(selected, theByte);
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    uint8 I2C_Master_MasterReadByte(uint8 acknNak)
+    {
+        (void)acknNak;
+        if (!started)
+        {
+            return 0xFF;
+        }
+        BusTime(I2C_Master_Sim_ByteNs());
+        I2C_Master_Sim_stats.bytes++;
+        if (selected == NULL)
+        {
+            // Nobody drives SDA: the pull-ups read back as ones
+            return 0xFF;
+        }
+        return LIS3DH_Model_ReadByte(selected);
+    }
+
+    static void FinishTransfer(void)
+    {
+        xfer_active = 0;
+        mstr_status &= (uint8)~I2C_Master_MSTAT_XFER_INP;
+        mstr_status |= xfer_read ? I2C_Master_MSTAT_RD_CMPLT : I2C_Master_MSTAT_WR_CMPLT;
+        if (xfer_mode & I2C_Master_MODE_NO_STOP)
+        {
+            // Keep the bus for a repeated start, also when the slave NAKed (as the component)
+            mstr_status |= I2C_Master_MSTAT_XFER_HALT;
+            bus_held = 1;
+        }
+        else
+        {
+            I2C_Master_Sim_stats.bus_busy_ns += I2C_Master_Sim_BitNs();
+            bus_held = 0;
+            selected = NULL;
+        }
+    }
+
+    static void TransferInterrupt(HostSim_Event* event)
+    {
+        if (xfer_address_phase)
+        {
+            xfer_address_phase = 0;
+            I2C_Master_Sim_stats.bytes++;
+            LIS3DH_Model* device = Acknowledge(xfer_address);
+            if (device == NULL)
+            {
+                mstr_status |= I2C_Master_MSTAT_ERR_ADDR_NAK | I2C_Master_MSTAT_ERR_XFER;
+                FinishTransfer();
+            }
+            else
+            {
+                if (!(xfer_mode & I2C_Master_MODE_REPEAT_START) || selected != device)
+                {
+                    LIS3DH_Model_BeginTransfer(device);
+                }
+                else
+                {
+                    LIS3DH_Model_Sync(device);
+                }
+                selected = device;
+                ScheduleByte(I2C_Master_Sim_ByteNs());
+            }
+        }
+        else
+        {
+            I2C_Master_Sim_stats.bytes++;
+            if (xfer_read)
+            {
+                xfer_buffer[xfer_index] = LIS3DH_Model_ReadByte(selected);
+            }
+            else
+            {
+                LIS3DH_Model_WriteByte(selected, xfer_buffer[xfer_index]);
+            }
+            if (++xfer_index == xfer_count)
+            {
+                FinishTransfer();
+            }
+            else
+            {
+                ScheduleByte(I2C_Master_Sim_ByteNs());
+            }
+        }
+
+        HostSim_Busy(HostSim_config.i2c_isr_overhead_ns);
+        if (I2C_Master_ISR_ExitCallback != NULL)
+        {
+            I2C_Master_ISR_ExitCallback();
+        }
+    }
+
+    static uint8 StartTransfer(uint8 slaveAddress, uint8* buffer, uint8 cnt, uint8 mode, uint8 read)
+    {
+        if (started || xfer_active || (BusBlocked() && !(mode & I2C_Master_MODE_REPEAT_START)))
+        {
+            return I2C_Master_MSTR_BUS_BUSY;
+        }
+        if ((mode & I2C_Master_MODE_REPEAT_START) ? !bus_held : bus_held)
+        {
+            return I2C_Master_MSTR_NOT_READY;
+        }
+        if (cnt == 0)
+        {
+            return I2C_Master_MSTR_NOT_READY;
+        }
+        if (!(mode & I2C_Master_MODE_REPEAT_START))
+        {
+            I2C_Master_Sim_stats.transactions++;
+        }
+
+        xfer_event.fire = TransferInterrupt;
+        xfer_event.is_irq = 1;
+        HostSim_Register(&xfer_event);
+
+        xfer_active = 1;
+        xfer_read = read;
+        xfer_mode = mode;
+        xfer_address = slaveAddress;
+        xfer_address_phase = 1;
+        xfer_buffer = buffer;
+        xfer_count = cnt;
+        xfer_index = 0;
+        bus_held = 0;
+        mstr_status &= (uint8)~(I2C_Master_MSTAT_XFER_HALT |
+                                (read ? I2C_Master_MSTAT_RD_CMPLT : I2C_Master_MSTAT_WR_CMPLT));
+        mstr_status |= I2C_Master_MSTAT_XFER_INP;
+
+        // (Repeated) start condition followed by the address byte
+        ScheduleByte(I2C_Master_Sim_BitNs() + I2C_Master_Sim_ByteNs());
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8 * wrData, uint8 cnt, uint8 mode)
+    {
+        return StartTransfer(slaveAddress, wrData, cnt, mode, 0);
+    }
+
+    uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8 * rdData, uint8 cnt, uint8 mode)
+    {
+        return StartTransfer(slaveAddress, rdData, cnt, mode, 1);
+    }
+
+    uint8 I2C_Master_MasterStatus(void)
+    {
+        return mstr_status;
+    }
+
+    uint8 I2C_Master_MasterClearStatus(void)
+    {
+        uint8 status = mstr_status;
+        // The transfer-in-progress and halt bits reflect the bus, not events
+        mstr_status &= I2C_Master_MSTAT_XFER_INP | I2C_Master_MSTAT_XFER_HALT;
+        return status;
+    }
+
+    // Bus lines under firmware control (bypass bit clear), open drain with pull-ups
+    void SCL_1_Write(uint8 value)
+    {
+        // The data register only reaches the line with the bypass bit clear
+        if (!(I2C_Master_Sim_scl_bypass & SCL_1_MASK) && value && !scl_out)
+        {
+            // Rising edge: the stuck slave shifts out one more bit
+            I2C_Master_Sim_stats.recovery_clocks++;
+            if (sda_stuck_clocks > 0)
+            {
+                sda_stuck_clocks--;
+            }
+        }
+        scl_out = value != 0;
+    }
+
+    uint8 SCL_1_Read(void)
+    {
+        return (I2C_Master_Sim_scl_bypass & SCL_1_MASK) ? 1 : scl_out;
+    }
+
+    void SDA_1_Write(uint8 value)
+    {
+        if (!(I2C_Master_Sim_sda_bypass & SDA_1_MASK) && value && !sda_out && scl_out &&
+            sda_stuck_clocks == 0)
+        {
+            // STOP condition: every slave goes back to waiting for a START
+            selected = NULL;
+        }
+        sda_out = value != 0;
+    }
+
+    uint8 SDA_1_Read(void)
+    {
+        uint8_t driven = (I2C_Master_Sim_sda_bypass & SDA_1_MASK) ? 1 : sda_out;
+        return driven && sda_stuck_clocks == 0;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,58 @@
+/**
+*   \file I2C_Master_Sim.h
+*   \brief Simulated I2C bus behind the I2C_Master stand-in API.
+*
+*   LIS3DH models are attached to the bus at their 7-bit address. Every
+*   bus condition and byte is charged to the host simulator clock using
+*   the configured SCL frequency and per-byte overhead.
+*
+*   Faults can be injected on the bus: a slave stuck in the middle of a
+*   read keeps SDA low (the controller then finds the bus busy) until the
+*   firmware clocks SCL through the SCL_1/SDA_1 pins, and a NAK window
+*   makes every address phase fail for a while. A LIS3DH_Model rebooting
+*   (LIS3DH_Model_Reboot()) NAKs its address until the boot is over.
+*/
+#ifndef I2C_MASTER_SIM_H
+    #define I2C_MASTER_SIM_H
+
+    #include <stdint.h>
+    #include "LIS3DH_Model.h"
+
+    #define I2C_MASTER_SIM_MAX_DEVICES 8
+
+    /**
+    *   \brief Bus counters.
+    */
+    typedef struct {
+        uint64_t transactions;          ///< START conditions (a RESTART is part of a transaction)
+        uint64_t bytes;                 ///< Data and address bytes clocked on the bus
+        uint64_t address_naks;          ///< Addresses not acknowledged
+        uint64_t bus_busy_ns;           ///< Time the bus was owned by the master
+        uint64_t recovery_clocks;       ///< SCL pulses driven by the firmware through SCL_1
+    } I2C_Master_Sim_Stats;
+
+    extern I2C_Master_Sim_Stats I2C_Master_Sim_stats;
+
+    /** \brief Detach every device and clear the counters. */
+    void I2C_Master_Sim_Reset(void);
+
+    /** \brief Attach a sensor model to the bus. */
+    void I2C_Master_Sim_Attach(LIS3DH_Model* device);
+
+    /** \brief Hold SDA low until the firmware has clocked SCL \p clocks times. */
+    void I2C_Master_Sim_StickSda(uint8_t clocks);
+
+    /** \brief Check if SDA is still held low by I2C_Master_Sim_StickSda(). */
+    uint8_t I2C_Master_Sim_IsSdaStuck(void);
+
+    /** \brief Fail every address phase for the next \p ns. */
+    void I2C_Master_Sim_NakFor(uint64_t ns);
+
+    /** \brief Duration of one SCL period [ns]. */
+    uint64_t I2C_Master_Sim_BitNs(void);
+
+    /** \brief Duration of one acknowledged byte including the configured overhead [ns]. */
+    uint64_t I2C_Master_Sim_ByteNs(void);
+
+#endif // I2C_MASTER_SIM_H
+/* [] END OF FILE */
@@ -0,0 +1,30 @@
+/**
+*   \file ISR_DataReady_Sim.c
+*   \brief Simulated ISR_DataReady interrupt component.
+*/
+#include "ISR_DataReady.h"
+#include "ISR_DataReady_Sim.h"
+
+#include <stddef.h>
+
+static cyisraddress data_ready_isr;
+
+    void ISR_DataReady_Sim_Raise(void)
+    {
+        if (data_ready_isr != NULL)
+        {
+            data_ready_isr();
+        }
+    }
+
+    void ISR_DataReady_StartEx(cyisraddress address)
+    {
+        data_ready_isr = address;
+    }
+
+    void ISR_DataReady_Stop(void)
+    {
+        data_ready_isr = NULL;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,16 @@
+/**
+*   \file ISR_DataReady_Sim.h
+*   \brief Simulated ISR_DataReady interrupt component.
+*
+*   The interrupt is raised either by the Timer_LISD3H terminal count or
+*   by a rising edge of the LIS3DH INT1 pin, depending on which of the
+*   two the firmware starts.
+*/
+#ifndef ISR_DATAREADY_SIM_H
+    #define ISR_DATAREADY_SIM_H
+
+    /** \brief Run the DataReady handler, if one has been started (interrupt context). */
+    void ISR_DataReady_Sim_Raise(void);
+
+#endif // ISR_DATAREADY_SIM_H
+/* [] END OF FILE */
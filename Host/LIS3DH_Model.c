@@ -0,0 +1,602 @@
+/**
+*   \file LIS3DH_Model.c
+*   \brief Register-level model of the LIS3DH accelerometer.
+*/
+#include "LIS3DH_Model.h"
+#include "HostSim.h"
+
+#include <math.h>
+#include <string.h>
+
+// Output data rates selected by CTRL_REG1[7:4], in mHz (normal/HR and low-power)
+static const uint32_t odr_mhz[16] = {
+    0, 1000, 10000, 25000, 50000, 100000, 200000, 400000,
+    0, 1344000, 0, 0, 0, 0, 0, 0
+};
+static const uint32_t odr_lp_mhz[16] = {
+    0, 1000, 10000, 25000, 50000, 100000, 200000, 400000,
+    1600000, 5376000, 0, 0, 0, 0, 0, 0
+};
+
+// Sensitivity in mg/digit indexed by full scale, for HR, normal and low-power mode
+static const int32_t sensitivity_hr[4] = { 1, 2, 4, 12 };
+static const int32_t sensitivity_normal[4] = { 4, 8, 16, 48 };
+static const int32_t sensitivity_lp[4] = { 16, 32, 64, 192 };
+
+    static void DefaultSource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        (void)context;
+        double t = (double)t_ns * 1e-9;
+        // Board lying flat on a slowly vibrating bench
+        mg[0] = (int32_t)lround(50.0 * sin(2.0 * M_PI * 5.0 * t));
+        mg[1] = (int32_t)lround(20.0 * sin(2.0 * M_PI * 2.0 * t));
+        mg[2] = 1000 + (int32_t)(HostSim_Random() % 9u) - 4;
+    }
+
+    static void SampleEvent(HostSim_Event* event)
+    {
+        LIS3DH_Model_Sync((LIS3DH_Model*)event->context);
+    }
+
+    // Power-on values of the register file
+    static void PowerOnRegisters(LIS3DH_Model* device)
+    {
+        memset(device->regs, 0, sizeof(device->regs));
+        device->regs[LIS3DH_MODEL_WHO_AM_I] = 0x33;
+        device->regs[0x1E] = 0x10;
+        device->regs[LIS3DH_MODEL_CTRL_REG1] = 0x07;
+    }
+
+    void LIS3DH_Model_Init(LIS3DH_Model* device, uint8_t address)
+    {
+        memset(device, 0, sizeof(*device));
+        device->address = address;
+        PowerOnRegisters(device);
+        device->source = DefaultSource;
+        device->temperature_delta = 3;
+        device->sample_event.fire = SampleEvent;
+        device->sample_event.context = device;
+        HostSim_Register(&device->sample_event);
+    }
+
+    void LIS3DH_Model_Reboot(LIS3DH_Model* device)
+    {
+        // Samples produced up to now are accounted before they are wiped
+        LIS3DH_Model_Sync(device);
+        device->stats.samples_overrun += device->fifo_count;
+        PowerOnRegisters(device);
+        device->fifo_head = 0;
+        device->fifo_count = 0;
+        device->pointer = 0;
+        device->auto_increment = 0;
+        device->next_sample_ns = 0;
+        device->ia1_primed = 0;
+        device->ia1_count = 0;
+        device->click_primed = 0;
+        device->click_count = 0;
+        device->click_latency = 0;
+        device->boot_done_ns = HostSim_Now() + LIS3DH_MODEL_BOOT_NS;
+        device->stats.reboots++;
+        LIS3DH_Model_Sync(device);
+    }
+
+    uint8_t LIS3DH_Model_IsReady(const LIS3DH_Model* device)
+    {
+        return HostSim_Now() >= device->boot_done_ns;
+    }
+
+    void LIS3DH_Model_SetInt1(LIS3DH_Model* device, LIS3DH_Model_Pin pin, void* context)
+    {
+        device->int1 = pin;
+        device->int1_context = context;
+    }
+
+    void LIS3DH_Model_SetSource(LIS3DH_Model* device, LIS3DH_Model_Source source, void* context)
+    {
+        device->source = source ? source : DefaultSource;
+        device->source_context = context;
+    }
+
+    uint32_t LIS3DH_Model_OdrMilliHz(const LIS3DH_Model* device)
+    {
+        uint8_t ctrl_reg1 = device->regs[LIS3DH_MODEL_CTRL_REG1];
+        uint8_t odr = ctrl_reg1 >> 4;
+        return (ctrl_reg1 & 0x08) ? odr_lp_mhz[odr] : odr_mhz[odr];
+    }
+
+    LIS3DH_Model_FifoMode LIS3DH_Model_GetFifoMode(const LIS3DH_Model* device)
+    {
+        if (!(device->regs[LIS3DH_MODEL_CTRL_REG5] & 0x40))
+        {
+            return LIS3DH_MODEL_FIFO_BYPASS;
+        }
+        return (LIS3DH_Model_FifoMode)(device->regs[LIS3DH_MODEL_FIFO_CTRL_REG] >> 6);
+    }
+
+    // Resolution in bits and sensitivity in mg/digit of the current operating mode
+    static void OperatingMode(const LIS3DH_Model* device, uint8_t* bits, int32_t* sensitivity)
+    {
+        uint8_t fs = (device->regs[LIS3DH_MODEL_CTRL_REG4] >> 4) & 0x03;
+        if (device->regs[LIS3DH_MODEL_CTRL_REG1] & 0x08)
+        {
+            *bits = 8;
+            *sensitivity = sensitivity_lp[fs];
+        }
+        else if (device->regs[LIS3DH_MODEL_CTRL_REG4] & 0x08)
+        {
+            *bits = 12;
+            *sensitivity = sensitivity_hr[fs];
+        }
+        else
+        {
+            *bits = 10;
+            *sensitivity = sensitivity_normal[fs];
+        }
+    }
+
+    static void Convert(const LIS3DH_Model* device, const int32_t mg[3], uint8_t out[6])
+    {
+        uint8_t bits;
+        int32_t sensitivity;
+        OperatingMode(device, &bits, &sensitivity);
+        int32_t max = (1 << (bits - 1)) - 1;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int32_t digits = mg[axis] / sensitivity;
+            if (digits > max)
+            {
+                digits = max;
+            }
+            if (digits < -max - 1)
+            {
+                digits = -max - 1;
+            }
+            // Output registers are left-justified 16-bit two's complement
+            uint16_t raw = (uint16_t)(digits * (1 << (16 - bits)));
+            out[2 * axis] = (uint8_t)(raw & 0xFF);
+            out[2 * axis + 1] = (uint8_t)(raw >> 8);
+        }
+    }
+
+    // IA1 generator: INT1_CFG events of a sample against INT1_THS, for INT1_DURATION samples
+    static void EvaluateIa1(LIS3DH_Model* device, const int32_t mg[3])
+    {
+        // INT1_THS LSb by full scale [mg]
+        static const int32_t threshold_step[4] = { 16, 32, 62, 186 };
+        uint8_t cfg = device->regs[LIS3DH_MODEL_INT1_CFG];
+        uint8_t enabled = cfg & 0x3F;
+        uint8_t* source = &device->regs[LIS3DH_MODEL_INT1_SRC];
+        if (enabled == 0)
+        {
+            device->ia1_count = 0;
+            return;
+        }
+        uint8_t fs = (device->regs[LIS3DH_MODEL_CTRL_REG4] >> 4) & 0x03;
+        int32_t threshold = (device->regs[LIS3DH_MODEL_INT1_THS] & 0x7F) * threshold_step[fs];
+        uint8_t highpass = device->regs[LIS3DH_MODEL_CTRL_REG2] & 0x01;
+        uint8_t events = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int32_t value = mg[axis];
+            if (highpass)
+            {
+                if (!device->ia1_primed)
+                {
+                    device->ia1_reference[axis] = value;
+                }
+                // First-order high-pass, cut-off about ODR/50
+                value -= device->ia1_reference[axis];
+                device->ia1_reference[axis] += value / 8;
+            }
+            value = value < 0 ? -value : value;
+            // XL, XH, YL, YH, ZL, ZH from bit 0
+            events |= (uint8_t)((value > threshold ? 0x02 : 0x01) << (2 * axis));
+        }
+        device->ia1_primed = highpass;
+        events &= enabled;
+        // INT1_CFG[7]=AOI: every enabled event (AND) or any of them (OR)
+        uint8_t condition = (cfg & 0x80) ? events == enabled : events != 0;
+        if (!condition)
+        {
+            device->ia1_count = 0;
+            if (!(device->regs[LIS3DH_MODEL_CTRL_REG5] & 0x08))
+            {
+                *source = 0x00;
+            }
+            return;
+        }
+        if (device->ia1_count < 0xFF)
+        {
+            device->ia1_count++;
+        }
+        if (device->ia1_count > (device->regs[LIS3DH_MODEL_INT1_DURATION] & 0x7F))
+        {
+            if (!(*source & 0x40))
+            {
+                device->stats.ia1_events++;
+            }
+            // INT1_SRC[6]=IA and the events of the sample
+            *source = 0x40 | events;
+        }
+    }
+
+    // Click engine: single clicks of the CLICK_CFG axes against CLICK_THS, TIME_LIMIT and TIME_LATENCY
+    static void EvaluateClick(LIS3DH_Model* device, const int32_t mg[3])
+    {
+        // CLICK_THS LSb by full scale [mg], as INT1_THS
+        static const int32_t threshold_step[4] = { 16, 32, 62, 186 };
+        uint8_t cfg = device->regs[LIS3DH_MODEL_CLICK_CFG];
+        uint8_t* source = &device->regs[LIS3DH_MODEL_CLICK_SRC];
+        uint8_t latched = device->regs[LIS3DH_MODEL_CLICK_THS] & 0x80;
+        if (!latched)
+        {
+            // Without LIR_Click the event lasts one sample
+            *source = 0x00;
+        }
+        // XS, YS, ZS at bits 0, 2, 4
+        if ((cfg & 0x15) == 0)
+        {
+            device->click_count = 0;
+            device->click_latency = 0;
+            device->click_primed = 0;
+            return;
+        }
+        uint8_t fs = (device->regs[LIS3DH_MODEL_CTRL_REG4] >> 4) & 0x03;
+        int32_t threshold = (device->regs[LIS3DH_MODEL_CLICK_THS] & 0x7F) * threshold_step[fs];
+        uint8_t highpass = device->regs[LIS3DH_MODEL_CTRL_REG2] & 0x04;
+        uint8_t above = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int32_t value = mg[axis];
+            if (highpass)
+            {
+                if (!device->click_primed)
+                {
+                    device->click_reference[axis] = value;
+                }
+                // Same first-order high-pass as IA1
+                value -= device->click_reference[axis];
+                device->click_reference[axis] += value / 8;
+            }
+            int32_t magnitude = value < 0 ? -value : value;
+            if (!(cfg & (1 << (2 * axis))) || magnitude <= threshold)
+            {
+                continue;
+            }
+            above = 1;
+            int32_t peak = device->click_peak < 0 ? -device->click_peak : device->click_peak;
+            if (device->click_count == 0 || magnitude > peak)
+            {
+                device->click_peak = value;
+                device->click_axis = (uint8_t)axis;
+            }
+        }
+        device->click_primed = highpass;
+        if (device->click_latency > 0)
+        {
+            // The ring of the last click
+            device->click_latency--;
+            device->click_count = 0;
+            return;
+        }
+        if (above)
+        {
+            if (device->click_count < 0xFF)
+            {
+                device->click_count++;
+            }
+            return;
+        }
+        if (device->click_count > 0 && device->click_count <= (device->regs[LIS3DH_MODEL_TIME_LIMIT] & 0x7F))
+        {
+            // CLICK_SRC[6]=IA, CLICK_SRC[4]=SClick, CLICK_SRC[3]=Sign (negative), X, Y, Z from bit 0
+            *source = 0x40 | 0x10 | (device->click_peak < 0 ? 0x08 : 0x00) | (uint8_t)(1 << device->click_axis);
+            device->click_latency = device->regs[LIS3DH_MODEL_TIME_LATENCY];
+            device->stats.click_events++;
+        }
+        device->click_count = 0;
+    }
+
+    static void GenerateSample(LIS3DH_Model* device, uint64_t t_ns)
+    {
+        int32_t mg[3];
+        device->source(t_ns, mg, device->source_context);
+        // Axes that are disabled in CTRL_REG1[2:0] keep reading zero
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!(device->regs[LIS3DH_MODEL_CTRL_REG1] & (1 << axis)))
+            {
+                mg[axis] = 0;
+            }
+        }
+        EvaluateIa1(device, mg);
+        EvaluateClick(device, mg);
+        uint8_t* status = &device->regs[LIS3DH_MODEL_STATUS_REG];
+        LIS3DH_Model_FifoMode mode = LIS3DH_Model_GetFifoMode(device);
+        device->stats.samples_generated++;
+        if (device->stats.first_sample_ns == 0)
+        {
+            device->stats.first_sample_ns = t_ns;
+        }
+
+        if (mode != LIS3DH_MODEL_FIFO_BYPASS)
+        {
+            if (device->fifo_count == LIS3DH_MODEL_FIFO_LENGTH)
+            {
+                device->stats.samples_overrun++;
+                *status |= 0xF0;
+                if (mode == LIS3DH_MODEL_FIFO_FIFO)
+                {
+                    // FIFO mode stops collecting once full
+                    return;
+                }
+                // Stream mode: the oldest sample is lost
+                device->fifo_head = (device->fifo_head + 1) % LIS3DH_MODEL_FIFO_LENGTH;
+                device->fifo_count--;
+            }
+            uint8_t tail = (device->fifo_head + device->fifo_count) % LIS3DH_MODEL_FIFO_LENGTH;
+            Convert(device, mg, device->fifo[tail]);
+            device->fifo_count++;
+            // Output registers always show the oldest unread sample
+            memcpy(&device->regs[LIS3DH_MODEL_OUT_X_L], device->fifo[device->fifo_head], 6);
+            *status |= 0x0F;
+            return;
+        }
+
+        Convert(device, mg, &device->regs[LIS3DH_MODEL_OUT_X_L]);
+        if (*status & 0x08)
+        {
+            // Previous sample never read: ZYXOR and the per-axis overrun bits
+            *status |= 0xF0;
+            device->stats.samples_overrun++;
+        }
+        *status |= 0x0F;
+    }
+
+    static uint8_t FifoSource(const LIS3DH_Model* device)
+    {
+        uint8_t count = device->fifo_count;
+        uint8_t threshold = device->regs[LIS3DH_MODEL_FIFO_CTRL_REG] & 0x1F;
+        uint8_t value = 0;
+        if (LIS3DH_Model_GetFifoMode(device) == LIS3DH_MODEL_FIFO_BYPASS)
+        {
+            return 0x20;
+        }
+        if (count >= threshold)
+        {
+            value |= 0x80;
+        }
+        if (count == LIS3DH_MODEL_FIFO_LENGTH)
+        {
+            // Full: FSS saturates and OVRN_FIFO is set
+            return value | 0x40 | 0x1F;
+        }
+        if (count == 0)
+        {
+            value |= 0x20;
+        }
+        return value | count;
+    }
+
+    // Reading OUT_Z_H of the oldest FIFO entry moves the FIFO on by one sample
+    static void FifoPop(LIS3DH_Model* device)
+    {
+        if (device->fifo_count == 0)
+        {
+            device->stats.samples_stale++;
+            return;
+        }
+        device->stats.samples_read++;
+        device->fifo_head = (device->fifo_head + 1) % LIS3DH_MODEL_FIFO_LENGTH;
+        device->fifo_count--;
+        if (device->fifo_count > 0)
+        {
+            memcpy(&device->regs[LIS3DH_MODEL_OUT_X_L], device->fifo[device->fifo_head], 6);
+        }
+        else
+        {
+            device->regs[LIS3DH_MODEL_STATUS_REG] = 0x00;
+        }
+    }
+
+    static void UpdateInt1(LIS3DH_Model* device)
+    {
+        uint8_t ctrl_reg3 = device->regs[LIS3DH_MODEL_CTRL_REG3];
+        uint8_t fifo = LIS3DH_Model_GetFifoMode(device) != LIS3DH_MODEL_FIFO_BYPASS;
+        uint8_t threshold = device->regs[LIS3DH_MODEL_FIFO_CTRL_REG] & 0x1F;
+        uint8_t level =
+            ((ctrl_reg3 & 0x10) && (device->regs[LIS3DH_MODEL_STATUS_REG] & 0x08)) ||
+            ((ctrl_reg3 & 0x04) && fifo && device->fifo_count >= threshold) ||
+            ((ctrl_reg3 & 0x02) && fifo && device->fifo_count == LIS3DH_MODEL_FIFO_LENGTH) ||
+            ((ctrl_reg3 & 0x40) && (device->regs[LIS3DH_MODEL_INT1_SRC] & 0x40)) ||
+            ((ctrl_reg3 & 0x80) && (device->regs[LIS3DH_MODEL_CLICK_SRC] & 0x40));
+
+        if (level != device->int1_level)
+        {
+            device->int1_level = level;
+            if (device->int1 != NULL)
+            {
+                device->int1(level, device->int1_context);
+            }
+        }
+    }
+
+    // Refresh INT1 and, while it has sources enabled, wake up at the next sample
+    static void Schedule(LIS3DH_Model* device)
+    {
+        UpdateInt1(device);
+        if ((device->regs[LIS3DH_MODEL_CTRL_REG3] & 0xD6) && device->next_sample_ns != 0)
+        {
+            HostSim_Arm(&device->sample_event, device->next_sample_ns);
+        }
+        else
+        {
+            HostSim_Disarm(&device->sample_event);
+        }
+    }
+
+    void LIS3DH_Model_Sync(LIS3DH_Model* device)
+    {
+        uint32_t odr = LIS3DH_Model_OdrMilliHz(device);
+        uint64_t now = HostSim_Now();
+        if (odr == 0)
+        {
+            device->next_sample_ns = 0;
+            Schedule(device);
+            return;
+        }
+        uint64_t period = 1000000000000ull / odr;
+        if (device->next_sample_ns == 0)
+        {
+            device->next_sample_ns = now + period;
+            Schedule(device);
+            return;
+        }
+        if (device->next_sample_ns + 64 * period < now)
+        {
+            // Long gap: only the last samples are observable, count the rest as overrun
+            uint64_t skipped = (now - device->next_sample_ns) / period - 32;
+            device->stats.samples_generated += skipped;
+            device->stats.samples_overrun += skipped;
+            device->regs[LIS3DH_MODEL_STATUS_REG] |= 0xFF;
+            device->next_sample_ns += skipped * period;
+        }
+        while (device->next_sample_ns <= now)
+        {
+            GenerateSample(device, device->next_sample_ns);
+            device->next_sample_ns += period;
+        }
+        Schedule(device);
+    }
+
+    static void UpdateAdc(LIS3DH_Model* device)
+    {
+        uint8_t temp_cfg = device->regs[LIS3DH_MODEL_TEMP_CFG_REG];
+        int16_t adc[3] = { 0, 0, 0 };
+        if (temp_cfg & 0x80)
+        {
+            adc[0] = 100;
+            adc[1] = -100;
+            adc[2] = (temp_cfg & 0x40) ? (int16_t)device->temperature_delta : 0;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            // 10-bit left-justified, like the acceleration outputs in normal mode
+            uint16_t raw = (uint16_t)(adc[i] * 64);
+            device->regs[LIS3DH_MODEL_OUT_ADC1_L + 2 * i] = (uint8_t)(raw & 0xFF);
+            device->regs[LIS3DH_MODEL_OUT_ADC1_L + 2 * i + 1] = (uint8_t)(raw >> 8);
+        }
+        device->regs[LIS3DH_MODEL_STATUS_REG_AUX] = (temp_cfg & 0x80) ? 0x0F : 0x00;
+    }
+
+    static uint8_t IsWritable(uint8_t reg)
+    {
+        return (reg >= 0x1E && reg <= 0x26) ||
+               reg == 0x2E ||
+               (reg >= 0x30 && reg <= 0x3F && reg != 0x31 && reg != 0x35 && reg != 0x39);
+    }
+
+    void LIS3DH_Model_BeginTransfer(LIS3DH_Model* device)
+    {
+        LIS3DH_Model_Sync(device);
+        device->first_write = 1;
+    }
+
+    static void AdvancePointer(LIS3DH_Model* device)
+    {
+        if (device->auto_increment && device->pointer == LIS3DH_MODEL_OUT_Z_H &&
+            LIS3DH_Model_GetFifoMode(device) != LIS3DH_MODEL_FIFO_BYPASS)
+        {
+            // With the FIFO enabled burst reads wrap around the output registers
+            device->pointer = LIS3DH_MODEL_OUT_X_L;
+        }
+        else if (device->auto_increment)
+        {
+            device->pointer = (device->pointer + 1) & (LIS3DH_MODEL_REGISTER_COUNT - 1);
+        }
+    }
+
+    void LIS3DH_Model_WriteByte(LIS3DH_Model* device, uint8_t value)
+    {
+        if (device->first_write)
+        {
+            device->first_write = 0;
+            device->pointer = value & 0x7F;
+            device->auto_increment = (value & 0x80) != 0;
+            return;
+        }
+        uint8_t reg = device->pointer;
+        if (IsWritable(reg))
+        {
+            uint32_t odr_before = LIS3DH_Model_OdrMilliHz(device);
+            device->regs[reg] = value;
+            if (LIS3DH_Model_GetFifoMode(device) == LIS3DH_MODEL_FIFO_BYPASS)
+            {
+                // Going through bypass empties the FIFO
+                device->fifo_count = 0;
+                device->fifo_head = 0;
+            }
+            if (reg == LIS3DH_MODEL_CTRL_REG1 && LIS3DH_Model_OdrMilliHz(device) != odr_before)
+            {
+                // New data rate: the first sample comes one new period later
+                device->next_sample_ns = 0;
+                LIS3DH_Model_Sync(device);
+            }
+        }
+        device->stats.register_writes++;
+        AdvancePointer(device);
+        Schedule(device);
+    }
+
+    uint8_t LIS3DH_Model_ReadByte(LIS3DH_Model* device)
+    {
+        uint8_t reg = device->pointer;
+        if (reg >= LIS3DH_MODEL_OUT_ADC1_L && reg <= LIS3DH_MODEL_OUT_ADC3_H)
+        {
+            UpdateAdc(device);
+        }
+        if (reg == LIS3DH_MODEL_FIFO_SRC_REG)
+        {
+            device->regs[reg] = FifoSource(device);
+        }
+        uint8_t value = device->regs[reg];
+        if (reg == LIS3DH_MODEL_INT1_SRC && (device->regs[LIS3DH_MODEL_CTRL_REG5] & 0x08))
+        {
+            // Reading INT1_SRC releases a latched interrupt
+            device->regs[reg] = 0x00;
+        }
+        else if (reg == LIS3DH_MODEL_CLICK_SRC && (device->regs[LIS3DH_MODEL_CLICK_THS] & 0x80))
+        {
+            // As does reading CLICK_SRC a latched click
+            device->regs[reg] = 0x00;
+        }
+        else if (reg == LIS3DH_MODEL_REFERENCE)
+        {
+            // The high-pass filter restarts from the next sample
+            device->ia1_primed = 0;
+        }
+        if (reg == LIS3DH_MODEL_OUT_Z_H &&
+            LIS3DH_Model_GetFifoMode(device) != LIS3DH_MODEL_FIFO_BYPASS)
+        {
+            FifoPop(device);
+        }
+        else if (reg == LIS3DH_MODEL_OUT_Z_H)
+        {
+            // Reading the last output byte releases the sample
+            if (device->regs[LIS3DH_MODEL_STATUS_REG] & 0x08)
+            {
+                device->stats.samples_read++;
+            }
+            else
+            {
+                device->stats.samples_stale++;
+            }
+            device->regs[LIS3DH_MODEL_STATUS_REG] = 0x00;
+        }
+        device->stats.register_reads++;
+        AdvancePointer(device);
+        UpdateInt1(device);
+        return value;
+    }
+
+/* [] END OF FILE */
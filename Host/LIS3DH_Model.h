@@ -0,0 +1,179 @@
+/**
+*   \file LIS3DH_Model.h
+*   \brief Register-level model of the LIS3DH accelerometer.
+*
+*   The model keeps the full register file of the sensor and produces
+*   new output samples at the data rate selected in CTRL_REG1, with the
+*   resolution and scale selected by CTRL_REG1[LPen] and CTRL_REG4[HR,FS].
+*   With CTRL_REG5[FIFO_EN] set samples go through the 32-level FIFO in
+*   the mode selected by FIFO_CTRL_REG; FIFO_SRC_REG reports the level,
+*   the watermark and overrun flags, and auto-incremented reads of the
+*   output registers wrap from OUT_Z_H back to OUT_X_L, so a whole batch
+*   can be read in one burst.
+*   The IA1 generator compares every sample (high-pass filtered with
+*   CTRL_REG2[HP_IA1]) with INT1_THS for INT1_DURATION samples, following
+*   INT1_CFG; INT1_SRC reports the event, held until it is read with
+*   CTRL_REG5[LIR_INT1], and a read of REFERENCE restarts the filter.
+*   The click engine detects the single clicks enabled in CLICK_CFG: a
+*   run of samples (high-pass filtered with CTRL_REG2[HP_CLICK]) beyond
+*   CLICK_THS on an axis, back below it within TIME_LIMIT samples, then
+*   none for TIME_LATENCY samples. CLICK_SRC reports the axis with the
+*   peak and its sign, held until it is read with CLICK_THS[LIR_Click].
+*   Double clicks are not modelled.
+*   Samples are generated lazily against the host simulator clock, so
+*   the model costs nothing while the firmware is not talking to it.
+*/
+#ifndef LIS3DH_MODEL_H
+    #define LIS3DH_MODEL_H
+
+    #include <stdint.h>
+
+    #include "HostSim.h"
+
+    #define LIS3DH_MODEL_REGISTER_COUNT 0x40
+
+    /** \brief Register addresses used by the model. */
+    #define LIS3DH_MODEL_STATUS_REG_AUX 0x07
+    #define LIS3DH_MODEL_OUT_ADC1_L     0x08
+    #define LIS3DH_MODEL_OUT_ADC3_H     0x0D
+    #define LIS3DH_MODEL_WHO_AM_I       0x0F
+    #define LIS3DH_MODEL_TEMP_CFG_REG   0x1F
+    #define LIS3DH_MODEL_CTRL_REG1      0x20
+    #define LIS3DH_MODEL_CTRL_REG2      0x21
+    #define LIS3DH_MODEL_CTRL_REG3      0x22
+    #define LIS3DH_MODEL_CTRL_REG4      0x23
+    #define LIS3DH_MODEL_CTRL_REG5      0x24
+    #define LIS3DH_MODEL_REFERENCE      0x26
+    #define LIS3DH_MODEL_STATUS_REG     0x27
+    #define LIS3DH_MODEL_OUT_X_L        0x28
+    #define LIS3DH_MODEL_OUT_Z_H        0x2D
+    #define LIS3DH_MODEL_FIFO_CTRL_REG  0x2E
+    #define LIS3DH_MODEL_FIFO_SRC_REG   0x2F
+    #define LIS3DH_MODEL_INT1_CFG       0x30
+    #define LIS3DH_MODEL_INT1_SRC       0x31
+    #define LIS3DH_MODEL_INT1_THS       0x32
+    #define LIS3DH_MODEL_INT1_DURATION  0x33
+    #define LIS3DH_MODEL_CLICK_CFG      0x38
+    #define LIS3DH_MODEL_CLICK_SRC      0x39
+    #define LIS3DH_MODEL_CLICK_THS      0x3A
+    #define LIS3DH_MODEL_TIME_LIMIT     0x3B
+    #define LIS3DH_MODEL_TIME_LATENCY   0x3C
+
+    /** \brief Boot time after a power-on or a reboot, while the address is not acknowledged [ns]. */
+    #define LIS3DH_MODEL_BOOT_NS        5000000ull
+
+    /** \brief Depth of the output FIFO in samples. */
+    #define LIS3DH_MODEL_FIFO_LENGTH    32
+
+    /** \brief FIFO modes selected by FIFO_CTRL_REG[7:6] when CTRL_REG5[FIFO_EN] is set. */
+    typedef enum {
+        LIS3DH_MODEL_FIFO_BYPASS,           ///< FIFO not used, outputs hold the last sample
+        LIS3DH_MODEL_FIFO_FIFO,             ///< Collect until full, then stop
+        LIS3DH_MODEL_FIFO_STREAM,           ///< Collect continuously, overwriting the oldest sample
+        LIS3DH_MODEL_FIFO_STREAM_TO_FIFO    ///< Stream until a trigger (modelled as stream)
+    } LIS3DH_Model_FifoMode;
+
+    /**
+    *   \brief Acceleration source.
+    *
+    *   Returns the acceleration seen by the sensor at time \p t_ns, in mg,
+    *   for the three axes.
+    */
+    typedef void (*LIS3DH_Model_Source)(uint64_t t_ns, int32_t mg[3], void* context);
+
+    /**
+    *   \brief Observer of the INT1 output, called on every level change.
+    */
+    typedef void (*LIS3DH_Model_Pin)(uint8_t level, void* context);
+
+    /**
+    *   \brief Counters collected by the model.
+    */
+    typedef struct {
+        uint64_t samples_generated;     ///< Output samples produced at the ODR
+        uint64_t samples_read;          ///< Samples read out completely (OUT_Z_H read)
+        uint64_t samples_overrun;       ///< Samples overwritten (or discarded by a full FIFO) before being read
+        uint64_t samples_stale;         ///< Output reads that returned no new sample (read twice)
+        uint64_t register_reads;        ///< Bytes read from the register file
+        uint64_t register_writes;       ///< Bytes written to the register file
+        uint64_t reboots;               ///< LIS3DH_Model_Reboot() calls
+        uint64_t first_sample_ns;       ///< Time of the first output sample (0: none yet)
+        uint64_t ia1_events;            ///< Times the IA1 condition has started to hold
+        uint64_t click_events;          ///< Single clicks detected
+    } LIS3DH_Model_Stats;
+
+    /**
+    *   \brief State of a simulated LIS3DH.
+    */
+    typedef struct {
+        uint8_t address;                                ///< 7-bit I2C address (SA0 selects 0x18/0x19)
+        uint8_t regs[LIS3DH_MODEL_REGISTER_COUNT];      ///< Register file
+        uint8_t pointer;                                ///< Current sub-address
+        uint8_t auto_increment;                         ///< Sub-address MSB of the current transfer
+        uint8_t first_write;                            ///< Next written byte is the sub-address
+        uint64_t next_sample_ns;                        ///< Time of the next output sample
+        uint8_t fifo[LIS3DH_MODEL_FIFO_LENGTH][6];      ///< Output FIFO, OUT_X_L..OUT_Z_H per sample
+        uint8_t fifo_head;                              ///< Oldest unread FIFO entry
+        uint8_t fifo_count;                             ///< Unread FIFO entries
+        LIS3DH_Model_Source source;                     ///< Acceleration source
+        void* source_context;                           ///< Context passed to the source
+        int32_t temperature_delta;                      ///< Temperature delta reported on ADC3
+        int32_t ia1_reference[3];                       ///< High-pass filter state of IA1 per axis [mg]
+        uint8_t ia1_primed;                             ///< ia1_reference holds a sample
+        uint8_t ia1_count;                              ///< Consecutive samples meeting the IA1 condition
+        int32_t click_reference[3];                     ///< High-pass filter state of the click engine per axis [mg]
+        uint8_t click_primed;                           ///< click_reference holds a sample
+        uint8_t click_count;                            ///< Consecutive samples beyond CLICK_THS
+        int32_t click_peak;                             ///< Largest value of the run [mg], signed
+        uint8_t click_axis;                             ///< Axis of click_peak
+        uint8_t click_latency;                          ///< Samples left before the next click can start
+        uint8_t int1_level;                             ///< Current level of INT1
+        LIS3DH_Model_Pin int1;                          ///< INT1 observer (may be NULL)
+        void* int1_context;                             ///< Context passed to the INT1 observer
+        HostSim_Event sample_event;                     ///< Wakes the model at the ODR while INT1 is in use
+        uint64_t boot_done_ns;                          ///< End of the current boot (0: not booting)
+        LIS3DH_Model_Stats stats;                       ///< Counters
+    } LIS3DH_Model;
+
+    /** \brief Power-on reset of \p device, listening on \p address (after HostSim_Reset()). */
+    void LIS3DH_Model_Init(LIS3DH_Model* device, uint8_t address);
+
+    /**
+    *   \brief Reset the device as a brown-out would.
+    *
+    *   Registers go back to their power-on values (power-down, interrupts
+    *   and FIFO off), the FIFO is emptied and the address is not
+    *   acknowledged for LIS3DH_MODEL_BOOT_NS. Source, INT1 observer and
+    *   counters are kept.
+    */
+    void LIS3DH_Model_Reboot(LIS3DH_Model* device);
+
+    /** \brief Check if the device acknowledges its address (not booting). */
+    uint8_t LIS3DH_Model_IsReady(const LIS3DH_Model* device);
+
+    /** \brief Replace the acceleration source (NULL restores the default one). */
+    void LIS3DH_Model_SetSource(LIS3DH_Model* device, LIS3DH_Model_Source source, void* context);
+
+    /** \brief Output data rate in mHz selected by the current register settings (0 = power-down). */
+    uint32_t LIS3DH_Model_OdrMilliHz(const LIS3DH_Model* device);
+
+    /** \brief Observe the INT1 output (NULL to disconnect). */
+    void LIS3DH_Model_SetInt1(LIS3DH_Model* device, LIS3DH_Model_Pin pin, void* context);
+
+    /** \brief FIFO mode currently selected (bypass if the FIFO is disabled). */
+    LIS3DH_Model_FifoMode LIS3DH_Model_GetFifoMode(const LIS3DH_Model* device);
+
+    /** \brief Bring the output registers up to date with the simulator clock. */
+    void LIS3DH_Model_Sync(LIS3DH_Model* device);
+
+    /** \brief Start of a bus transfer addressed to the device. */
+    void LIS3DH_Model_BeginTransfer(LIS3DH_Model* device);
+
+    /** \brief Byte written by the master (sub-address first, then data). */
+    void LIS3DH_Model_WriteByte(LIS3DH_Model* device, uint8_t value);
+
+    /** \brief Byte read by the master from the current sub-address. */
+    uint8_t LIS3DH_Model_ReadByte(LIS3DH_Model* device);
+
+#endif // LIS3DH_MODEL_H
+/* [] END OF FILE */
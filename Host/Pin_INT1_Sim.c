@@ -0,0 +1,55 @@
+/**
+*   \file Pin_INT1_Sim.c
+*   \brief Simulated Pin_INT1 input, wired to the LIS3DH INT1 output.
+*/
+#include "Pin_INT1.h"
+#include "Pin_INT1_Sim.h"
+#include "ISR_DataReady_Sim.h"
+
+Pin_INT1_Sim_Stats Pin_INT1_Sim_stats;
+
+static HostSim_Event edge_event;
+static uint8 level;
+static uint8 interrupt_status;
+
+    static void EdgeInterrupt(HostSim_Event* event)
+    {
+        ISR_DataReady_Sim_Raise();
+    }
+
+    static void LevelChanged(uint8_t new_level, void* context)
+    {
+        if (new_level && !level)
+        {
+            Pin_INT1_Sim_stats.rising_edges++;
+            interrupt_status = 1;
+            // Taken as soon as interrupts allow it
+            HostSim_Arm(&edge_event, HostSim_Now());
+        }
+        level = new_level;
+    }
+
+    void Pin_INT1_Sim_Connect(LIS3DH_Model* device)
+    {
+        Pin_INT1_Sim_stats = (Pin_INT1_Sim_Stats){ 0 };
+        edge_event.fire = EdgeInterrupt;
+        edge_event.is_irq = 1;
+        HostSim_Register(&edge_event);
+        level = device->int1_level;
+        interrupt_status = 0;
+        LIS3DH_Model_SetInt1(device, LevelChanged, NULL);
+    }
+
+    uint8 Pin_INT1_Read(void)
+    {
+        return level;
+    }
+
+    uint8 Pin_INT1_ClearInterrupt(void)
+    {
+        uint8 status = interrupt_status;
+        interrupt_status = 0;
+        return status;
+    }
+
+/* [] END OF FILE */
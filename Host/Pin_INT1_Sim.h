@@ -0,0 +1,25 @@
+/**
+*   \file Pin_INT1_Sim.h
+*   \brief Simulated Pin_INT1 input, wired to the LIS3DH INT1 output.
+*
+*   A rising edge latches the pin interrupt status and raises
+*   ISR_DataReady; the firmware releases the latch with
+*   Pin_INT1_ClearInterrupt().
+*/
+#ifndef PIN_INT1_SIM_H
+    #define PIN_INT1_SIM_H
+
+    #include "LIS3DH_Model.h"
+
+    /** \brief Counters collected by the pin. */
+    typedef struct {
+        uint64_t rising_edges;          ///< Rising edges seen on INT1
+    } Pin_INT1_Sim_Stats;
+
+    extern Pin_INT1_Sim_Stats Pin_INT1_Sim_stats;
+
+    /** \brief Wire the pin to the INT1 output of \p device (after HostSim_Reset()). */
+    void Pin_INT1_Sim_Connect(LIS3DH_Model* device);
+
+#endif // PIN_INT1_SIM_H
+/* [] END OF FILE */
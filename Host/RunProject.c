@@ -0,0 +1,921 @@
+/**
+*   \file RunProject.c
+*   \brief Runs the main() of a PSoC project against the simulated board.
+*
+*   The project main.c is compiled with main renamed to Project_Main and
+*   linked with the stand-in component APIs. The runner sets up the bus,
+*   the sensor and the UART, lets the firmware run for the requested
+*   simulated time and prints where the time went.
+*
+*   -c ms:config sends a FRAME_TYPE_CONFIG command (PROJ_3 Command.h)
+*   on the UART RX line at the given time, e.g. -c 500:0x99 for 1.344 kHz
+*   in high resolution mode at +-4 g; up to RUN_MAX_SWITCHES of them. For
+*   each one the runner reports when the last byte was received, how
+*   long the firmware took to bring CTRL_REG1 and CTRL_REG4 to the new
+*   configuration and, decoding the batched stream, when the first frame
+*   with the new configuration byte was stamped.
+*
+*   -q ms reads the latency statistics of the sample path (PROJ_3
+*   Trace.h) with one FRAME_TYPE_TRACE_QUERY command per stage, starting
+*   at the given time, and prints them from the FRAME_TYPE_TRACE answers.
+*
+*   The counters of the last status frame of the stream (PROJ_3
+*   StatusReport.h) are printed next to what the simulator counted.
+*
+*   -f ms:fault injects a bus fault at the given time: "sda" (a slave
+*   stuck in the middle of a read holds SDA low until SCL is clocked),
+*   "nak" (every address NAKed for FAULT_NAK_NS) or "reboot" (sensor
+*   reset to its power-on registers). The runner reports when the bus was
+*   free and the sensor configured as before the fault again and when the
+*   first samples frame after the fault was stamped.
+*
+*   -v hz:mg replaces the bench vibration of the sensor model with a
+*   sinusoid of mg amplitude at hz on x, its second harmonic at half the
+*   amplitude on y and its third at a quarter on z (on top of gravity),
+*   e.g. to check the peaks of the spectrum format (PROJ_3 Spectrum.h).
+*
+*   -d count puts count sensors on the bus, at 0x18 (INT1 wired, target
+*   of the faults and of the register probes) and the addresses above
+*   it, e.g. -d 2 for the SA0 pair of the rigs (PROJ_3 BusManager.h
+*   discovers SENSOR_ADDRESS_COUNT of them). The samples of each sensor
+*   are printed next to those the stream attributes to each device.
+*
+*   -p powers the sensors up together with the PSoC: their address is
+*   not acknowledged for the LIS3DH boot time (LIS3DH_MODEL_BOOT_NS);
+*   without it the PSoC alone is reset and the sensors are already up.
+*   The runner prints when the first sample was produced and when the
+*   first byte left the UART, next to the boot phase times the firmware
+*   reports (Shared/Boot.h, PROJ_3 FRAME_TYPE_BOOT). Building a project
+*   with -DFAST_BOOT=0 gives the boot path with the blind 5 ms wait, to
+*   compare with.
+*
+*   -a period_s:burst_s replaces the bench vibration with a mostly-idle
+*   trace: the board lies still (gravity and a few mg of noise) but for
+*   burst_s of handling in the middle of every period_s, e.g. -a 300:10
+*   over -t 3600000 for an hour with 12 bursts. The runner prints the
+*   samples read from the sensor and sent in the stream per hour, to
+*   compare a build with -DACTIVITY_GATED=1 (PROJ_3 Activity.h) with one
+*   streaming all the time.
+*
+*   -e period_s replaces the bench vibration with taps and drops: the
+*   board lies still but for a tap (a half-sine of TAP_MG over TAP_MS)
+*   a quarter into every period_s, on x, y and z in turn, towards the
+*   positive side one round and the negative the next, and a drop
+*   (DROP_MS weightless, then caught back at rest) two thirds into it.
+*   The runner prints the taps and drops, the clicks and IA1 events of
+*   the sensor and the event frames of the stream, to check a build with
+*   -DOUTPUT_FORMAT=5 (PROJ_3 Events.h).
+*
+*   -l ms sends a FRAME_TYPE_LOG_DUMP command at the given time, to a
+*   build with -DFLASH_LOG=1 (PROJ_3 FlashLog.h). The runner prints the
+*   flash rows the log has programmed per byte of the stream, their
+*   wear, and the pages and frames read back from it.
+*
+*   The time the firmware spent in each power mode, as it accounts it
+*   (Shared/LowPower.h), is printed next to the CPU busy and idle time of
+*   the simulator.
+*
+*   Usage: host_projN [-t ms] [-k i2c_khz] [-g byte_overhead_ns] [-b baud]
+*                     [-r timer_hz] [-n nak_ppm] [-s seed] [-F] [-o capture]
+*                     [-c ms:config]... [-q ms] [-f ms:fault]... [-v hz:mg] [-d count] [-p]
+*                     [-a period_s:burst_s] [-e period_s] [-l ms]
+*/
+#include "FrameDecoder.h"
+#include "HostSim.h"
+#include "I2C_Master_Sim.h"
+#include "LIS3DH.h"
+#include "LIS3DH_Model.h"
+#include "LowPower.h"
+#include "Pin_INT1_Sim.h"
+#include "UART_Debug_Sim.h"
+#include "cy_em_eeprom.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUN_MAX_SWITCHES    8
+#define RUN_MAX_FAULTS      8
+// Interval at which the sensor registers are checked after a command, and for how long
+#define PROBE_NS            10000ull
+#define PROBE_LIMIT_NS      100000000ull
+
+#define CTRL_REG1           0x20
+#define CTRL_REG4           0x23
+
+// Registers of the sensor configuration checked after a fault: CTRL_REG1..CTRL_REG5, FIFO_CTRL_REG
+#define FAULT_REG_FIRST     0x20
+#define FAULT_REG_COUNT     5
+#define FIFO_CTRL_REG       0x2E
+
+// Length of a NAK fault and SCL clocks a stuck slave needs to release SDA
+#define FAULT_NAK_NS        2000000ull
+#define FAULT_SDA_CLOCKS    5
+// A fault is only noticed at the next read of the sensor: probe for longer than after a command
+#define FAULT_PROBE_LIMIT_NS 2000000000ull
+
+// Stages of PROJ_3 Trace.h and size of the FRAME_TYPE_TRACE payload
+#define TRACE_STAGES        6
+#define TRACE_BINS          24
+#define TRACE_PAYLOAD_SIZE  (18 + 4*TRACE_BINS)
+#define TRACE_FRAME_SIZE    (FRAME_DECODER_HEADER_SIZE + TRACE_PAYLOAD_SIZE + FRAME_DECODER_CRC_SIZE)
+
+// Taps and drops of the -e trace: tap peak [mg] and length, time weightless
+#define TAP_MG              2500
+#define TAP_MS              10
+#define DROP_MS             300
+
+// A configuration command and what became of it [ns]
+typedef struct {
+    uint64_t sent_ns;
+    uint8_t config;
+    uint64_t received_ns;           ///< Last byte in the RX buffer
+    uint64_t switched_ns;           ///< Sensor registers at the new configuration (0: never)
+    uint64_t first_frame_ns;        ///< Timestamp of the first frame with the new configuration
+    HostSim_Event probe;
+} ConfigSwitch;
+
+// An injected fault and how long the firmware took to get over it [ns]
+typedef struct {
+    uint64_t at_ns;
+    char kind;                      ///< 's' (SDA stuck), 'n' (NAK window) or 'r' (sensor reboot)
+    uint8_t regs[FAULT_REG_COUNT + 1];  ///< Configuration before the fault, FIFO_CTRL_REG last
+    uint64_t restored_ns;           ///< Bus free, sensor configured as before (0: never)
+    uint64_t first_frame_ns;        ///< Timestamp of the first samples frame after the fault
+    HostSim_Event event;
+} Fault;
+
+int Project_Main(void);
+
+static LIS3DH_Model sensor;
+static LIS3DH_Model others[I2C_MASTER_SIM_MAX_DEVICES - 1];
+static unsigned sensor_count = 1;
+static ConfigSwitch switches[RUN_MAX_SWITCHES];
+static unsigned switch_count;
+static Fault faults[RUN_MAX_FAULTS];
+static unsigned fault_count;
+
+// Last FRAME_TYPE_TRACE answer of each stage
+static const char* const trace_labels[TRACE_STAGES] = {
+    "Trace status read    ", "Trace OUT_X_L burst  ", "Trace conversion     ",
+    "Trace UART enqueue   ", "Trace TX complete    ", "Trace ISR to TX      "
+};
+static uint8_t trace_reports[TRACE_STAGES][TRACE_PAYLOAD_SIZE];
+static uint8_t trace_received[TRACE_STAGES];
+
+static FrameDecoder_Status last_status;
+static unsigned status_frames;
+
+static FrameDecoder_Filter last_filter;
+static unsigned filter_frames;
+
+static FrameDecoder_Features last_features;
+static unsigned features_frames;
+
+static FrameDecoder_Peaks last_peaks;
+static unsigned peaks_frames;
+
+static FrameDecoder_Boot last_boot;
+static unsigned boot_frames;
+static unsigned spectrum_frames;
+
+// Samples of the stream per device ID, the unknown ones last
+static uint64_t device_samples[FRAME_DECODER_MAX_DEVICES + 1];
+static unsigned device_frames;
+
+// Fundamental [Hz] and amplitude [mg] of the -v vibration
+static double vibration[2];
+
+// Period and length [s] of the -a handling bursts
+static double activity[2];
+
+// Period [s] of the -e taps and drops
+static double taps;
+
+// Event frames of the stream by kind, and the last one
+static unsigned click_frames;
+static unsigned free_fall_frames;
+static FrameDecoder_Event last_event;
+
+// Bytes of the live frames the log may hold, log pages read back and the frames in them
+static uint64_t stream_bytes;
+static unsigned log_frames;
+static FrameDecoder log_decoder;
+
+    // Fuzzing source: uniformly random acceleration over the widest full scale
+    static void RandomSource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        (void)t_ns;
+        (void)context;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mg[axis] = (int32_t)(HostSim_Random() % 32001u) - 16000;
+        }
+    }
+
+    // Vibration source: a fundamental on x, its 2nd and 3rd harmonics on y and z
+    static void VibrationSource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        const double* tone = context;
+        double t = (double)t_ns * 1e-9;
+        mg[0] = (int32_t)lround(tone[1] * sin(2.0 * M_PI * tone[0] * t));
+        mg[1] = (int32_t)lround(tone[1] / 2.0 * sin(2.0 * M_PI * 2.0 * tone[0] * t));
+        mg[2] = 1000 + (int32_t)lround(tone[1] / 4.0 * sin(2.0 * M_PI * 3.0 * tone[0] * t));
+    }
+
+    // Mostly-idle source: still on a table, handled for activity[1] s in the middle of every activity[0] s
+    static void ActivitySource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        const double* trace = context;
+        double t = (double)t_ns * 1e-9;
+        double phase = fmod(t, trace[0]) - trace[0] / 2.0;
+        mg[0] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[1] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[2] = 1000 + (int32_t)(HostSim_Random() % 9u) - 4;
+        if (phase >= 0.0 && phase < trace[1])
+        {
+            // Picked up and turned around: slow swings of a few hundred mg
+            mg[0] += (int32_t)lround(400.0 * sin(2.0 * M_PI * 1.3 * phase));
+            mg[1] += (int32_t)lround(250.0 * sin(2.0 * M_PI * 2.1 * phase));
+            mg[2] += (int32_t)lround(200.0 * sin(2.0 * M_PI * 0.7 * phase));
+        }
+    }
+
+    // Taps and drops source: still on a table, a tap and a drop every *period s
+    static void TapSource(uint64_t t_ns, int32_t mg[3], void* context)
+    {
+        const double* period = context;
+        double t = (double)t_ns * 1e-9;
+        unsigned round = (unsigned)(t / *period);
+        double phase = t - round * *period;
+        double tap = phase - *period / 4.0;
+        double drop = phase - *period * 2.0 / 3.0;
+        mg[0] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[1] = (int32_t)(HostSim_Random() % 9u) - 4;
+        mg[2] = 1000 + (int32_t)(HostSim_Random() % 9u) - 4;
+        if (tap >= 0.0 && tap < TAP_MS * 1e-3)
+        {
+            // x, y, z in turn, the sign changing every three taps
+            int32_t peak = (int32_t)lround(TAP_MG * sin(M_PI * tap / (TAP_MS * 1e-3)));
+            mg[round % 3] += (round / 3) % 2 ? -peak : peak;
+        }
+        if (drop >= 0.0 && drop < DROP_MS * 1e-3)
+        {
+            // Weightless: only the noise is left
+            mg[2] -= 1000;
+        }
+    }
+
+    static void Usage(const char* name)
+    {
+        fprintf(stderr,
+                "usage: %s [-t ms] [-k i2c_khz] [-g byte_overhead_ns] [-b baud]\n"
+                "       [-r timer_hz] [-n nak_ppm] [-s seed] [-F] [-o capture]\n"
+                "       [-c ms:config]... [-q ms] [-f ms:sda|nak|reboot]... [-v hz:mg] [-d count] [-p]\n"
+                "       [-a period_s:burst_s] [-e period_s] [-l ms]\n",
+                name);
+        exit(2);
+    }
+
+    // Check whether CTRL_REG1 and CTRL_REG4 hold the configuration of the command
+    static void Probe(HostSim_Event* event)
+    {
+        ConfigSwitch* command = event->context;
+        uint8_t mode = (command->config >> 2) & 0x03;
+        uint8_t ctrl_reg1 = (uint8_t)(command->config & 0xF0) | (mode == 0 ? 0x08 : 0x00);
+        uint8_t ctrl_reg4 = (uint8_t)((command->config & 0x03) << 4) | (mode == 2 ? 0x08 : 0x00);
+
+        if ((sensor.regs[CTRL_REG1] & 0xF8) == ctrl_reg1 && (sensor.regs[CTRL_REG4] & 0x38) == ctrl_reg4)
+        {
+            command->switched_ns = HostSim_Now();
+        }
+        else if (HostSim_Now() < command->received_ns + PROBE_LIMIT_NS)
+        {
+            HostSim_Arm(event, HostSim_Now() + PROBE_NS);
+        }
+    }
+
+    // Sensor configuration registers, FIFO_CTRL_REG last
+    static void ReadConfig(uint8_t regs[FAULT_REG_COUNT + 1])
+    {
+        memcpy(regs, &sensor.regs[FAULT_REG_FIRST], FAULT_REG_COUNT);
+        regs[FAULT_REG_COUNT] = sensor.regs[FIFO_CTRL_REG];
+    }
+
+    // Check whether the bus is free and the sensor configured as before the fault
+    static void FaultProbe(HostSim_Event* event)
+    {
+        Fault* fault = event->context;
+        uint8_t regs[FAULT_REG_COUNT + 1];
+        ReadConfig(regs);
+        if (!I2C_Master_Sim_IsSdaStuck() && LIS3DH_Model_IsReady(&sensor) &&
+            (fault->kind != 'n' || HostSim_Now() >= fault->at_ns + FAULT_NAK_NS) &&
+            memcmp(regs, fault->regs, sizeof(regs)) == 0)
+        {
+            fault->restored_ns = HostSim_Now();
+        }
+        else if (HostSim_Now() < fault->at_ns + FAULT_PROBE_LIMIT_NS)
+        {
+            HostSim_Arm(event, HostSim_Now() + PROBE_NS);
+        }
+    }
+
+    static void FaultInject(HostSim_Event* event)
+    {
+        Fault* fault = event->context;
+        ReadConfig(fault->regs);
+        switch (fault->kind)
+        {
+            case 's': I2C_Master_Sim_StickSda(FAULT_SDA_CLOCKS); break;
+            case 'n': I2C_Master_Sim_NakFor(FAULT_NAK_NS); break;
+            default: LIS3DH_Model_Reboot(&sensor); break;
+        }
+        event->fire = FaultProbe;
+        HostSim_Arm(event, HostSim_Now() + PROBE_NS);
+    }
+
+    // Queue a command with a one-byte payload (frame format of PROJ_3 Frame.h) on the RX line
+    static uint64_t SendCommand(uint8_t type, uint8_t value, uint64_t at_ns)
+    {
+        uint8_t frame[FRAME_DECODER_HEADER_SIZE + 1 + FRAME_DECODER_CRC_SIZE] = {
+            FRAME_DECODER_SYNC_0, FRAME_DECODER_SYNC_1, type, 1,
+            0, 0, 0, 0, 0, 0, value
+        };
+        uint16_t crc = FrameDecoder_Crc16(&frame[2], FRAME_DECODER_HEADER_SIZE - 1);
+        frame[FRAME_DECODER_HEADER_SIZE + 1] = (uint8_t)(crc & 0xFF);
+        frame[FRAME_DECODER_HEADER_SIZE + 2] = (uint8_t)(crc >> 8);
+        return UART_Debug_Sim_Receive(frame, sizeof(frame), at_ns);
+    }
+
+    static void SendConfig(ConfigSwitch* command)
+    {
+        command->received_ns = SendCommand(FRAME_DECODER_TYPE_CONFIG, command->config, command->sent_ns);
+        command->probe.fire = Probe;
+        command->probe.context = command;
+        HostSim_Register(&command->probe);
+        HostSim_Arm(&command->probe, command->received_ns);
+    }
+
+    // First frame of each switch: new configuration byte, stamped after the command;
+    // trace answers are kept for printing
+    static void FindSwitch(const FrameDecoder_Frame* frame, void* context)
+    {
+        (void)context;
+        if (FrameDecoder_ParseStatus(frame, &last_status))
+        {
+            status_frames++;
+        }
+        if (FrameDecoder_ParseFilter(frame, &last_filter))
+        {
+            filter_frames++;
+        }
+        if (FrameDecoder_ParseFeatures(frame, &last_features))
+        {
+            features_frames++;
+        }
+        if (FrameDecoder_ParsePeaks(frame, &last_peaks))
+        {
+            peaks_frames++;
+        }
+        if (FrameDecoder_ParseBoot(frame, &last_boot))
+        {
+            boot_frames++;
+        }
+        if (FrameDecoder_ParseEvent(frame, &last_event))
+        {
+            if (last_event.kind == FRAME_DECODER_EVENT_CLICK)
+            {
+                click_frames++;
+            }
+            else
+            {
+                free_fall_frames++;
+            }
+        }
+        FrameDecoder_Log log;
+        if (FrameDecoder_ParseLog(frame, &log))
+        {
+            log_frames++;
+            FrameDecoder_FeedLog(&log_decoder, &log);
+        }
+        else if (frame->type != FRAME_DECODER_TYPE_TRACE)
+        {
+            stream_bytes += FRAME_DECODER_HEADER_SIZE + frame->length + FRAME_DECODER_CRC_SIZE;
+        }
+        if (frame->type == FRAME_DECODER_TYPE_SPECTRUM)
+        {
+            spectrum_frames++;
+        }
+        if (frame->type == FRAME_DECODER_TYPE_DEVICE)
+        {
+            device_frames++;
+        }
+        if (frame->samples != NULL)
+        {
+            unsigned device = frame->device < FRAME_DECODER_MAX_DEVICES ? frame->device : FRAME_DECODER_MAX_DEVICES;
+            device_samples[device] += frame->sample_count;
+        }
+        if (frame->type == FRAME_DECODER_TYPE_TRACE && frame->length == TRACE_PAYLOAD_SIZE &&
+            frame->payload[0] < TRACE_STAGES)
+        {
+            memcpy(trace_reports[frame->payload[0]], frame->payload, TRACE_PAYLOAD_SIZE);
+            trace_received[frame->payload[0]] = 1;
+        }
+        for (unsigned i = 0; i < fault_count && frame->samples != NULL; i++)
+        {
+            uint64_t stamped_ns = frame->timestamp * 1000ull;
+            if (faults[i].first_frame_ns == 0 && stamped_ns >= faults[i].at_ns)
+            {
+                faults[i].first_frame_ns = stamped_ns;
+            }
+        }
+        for (unsigned i = 0; i < switch_count && frame->samples != NULL; i++)
+        {
+            uint64_t stamped_ns = frame->timestamp * 1000ull;
+            if (switches[i].first_frame_ns == 0 && frame->config == switches[i].config &&
+                stamped_ns >= switches[i].received_ns)
+            {
+                switches[i].first_frame_ns = stamped_ns;
+            }
+        }
+    }
+
+    static uint32_t Get32(const uint8_t* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    // One line per stage in microseconds, then the non-empty log2 histogram bins
+    static void PrintTrace(unsigned stage)
+    {
+        const uint8_t* p = trace_reports[stage];
+        double us_per_cycle = 1.0 / (double)p[1];
+        printf("%s: %lu, min %.2f us, mean %.2f us, max %.2f us\n", trace_labels[stage],
+               (unsigned long)Get32(&p[2]), Get32(&p[6]) * us_per_cycle,
+               Get32(&p[14]) * us_per_cycle, Get32(&p[10]) * us_per_cycle);
+        printf("                       log2(cycles):");
+        for (unsigned bin = 0; bin < TRACE_BINS; bin++)
+        {
+            uint32_t count = Get32(&p[18 + 4*bin]);
+            if (count > 0)
+            {
+                printf(" %u:%lu", bin, (unsigned long)count);
+            }
+        }
+        printf("\n");
+    }
+
+    static double Percent(uint64_t part, uint64_t total)
+    {
+        return total ? 100.0 * (double)part / (double)total : 0.0;
+    }
+
+int main(int argc, char** argv)
+{
+    uint64_t duration_ms = 1000;
+    uint8_t fuzz = 0;
+    const char* capture_path = NULL;
+    int64_t query_ms = -1;
+    int64_t dump_ms = -1;
+    uint8_t power_on = 0;
+
+    HostSim_Reset();
+    I2C_Master_Sim_Reset();
+    UART_Debug_Sim_Reset();
+
+    int option;
+    while ((option = getopt(argc, argv, "t:k:g:b:r:n:s:Fo:c:q:f:v:d:pa:e:l:")) != -1)
+    {
+        switch (option)
+        {
+            case 't': duration_ms = strtoull(optarg, NULL, 0); break;
+            case 'k': HostSim_config.i2c_bus_khz = strtoul(optarg, NULL, 0); break;
+            case 'g': HostSim_config.i2c_byte_overhead_ns = strtoul(optarg, NULL, 0); break;
+            case 'b': HostSim_config.uart_baud = strtoul(optarg, NULL, 0); break;
+            case 'r': HostSim_config.timer_period_ns = 1000000000ull / strtoull(optarg, NULL, 0); break;
+            case 'n': HostSim_config.nak_rate_ppm = strtoul(optarg, NULL, 0); break;
+            case 's': HostSim_config.seed = strtoul(optarg, NULL, 0); break;
+            case 'F': fuzz = 1; break;
+            case 'o': capture_path = optarg; break;
+            case 'c':
+            {
+                char* end;
+                if (switch_count == RUN_MAX_SWITCHES)
+                {
+                    Usage(argv[0]);
+                }
+                switches[switch_count].sent_ns = strtoull(optarg, &end, 0) * 1000000ull;
+                if (*end != ':')
+                {
+                    Usage(argv[0]);
+                }
+                switches[switch_count++].config = (uint8_t)strtoul(end + 1, NULL, 0);
+                break;
+            }
+            case 'q': query_ms = (int64_t)strtoull(optarg, NULL, 0); break;
+            case 'l': dump_ms = (int64_t)strtoull(optarg, NULL, 0); break;
+            case 'f':
+            {
+                char* end;
+                if (fault_count == RUN_MAX_FAULTS)
+                {
+                    Usage(argv[0]);
+                }
+                faults[fault_count].at_ns = strtoull(optarg, &end, 0) * 1000000ull;
+                if (strcmp(end, ":sda") != 0 && strcmp(end, ":nak") != 0 && strcmp(end, ":reboot") != 0)
+                {
+                    Usage(argv[0]);
+                }
+                faults[fault_count++].kind = end[1];
+                break;
+            }
+            case 'v':
+            {
+                char* end;
+                vibration[0] = strtod(optarg, &end);
+                if (*end != ':' || vibration[0] <= 0.0)
+                {
+                    Usage(argv[0]);
+                }
+                vibration[1] = strtod(end + 1, NULL);
+                break;
+            }
+            case 'd':
+                sensor_count = strtoul(optarg, NULL, 0);
+                if (sensor_count < 1 || sensor_count > I2C_MASTER_SIM_MAX_DEVICES)
+                {
+                    Usage(argv[0]);
+                }
+                break;
+            case 'p': power_on = 1; break;
+            case 'a':
+            {
+                char* end;
+                activity[0] = strtod(optarg, &end);
+                if (*end != ':' || activity[0] <= 0.0)
+                {
+                    Usage(argv[0]);
+                }
+                activity[1] = strtod(end + 1, NULL);
+                break;
+            }
+            case 'e':
+                taps = strtod(optarg, NULL);
+                if (taps <= 0.0)
+                {
+                    Usage(argv[0]);
+                }
+                break;
+            default: Usage(argv[0]);
+        }
+    }
+    if (HostSim_config.i2c_bus_khz == 0 || HostSim_config.uart_baud == 0 ||
+        HostSim_config.timer_period_ns == 0)
+    {
+        Usage(argv[0]);
+    }
+
+    FILE* capture = NULL;
+    if (capture_path != NULL)
+    {
+        capture = fopen(capture_path, "wb");
+        if (capture == NULL)
+        {
+            perror(capture_path);
+            return 1;
+        }
+        UART_Debug_Sim_SetCaptureFile(capture);
+    }
+
+    for (unsigned i = 0; i < sensor_count; i++)
+    {
+        LIS3DH_Model* model = i == 0 ? &sensor : &others[i - 1];
+        LIS3DH_Model_Init(model, (uint8_t)(0x18 + i));
+        if (power_on)
+        {
+            // Booting from t = 0, as after a power-on
+            LIS3DH_Model_Reboot(model);
+        }
+        if (fuzz)
+        {
+            LIS3DH_Model_SetSource(model, RandomSource, NULL);
+        }
+        else if (vibration[0] > 0.0)
+        {
+            LIS3DH_Model_SetSource(model, VibrationSource, vibration);
+        }
+        else if (activity[0] > 0.0)
+        {
+            LIS3DH_Model_SetSource(model, ActivitySource, activity);
+        }
+        else if (taps > 0.0)
+        {
+            LIS3DH_Model_SetSource(model, TapSource, &taps);
+        }
+        I2C_Master_Sim_Attach(model);
+    }
+    Pin_INT1_Sim_Connect(&sensor);
+    for (unsigned i = 0; i < switch_count; i++)
+    {
+        SendConfig(&switches[i]);
+    }
+    for (unsigned i = 0; i < fault_count; i++)
+    {
+        faults[i].event.fire = FaultInject;
+        faults[i].event.context = &faults[i];
+        HostSim_Register(&faults[i].event);
+        HostSim_Arm(&faults[i].event, faults[i].at_ns);
+    }
+    if (query_ms >= 0)
+    {
+        // Queries two answers apart, so that the UART stream keeps room for the samples
+        uint64_t spacing_ns = 2ull * TRACE_FRAME_SIZE * 10u * 1000000000ull / HostSim_config.uart_baud;
+        for (unsigned stage = 0; stage < TRACE_STAGES; stage++)
+        {
+            SendCommand(FRAME_DECODER_TYPE_TRACE_QUERY, (uint8_t)stage,
+                        (uint64_t)query_ms * 1000000ull + stage * spacing_ns);
+        }
+    }
+
+    if (dump_ms >= 0)
+    {
+        // No payload needed, the one-byte command is as good
+        SendCommand(FRAME_DECODER_TYPE_LOG_DUMP, 0, (uint64_t)dump_ms * 1000000ull);
+    }
+
+    uint64_t elapsed = HostSim_Run(Project_Main, duration_ms * 1000000ull);
+
+    if (capture != NULL)
+    {
+        fclose(capture);
+    }
+
+    printf("Simulated time       : %.3f ms\n", (double)elapsed * 1e-6);
+    printf("I2C bus              : %u kHz, %u ns/byte overhead\n",
+           (unsigned)HostSim_config.i2c_bus_khz, (unsigned)HostSim_config.i2c_byte_overhead_ns);
+    printf("I2C transactions     : %llu (%llu bytes, %llu address NAKs)\n",
+           (unsigned long long)I2C_Master_Sim_stats.transactions,
+           (unsigned long long)I2C_Master_Sim_stats.bytes,
+           (unsigned long long)I2C_Master_Sim_stats.address_naks);
+    printf("I2C bus utilisation  : %.2f %%\n", Percent(I2C_Master_Sim_stats.bus_busy_ns, elapsed));
+    printf("CPU busy / idle      : %.2f %% / %.2f %%\n",
+           Percent(HostSim_stats.cpu_busy_ns, elapsed), Percent(HostSim_stats.cpu_idle_ns, elapsed));
+    LowPower_Stats power = LowPower_GetStats();
+    printf("Power modes          : active %.2f %%, alternate active %.2f %% (%lu), sleep %.2f %% (%lu), "
+           "%lu uA estimated\n",
+           power.duty_cycle_ppm * 1e-4,
+           Percent(power.time_ms[LOW_POWER_ALT_ACTIVE] * 1000000ull, elapsed),
+           (unsigned long)power.entries[LOW_POWER_ALT_ACTIVE],
+           Percent(power.time_ms[LOW_POWER_SLEEP] * 1000000ull, elapsed),
+           (unsigned long)power.entries[LOW_POWER_SLEEP], (unsigned long)power.current_ua);
+    printf("Interrupts           : %llu (%llu INT1 edges)\n", (unsigned long long)HostSim_stats.isr_count,
+           (unsigned long long)Pin_INT1_Sim_stats.rising_edges);
+    printf("Sensor samples       : %llu generated, %llu read, %llu overrun, %llu stale\n",
+           (unsigned long long)sensor.stats.samples_generated,
+           (unsigned long long)sensor.stats.samples_read,
+           (unsigned long long)sensor.stats.samples_overrun,
+           (unsigned long long)sensor.stats.samples_stale);
+    for (unsigned i = 1; i < sensor_count; i++)
+    {
+        const LIS3DH_Model* model = &others[i - 1];
+        printf("Sensor 0x%02X samples  : %llu generated, %llu read, %llu overrun, %llu stale\n",
+               (unsigned)model->address,
+               (unsigned long long)model->stats.samples_generated,
+               (unsigned long long)model->stats.samples_read,
+               (unsigned long long)model->stats.samples_overrun,
+               (unsigned long long)model->stats.samples_stale);
+    }
+    printf("UART                 : %u baud, %llu bytes, blocked %.2f %%\n",
+           (unsigned)HostSim_config.uart_baud,
+           (unsigned long long)UART_Debug_Sim_stats.bytes,
+           Percent(UART_Debug_Sim_stats.blocked_ns, elapsed));
+
+    static FrameDecoder decoder;
+    size_t length;
+    const uint8_t* stream = UART_Debug_Sim_Capture(&length);
+    FrameDecoder_Init(&decoder, FRAME_DECODER_BATCHED, FindSwitch, NULL);
+    FrameDecoder_Init(&log_decoder, FRAME_DECODER_BATCHED, NULL, NULL);
+    FrameDecoder_Feed(&decoder, stream, length);
+    if (status_frames > 0)
+    {
+        printf("Device status        : %u frames, last: %lu overruns (%lu samples lost), "
+               "%lu samples dropped, %lu/%lu I2C errors, %lu retries, %lu bus recoveries, "
+               "CPU duty cycle %.2f %%\n",
+               status_frames,
+               (unsigned long)last_status.sensor_overruns, (unsigned long)last_status.samples_lost,
+               (unsigned long)last_status.samples_dropped, (unsigned long)last_status.i2c_errors,
+               (unsigned long)last_status.i2c_transactions, (unsigned long)last_status.i2c_retries,
+               (unsigned long)last_status.i2c_recoveries, last_status.cpu_duty_ppm * 1e-4);
+    }
+
+    if (sensor_count > 1)
+    {
+        printf("Device samples       : %u device frames, samples per device", device_frames);
+        for (unsigned device = 0; device < FRAME_DECODER_MAX_DEVICES; device++)
+        {
+            if (device_samples[device] > 0)
+            {
+                printf(" %u: %llu,", device, (unsigned long long)device_samples[device]);
+            }
+        }
+        printf(" unknown: %llu\n", (unsigned long long)device_samples[FRAME_DECODER_MAX_DEVICES]);
+    }
+
+    printf("Boot (simulator)     : sensors %s, first sample %.3f ms, first UART byte %.3f ms\n",
+           power_on ? "powered up with the PSoC" : "already up",
+           (double)sensor.stats.first_sample_ns * 1e-6, (double)UART_Debug_Sim_stats.first_byte_ns * 1e-6);
+    if (boot_frames > 0)
+    {
+        static const char* const phases[FRAME_DECODER_BOOT_PHASES] = {
+            "sensor ready", "configured", "first data", "diagnostics"
+        };
+        printf("Boot (device)        :");
+        for (unsigned phase = 0; phase < FRAME_DECODER_BOOT_PHASES; phase++)
+        {
+            if (last_boot.times[phase] == FRAME_DECODER_BOOT_NOT_REACHED)
+            {
+                printf("%s %s -", phase ? "," : "", phases[phase]);
+            }
+            else
+            {
+                printf("%s %s %.3f ms", phase ? "," : "", phases[phase], last_boot.times[phase] * 1e-3);
+            }
+        }
+        printf("\n");
+    }
+
+    if (filter_frames > 0)
+    {
+        unsigned odr_hz = LIS3DH_OdrHz((LIS3DH_Odr)(last_filter.config >> 4),
+                                       (LIS3DH_Mode)((last_filter.config >> 2) & 0x03));
+        printf("Device filter        : %u frames, last: %u Hz / %u = %.1f Hz output, "
+               "low-pass %u/%.3f Hz, high-pass %u/%.3f Hz\n",
+               filter_frames, odr_hz, (unsigned)last_filter.decimation,
+               last_filter.decimation ? (double)odr_hz / last_filter.decimation : 0.0,
+               (unsigned)last_filter.lowpass_order, last_filter.lowpass_mhz * 1e-3,
+               (unsigned)last_filter.highpass_order, last_filter.highpass_mhz * 1e-3);
+    }
+
+    if (features_frames > 0)
+    {
+        printf("Device features      : %u frames, last: %u samples, mean %d/%d/%d mg, "
+               "RMS %u/%u/%u mg, peak-to-peak %u/%u/%u mg, SMA %lu mg\n",
+               features_frames, (unsigned)last_features.samples,
+               last_features.mean[0], last_features.mean[1], last_features.mean[2],
+               (unsigned)last_features.rms[0], (unsigned)last_features.rms[1], (unsigned)last_features.rms[2],
+               (unsigned)last_features.peak_to_peak[0], (unsigned)last_features.peak_to_peak[1],
+               (unsigned)last_features.peak_to_peak[2], (unsigned long)last_features.sma);
+    }
+
+    if (spectrum_frames > 0)
+    {
+        printf("Device spectrum      : %u bins frames\n", spectrum_frames);
+    }
+    if (peaks_frames > 0)
+    {
+        double resolution = (double)FrameDecoder_OdrHz(last_peaks.config) / last_peaks.points;
+        printf("Device peaks         : %u frames, last (%u points):", peaks_frames,
+               (unsigned)last_peaks.points);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            printf(" %c", "xyz"[axis]);
+            for (int i = 0; i < last_peaks.count && last_peaks.bin[axis][i] != 0; i++)
+            {
+                printf(" %.2f Hz/%.1f mg", last_peaks.bin[axis][i] * resolution,
+                       (double)last_peaks.magnitude[axis][i] / FRAME_DECODER_MAGNITUDE_SCALE);
+            }
+        }
+        printf("\n");
+    }
+
+    if (click_frames + free_fall_frames > 0)
+    {
+        printf("Device events        : %u clicks, %u free falls, last: %s ",
+               click_frames, free_fall_frames,
+               last_event.kind == FRAME_DECODER_EVENT_CLICK ? "click" : "free fall");
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (last_event.axes & (1u << axis))
+            {
+                printf("%s%c", (last_event.axes & FRAME_DECODER_EVENT_NEGATIVE) ? "-" : "+", "xyz"[axis]);
+            }
+        }
+        printf(", snapshot %d/%d/%d mg\n", last_event.snapshot[0], last_event.snapshot[1], last_event.snapshot[2]);
+    }
+
+    if (Em_EEPROM_Sim_stats.rows_programmed > 0 || dump_ms >= 0)
+    {
+        uint32_t rows = Em_EEPROM_Sim_RowCount();
+        uint32_t most = 0;
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            if (Em_EEPROM_Sim_RowErases(row) > most)
+            {
+                most = Em_EEPROM_Sim_RowErases(row);
+            }
+        }
+        printf("Flash log            : %llu rows programmed (%.2f flash bytes per stream byte), "
+               "%lu rows, the most worn erased %lu times\n",
+               (unsigned long long)Em_EEPROM_Sim_stats.rows_programmed,
+               stream_bytes ? (double)(Em_EEPROM_Sim_stats.rows_programmed * CY_EM_EEPROM_FLASH_SIZEOF_ROW) /
+                              (double)stream_bytes : 0.0,
+               (unsigned long)rows, (unsigned long)most);
+        printf("Flash log dump       : %u pages (%llu lost), %llu frames, %llu samples, "
+               "%llu sequence gaps (%llu frames lost), %llu CRC errors\n",
+               log_frames, (unsigned long long)log_decoder.stats.log_pages_lost,
+               (unsigned long long)log_decoder.stats.frames, (unsigned long long)log_decoder.stats.samples,
+               (unsigned long long)log_decoder.stats.sequence_gaps,
+               (unsigned long long)log_decoder.stats.frames_lost,
+               (unsigned long long)log_decoder.stats.crc_errors);
+    }
+
+    for (unsigned i = 0; i < fault_count; i++)
+    {
+        const Fault* fault = &faults[i];
+        const char* name = fault->kind == 's' ? "SDA stuck" : fault->kind == 'n' ? "NAK burst" : "reboot";
+        printf("Fault %-15s: at %.3f ms, ", name, (double)fault->at_ns * 1e-6);
+        if (fault->restored_ns == 0)
+        {
+            printf("not recovered\n");
+            continue;
+        }
+        printf("bus and sensor restored +%.3f ms", (double)(fault->restored_ns - fault->at_ns) * 1e-6);
+        if (fault->first_frame_ns != 0)
+        {
+            printf(", first samples frame +%.3f ms", (double)(fault->first_frame_ns - fault->at_ns) * 1e-6);
+        }
+        printf("\n");
+    }
+
+    if (switch_count > 0 || query_ms >= 0 || fault_count > 0)
+    {
+
+        for (unsigned i = 0; i < switch_count; i++)
+        {
+            const ConfigSwitch* command = &switches[i];
+            printf("Config 0x%02X          : sent %.3f ms, received +%.3f ms, ", command->config,
+                   (double)command->sent_ns * 1e-6,
+                   (double)(command->received_ns - command->sent_ns) * 1e-6);
+            if (command->switched_ns == 0)
+            {
+                printf("not applied\n");
+                continue;
+            }
+            printf("sensor switched +%.3f ms", (double)(command->switched_ns - command->received_ns) * 1e-6);
+            if (command->first_frame_ns != 0)
+            {
+                printf(", first frame +%.3f ms", (double)(command->first_frame_ns - command->received_ns) * 1e-6);
+            }
+            printf("\n");
+        }
+        for (unsigned stage = 0; stage < TRACE_STAGES; stage++)
+        {
+            if (trace_received[stage])
+            {
+                PrintTrace(stage);
+            }
+            else if (query_ms >= 0)
+            {
+                printf("%s: no answer\n", trace_labels[stage]);
+            }
+        }
+        printf("Batched stream       : %llu frames, %llu samples, %llu sequence gaps, %llu CRC errors\n",
+               (unsigned long long)decoder.stats.frames, (unsigned long long)decoder.stats.samples,
+               (unsigned long long)decoder.stats.sequence_gaps,
+               (unsigned long long)decoder.stats.crc_errors);
+        printf("UART RX              : %llu bytes, %llu overruns\n",
+               (unsigned long long)UART_Debug_Sim_stats.rx_bytes,
+               (unsigned long long)UART_Debug_Sim_stats.rx_overruns);
+    }
+    if (activity[0] > 0.0)
+    {
+        uint64_t read = sensor.stats.samples_read;
+        for (unsigned i = 1; i < sensor_count; i++)
+        {
+            read += others[i - 1].stats.samples_read;
+        }
+        double hours = (double)elapsed * 1e-9 / 3600.0;
+        printf("Activity trace       : %g s of handling every %g s, %llu IA1 events; per hour %.0f samples read",
+               activity[1], activity[0], (unsigned long long)sensor.stats.ia1_events, (double)read / hours);
+        if (decoder.stats.samples > 0)
+        {
+            printf(", %.0f sent", (double)decoder.stats.samples / hours);
+        }
+        printf("\n");
+    }
+    if (taps > 0.0)
+    {
+        // Taps a quarter and drops two thirds into every period
+        unsigned rounds = (unsigned)((double)elapsed * 1e-9 / taps);
+        double rest = (double)elapsed * 1e-9 - rounds * taps;
+        printf("Tap and drop trace   : every %g s, %u taps, %u drops; sensor %llu clicks, %llu IA1 events\n",
+               taps, rounds + (rest >= taps / 4.0 + TAP_MS * 1e-3 ? 1 : 0),
+               rounds + (rest >= taps * 2.0 / 3.0 + DROP_MS * 1e-3 ? 1 : 0),
+               (unsigned long long)sensor.stats.click_events, (unsigned long long)sensor.stats.ia1_events);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
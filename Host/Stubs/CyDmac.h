@@ -0,0 +1,37 @@
+/**
+*   \file CyDmac.h
+*   \brief Host stand-in for the PSoC 5LP DMA controller library.
+*
+*   Transaction descriptors are executed by CyDmac_Sim.c. Only transfers
+*   from SRAM to the UART_Debug TX data register are modelled.
+*/
+#ifndef CY_BOOT_CYDMAC_H
+    #define CY_BOOT_CYDMAC_H
+
+    #include "cytypes.h"
+
+    #define CY_DMA_INVALID_CHANNEL      (0xFFu)
+    #define CY_DMA_INVALID_TD           (0xFFu)
+    #define CY_DMA_END_CHAIN_TD         (0xFFu)
+    #define CY_DMA_DISABLE_TD           (0xFEu)
+
+    /* TD configuration bits */
+    #define TD_SWAP_EN                  (0x80u)
+    #define TD_SWAP_SIZE4               (0x40u)
+    #define TD_AUTO_EXEC_NEXT           (0x20u)
+    #define TD_TERMIN_EN                (0x10u)
+    #define TD_TERMOUT1_EN              (0x08u)
+    #define TD_TERMOUT0_EN              (0x04u)
+    #define TD_INC_DST_ADR              (0x02u)
+    #define TD_INC_SRC_ADR              (0x01u)
+
+    uint8    CyDmaTdAllocate(void);
+    void     CyDmaTdFree(uint8 tdHandle);
+    cystatus CyDmaTdSetConfiguration(uint8 tdHandle, uint16 transferCount, uint8 nextTd, uint8 configuration);
+    cystatus CyDmaTdSetAddress(uint8 tdHandle, uint16 source, uint16 destination);
+    cystatus CyDmaChSetInitialTd(uint8 chHandle, uint8 startTd);
+    cystatus CyDmaChEnable(uint8 chHandle, uint8 preserveTds);
+    cystatus CyDmaChDisable(uint8 chHandle);
+
+#endif /* CY_BOOT_CYDMAC_H */
+/* [] END OF FILE */
@@ -0,0 +1,63 @@
+/**
+*   \file CyLib.h
+*   \brief Host stand-in for the PSoC Creator system library.
+*
+*   Global interrupt control, critical sections and the blocking delay
+*   functions are routed to the host simulator, so that simulated time
+*   advances while the firmware waits.
+*/
+#ifndef CY_BOOT_CYLIB_H
+    #define CY_BOOT_CYLIB_H
+
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    #include "core_cm3_psoc5.h"
+    #include "HostSim.h"
+
+    #define CyGlobalIntEnable       HostSim_SetGlobalInterrupts(1u)
+    #define CyGlobalIntDisable      HostSim_SetGlobalInterrupts(0u)
+
+    /** \brief Enter a critical section, returning the previous interrupt state. */
+    uint8 CyEnterCriticalSection(void);
+
+    /** \brief Leave a critical section, restoring the saved interrupt state. */
+    void CyExitCriticalSection(uint8 savedIntrStatus);
+
+    /** \brief Busy-wait for the given number of milliseconds. */
+    void CyDelay(uint32 milliseconds);
+
+    /** \brief Busy-wait for the given number of microseconds. */
+    void CyDelayUs(uint16 microseconds);
+
+    /* SysTick timer: counts BCLK cycles down from the reload value */
+    #define CY_SYS_SYST_NUM_OF_CALLBACKS    (5u)
+
+    /** \brief Configure SysTick for a 1 ms period and start it. */
+    void CySysTickStart(void);
+
+    /** \brief Stop the SysTick counter. */
+    void CySysTickStop(void);
+
+    /** \brief Set the value the counter reloads with when it reaches zero. */
+    void CySysTickSetReload(uint32 value);
+
+    /** \brief Read the reload value. */
+    uint32 CySysTickGetReload(void);
+
+    /** \brief Read the current (down-counting) value. */
+    uint32 CySysTickGetValue(void);
+
+    /** \brief Install \p function in callback slot \p number, returning the previous one. */
+    cyisraddress CySysTickSetCallback(uint32 number, cyisraddress function);
+
+    /** \brief Read callback slot \p number. */
+    cyisraddress CySysTickGetCallback(uint32 number);
+
+    /** \brief Host only: stop SysTick and the DWT cycle counter with the bus clock (Sleep). */
+    void CyLib_Sim_StopClocks(void);
+
+    /** \brief Host only: let them go on from where they stopped. */
+    void CyLib_Sim_StartClocks(void);
+
+#endif /* CY_BOOT_CYLIB_H */
+/* [] END OF FILE */
@@ -0,0 +1,21 @@
+/**
+*   \file DMA_UART_TX_dma.h
+*   \brief Host stand-in for a DMA component named DMA_UART_TX.
+*
+*   Its request input is the UART_Debug TX FIFO-not-full signal and its
+*   termination output drives ISR_DMA_TX.
+*/
+#ifndef CY_DMA_DMA_UART_TX_DMA_H
+    #define CY_DMA_DMA_UART_TX_DMA_H
+
+    #include "CyDmac.h"
+
+    /* Normally emitted into cyfitter.h when the component is placed */
+    #define DMA_UART_TX__TD_TERMOUT_EN  TD_TERMOUT0_EN
+
+    uint8 DMA_UART_TX_DmaInitialize(uint8 BurstCount, uint8 ReqestPerBurst,
+                                    uint16 UpperSrcAddress, uint16 UpperDestAddress);
+    void  DMA_UART_TX_DmaRelease(void);
+
+#endif /* CY_DMA_DMA_UART_TX_DMA_H */
+/* [] END OF FILE */
@@ -0,0 +1,62 @@
+/**
+*   \file I2C_Master.h
+*   \brief Host stand-in for the I2C_Master component API.
+*
+*   The master-mode manual (byte level) API and the interrupt driven
+*   buffer API used by I2C_Interface.c are provided. Every call is
+*   forwarded to the simulated bus in I2C_Master_Sim.c, which charges bus
+*   time to the host simulator. Buffer transfers raise one interrupt per
+*   byte and call I2C_Master_ISR_ExitCallback() when the firmware defines it.
+*/
+#ifndef CY_I2C_I2C_Master_H
+    #define CY_I2C_I2C_Master_H
+
+    #include "cytypes.h"
+
+    /* Transfer direction */
+    #define I2C_Master_WRITE_XFER_MODE          (0u)
+    #define I2C_Master_READ_XFER_MODE           (1u)
+
+    /* Acknowledge of the last read byte */
+    #define I2C_Master_ACK_DATA                 (1u)
+    #define I2C_Master_NAK_DATA                 (0u)
+
+    /* Return values of the manual master API */
+    #define I2C_Master_MSTR_NO_ERROR            (0x00u)
+    #define I2C_Master_MSTR_BUS_BUSY            (0x01u)
+    #define I2C_Master_MSTR_NOT_READY           (0x02u)
+    #define I2C_Master_MSTR_ERR_LB_NAK          (0x03u)
+    #define I2C_Master_MSTR_ERR_ARB_LOST        (0x04u)
+    #define I2C_Master_MSTR_ERR_ABORT_START_GEN (0x05u)
+
+    /* Buffer API transfer modes */
+    #define I2C_Master_MODE_COMPLETE_XFER       (0x00u)
+    #define I2C_Master_MODE_REPEAT_START        (0x01u)
+    #define I2C_Master_MODE_NO_STOP             (0x02u)
+
+    /* Buffer API status bits */
+    #define I2C_Master_MSTAT_RD_CMPLT           (0x01u)
+    #define I2C_Master_MSTAT_WR_CMPLT           (0x02u)
+    #define I2C_Master_MSTAT_XFER_INP           (0x04u)
+    #define I2C_Master_MSTAT_XFER_HALT          (0x08u)
+    #define I2C_Master_MSTAT_ERR_SHORT_XFER     (0x10u)
+    #define I2C_Master_MSTAT_ERR_ADDR_NAK       (0x20u)
+    #define I2C_Master_MSTAT_ERR_ARB_LOST       (0x40u)
+    #define I2C_Master_MSTAT_ERR_XFER           (0x80u)
+
+    void  I2C_Master_Start(void);
+    void  I2C_Master_Stop(void);
+
+    uint8 I2C_Master_MasterSendStart(uint8 slaveAddress, uint8 R_nW);
+    uint8 I2C_Master_MasterSendRestart(uint8 slaveAddress, uint8 R_nW);
+    uint8 I2C_Master_MasterSendStop(void);
+    uint8 I2C_Master_MasterWriteByte(uint8 theByte);
+    uint8 I2C_Master_MasterReadByte(uint8 acknNak);
+
+    uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8 * wrData, uint8 cnt, uint8 mode);
+    uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8 * rdData, uint8 cnt, uint8 mode);
+    uint8 I2C_Master_MasterStatus(void);
+    uint8 I2C_Master_MasterClearStatus(void);
+
+#endif /* CY_I2C_I2C_Master_H */
+/* [] END OF FILE */
@@ -0,0 +1,14 @@
+/**
+*   \file ISR_DMA_TX.h
+*   \brief Host stand-in for the ISR_DMA_TX interrupt component.
+*/
+#ifndef CY_ISR_ISR_DMA_TX_H
+    #define CY_ISR_ISR_DMA_TX_H
+
+    #include "cytypes.h"
+
+    void ISR_DMA_TX_StartEx(cyisraddress address);
+    void ISR_DMA_TX_Stop(void);
+
+#endif /* CY_ISR_ISR_DMA_TX_H */
+/* [] END OF FILE */
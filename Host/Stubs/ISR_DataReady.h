@@ -0,0 +1,14 @@
+/**
+*   \file ISR_DataReady.h
+*   \brief Host stand-in for the ISR_DataReady interrupt component.
+*/
+#ifndef CY_ISR_ISR_DataReady_H
+    #define CY_ISR_ISR_DataReady_H
+
+    #include "cytypes.h"
+
+    void ISR_DataReady_StartEx(cyisraddress address);
+    void ISR_DataReady_Stop(void);
+
+#endif /* CY_ISR_ISR_DataReady_H */
+/* [] END OF FILE */
@@ -0,0 +1,20 @@
+/**
+*   \file Pin_INT1.h
+*   \brief Host stand-in for a digital input pin named Pin_INT1.
+*
+*   The pin is wired to the LIS3DH INT1 output with a rising-edge
+*   interrupt driving ISR_DataReady.
+*/
+#ifndef CY_PINS_Pin_INT1_H
+    #define CY_PINS_Pin_INT1_H
+
+    #include "cytypes.h"
+
+    /* Normally emitted into cyfitter.h for pins with an interrupt */
+    #define Pin_INT1__INTSTAT       (0u)
+
+    uint8 Pin_INT1_Read(void);
+    uint8 Pin_INT1_ClearInterrupt(void);
+
+#endif /* CY_PINS_Pin_INT1_H */
+/* [] END OF FILE */
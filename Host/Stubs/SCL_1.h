@@ -0,0 +1,23 @@
+/**
+*   \file SCL_1.h
+*   \brief Host stand-in for the Pins component on the I2C SCL line.
+*
+*   The pin follows I2C_Master while its bit is set in SCL_1_BYP (the
+*   port bypass register); cleared, SCL_1_Write() drives the open-drain
+*   line (see I2C_Master_Sim.h).
+*/
+#ifndef CY_PINS_SCL_1_H
+    #define CY_PINS_SCL_1_H
+
+    #include "cytypes.h"
+
+    #define SCL_1_MASK              (0x01u)
+    #define SCL_1_BYP               (I2C_Master_Sim_scl_bypass)
+
+    extern reg8 I2C_Master_Sim_scl_bypass;
+
+    void  SCL_1_Write(uint8 value);
+    uint8 SCL_1_Read(void);
+
+#endif /* CY_PINS_SCL_1_H */
+/* [] END OF FILE */
@@ -0,0 +1,23 @@
+/**
+*   \file SDA_1.h
+*   \brief Host stand-in for the Pins component on the I2C SDA line.
+*
+*   The pin follows I2C_Master while its bit is set in SDA_1_BYP (the
+*   port bypass register); cleared, SDA_1_Write() drives the open-drain
+*   line (see I2C_Master_Sim.h).
+*/
+#ifndef CY_PINS_SDA_1_H
+    #define CY_PINS_SDA_1_H
+
+    #include "cytypes.h"
+
+    #define SDA_1_MASK              (0x02u)
+    #define SDA_1_BYP               (I2C_Master_Sim_sda_bypass)
+
+    extern reg8 I2C_Master_Sim_sda_bypass;
+
+    void  SDA_1_Write(uint8 value);
+    uint8 SDA_1_Read(void);
+
+#endif /* CY_PINS_SDA_1_H */
+/* [] END OF FILE */
@@ -0,0 +1,23 @@
+/**
+*   \file Timer_LISD3H.h
+*   \brief Host stand-in for the Timer_LISD3H component API.
+*
+*   The terminal count is generated by the host simulator at the period
+*   configured with HostSim_Config.timer_period_ns. The period register
+*   counts a 10 kHz clock, the one PROJ_3 assumes (TIMER_LISD3H_CLOCK_HZ).
+*/
+#ifndef CY_TIMER_Timer_LISD3H_H
+    #define CY_TIMER_Timer_LISD3H_H
+
+    #include "cytypes.h"
+
+    #define Timer_LISD3H_STATUS_TC  (0x01u)
+
+    void  Timer_LISD3H_Start(void);
+    void  Timer_LISD3H_Stop(void);
+    uint8 Timer_LISD3H_ReadStatusRegister(void);
+    uint8 Timer_LISD3H_ReadPeriod(void);
+    void  Timer_LISD3H_WritePeriod(uint8 period);
+
+#endif /* CY_TIMER_Timer_LISD3H_H */
+/* [] END OF FILE */
@@ -0,0 +1,44 @@
+/**
+*   \file UART_Debug.h
+*   \brief Host stand-in for the UART_Debug component API.
+*
+*   Transmitted bytes are timed at the configured baud rate against a
+*   software TX buffer and captured by UART_Debug_Sim.c, which also
+*   delivers the bytes injected on the RX line.
+*/
+#ifndef CY_UART_UART_Debug_H
+    #define CY_UART_UART_Debug_H
+
+    #include "cytypes.h"
+
+    /* Component parameters of the designs */
+    #define UART_Debug_RX_ENABLED   (1u)
+
+    /* TX status register bits */
+    #define UART_Debug_TX_STS_COMPLETE      (0x01u)
+    #define UART_Debug_TX_STS_FIFO_EMPTY    (0x02u)
+    #define UART_Debug_TX_STS_FIFO_FULL     (0x04u)
+    #define UART_Debug_TX_STS_FIFO_NOT_FULL (0x08u)
+
+    /* TX data register, destination of DMA transfers */
+    extern reg8 UART_Debug_TXDATA_REG;
+    #define UART_Debug_TXDATA_PTR   (&UART_Debug_TXDATA_REG)
+
+    void  UART_Debug_Start(void);
+    void  UART_Debug_Stop(void);
+
+    void  UART_Debug_PutChar(uint8 txDataByte);
+    void  UART_Debug_PutString(const char8 * string);
+    void  UART_Debug_PutArray(const uint8 * string, uint8 byteCount);
+    void  UART_Debug_PutCRLF(uint8 txDataByte);
+    uint8 UART_Debug_GetTxBufferSize(void);
+    void  UART_Debug_ClearTxBuffer(void);
+    uint8 UART_Debug_ReadTxStatus(void);
+
+    uint8 UART_Debug_ReadRxData(void);
+    uint8 UART_Debug_GetChar(void);
+    uint8 UART_Debug_GetRxBufferSize(void);
+    void  UART_Debug_ClearRxBuffer(void);
+
+#endif /* CY_UART_UART_Debug_H */
+/* [] END OF FILE */
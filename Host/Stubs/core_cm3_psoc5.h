@@ -0,0 +1,49 @@
+/**
+*   \file core_cm3_psoc5.h
+*   \brief Host stand-in for the CMSIS Cortex-M3 core peripherals.
+*
+*   SCB is a snapshot refreshed from the simulator on every access, so
+*   that pending bits reflect the simulated interrupt state. DWT and
+*   CoreDebug work the same way: CYCCNT counts the simulated clock at
+*   BCLK__BUS_CLK__HZ while TRCENA and CYCCNTENA are set, and a value
+*   written to it is picked up by the next access.
+*/
+#ifndef CORE_CM3_PSOC5_H
+    #define CORE_CM3_PSOC5_H
+
+    #include <stdint.h>
+
+    typedef struct {
+        volatile uint32_t CPUID;
+        volatile uint32_t ICSR;
+    } SCB_Type;
+
+    #define SCB_ICSR_PENDSTSET_Pos  26U
+    #define SCB_ICSR_PENDSTSET_Msk  (1UL << SCB_ICSR_PENDSTSET_Pos)
+
+    SCB_Type* CyLib_Sim_Scb(void);
+    #define SCB                     (CyLib_Sim_Scb())
+
+    typedef struct {
+        volatile uint32_t CTRL;
+        volatile uint32_t CYCCNT;
+    } DWT_Type;
+
+    #define DWT_CTRL_CYCCNTENA_Pos  0U
+    #define DWT_CTRL_CYCCNTENA_Msk  (1UL << DWT_CTRL_CYCCNTENA_Pos)
+
+    DWT_Type* CyLib_Sim_Dwt(void);
+    #define DWT                     (CyLib_Sim_Dwt())
+
+    typedef struct {
+        volatile uint32_t DEMCR;
+    } CoreDebug_Type;
+
+    #define CoreDebug_DEMCR_TRCENA_Pos  24U
+    #define CoreDebug_DEMCR_TRCENA_Msk  (1UL << CoreDebug_DEMCR_TRCENA_Pos)
+
+    CoreDebug_Type* CyLib_Sim_CoreDebug(void);
+    #define CoreDebug               (CyLib_Sim_CoreDebug())
+
+#endif /* CORE_CM3_PSOC5_H */
+/* [] END OF FILE */
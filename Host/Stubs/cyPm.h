@@ -0,0 +1,56 @@
+/**
+*   \file cyPm.h
+*   \brief Host stand-in for the PSoC 5LP power management API.
+*
+*   Alternate Active halts the simulated CPU until an interrupt becomes
+*   pending, masked or not, and adds HostSim_Config.alt_active_wakeup_ns.
+*   Sleep stops SysTick and the DWT cycle counter, lasts the CTW interval
+*   plus HostSim_Config.sleep_wakeup_ns, and CyPmRestoreClocks() spins for
+*   HostSim_Config.clock_restore_ns (PLL lock). The other peripherals are
+*   not stopped: the firmware only sleeps with them idle. Only the CTW
+*   wakes the device from Sleep.
+*/
+#ifndef CY_BOOT_CYPM_H
+    #define CY_BOOT_CYPM_H
+
+    #include "cytypes.h"
+
+    #define PM_ALT_ACT_TIME_NONE        (0u)
+    #define PM_ALT_ACT_SRC_NONE         (0u)
+
+    #define PM_SLEEP_TIME_NONE          (0u)
+    #define PM_SLEEP_TIME_CTW_2MS       (1u)
+    #define PM_SLEEP_TIME_CTW_4MS       (2u)
+    #define PM_SLEEP_TIME_CTW_8MS       (3u)
+    #define PM_SLEEP_TIME_CTW_16MS      (4u)
+    #define PM_SLEEP_TIME_CTW_32MS      (5u)
+    #define PM_SLEEP_TIME_CTW_64MS      (6u)
+    #define PM_SLEEP_TIME_CTW_128MS     (7u)
+    #define PM_SLEEP_TIME_CTW_256MS     (8u)
+    #define PM_SLEEP_TIME_CTW_512MS     (9u)
+    #define PM_SLEEP_TIME_CTW_1024MS    (10u)
+    #define PM_SLEEP_TIME_CTW_2048MS    (11u)
+    #define PM_SLEEP_TIME_CTW_4096MS    (12u)
+
+    #define PM_SLEEP_SRC_NONE           (0x0000u)
+    #define PM_SLEEP_SRC_PICU           (0x0040u)
+    #define PM_SLEEP_SRC_CTW            (0x0800u)
+
+    /**
+    *   \brief Entries and time of the simulated power modes.
+    */
+    typedef struct {
+        uint64_t alt_active_entries;    ///< CyPmAltAct() calls
+        uint64_t sleep_entries;         ///< CyPmSleep() calls
+        uint64_t sleep_ns;              ///< Time with the clocks stopped, wake-up included
+    } CyPm_Sim_Stats;
+
+    extern CyPm_Sim_Stats CyPm_Sim_stats;
+
+    void CyPmSaveClocks(void);
+    void CyPmRestoreClocks(void);
+    void CyPmAltAct(uint16 wakeupTime, uint16 wakeupSource);
+    void CyPmSleep(uint8 wakeupTime, uint16 wakeupSource);
+
+#endif /* CY_BOOT_CYPM_H */
+/* [] END OF FILE */
@@ -0,0 +1,91 @@
+/**
+*   \file cy_em_eeprom.h
+*   \brief Host stand-in for the Em_EEPROM middleware (Em_EEPROM_Dynamic v2.20).
+*
+*   Implemented by Em_EEPROM_Sim.c. The emulated EEPROM is a logical
+*   image of eepromSize bytes in blocks of half a flash row, each with
+*   wearLevelingFactor rows of its own; a write programs one whole row
+*   per block it touches, the next one of the block (one more for the
+*   redundant copy), and keeps the CPU busy for
+*   HostSim_Config.flash_row_write_ns per row.
+*   The image survives firmware restarts in the same process, like the
+*   flash survives a power cycle; Em_EEPROM_Sim_Erase() blanks it.
+*/
+#ifndef CY_EM_EEPROM_H
+    #define CY_EM_EEPROM_H
+
+    #include "cytypes.h"
+
+    #define CY_EM_EEPROM_FLASH_SIZEOF_ROW       (256u)
+
+    /** \brief Flash needed by an emulated EEPROM of \p dataSize bytes. */
+    #define CY_EM_EEPROM_GET_PHYSICAL_SIZE(dataSize, wearLevelingFactor, redundantCopy) \
+        (((((dataSize) - 1u) / (CY_EM_EEPROM_FLASH_SIZEOF_ROW / 2u)) + 1u) * \
+         (wearLevelingFactor) * ((redundantCopy) + 1u) * CY_EM_EEPROM_FLASH_SIZEOF_ROW)
+
+    typedef enum
+    {
+        CY_EM_EEPROM_SUCCESS      = 0x00u,
+        CY_EM_EEPROM_BAD_PARAM    = 0x01u,
+        CY_EM_EEPROM_BAD_CHECKSUM = 0x02u,
+        CY_EM_EEPROM_BAD_DATA     = 0x03u,
+        CY_EM_EEPROM_WRITE_FAIL   = 0x04u
+    } cy_en_em_eeprom_status_t;
+
+    typedef struct
+    {
+        uint32 eepromSize;
+        uint32 wearLevelingFactor;
+        uint8 redundantCopy;
+        uint8 blockingWrite;
+        uint32 userFlashStartAddr;
+    } cy_stc_eeprom_config_t;
+
+    typedef struct
+    {
+        uint32 eepromSize;
+        uint32 numberOfRows;
+        uint32 wearLevelingFactor;
+        uint8 redundantCopy;
+        uint8 blockingWrite;
+        uint32 userFlashStartAddr;
+        uint32* ptrLastWrittenRow;
+    } cy_stc_eeprom_context_t;
+
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Init(cy_stc_eeprom_config_t* config, cy_stc_eeprom_context_t* context);
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Read(uint32 addr, void* eepromData, uint32 size,
+                                               cy_stc_eeprom_context_t* context);
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Write(uint32 addr, void* eepromData, uint32 size,
+                                                cy_stc_eeprom_context_t* context);
+    cy_en_em_eeprom_status_t Cy_Em_EEPROM_Erase(cy_stc_eeprom_context_t* context);
+    uint32 Cy_Em_EEPROM_NumWrites(cy_stc_eeprom_context_t* context);
+
+    /** \brief Largest emulated EEPROM the simulation holds [bytes]. */
+    #define EM_EEPROM_SIM_MAX_SIZE      65536u
+
+    /** \brief Largest number of flash rows the simulation wears. */
+    #define EM_EEPROM_SIM_MAX_ROWS      2048u
+
+    /**
+    *   \brief Counters of the simulated flash, kept across Cy_Em_EEPROM_Init().
+    */
+    typedef struct {
+        uint64_t writes;                ///< Cy_Em_EEPROM_Write() calls
+        uint64_t bytes_written;         ///< Bytes passed to Cy_Em_EEPROM_Write()
+        uint64_t rows_programmed;       ///< Flash rows erased and programmed
+        uint64_t reads;                 ///< Cy_Em_EEPROM_Read() calls
+    } Em_EEPROM_Sim_Stats;
+
+    extern Em_EEPROM_Sim_Stats Em_EEPROM_Sim_stats;
+
+    /** \brief Blank the image, the wear of every row and the counters, as a new device. */
+    void Em_EEPROM_Sim_Erase(void);
+
+    /** \brief Rows of the area set up by the last Cy_Em_EEPROM_Init(). */
+    uint32 Em_EEPROM_Sim_RowCount(void);
+
+    /** \brief Times \p row of that area has been erased. */
+    uint32 Em_EEPROM_Sim_RowErases(uint32 row);
+
+#endif /* CY_EM_EEPROM_H */
+/* [] END OF FILE */
@@ -0,0 +1,17 @@
+/**
+*   \file cyfitter.h
+*   \brief Host stand-in for the generated cyfitter.h.
+*
+*   Only the clock frequencies read by the firmware are provided; the
+*   component macros live in the matching component stub headers.
+*/
+#ifndef INCLUDED_CYFITTER_H
+    #define INCLUDED_CYFITTER_H
+
+    /* Default PSoC Creator clock tree of the CY8C5888LTI-LP097 designs */
+    #define BCLK__BUS_CLK__HZ       24000000U
+    #define BCLK__BUS_CLK__KHZ      24000U
+    #define BCLK__BUS_CLK__MHZ      24U
+
+#endif /* INCLUDED_CYFITTER_H */
+/* [] END OF FILE */
@@ -0,0 +1,52 @@
+/**
+*   \file cytypes.h
+*   \brief Host stand-in for the PSoC Creator cytypes.h header.
+*
+*   Provides the fixed-width type aliases and the interrupt helper
+*   macros used by the firmware sources, so that they can be compiled
+*   unchanged on a Linux workstation.
+*/
+#ifndef CY_BOOT_CYTYPES_H
+    #define CY_BOOT_CYTYPES_H
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    typedef uint8_t  uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef int8_t   int8;
+    typedef int16_t  int16;
+    typedef int32_t  int32;
+    typedef float    float32;
+    typedef double   float64;
+    typedef char     char8;
+
+    typedef volatile uint8  reg8;
+    typedef volatile uint16 reg16;
+    typedef volatile uint32 reg32;
+
+    typedef uint32 cystatus;
+    typedef void (*cyisraddress)(void);
+
+    #define CYRET_SUCCESS           (0x00u)
+    #define CYRET_BAD_PARAM         (0x01u)
+
+    /* Firmware images are linked below 4 GiB (-no-pie), like on the target */
+    #define LO16(x)                 ((uint16)((uintptr_t)(x) & 0xFFFFu))
+    #define HI16(x)                 ((uint16)(((uintptr_t)(x) >> 16) & 0xFFFFu))
+
+    #define CY_ISR(FuncName)        void FuncName(void)
+    #define CY_ISR_PROTO(FuncName)  void FuncName(void)
+
+    #define CY_NOP                  do { } while (0)
+
+    #define CYBIT                   uint8
+    #define CYCODE
+    #define CYDATA
+    #define CYXDATA
+    #define CYREENTRANT
+    #define CY_INLINE               static inline
+
+#endif /* CY_BOOT_CYTYPES_H */
+/* [] END OF FILE */
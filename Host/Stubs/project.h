@@ -0,0 +1,29 @@
+/**
+*   \file project.h
+*   \brief Host stand-in for the generated project.h.
+*
+*   Pulls in the component headers that the firmware of the three
+*   PSoC projects expects from the generated sources.
+*/
+#ifndef CY_PROJECT_H
+    #define CY_PROJECT_H
+
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    #include "CyLib.h"
+    #include "cyPm.h"
+    #include "cyapicallbacks.h"
+    #include "I2C_Master.h"
+    #include "UART_Debug.h"
+    #include "Timer_LISD3H.h"
+    #include "ISR_DataReady.h"
+    #include "CyDmac.h"
+    #include "DMA_UART_TX_dma.h"
+    #include "ISR_DMA_TX.h"
+    #include "Pin_INT1.h"
+    #include "SCL_1.h"
+    #include "SDA_1.h"
+    #include "cy_em_eeprom.h"
+
+#endif /* CY_PROJECT_H */
+/* [] END OF FILE */
@@ -0,0 +1,57 @@
+/**
+*   \file Timer_LISD3H_Sim.c
+*   \brief Host implementation of Timer_LISD3H.
+*
+*   The terminal count sets the status register and raises the
+*   DataReady interrupt.
+*/
+#include "Timer_LISD3H.h"
+#include "ISR_DataReady_Sim.h"
+#include "HostSim.h"
+
+// Clock counted by the period register
+#define TIMER_LISD3H_SIM_CLOCK_HZ 10000u
+
+static HostSim_Event tc_event;
+static uint8 status;
+
+    static void TerminalCount(HostSim_Event* event)
+    {
+        status |= Timer_LISD3H_STATUS_TC;
+        HostSim_Arm(&tc_event, tc_event.at + HostSim_config.timer_period_ns);
+        ISR_DataReady_Sim_Raise();
+    }
+
+    void Timer_LISD3H_Start(void)
+    {
+        tc_event.fire = TerminalCount;
+        tc_event.is_irq = 1;
+        HostSim_Register(&tc_event);
+        HostSim_Arm(&tc_event, HostSim_Now() + HostSim_config.timer_period_ns);
+    }
+
+    void Timer_LISD3H_Stop(void)
+    {
+        HostSim_Disarm(&tc_event);
+    }
+
+    uint8 Timer_LISD3H_ReadPeriod(void)
+    {
+        uint64_t counts = HostSim_config.timer_period_ns * TIMER_LISD3H_SIM_CLOCK_HZ / 1000000000ull;
+        return (uint8)(counts > 256 ? 255 : counts > 0 ? counts - 1 : 0);
+    }
+
+    void Timer_LISD3H_WritePeriod(uint8 period)
+    {
+        // Period + 1 clocks between terminal counts, from the next reload on
+        HostSim_config.timer_period_ns = (period + 1ull) * 1000000000ull / TIMER_LISD3H_SIM_CLOCK_HZ;
+    }
+
+    uint8 Timer_LISD3H_ReadStatusRegister(void)
+    {
+        uint8 value = status;
+        status = 0;
+        return value;
+    }
+
+/* [] END OF FILE */
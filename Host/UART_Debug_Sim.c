@@ -0,0 +1,303 @@
+/**
+*   \file UART_Debug_Sim.c
+*   \brief Simulated UART_Debug transmitter and receiver.
+*/
+#include "UART_Debug_Sim.h"
+#include "UART_Debug.h"
+#include "HostSim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Hardware TX (and RX) FIFO depth in front of the software buffer
+#define UART_DEBUG_SIM_FIFO_LENGTH 4
+
+// A byte injected on the RX line and the time its stop bit ends
+typedef struct {
+    uint64_t at;
+    uint8_t byte;
+} RxByte;
+
+UART_Debug_Sim_Stats UART_Debug_Sim_stats;
+
+reg8 UART_Debug_TXDATA_REG;
+
+static uint8_t* capture;
+static size_t capture_length;
+static size_t capture_size;
+static FILE* capture_file;
+
+// Time at which the last queued byte has been shifted out
+static uint64_t tx_idle_at;
+// tx_idle_at as of the last TX_STS_COMPLETE reported (the bit is cleared on read)
+static uint64_t tx_complete_read;
+
+// Bytes on their way on the RX line, in order of arrival
+static RxByte* rx_line;
+static size_t rx_line_length;
+static size_t rx_line_size;
+static size_t rx_line_next;
+
+// RX interrupt moving the bytes from the line into the buffer
+static HostSim_Event rx_event;
+
+// RX FIFO and software buffer, as a ring
+static uint8_t rx_buffer[256];
+static uint8_t rx_head;
+static uint16_t rx_count;
+
+    void UART_Debug_Sim_Reset(void)
+    {
+        capture_length = 0;
+        tx_idle_at = 0;
+        tx_complete_read = 0;
+        rx_line_length = 0;
+        rx_line_next = 0;
+        rx_head = 0;
+        rx_count = 0;
+        UART_Debug_Sim_stats = (UART_Debug_Sim_Stats){ 0 };
+    }
+
+    void UART_Debug_Sim_SetCaptureFile(FILE* file)
+    {
+        capture_file = file;
+    }
+
+    const uint8_t* UART_Debug_Sim_Capture(size_t* length)
+    {
+        *length = capture_length;
+        return capture;
+    }
+
+    uint64_t UART_Debug_Sim_ByteNs(void)
+    {
+        // Start bit, 8 data bits, stop bit
+        return 10000000000ull / HostSim_config.uart_baud;
+    }
+
+    uint64_t UART_Debug_Sim_IdleAt(void)
+    {
+        return tx_idle_at;
+    }
+
+    static uint64_t Pending(void)
+    {
+        uint64_t now = HostSim_Now();
+        uint64_t byte_ns = UART_Debug_Sim_ByteNs();
+        return tx_idle_at > now ? (tx_idle_at - now + byte_ns - 1) / byte_ns : 0;
+    }
+
+    static void Capture(uint8_t byte)
+    {
+        if (capture_length == capture_size)
+        {
+            capture_size = capture_size ? 2 * capture_size : 4096;
+            capture = realloc(capture, capture_size);
+        }
+        capture[capture_length++] = byte;
+        if (capture_file != NULL)
+        {
+            fputc(byte, capture_file);
+        }
+    }
+
+    void UART_Debug_Start(void)
+    {
+    }
+
+    void UART_Debug_Stop(void)
+    {
+    }
+
+    static void Enqueue(uint8_t byte)
+    {
+        uint64_t now = HostSim_Now();
+        uint64_t start = tx_idle_at > now ? tx_idle_at : now;
+        if (UART_Debug_Sim_stats.bytes == 0)
+        {
+            UART_Debug_Sim_stats.first_byte_ns = start;
+        }
+        tx_idle_at = start + UART_Debug_Sim_ByteNs();
+        UART_Debug_Sim_stats.bytes++;
+        Capture(byte);
+    }
+
+    uint64_t UART_Debug_Sim_DmaWrite(const uint8_t* data, uint16_t length)
+    {
+        for (uint16_t i = 0; i < length; i++)
+        {
+            Enqueue(data[i]);
+        }
+        // The DMA is done once the last byte fits in the hardware FIFO
+        uint64_t fifo_ns = (UART_DEBUG_SIM_FIFO_LENGTH - 1) * UART_Debug_Sim_ByteNs();
+        uint64_t now = HostSim_Now();
+        return tx_idle_at > now + fifo_ns ? tx_idle_at - fifo_ns : now;
+    }
+
+    // Move the bytes received by now into the RX buffer
+    static void Receive(void)
+    {
+        uint64_t now = HostSim_Now();
+        uint32_t capacity = UART_DEBUG_SIM_FIFO_LENGTH + HostSim_config.uart_rx_buffer_size;
+        if (capacity > sizeof(rx_buffer))
+        {
+            capacity = sizeof(rx_buffer);
+        }
+        for (; rx_line_next < rx_line_length && rx_line[rx_line_next].at <= now; rx_line_next++)
+        {
+            if (rx_count < capacity)
+            {
+                rx_buffer[(uint8_t)(rx_head + rx_count++)] = rx_line[rx_line_next].byte;
+                UART_Debug_Sim_stats.rx_bytes++;
+            }
+            else
+            {
+                UART_Debug_Sim_stats.rx_overruns++;
+            }
+        }
+    }
+
+    // Interrupt of the internal RX buffer: wakes the CPU for every byte received
+    static void RxInterrupt(HostSim_Event* event)
+    {
+        HostSim_Busy(HostSim_config.uart_isr_ns);
+        Receive();
+        if (rx_line_next < rx_line_length)
+        {
+            HostSim_Arm(event, rx_line[rx_line_next].at);
+        }
+    }
+
+    uint64_t UART_Debug_Sim_Receive(const uint8_t* data, size_t length, uint64_t at_ns)
+    {
+        uint64_t at = at_ns;
+        if (rx_line_length > 0 && rx_line[rx_line_length - 1].at > at)
+        {
+            at = rx_line[rx_line_length - 1].at;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            if (rx_line_length == rx_line_size)
+            {
+                rx_line_size = rx_line_size ? 2 * rx_line_size : 64;
+                rx_line = realloc(rx_line, rx_line_size * sizeof(RxByte));
+            }
+            at += UART_Debug_Sim_ByteNs();
+            rx_line[rx_line_length++] = (RxByte){ at, data[i] };
+        }
+        rx_event.fire = RxInterrupt;
+        rx_event.is_irq = 1;
+        HostSim_Register(&rx_event);
+        if (!rx_event.armed && rx_line_next < rx_line_length)
+        {
+            HostSim_Arm(&rx_event, rx_line[rx_line_next].at);
+        }
+        return at;
+    }
+
+    uint8 UART_Debug_ReadRxData(void)
+    {
+        Receive();
+        if (rx_count == 0)
+        {
+            return 0;
+        }
+        rx_count--;
+        return rx_buffer[rx_head++];
+    }
+
+    uint8 UART_Debug_GetChar(void)
+    {
+        return UART_Debug_ReadRxData();
+    }
+
+    uint8 UART_Debug_GetRxBufferSize(void)
+    {
+        Receive();
+        return (uint8)(rx_count > 255 ? 255 : rx_count);
+    }
+
+    void UART_Debug_ClearRxBuffer(void)
+    {
+        Receive();
+        rx_count = 0;
+    }
+
+    void UART_Debug_PutChar(uint8 txDataByte)
+    {
+        uint64_t capacity = HostSim_config.uart_tx_buffer_size + UART_DEBUG_SIM_FIFO_LENGTH;
+        while (Pending() >= capacity)
+        {
+            // Buffer full: spin until the oldest byte has left the shift register
+            uint64_t byte_ns = UART_Debug_Sim_ByteNs();
+            uint64_t wait = tx_idle_at - HostSim_Now() - (capacity - 1) * byte_ns;
+            UART_Debug_Sim_stats.blocked_ns += wait;
+            HostSim_Busy(wait);
+        }
+        // Bytes that do not fit in the hardware FIFO cost one TX interrupt each
+        uint64_t cost = HostSim_config.uart_putchar_ns;
+        if (Pending() >= UART_DEBUG_SIM_FIFO_LENGTH)
+        {
+            cost += HostSim_config.uart_isr_ns;
+        }
+        HostSim_Busy(cost);
+        Enqueue(txDataByte);
+    }
+
+    void UART_Debug_PutString(const char8 * string)
+    {
+        while (*string != '\0')
+        {
+            UART_Debug_PutChar((uint8)*string++);
+        }
+    }
+
+    void UART_Debug_PutArray(const uint8 * string, uint8 byteCount)
+    {
+        for (uint8 i = 0; i < byteCount; i++)
+        {
+            UART_Debug_PutChar(string[i]);
+        }
+    }
+
+    void UART_Debug_PutCRLF(uint8 txDataByte)
+    {
+        UART_Debug_PutChar(txDataByte);
+        UART_Debug_PutChar('\r');
+        UART_Debug_PutChar('\n');
+    }
+
+    uint8 UART_Debug_GetTxBufferSize(void)
+    {
+        uint64_t pending = Pending();
+        return (uint8)(pending > 255 ? 255 : pending);
+    }
+
+    uint8 UART_Debug_ReadTxStatus(void)
+    {
+        uint64_t pending = Pending();
+        uint8 status = 0;
+        // Last byte in the shift register: the FIFO is empty already
+        if (pending <= 1)
+        {
+            status |= UART_Debug_TX_STS_FIFO_EMPTY;
+        }
+        status |= pending > UART_DEBUG_SIM_FIFO_LENGTH ? UART_Debug_TX_STS_FIFO_FULL : UART_Debug_TX_STS_FIFO_NOT_FULL;
+        if (pending == 0 && tx_idle_at != tx_complete_read)
+        {
+            status |= UART_Debug_TX_STS_COMPLETE;
+            tx_complete_read = tx_idle_at;
+        }
+        return status;
+    }
+
+    void UART_Debug_ClearTxBuffer(void)
+    {
+        uint64_t now = HostSim_Now();
+        if (tx_idle_at > now + UART_Debug_Sim_ByteNs())
+        {
+            tx_idle_at = now + UART_Debug_Sim_ByteNs();
+        }
+    }
+
+/* [] END OF FILE */
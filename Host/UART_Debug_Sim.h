@@ -0,0 +1,72 @@
+/**
+*   \file UART_Debug_Sim.h
+*   \brief Simulated UART_Debug transmitter and receiver.
+*
+*   Bytes leave the simulated UART at the configured baud rate (8N1).
+*   When the software TX buffer is full the firmware blocks, exactly as
+*   UART_Debug_PutChar() does on the target. Every PutChar is charged its
+*   CPU cost, plus the TX interrupt cost when the byte has to go through
+*   the software buffer instead of straight into the hardware FIFO. Every transmitted byte is
+*   captured so that the stream can be decoded after the run.
+*
+*   Bytes injected with UART_Debug_Sim_Receive() arrive one byte time
+*   apart, each one raising the RX interrupt (which wakes a halted CPU),
+*   and wait in the RX hardware FIFO plus the software RX buffer; the
+*   ones arriving while both are full are lost, as on the target.
+*   UART_Debug_ReadTxStatus() reports TX_STS_COMPLETE once the last
+*   queued byte has left the shift register, until read.
+*/
+#ifndef UART_DEBUG_SIM_H
+    #define UART_DEBUG_SIM_H
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <stdio.h>
+
+    /**
+    *   \brief Transmitter counters.
+    */
+    typedef struct {
+        uint64_t bytes;                 ///< Bytes queued for transmission
+        uint64_t blocked_ns;            ///< Time the firmware waited for buffer space
+        uint64_t first_byte_ns;         ///< Time the first byte started on the line
+        uint64_t rx_bytes;              ///< Bytes received into the RX buffer
+        uint64_t rx_overruns;           ///< Bytes lost because the RX buffer was full
+    } UART_Debug_Sim_Stats;
+
+    extern UART_Debug_Sim_Stats UART_Debug_Sim_stats;
+
+    /** \brief Clear the capture, the TX queue and the counters. */
+    void UART_Debug_Sim_Reset(void);
+
+    /** \brief Also write every transmitted byte to \p file (NULL to stop). */
+    void UART_Debug_Sim_SetCaptureFile(FILE* file);
+
+    /** \brief Bytes transmitted since the last reset. */
+    const uint8_t* UART_Debug_Sim_Capture(size_t* length);
+
+    /** \brief Time needed to shift one byte out of the UART [ns]. */
+    uint64_t UART_Debug_Sim_ByteNs(void);
+
+    /** \brief Simulated time at which the last queued byte leaves the UART [ns]. */
+    uint64_t UART_Debug_Sim_IdleAt(void);
+
+    /**
+    *   \brief Bytes written into the TX FIFO by the DMA controller.
+    *
+    *   No CPU time is charged. Returns the simulated time at which the last
+    *   byte has entered the hardware FIFO, i.e. when the DMA transfer ends.
+    */
+    uint64_t UART_Debug_Sim_DmaWrite(const uint8_t* data, uint16_t length);
+
+    /**
+    *   \brief Send bytes to the firmware on the RX line.
+    *
+    *   The first byte starts at \p at_ns, or when the bytes injected
+    *   before have been received.
+    *   \retval Simulated time at which the last byte has been received.
+    */
+    uint64_t UART_Debug_Sim_Receive(const uint8_t* data, size_t length, uint64_t at_ns);
+
+#endif // UART_DEBUG_SIM_H
+/* [] END OF FILE */
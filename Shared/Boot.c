@@ -0,0 +1,33 @@
+/*
+* This file includes the source code of the boot phase timestamps.
+*/
+#include "Boot.h"
+#include "Timestamp.h"
+
+// Time of every phase, BOOT_NOT_REACHED until marked
+static uint32_t boot_times[BOOT_PHASES] = {
+    BOOT_NOT_REACHED, BOOT_NOT_REACHED, BOOT_NOT_REACHED, BOOT_NOT_REACHED
+};
+
+    void Boot_Reset(void)
+    {
+        for (uint8_t i = 0; i < BOOT_PHASES; i++)
+        {
+            boot_times[i] = BOOT_NOT_REACHED;
+        }
+    }
+
+    void Boot_Mark(Boot_Phase phase)
+    {
+        if (phase < BOOT_PHASES && boot_times[phase] == BOOT_NOT_REACHED)
+        {
+            boot_times[phase] = Timestamp_Now();
+        }
+    }
+
+    uint32_t Boot_Time(Boot_Phase phase)
+    {
+        return phase < BOOT_PHASES ? boot_times[phase] : BOOT_NOT_REACHED;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,44 @@
+/**
+*   \file Boot.h
+*   \brief Timestamps of the boot phases, from reset to the first data out.
+*
+*   The main loops mark each phase once it is reached: sensor out of its
+*   own boot (WHO_AM_I answered, see LIS3DH_WaitBoot()), configuration
+*   written, first data handed to the UART, and the diagnostics that are
+*   deferred until the stream runs (bus scan, banners, boot report). The
+*   times count from Timestamp_Start(), the first thing main() does.
+*/
+#ifndef BOOT_H
+    #define BOOT_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Boot phases, in the order they are reached.
+    */
+    typedef enum {
+        BOOT_SENSOR_READY,      ///< WHO_AM_I answered
+        BOOT_CONFIGURED,        ///< Sensor configuration written: sampling
+        BOOT_STREAMING,         ///< First data handed to the UART
+        BOOT_DIAGNOSTICS,       ///< Deferred diagnostics done
+        BOOT_PHASES
+    } Boot_Phase;
+
+    /** \brief Time of a phase not reached (yet). */
+    #define BOOT_NOT_REACHED 0xFFFFFFFFu
+
+    /** \brief Forget the phases (Timestamp_Start() restarts the time). */
+    void Boot_Reset(void);
+
+    /**
+    *   \brief Record Timestamp_Now() for \p phase, unless it has been reached before.
+    */
+    void Boot_Mark(Boot_Phase phase);
+
+    /**
+    *   \brief Time [us] at which \p phase was reached, or BOOT_NOT_REACHED.
+    */
+    uint32_t Boot_Time(Boot_Phase phase);
+
+#endif // BOOT_H
+/* [] END OF FILE */
@@ -0,0 +1,32 @@
+/**
+*   \file ErrorCodes.h
+*   \brief Error codes definition.
+*   
+*   This file contains several definition of error codes to be used throughout
+*   the project to be consisted with the written firmware.
+*
+*   \author Davide Marzorati
+*   \date September 12, 2019
+*/
+
+/**
+*   \brief Error codes.
+* 
+*   This definition defines several error codes that will
+*   be used throughout the project.
+*/
+#ifndef __ERRORCODES_H
+    #define __ERRORCODES_H
+    
+    typedef enum {
+        NO_ERROR,                   ///< No error generated
+        ERROR,                      ///< Error generated (invalid argument, dropped frame, ...)
+        ERROR_I2C_NAK,              ///< Address or data byte not acknowledged
+        ERROR_I2C_ARBITRATION_LOST, ///< Bus taken by another master
+        ERROR_I2C_BUS_BUSY,         ///< Bus busy, controller not ready or transfer refused
+        ERROR_I2C_BUS_STUCK,        ///< SDA still held low after the bus recovery sequence
+        ERROR_QUEUE_FULL            ///< No room left in a queue
+    } ErrorCode;
+
+#endif
+/* [] END OF FILE */
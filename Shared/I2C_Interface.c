@@ -0,0 +1,724 @@
+/*
+* This file includes all the required source code to interface
+* the I2C peripheral.
+*/
+
+/**
+*   \brief Value returned if device present on I2C bus.
+*/
+#ifndef DEVICE_CONNECTED
+    #define DEVICE_CONNECTED 1
+#endif
+
+/**
+*   \brief Value returned if device not present on I2C bus.
+*/
+#ifndef DEVICE_UNCONNECTED
+    #define DEVICE_UNCONNECTED 0
+#endif
+
+#include "I2C_Interface.h" 
+#include "I2C_Master.h"
+#include "SCL_1.h"
+#include "SDA_1.h"
+#include "CyLib.h"
+
+/**
+*   \brief Half period of the SCL clock generated by the bus recovery [us] (100 kHz).
+*/
+#define I2C_RECOVERY_HALF_BIT_US 5
+
+/**
+*   \brief SCL pulses that let a slave finish the byte it is sending (8 bits and the ACK).
+*/
+#define I2C_RECOVERY_PULSES 9
+
+/**
+*   \brief States of the asynchronous transaction engine.
+*/
+typedef enum {
+    I2C_ASYNC_IDLE,         ///< Nothing on the bus
+    I2C_ASYNC_ADDRESSING,   ///< Sub-address being written, bus kept for the restart
+    I2C_ASYNC_READING,      ///< Registers being read after the restart
+    I2C_ASYNC_WRITING       ///< Sub-address and data being written
+} I2C_AsyncState;
+
+// Queue of pending transactions (head is the one on the bus)
+static I2C_Peripheral_Transaction* async_queue[I2C_PERIPHERAL_QUEUE_SIZE];
+static volatile uint8_t async_head = 0;
+static volatile uint8_t async_count = 0;
+static volatile I2C_AsyncState async_state = I2C_ASYNC_IDLE;
+static uint8_t async_attempt = 0;
+// Bus kept by a read whose sub-address was NAKed: the next transfer restarts on it
+static volatile uint8_t async_bus_held = 0;
+
+// Sub-address (and payload of writes) handed to I2C_Master_MasterWriteBuf
+static uint8_t async_buffer[1 + I2C_PERIPHERAL_MAX_WRITE];
+
+static void I2C_Async_Complete(ErrorCode error);
+static void I2C_Async_Fail(ErrorCode error);
+
+/**
+*   \brief Entry of the register shadow cache.
+*/
+typedef struct {
+    uint8_t device_address;     ///< I2C address of the device
+    uint8_t register_address;   ///< Register address (without auto-increment bit)
+    uint8_t value;              ///< Last value read or written
+    uint8_t valid;              ///< Non-zero once value matches the device
+} I2C_CacheEntry;
+
+static I2C_CacheEntry cache[I2C_PERIPHERAL_CACHE_SIZE];
+static uint8_t cache_used = 0;
+static I2C_Peripheral_CacheMode cache_mode = I2C_CACHE_WRITE_THROUGH;
+static I2C_Peripheral_Stats stats;
+
+    static I2C_CacheEntry* I2C_Cache_Find(uint8_t device_address, uint8_t register_address)
+    {
+        for (uint8_t i = 0; i < cache_used; i++)
+        {
+            if (cache[i].device_address == device_address &&
+                cache[i].register_address == register_address)
+            {
+                return &cache[i];
+            }
+        }
+        return NULL;
+    }
+    
+    // Copy the shadow into data if every register is cached and valid
+    static uint8_t I2C_Cache_Read(uint8_t device_address, uint8_t register_address,
+                                  uint8_t register_count, uint8_t* data)
+    {
+        if (cache_mode != I2C_CACHE_WRITE_THROUGH)
+        {
+            return 0;
+        }
+        for (uint8_t i = 0; i < register_count; i++)
+        {
+            I2C_CacheEntry* entry = I2C_Cache_Find(device_address, register_address + i);
+            if (entry == NULL || !entry->valid)
+            {
+                return 0;
+            }
+        }
+        for (uint8_t i = 0; i < register_count; i++)
+        {
+            data[i] = I2C_Cache_Find(device_address, register_address + i)->value;
+        }
+        stats.reads_served++;
+        return 1;
+    }
+    
+    // Check if the shadow holds value for the register
+    static uint8_t I2C_Cache_Holds(uint8_t device_address, uint8_t register_address, uint8_t value)
+    {
+        I2C_CacheEntry* entry = I2C_Cache_Find(device_address, register_address);
+        return cache_mode == I2C_CACHE_WRITE_THROUGH && entry != NULL && entry->valid && entry->value == value;
+    }
+    
+    // Check if writing data would leave every register as it is
+    static uint8_t I2C_Cache_Unchanged(uint8_t device_address, uint8_t register_address,
+                                       uint8_t register_count, const uint8_t* data)
+    {
+        for (uint8_t i = 0; i < register_count; i++)
+        {
+            if (!I2C_Cache_Holds(device_address, register_address + i, data[i]))
+            {
+                return 0;
+            }
+        }
+        stats.writes_skipped++;
+        return 1;
+    }
+    
+    // Record the outcome of a bus transfer in the shadow
+    static void I2C_Cache_Update(uint8_t device_address, uint8_t register_address,
+                                 uint8_t register_count, const uint8_t* data,
+                                 uint8_t is_write, ErrorCode error)
+    {
+        for (uint8_t i = 0; i < register_count; i++)
+        {
+            I2C_CacheEntry* entry = I2C_Cache_Find(device_address, register_address + i);
+            if (entry == NULL)
+            {
+                continue;
+            }
+            if (error != NO_ERROR)
+            {
+                // A failed write may have landed or not; a failed read changes nothing
+                if (is_write)
+                {
+                    entry->valid = 0;
+                }
+                continue;
+            }
+            if (!is_write && cache_mode == I2C_CACHE_VERIFY && entry->valid &&
+                entry->value != data[i])
+            {
+                stats.verify_mismatches++;
+            }
+            entry->value = data[i];
+            entry->valid = 1;
+        }
+    }
+    
+    ErrorCode I2C_Peripheral_CacheRegisters(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t register_count)
+    {
+        for (uint8_t i = 0; i < register_count; i++)
+        {
+            if (I2C_Cache_Find(device_address, register_address + i) != NULL)
+            {
+                continue;
+            }
+            if (cache_used == I2C_PERIPHERAL_CACHE_SIZE)
+            {
+                return ERROR;
+            }
+            cache[cache_used].device_address = device_address;
+            cache[cache_used].register_address = register_address + i;
+            cache[cache_used].valid = 0;
+            cache_used++;
+        }
+        return NO_ERROR;
+    }
+    
+    void I2C_Peripheral_CacheInvalidate(uint8_t device_address)
+    {
+        for (uint8_t i = 0; i < cache_used; i++)
+        {
+            if (device_address == I2C_PERIPHERAL_ALL_DEVICES ||
+                cache[i].device_address == device_address)
+            {
+                cache[i].valid = 0;
+            }
+        }
+    }
+    
+    void I2C_Peripheral_SetCacheMode(I2C_Peripheral_CacheMode mode)
+    {
+        cache_mode = mode;
+    }
+    
+    I2C_Peripheral_Stats I2C_Peripheral_GetStats(void)
+    {
+        // The asynchronous engine updates the counters from the interrupt
+        uint8_t interrupts = CyEnterCriticalSection();
+        I2C_Peripheral_Stats copy = stats;
+        CyExitCriticalSection(interrupts);
+        return copy;
+    }
+    
+    // Count a failure reported by a I2C_Master_MSTR_* return code and map it to ErrorCode
+    static ErrorCode I2C_Result(uint8_t error)
+    {
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            return NO_ERROR;
+        }
+        stats.errors++;
+        if (error == I2C_Master_MSTR_ERR_LB_NAK)
+        {
+            stats.naks++;
+            return ERROR_I2C_NAK;
+        }
+        if (error == I2C_Master_MSTR_ERR_ARB_LOST)
+        {
+            stats.arbitration_lost++;
+            return ERROR_I2C_ARBITRATION_LOST;
+        }
+        stats.bus_errors++;
+        return ERROR_I2C_BUS_BUSY;
+    }
+    
+    // Count a failure reported by the I2C_Master_MSTAT_* status of a buffer transfer and map it to ErrorCode
+    static ErrorCode I2C_StatusResult(uint8_t status)
+    {
+        stats.errors++;
+        if (status & I2C_Master_MSTAT_ERR_ARB_LOST)
+        {
+            stats.arbitration_lost++;
+            return ERROR_I2C_ARBITRATION_LOST;
+        }
+        if (status & (I2C_Master_MSTAT_ERR_ADDR_NAK | I2C_Master_MSTAT_ERR_SHORT_XFER))
+        {
+            stats.naks++;
+            return ERROR_I2C_NAK;
+        }
+        stats.bus_errors++;
+        return ERROR_I2C_BUS_BUSY;
+    }
+    
+    /*
+    *   Decide whether a failed transfer is tried again, waiting the backoff
+    *   of the attempt first: a NAK from a sensor still booting, a lost
+    *   arbitration or a busy bus often clear by themselves in a few
+    *   hundred microseconds.
+    */
+    static uint8_t I2C_Retry(ErrorCode error, uint8_t attempt)
+    {
+        if (error == NO_ERROR || attempt >= I2C_PERIPHERAL_RETRIES)
+        {
+            return 0;
+        }
+        stats.retries++;
+        CyDelayUs((uint16_t)(I2C_PERIPHERAL_BACKOFF_US << attempt));
+        return 1;
+    }
+
+    ErrorCode I2C_Peripheral_Start(void) 
+    {
+        // Drop any transaction left over from a previous run
+        async_head = 0;
+        async_count = 0;
+        async_state = I2C_ASYNC_IDLE;
+        async_attempt = 0;
+        async_bus_held = 0;
+        
+        // Nothing is known about the devices yet
+        cache_used = 0;
+        cache_mode = I2C_CACHE_WRITE_THROUGH;
+        stats = (I2C_Peripheral_Stats){ 0 };
+        
+        // Start I2C peripheral
+        I2C_Master_Start();  
+        
+        // Return no error since start function does not return any error
+        return NO_ERROR;
+    }
+    
+    
+    ErrorCode I2C_Peripheral_Stop(void)
+    {
+        // Stop I2C peripheral
+        I2C_Master_Stop();
+        // Return no error since stop function does not return any error
+        return NO_ERROR;
+    }
+    
+    // Send the stop left pending by a failed asynchronous read, if the engine is idle
+    static void I2C_Bus_Release(void)
+    {
+        uint8_t interrupts = CyEnterCriticalSection();
+        uint8_t held = async_bus_held && async_state == I2C_ASYNC_IDLE;
+        async_bus_held = async_bus_held && !held;
+        CyExitCriticalSection(interrupts);
+        if (held)
+        {
+            I2C_Master_MasterSendStop();
+        }
+    }
+    
+    // One register read transaction on the bus, I2C_Master_MSTR_* code
+    static uint8_t I2C_Bus_Read(uint8_t device_address, uint8_t register_address,
+                                uint8_t register_count, uint8_t* data)
+    {
+        I2C_Bus_Release();
+        // Send start condition
+        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            // Write address of register to be read, with the MSB equal to 1 (auto-increment)
+            // when reading more than one
+            error = I2C_Master_MasterWriteByte(register_count > 1 ?
+                                               register_address | 0x80 : register_address);
+            if (error == I2C_Master_MSTR_NO_ERROR)
+            {
+                // Send restart condition
+                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
+                if (error == I2C_Master_MSTR_NO_ERROR)
+                {
+                    // Continue reading until we have register to read
+                    for (uint8_t i = 0; i + 1 < register_count; i++)
+                    {
+                        data[i] = I2C_Master_MasterReadByte(I2C_Master_ACK_DATA);
+                    }
+                    // Read last data without acknowledgement
+                    data[register_count - 1] = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
+                }
+            }
+        }
+        // Send stop condition
+        I2C_Master_MasterSendStop();
+        return error;
+    }
+    
+    // One register write transaction on the bus, I2C_Master_MSTR_* code
+    static uint8_t I2C_Bus_Write(uint8_t device_address, uint8_t register_address,
+                                 uint8_t register_count, const uint8_t* data)
+    {
+        I2C_Bus_Release();
+        // Send start condition
+        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            // Write register address with the MSB equal to 1 (auto-increment) for bursts
+            error = I2C_Master_MasterWriteByte(register_count > 1 ?
+                                               register_address | 0x80 : register_address);
+            // Continue writing until we have data to write
+            for (uint8_t i = 0; i < register_count && error == I2C_Master_MSTR_NO_ERROR; i++)
+            {
+                error = I2C_Master_MasterWriteByte(data[i]);
+            }
+        }
+        // Send stop condition
+        I2C_Master_MasterSendStop();
+        return error;
+    }
+
+    ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
+                                            uint8_t register_address,
+                                            uint8_t* data)
+    {
+        return I2C_Peripheral_ReadRegisterMulti(device_address, register_address, 1, data);
+    }
+    
+    ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
+                                                uint8_t register_address,
+                                                uint8_t register_count,
+                                                uint8_t* data)
+    {
+        // Serve the read from the shadow when possible
+        if (I2C_Cache_Read(device_address, register_address, register_count, data))
+        {
+            return NO_ERROR;
+        }
+        ErrorCode error;
+        uint8_t attempt = 0;
+        do
+        {
+            stats.transactions++;
+            error = I2C_Result(I2C_Bus_Read(device_address, register_address, register_count, data));
+        } while (I2C_Retry(error, attempt++));
+        I2C_Cache_Update(device_address, register_address, register_count, data, 0, error);
+        return error;
+    }
+    
+    ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t data)
+    {
+        return I2C_Peripheral_WriteRegisterMulti(device_address, register_address, 1, &data);
+    }
+    
+    ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t register_count,
+                                            uint8_t* data)
+    {
+        // Skip writes that would not change any register
+        if (I2C_Cache_Unchanged(device_address, register_address, register_count, data))
+        {
+            return NO_ERROR;
+        }
+        ErrorCode error;
+        uint8_t attempt = 0;
+        do
+        {
+            stats.transactions++;
+            error = I2C_Result(I2C_Bus_Write(device_address, register_address, register_count, data));
+        } while (I2C_Retry(error, attempt++));
+        I2C_Cache_Update(device_address, register_address, register_count, data, 1, error);
+        return error;
+    }
+    
+    ErrorCode I2C_Peripheral_WriteRegisterList(uint8_t device_address,
+                                               const I2C_Peripheral_RegisterWrite* writes,
+                                               uint8_t write_count)
+    {
+        uint8_t burst[I2C_PERIPHERAL_MAX_BURST];
+        uint8_t index = 0;
+        
+        while (index < write_count)
+        {
+            // Registers the shadow already holds are left out, the runs split around them
+            if (I2C_Cache_Holds(device_address, writes[index].register_address, writes[index].value))
+            {
+                stats.writes_skipped++;
+                index++;
+                continue;
+            }
+            // Extend the run while the next entry writes the next register, with a new value
+            uint8_t first = writes[index].register_address;
+            uint8_t length = 0;
+            do
+            {
+                burst[length++] = writes[index++].value;
+            } while (index < write_count && length < I2C_PERIPHERAL_MAX_BURST &&
+                     writes[index].register_address == (uint8_t)(first + length) &&
+                     !I2C_Cache_Holds(device_address, writes[index].register_address, writes[index].value));
+            
+            ErrorCode error = I2C_Peripheral_WriteRegisterMulti(device_address, first, length, burst);
+            if (error != NO_ERROR)
+            {
+                return error;
+            }
+        }
+        return NO_ERROR;
+    }
+    
+    
+    uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address)
+    {
+        stats.transactions++;
+        I2C_Bus_Release();
+        // Send a start condition followed by a stop condition
+        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
+        I2C_Master_MasterSendStop();
+        // If no error generated during stop, device is connected
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            return DEVICE_CONNECTED;
+        }
+        return DEVICE_UNCONNECTED;
+    }
+    
+    // Put the transaction at the head of the queue on the bus (interrupts masked)
+    static void I2C_Async_Begin(void)
+    {
+        I2C_Peripheral_Transaction* transaction = async_queue[async_head];
+        uint8_t sub_address = transaction->register_address;
+        // Restart on a bus left held by a failed read instead of waiting for its stop
+        uint8_t restart = async_bus_held ? I2C_Master_MODE_REPEAT_START : 0;
+        uint8_t error;
+        
+        // Auto-increment the sub-address on multi-register transfers
+        if (transaction->register_count > 1)
+        {
+            sub_address |= 0x80;
+        }
+        async_buffer[0] = sub_address;
+        I2C_Master_MasterClearStatus();
+        stats.transactions++;
+        
+        if (transaction->is_write)
+        {
+            for (uint8_t i = 0; i < transaction->register_count; i++)
+            {
+                async_buffer[1 + i] = transaction->data[i];
+            }
+            async_state = I2C_ASYNC_WRITING;
+            error = I2C_Master_MasterWriteBuf(transaction->device_address, async_buffer,
+                                              transaction->register_count + 1,
+                                              I2C_Master_MODE_COMPLETE_XFER | restart);
+        }
+        else
+        {
+            // Write the sub-address and keep the bus for the repeated start
+            async_state = I2C_ASYNC_ADDRESSING;
+            error = I2C_Master_MasterWriteBuf(transaction->device_address, async_buffer, 1,
+                                              I2C_Master_MODE_NO_STOP | restart);
+        }
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            async_bus_held = 0;
+        }
+        else
+        {
+            // The component refused the transfer (e.g. bus busy): fail it now
+            I2C_Async_Complete(I2C_Result(error));
+        }
+    }
+    
+    /*
+    *   Put a transaction that failed on the bus back on it, at most
+    *   I2C_PERIPHERAL_RETRIES times. There is no backoff in interrupt
+    *   context: the owner of the transaction backs off once it has failed
+    *   for good.
+    */
+    static void I2C_Async_Fail(ErrorCode error)
+    {
+        if (async_attempt < I2C_PERIPHERAL_RETRIES)
+        {
+            async_attempt++;
+            stats.retries++;
+            I2C_Async_Begin();
+            return;
+        }
+        I2C_Async_Complete(error);
+    }
+    
+    // Retire the transaction on the bus and start the next one
+    static void I2C_Async_Complete(ErrorCode error)
+    {
+        I2C_Peripheral_Transaction* transaction = async_queue[async_head];
+        
+        async_state = I2C_ASYNC_IDLE;
+        async_attempt = 0;
+        async_head = (async_head + 1) & (I2C_PERIPHERAL_QUEUE_SIZE - 1);
+        async_count--;
+        I2C_Cache_Update(transaction->device_address, transaction->register_address,
+                         transaction->register_count, transaction->data,
+                         transaction->is_write, error);
+        
+        // The callback may queue a follow-up transaction
+        if (transaction->callback != NULL)
+        {
+            transaction->callback(error, transaction);
+        }
+        if (async_count > 0 && async_state == I2C_ASYNC_IDLE)
+        {
+            I2C_Async_Begin();
+        }
+    }
+    
+    ErrorCode I2C_Peripheral_Submit(I2C_Peripheral_Transaction* transaction)
+    {
+        if (transaction->register_count == 0 ||
+            (transaction->is_write && transaction->register_count > I2C_PERIPHERAL_MAX_WRITE))
+        {
+            return ERROR;
+        }
+        
+        uint8_t interrupts = CyEnterCriticalSection();
+        if (async_count == I2C_PERIPHERAL_QUEUE_SIZE)
+        {
+            CyExitCriticalSection(interrupts);
+            return ERROR_QUEUE_FULL;
+        }
+        async_queue[(async_head + async_count) & (I2C_PERIPHERAL_QUEUE_SIZE - 1)] = transaction;
+        async_count++;
+        if (async_state == I2C_ASYNC_IDLE)
+        {
+            I2C_Async_Begin();
+        }
+        CyExitCriticalSection(interrupts);
+        return NO_ERROR;
+    }
+    
+    uint8_t I2C_Peripheral_IsBusy(void)
+    {
+        return async_count > 0;
+    }
+    
+    /*
+    *   Called at the end of every I2C_Master interrupt (enabled by
+    *   I2C_Master_ISR_EXIT_CALLBACK in cyapicallbacks.h). It advances the
+    *   asynchronous engine once the component reports that the current
+    *   buffer transfer is over.
+    */
+    void I2C_Master_ISR_ExitCallback(void)
+    {
+        if (async_state == I2C_ASYNC_IDLE)
+        {
+            return;
+        }
+        
+        uint8_t status = I2C_Master_MasterStatus();
+        uint8_t failed = (status & I2C_Master_MSTAT_ERR_XFER) != 0;
+        
+        switch (async_state)
+        {
+            case I2C_ASYNC_ADDRESSING:
+                if (status & I2C_Master_MSTAT_WR_CMPLT)
+                {
+                    if (failed)
+                    {
+                        // The component halts with the bus held: no blocking stop in
+                        // interrupt context, the next transfer starts with a restart
+                        async_bus_held = 1;
+                        I2C_Async_Fail(I2C_StatusResult(status));
+                    }
+                    else
+                    {
+                        I2C_Peripheral_Transaction* transaction = async_queue[async_head];
+                        I2C_Master_MasterClearStatus();
+                        async_state = I2C_ASYNC_READING;
+                        uint8_t error = I2C_Master_MasterReadBuf(transaction->device_address,
+                                                                 transaction->data,
+                                                                 transaction->register_count,
+                                                                 I2C_Master_MODE_REPEAT_START);
+                        if (error != I2C_Master_MSTR_NO_ERROR)
+                        {
+                            I2C_Async_Complete(I2C_Result(error));
+                        }
+                    }
+                }
+                break;
+            case I2C_ASYNC_READING:
+                if (status & I2C_Master_MSTAT_RD_CMPLT)
+                {
+                    if (failed)
+                    {
+                        I2C_Async_Fail(I2C_StatusResult(status));
+                    }
+                    else
+                    {
+                        I2C_Async_Complete(NO_ERROR);
+                    }
+                }
+                break;
+            case I2C_ASYNC_WRITING:
+                if (status & I2C_Master_MSTAT_WR_CMPLT)
+                {
+                    if (failed)
+                    {
+                        I2C_Async_Fail(I2C_StatusResult(status));
+                    }
+                    else
+                    {
+                        I2C_Async_Complete(NO_ERROR);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    ErrorCode I2C_Peripheral_Recover(void)
+    {
+        // Transactions in flight or queued are given up: their owners start over
+        uint8_t interrupts = CyEnterCriticalSection();
+        async_head = 0;
+        async_count = 0;
+        async_state = I2C_ASYNC_IDLE;
+        async_attempt = 0;
+        async_bus_held = 0;
+        CyExitCriticalSection(interrupts);
+        stats.recoveries++;
+        
+        // Controller off, so that it lets go of the lines
+        I2C_Master_Stop();
+        
+        uint8_t released = 1;
+#if defined(SCL_1_BYP) && defined(SDA_1_BYP)
+        // Lines taken from the controller: the data registers drive the open-drain pins
+        SCL_1_Write(1);
+        SDA_1_Write(1);
+        SCL_1_BYP &= (uint8)~SCL_1_MASK;
+        SDA_1_BYP &= (uint8)~SDA_1_MASK;
+        
+        // A slave stuck in the middle of a byte lets go of SDA within nine clocks
+        for (uint8_t pulse = 0; pulse < I2C_RECOVERY_PULSES && SDA_1_Read() == 0; pulse++)
+        {
+            SCL_1_Write(0);
+            CyDelayUs(I2C_RECOVERY_HALF_BIT_US);
+            SCL_1_Write(1);
+            CyDelayUs(I2C_RECOVERY_HALF_BIT_US);
+        }
+        // STOP condition (SDA rising while SCL is high) resets the slave state machines
+        SCL_1_Write(0);
+        CyDelayUs(I2C_RECOVERY_HALF_BIT_US);
+        SDA_1_Write(0);
+        CyDelayUs(I2C_RECOVERY_HALF_BIT_US);
+        SCL_1_Write(1);
+        CyDelayUs(I2C_RECOVERY_HALF_BIT_US);
+        SDA_1_Write(1);
+        CyDelayUs(I2C_RECOVERY_HALF_BIT_US);
+        released = SDA_1_Read();
+        
+        // Lines back to the controller
+        SCL_1_BYP |= SCL_1_MASK;
+        SDA_1_BYP |= SDA_1_MASK;
+#endif
+        
+        I2C_Master_Start();
+        // The devices may have been reset or left with a half written register
+        I2C_Peripheral_CacheInvalidate(I2C_PERIPHERAL_ALL_DEVICES);
+        return released ? NO_ERROR : ERROR_I2C_BUS_STUCK;
+    }
+
+/* [] END OF FILE */
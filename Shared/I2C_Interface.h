@@ -0,0 +1,302 @@
+/** 
+ * \file I2C_Interface.h
+ * \brief Hardware specific I2C interface.
+ *
+ * This is an interface to the I2C peripheral. If you need to port 
+ * this C-code to another platform, you could simply replace this
+ * interface and still use the code.
+ *
+ * \author Davide Marzorati
+ * \date September 12, 2019
+*/
+
+#ifndef I2C_Interface_H
+    #define I2C_Interface_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /** \brief Start the I2C peripheral.
+    *   
+    *   This function starts the I2C peripheral so that it is ready to work.
+    */
+    ErrorCode I2C_Peripheral_Start(void);
+    
+    /** \brief Stop the I2C peripheral.
+    *   
+    *   This function stops the I2C peripheral from working.
+    */
+    ErrorCode I2C_Peripheral_Stop(void);
+    
+    /**
+    *   \brief Attempts of a failed transfer after the first one.
+    *
+    *   The blocking functions wait I2C_PERIPHERAL_BACKOFF_US before the
+    *   first retry and twice as long before each of the next ones (700 us
+    *   in all with the defaults); the asynchronous engine retries at once.
+    */
+    #ifndef I2C_PERIPHERAL_RETRIES
+        #define I2C_PERIPHERAL_RETRIES 3
+    #endif
+    
+    /**
+    *   \brief Wait before the first retry of a failed transfer [us].
+    */
+    #ifndef I2C_PERIPHERAL_BACKOFF_US
+        #define I2C_PERIPHERAL_BACKOFF_US 100
+    #endif
+    
+    /**
+    *   \brief Read one byte over I2C.
+    *   
+    *   This function performs a complete reading operation over I2C from a single
+    *   register.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param register_address Address of the register to be read.
+    *   \param data Pointer to a variable where the byte will be saved.
+    *   \retval ERROR_I2C_* code of the last attempt if every attempt failed.
+    */
+    ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
+                                            uint8_t register_address,
+                                            uint8_t* data);
+    
+    /** 
+    *   \brief Read multiple bytes over I2C.
+    *   
+    *   This function performs a complete reading operation over I2C from multiple
+    *   registers.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param register_address Address of the first register to be read.
+    *   \param register_count Number of registers we want to read.
+    *   \param data Pointer to an array where data will be saved.
+    *   \retval ERROR_I2C_* code of the last attempt if every attempt failed.
+    */
+    ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
+                                                uint8_t register_address,
+                                                uint8_t register_count,
+                                                uint8_t* data);
+    /** 
+    *   \brief Write a byte over I2C.
+    *   
+    *   This function performs a complete writing operation over I2C to a single 
+    *   register.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param register_address Address of the register to be written.
+    *   \param data Data to be written
+    *   \retval ERROR_I2C_* code of the last attempt if every attempt failed.
+    */
+    ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t data);
+    
+    /** 
+    *   \brief Write multiple bytes over I2C.
+    *   
+    *   This function performs a complete writing operation over I2C to multiple
+    *   registers, in one transaction with the sub-address auto-incremented.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param register_address Address of the first register to be written.
+    *   \param register_count Number of registers that need to be written.
+    *   \param data Array of data to be written
+    *   \retval ERROR_I2C_* code of the last attempt if every attempt failed.
+    */
+    ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t register_count,
+                                            uint8_t* data);
+    
+    /**
+    *   \brief Longest burst issued by I2C_Peripheral_WriteRegisterList().
+    */
+    #ifndef I2C_PERIPHERAL_MAX_BURST
+        #define I2C_PERIPHERAL_MAX_BURST 16
+    #endif
+    
+    /**
+    *   \brief Register write in a I2C_Peripheral_WriteRegisterList() list.
+    */
+    typedef struct {
+        uint8_t register_address;   ///< Register to be written
+        uint8_t value;              ///< Value to be written
+    } I2C_Peripheral_RegisterWrite;
+    
+    /**
+    *   \brief Write a list of registers over I2C.
+    *
+    *   The writes are performed in the order of the list. Entries whose
+    *   registers follow each other are merged into one burst (at most
+    *   I2C_PERIPHERAL_MAX_BURST registers), so a list sorted by address
+    *   costs one transaction per contiguous run. With the shadow in
+    *   I2C_CACHE_WRITE_THROUGH mode the entries it already holds are left
+    *   out, so only the registers that change are written.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param writes Registers and values to be written.
+    *   \param write_count Number of entries in writes.
+    *   \retval ERROR_I2C_* code if a transfer failed; the following entries are not written.
+    */
+    ErrorCode I2C_Peripheral_WriteRegisterList(uint8_t device_address,
+                                               const I2C_Peripheral_RegisterWrite* writes,
+                                               uint8_t write_count);
+    
+    /**
+    *   \brief Check if device is connected over I2C.
+    *
+    *   This function checks if a device is connected over the I2C lines.
+    *   \param device_address I2C address of the device to be checked.
+    *   \retval Returns true (>0) if device is connected.
+    */
+    uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address);
+
+    /**
+    *   \brief Number of registers the shadow cache can hold.
+    */
+    #ifndef I2C_PERIPHERAL_CACHE_SIZE
+        #define I2C_PERIPHERAL_CACHE_SIZE 16
+    #endif
+
+    /**
+    *   \brief Device address matching every device in I2C_Peripheral_CacheInvalidate().
+    */
+    #define I2C_PERIPHERAL_ALL_DEVICES 0xFF
+
+    /**
+    *   \brief Modes of the register shadow cache.
+    *
+    *   Only registers declared with I2C_Peripheral_CacheRegisters() are
+    *   cached: status and output registers change on their own and must
+    *   never be. The shadow is updated by every successful read and write
+    *   of a cached register (blocking or asynchronous) and dropped when a
+    *   write fails.
+    */
+    typedef enum {
+        I2C_CACHE_OFF,              ///< Every access goes to the bus
+        I2C_CACHE_WRITE_THROUGH,    ///< Reads of valid registers served from the shadow, unchanged writes skipped
+        I2C_CACHE_VERIFY            ///< Every access goes to the bus, reads are checked against the shadow
+    } I2C_Peripheral_CacheMode;
+
+    /**
+    *   \brief Counters of the I2C layer, cleared by I2C_Peripheral_Start().
+    */
+    typedef struct {
+        uint32_t transactions;      ///< Transactions put on the bus
+        uint32_t reads_served;      ///< Read transactions answered by the shadow
+        uint32_t writes_skipped;    ///< Write transactions, and list entries, that would not have changed anything
+        uint32_t verify_mismatches; ///< Registers read back different from the shadow
+        uint32_t errors;            ///< Transactions that failed, for any of the reasons below
+        uint32_t naks;              ///< Address or data byte not acknowledged
+        uint32_t arbitration_lost;  ///< Bus taken by another master
+        uint32_t bus_errors;        ///< Bus busy, controller not ready or transfer refused
+        uint32_t retries;           ///< Transactions put on the bus again after a failure
+        uint32_t recoveries;        ///< Calls to I2C_Peripheral_Recover()
+    } I2C_Peripheral_Stats;
+
+    /**
+    *   \brief Declare registers as cacheable.
+    *
+    *   Registers already declared are left as they are; new ones start
+    *   invalid. I2C_Peripheral_Start() empties the cache.
+    *   \retval ERROR if the cache has no room left.
+    */
+    ErrorCode I2C_Peripheral_CacheRegisters(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t register_count);
+
+    /**
+    *   \brief Forget the shadow values of a device (e.g. after a sensor reboot).
+    *
+    *   \param device_address I2C address, or I2C_PERIPHERAL_ALL_DEVICES.
+    */
+    void I2C_Peripheral_CacheInvalidate(uint8_t device_address);
+
+    /**
+    *   \brief Select the cache mode (I2C_CACHE_WRITE_THROUGH after start).
+    */
+    void I2C_Peripheral_SetCacheMode(I2C_Peripheral_CacheMode mode);
+
+    /**
+    *   \brief Counters since I2C_Peripheral_Start().
+    */
+    I2C_Peripheral_Stats I2C_Peripheral_GetStats(void);
+
+    /**
+    *   \brief Number of transactions that can wait in the asynchronous queue.
+    *
+    *   Must be a power of two.
+    */
+    #ifndef I2C_PERIPHERAL_QUEUE_SIZE
+        #define I2C_PERIPHERAL_QUEUE_SIZE 4
+    #endif
+
+    /**
+    *   \brief Largest payload of an asynchronous write transaction.
+    */
+    #ifndef I2C_PERIPHERAL_MAX_WRITE
+        #define I2C_PERIPHERAL_MAX_WRITE 8
+    #endif
+
+    struct I2C_Peripheral_Transaction;
+
+    /**
+    *   \brief Completion callback of an asynchronous transaction.
+    *
+    *   Called from the I2C_Master interrupt once the transaction is over.
+    *   It may submit further transactions (e.g. to chain a data read after
+    *   a status read) but must not call the blocking functions.
+    *   \param error NO_ERROR if the whole transfer was acknowledged, otherwise
+    *                the ERROR_I2C_* code of the last attempt.
+    *   \param transaction The completed transaction.
+    */
+    typedef void (*I2C_Peripheral_Callback)(ErrorCode error,
+                                            struct I2C_Peripheral_Transaction* transaction);
+
+    /**
+    *   \brief Descriptor of an asynchronous transaction.
+    *
+    *   The descriptor is owned by the caller and must stay valid until its
+    *   callback has been called.
+    */
+    typedef struct I2C_Peripheral_Transaction {
+        uint8_t device_address;             ///< I2C address of the device to talk to
+        uint8_t register_address;           ///< Address of the first register
+        uint8_t register_count;             ///< Number of registers to transfer
+        uint8_t is_write;                   ///< 0 to read the registers, 1 to write them
+        uint8_t* data;                      ///< Source or destination buffer
+        I2C_Peripheral_Callback callback;   ///< Completion callback (may be NULL)
+        void* context;                      ///< Free for the caller
+    } I2C_Peripheral_Transaction;
+
+    /**
+    *   \brief Queue an asynchronous transaction.
+    *
+    *   The transfer is run by the I2C_Master interrupt using the component
+    *   buffer API, so the CPU is free while bytes are on the bus. Multi
+    *   register transfers set the auto-increment bit of the sub-address.
+    *   The blocking functions must not be used while transactions are
+    *   pending.
+    *   \param transaction Descriptor of the transaction.
+    *   \retval ERROR_QUEUE_FULL if the queue is full, ERROR if the descriptor is invalid.
+    */
+    ErrorCode I2C_Peripheral_Submit(I2C_Peripheral_Transaction* transaction);
+
+    /**
+    *   \brief Check if asynchronous transactions are running or queued.
+    *
+    *   \retval Returns true (>0) while the engine is busy.
+    */
+    uint8_t I2C_Peripheral_IsBusy(void);
+
+    /**
+    *   \brief Bring a faulty bus back to idle.
+    *
+    *   Gives up the asynchronous transactions (their callbacks are not
+    *   called), stops I2C_Master and, with the SCL_1 and SDA_1 pins taken
+    *   from it, clocks SCL until a slave stuck in the middle of a byte
+    *   releases SDA (at most 9 pulses) and generates a STOP. I2C_Master is
+    *   then started again and the register shadow is emptied: the caller
+    *   writes back the device configuration. Takes about 110 us.
+    *   \retval ERROR_I2C_BUS_STUCK if SDA is still held low.
+    */
+    ErrorCode I2C_Peripheral_Recover(void);
+
+#endif // I2C_Interface_H
+/* [] END OF FILE */
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*
+* This file includes the source code of the LIS3DH driver shared by the
+* projects.
+*/
+#include "LIS3DH.h"
+#include "I2C_Interface.h"
+#include "Timestamp.h"
+#include "CyLib.h"
+
+#include <stddef.h>
+
+// Entry of a TEMP_CFG_REG..CTRL_REG6 block by register address
+#define CONFIG_REG(address) registers[(address) - LIS3DH_CONFIG_FIRST_REG]
+
+    // Let the I2C interface shadow the configuration registers
+    static void LIS3DH_CacheConfig(uint8_t device_address)
+    {
+        // Errors only mean that the registers stay uncached
+        (void)I2C_Peripheral_CacheRegisters(device_address, LIS3DH_CONFIG_FIRST_REG,
+                                            LIS3DH_CONFIG_REG_COUNT);
+        (void)I2C_Peripheral_CacheRegisters(device_address, LIS3DH_FIFO_CTRL_REG, 1);
+    }
+    
+    void LIS3DH_EncodeConfig(const LIS3DH_Config* config,
+                             uint8_t registers[LIS3DH_CONFIG_REG_COUNT],
+                             uint8_t* fifo_ctrl_reg)
+    {
+        // TEMP_CFG_REG[7]=ADC_EN, TEMP_CFG_REG[6]=TEMP_EN
+        CONFIG_REG(LIS3DH_TEMP_CFG_REG) = (config->adc ? 0x80 : 0x00) |
+                                          (config->temperature ? 0x40 : 0x00);
+        // CTRL_REG1[7:4]=ODR, CTRL_REG1[3]=LPen, CTRL_REG1[2:0]=Zen Yen Xen
+        CONFIG_REG(LIS3DH_CTRL_REG1) = (uint8_t)(config->odr << 4) |
+                                       (config->mode == LIS3DH_MODE_LOW_POWER ? 0x08 : 0x00) |
+                                       (config->axes & LIS3DH_AXES_XYZ);
+        // CTRL_REG2[2]=HP_CLICK, CTRL_REG2[0]=HP_IA1, normal high-pass mode, outputs unfiltered (FDS=0)
+        CONFIG_REG(LIS3DH_CTRL_REG2) = (config->click_highpass ? 0x04 : 0x00) |
+                                       (config->int1_highpass ? 0x01 : 0x00);
+        CONFIG_REG(LIS3DH_CTRL_REG3) = config->int1;
+        // CTRL_REG4[7]=BDU, CTRL_REG4[5:4]=FS, CTRL_REG4[3]=HR
+        CONFIG_REG(LIS3DH_CTRL_REG4) = (config->block_data_update ? 0x80 : 0x00) |
+                                       (uint8_t)((config->full_scale & 0x03) << 4) |
+                                       (config->mode == LIS3DH_MODE_HIGH_RESOLUTION ? 0x08 : 0x00);
+        // CTRL_REG5[6]=FIFO_EN, CTRL_REG5[3]=LIR_INT1
+        CONFIG_REG(LIS3DH_CTRL_REG5) = (config->fifo_mode != LIS3DH_FIFO_BYPASS ? 0x40 : 0x00) |
+                                       (config->int1_latch ? 0x08 : 0x00);
+        // Nothing routed to INT2
+        CONFIG_REG(LIS3DH_CTRL_REG6) = 0x00;
+        
+        if (fifo_ctrl_reg != NULL)
+        {
+            // FIFO_CTRL_REG[7:6]=FM, FIFO_CTRL_REG[4:0]=FTH
+            *fifo_ctrl_reg = (uint8_t)(config->fifo_mode << 6) | (config->fifo_watermark & 0x1F);
+        }
+    }
+    
+    ErrorCode LIS3DH_WaitBoot(uint8_t device_address, uint32_t timeout_us)
+    {
+        uint32_t start = Timestamp_Now();
+        
+        // The address is not acknowledged until the boot is over
+        while (!I2C_Peripheral_IsDeviceConnected(device_address))
+        {
+            if (Timestamp_Now() - start >= timeout_us)
+            {
+                return ERROR_I2C_NAK;
+            }
+            CyDelayUs(LIS3DH_BOOT_POLL_US);
+        }
+        uint8_t who_am_i;
+        ErrorCode error = I2C_Peripheral_ReadRegister(device_address, LIS3DH_WHO_AM_I_REG_ADDR, &who_am_i);
+        if (error == NO_ERROR && who_am_i != LIS3DH_WHO_AM_I_VALUE)
+        {
+            error = ERROR;
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_Configure(const LIS3DH_Config* config)
+    {
+        uint8_t registers[LIS3DH_CONFIG_REG_COUNT];
+        uint8_t fifo_ctrl_reg;
+        I2C_Peripheral_RegisterWrite writes[LIS3DH_CONFIG_REG_COUNT + 1];
+        
+        LIS3DH_EncodeConfig(config, registers, &fifo_ctrl_reg);
+        LIS3DH_CacheConfig(config->device_address);
+        // Contiguous block first: merged into a single burst
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_REG_COUNT; i++)
+        {
+            writes[i].register_address = LIS3DH_CONFIG_FIRST_REG + i;
+            writes[i].value = registers[i];
+        }
+        writes[LIS3DH_CONFIG_REG_COUNT].register_address = LIS3DH_FIFO_CTRL_REG;
+        writes[LIS3DH_CONFIG_REG_COUNT].value = fifo_ctrl_reg;
+        return I2C_Peripheral_WriteRegisterList(config->device_address, writes,
+                                                LIS3DH_CONFIG_REG_COUNT + 1);
+    }
+    
+    // INT1_THS and CLICK_THS steps of a threshold, rounded up and saturated
+    static uint8_t LIS3DH_ThresholdSteps(LIS3DH_FullScale full_scale, uint16_t threshold_mg)
+    {
+        // LSb by full scale
+        static const uint8_t threshold_step_mg[4] = { 16, 32, 62, 186 };
+        uint8_t step = threshold_step_mg[full_scale & 0x03];
+        uint16_t threshold = (uint16_t)((threshold_mg + step - 1) / step);
+        return (uint8_t)(threshold > 0x7F ? 0x7F : threshold);
+    }
+    
+    // INT1_CFG, then INT1_THS and INT1_DURATION in one burst
+    static ErrorCode LIS3DH_ConfigureIa1(uint8_t device_address, uint8_t int1_cfg, LIS3DH_FullScale full_scale,
+                                         uint16_t threshold_mg, uint8_t duration)
+    {
+        I2C_Peripheral_RegisterWrite writes[3];
+        
+        writes[0].register_address = LIS3DH_INT1_CFG;
+        writes[0].value = threshold_mg > 0 ? int1_cfg : 0x00;
+        writes[1].register_address = LIS3DH_INT1_THS;
+        writes[1].value = LIS3DH_ThresholdSteps(full_scale, threshold_mg);
+        writes[2].register_address = LIS3DH_INT1_DURATION;
+        writes[2].value = duration & 0x7F;
+        return I2C_Peripheral_WriteRegisterList(device_address, writes, 3);
+    }
+    
+    ErrorCode LIS3DH_ConfigureMotion(uint8_t device_address, LIS3DH_FullScale full_scale,
+                                     uint16_t threshold_mg, uint8_t duration)
+    {
+        // INT1_CFG[7]=AOI=0 (OR), INT1_CFG[5]=ZHIE, INT1_CFG[3]=YHIE, INT1_CFG[1]=XHIE
+        return LIS3DH_ConfigureIa1(device_address, 0x2A, full_scale, threshold_mg, duration);
+    }
+    
+    ErrorCode LIS3DH_ConfigureFreeFall(uint8_t device_address, LIS3DH_FullScale full_scale,
+                                       uint16_t threshold_mg, uint8_t duration)
+    {
+        // INT1_CFG[7]=AOI=1 (AND), INT1_CFG[4]=ZLIE, INT1_CFG[2]=YLIE, INT1_CFG[0]=XLIE
+        return LIS3DH_ConfigureIa1(device_address, 0x95, full_scale, threshold_mg, duration);
+    }
+    
+    ErrorCode LIS3DH_ConfigureClick(uint8_t device_address, LIS3DH_FullScale full_scale,
+                                    uint16_t threshold_mg, uint8_t time_limit, uint8_t time_latency,
+                                    uint8_t latch)
+    {
+        I2C_Peripheral_RegisterWrite writes[5];
+        
+        // CLICK_CFG[4]=ZS, CLICK_CFG[2]=YS, CLICK_CFG[0]=XS
+        writes[0].register_address = LIS3DH_CLICK_CFG;
+        writes[0].value = threshold_mg > 0 ? 0x15 : 0x00;
+        // CLICK_THS[7]=LIR_Click, CLICK_THS[6:0]=THS; CLICK_SRC in between is read-only
+        writes[1].register_address = LIS3DH_CLICK_THS;
+        writes[1].value = (latch ? 0x80 : 0x00) | LIS3DH_ThresholdSteps(full_scale, threshold_mg);
+        writes[2].register_address = LIS3DH_TIME_LIMIT;
+        writes[2].value = time_limit & 0x7F;
+        writes[3].register_address = LIS3DH_TIME_LATENCY;
+        writes[3].value = time_latency;
+        writes[4].register_address = LIS3DH_TIME_WINDOW;
+        writes[4].value = 0x00;
+        return I2C_Peripheral_WriteRegisterList(device_address, writes, 5);
+    }
+    
+    ErrorCode LIS3DH_ReadConfig(uint8_t device_address, uint8_t registers[LIS3DH_CONFIG_REG_COUNT])
+    {
+        LIS3DH_CacheConfig(device_address);
+        return I2C_Peripheral_ReadRegisterMulti(device_address, LIS3DH_CONFIG_FIRST_REG,
+                                                LIS3DH_CONFIG_REG_COUNT, registers);
+    }
+    
+    ErrorCode LIS3DH_UpdateRegister(uint8_t device_address, uint8_t register_address,
+                                    uint8_t mask, uint8_t value)
+    {
+        uint8_t reg;
+        
+        LIS3DH_CacheConfig(device_address);
+        ErrorCode error = I2C_Peripheral_ReadRegister(device_address, register_address, &reg);
+        if (error == NO_ERROR)
+        {
+            reg = (reg & ~mask) | (value & mask);
+            error = I2C_Peripheral_WriteRegister(device_address, register_address, reg);
+        }
+        return error;
+    }
+    
+    uint8_t LIS3DH_OutputShift(LIS3DH_Mode mode)
+    {
+        // Left-justified 8, 10 or 12-bit two's complement
+        return LIS3DH_OUTPUT_SHIFT(mode);
+    }
+    
+    uint16_t LIS3DH_OdrHz(LIS3DH_Odr odr, LIS3DH_Mode mode)
+    {
+        static const uint16_t odr_hz[] = { 0, 1, 10, 25, 50, 100, 200, 400, 0, 1344 };
+        
+        if (mode == LIS3DH_MODE_LOW_POWER)
+        {
+            // Low-power mode adds 1.6 kHz and turns 1.344 kHz into 5.376 kHz
+            if (odr == LIS3DH_ODR_1600_HZ_LP)
+            {
+                return 1600;
+            }
+            if (odr == LIS3DH_ODR_1344_HZ)
+            {
+                return 5376;
+            }
+        }
+        return (unsigned)odr < sizeof(odr_hz) / sizeof(odr_hz[0]) ? odr_hz[odr] : 0;
+    }
+    
+    uint8_t LIS3DH_SensitivityMg(LIS3DH_Mode mode, LIS3DH_FullScale full_scale)
+    {
+        return LIS3DH_SENSITIVITY_MG(mode, full_scale & 0x03);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,318 @@
+/**
+*   \file LIS3DH.h
+*   \brief LIS3DH accelerometer driver shared by the projects.
+*
+*   The whole sensor configuration is described by an LIS3DH_Config and
+*   written by LIS3DH_Configure() in one auto-incremented burst from
+*   TEMP_CFG_REG to CTRL_REG6, plus FIFO_CTRL_REG which lies outside that
+*   range; once the registers are shadowed only the ones that change are
+*   written. The driver uses the blocking functions of I2C_Interface.h, so
+*   it is meant for boot and mode switches, not for the sample path.
+*/
+#ifndef LIS3DH_H
+    #define LIS3DH_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    /** \brief 7-bit I2C address with SDO/SA0 tied low (0x19 with SA0 high). */
+    #define LIS3DH_DEVICE_ADDRESS       0x18
+
+    /** \brief Expected content of WHO_AM_I. */
+    #define LIS3DH_WHO_AM_I_VALUE       0x33
+
+    // Register map
+    #define LIS3DH_STATUS_REG_AUX       0x07
+    #define LIS3DH_OUT_ADC_1L           0x08
+    #define LIS3DH_OUT_ADC_3L           0x0C
+    #define LIS3DH_OUT_ADC_3H           0x0D
+    #define LIS3DH_WHO_AM_I_REG_ADDR    0x0F
+    #define LIS3DH_TEMP_CFG_REG         0x1F
+    #define LIS3DH_CTRL_REG1            0x20
+    #define LIS3DH_CTRL_REG2            0x21
+    #define LIS3DH_CTRL_REG3            0x22
+    #define LIS3DH_CTRL_REG4            0x23
+    #define LIS3DH_CTRL_REG5            0x24
+    #define LIS3DH_CTRL_REG6            0x25
+    #define LIS3DH_REFERENCE            0x26
+    #define LIS3DH_STATUS_REG           0x27
+    #define LIS3DH_OUT_X_L              0x28
+    #define LIS3DH_OUT_Y_L              0x2A
+    #define LIS3DH_OUT_Z_L              0x2C
+    #define LIS3DH_FIFO_CTRL_REG        0x2E
+    #define LIS3DH_FIFO_SRC_REG         0x2F
+    #define LIS3DH_INT1_CFG             0x30
+    #define LIS3DH_INT1_SRC             0x31
+    #define LIS3DH_INT1_THS             0x32
+    #define LIS3DH_INT1_DURATION        0x33
+    #define LIS3DH_INT2_CFG             0x34
+    #define LIS3DH_INT2_SRC             0x35
+    #define LIS3DH_INT2_THS             0x36
+    #define LIS3DH_INT2_DURATION        0x37
+    #define LIS3DH_CLICK_CFG            0x38
+    #define LIS3DH_CLICK_SRC            0x39
+    #define LIS3DH_CLICK_THS            0x3A
+    #define LIS3DH_TIME_LIMIT           0x3B
+    #define LIS3DH_TIME_LATENCY         0x3C
+    #define LIS3DH_TIME_WINDOW          0x3D
+    #define LIS3DH_ACT_THS              0x3E
+    #define LIS3DH_ACT_DUR              0x3F
+
+    /** \brief Depth of the output FIFO (samples). */
+    #define LIS3DH_FIFO_LENGTH          32
+
+    /** \brief Registers written by the configuration burst (TEMP_CFG_REG..CTRL_REG6). */
+    #define LIS3DH_CONFIG_FIRST_REG     LIS3DH_TEMP_CFG_REG
+    #define LIS3DH_CONFIG_REG_COUNT     7
+
+    // CTRL_REG3 bits routed to INT1
+    #define LIS3DH_INT1_CLICK           0x80
+    #define LIS3DH_INT1_IA1             0x40
+    #define LIS3DH_INT1_IA2             0x20
+    #define LIS3DH_INT1_ZYXDA           0x10
+    #define LIS3DH_INT1_WTM             0x04
+    #define LIS3DH_INT1_OVERRUN         0x02
+
+    // INT1_SRC and CLICK_SRC bits
+    #define LIS3DH_SRC_IA               0x40
+    #define LIS3DH_CLICK_SRC_SINGLE     0x10
+    #define LIS3DH_CLICK_SRC_NEGATIVE   0x08
+
+    // CTRL_REG1[2:0] axis enables
+    #define LIS3DH_AXIS_X               0x01
+    #define LIS3DH_AXIS_Y               0x02
+    #define LIS3DH_AXIS_Z               0x04
+    #define LIS3DH_AXES_XYZ             0x07
+
+    /**
+    *   \brief Output data rates, CTRL_REG1[7:4].
+    */
+    typedef enum {
+        LIS3DH_ODR_POWER_DOWN = 0x0,
+        LIS3DH_ODR_1_HZ = 0x1,
+        LIS3DH_ODR_10_HZ = 0x2,
+        LIS3DH_ODR_25_HZ = 0x3,
+        LIS3DH_ODR_50_HZ = 0x4,
+        LIS3DH_ODR_100_HZ = 0x5,
+        LIS3DH_ODR_200_HZ = 0x6,
+        LIS3DH_ODR_400_HZ = 0x7,
+        LIS3DH_ODR_1600_HZ_LP = 0x8,    ///< Low-power mode only
+        LIS3DH_ODR_1344_HZ = 0x9        ///< 5376 Hz in low-power mode
+    } LIS3DH_Odr;
+
+    /**
+    *   \brief Operating modes (CTRL_REG1[3] LPen, CTRL_REG4[3] HR).
+    */
+    typedef enum {
+        LIS3DH_MODE_LOW_POWER = 0,      ///< 8-bit output
+        LIS3DH_MODE_NORMAL = 1,         ///< 10-bit output
+        LIS3DH_MODE_HIGH_RESOLUTION = 2 ///< 12-bit output
+    } LIS3DH_Mode;
+
+    /**
+    *   \brief Full scales, CTRL_REG4[5:4].
+    */
+    typedef enum {
+        LIS3DH_FULL_SCALE_2G = 0,
+        LIS3DH_FULL_SCALE_4G = 1,
+        LIS3DH_FULL_SCALE_8G = 2,
+        LIS3DH_FULL_SCALE_16G = 3
+    } LIS3DH_FullScale;
+
+    /**
+    *   \brief FIFO modes, FIFO_CTRL_REG[7:6].
+    */
+    typedef enum {
+        LIS3DH_FIFO_BYPASS = 0,         ///< FIFO disabled
+        LIS3DH_FIFO_FIFO = 1,           ///< Stop collecting when full
+        LIS3DH_FIFO_STREAM = 2,         ///< Overwrite the oldest sample when full
+        LIS3DH_FIFO_STREAM_TO_FIFO = 3  ///< Stream until the interrupt, then FIFO
+    } LIS3DH_FifoMode;
+
+    /**
+    *   \brief Sensor configuration.
+    *
+    *   Fields left at zero give a powered-down sensor with every optional
+    *   feature disabled.
+    */
+    typedef struct {
+        uint8_t device_address;         ///< 7-bit I2C address
+        LIS3DH_Odr odr;                 ///< Output data rate
+        LIS3DH_Mode mode;               ///< Resolution / power mode
+        LIS3DH_FullScale full_scale;    ///< Full scale
+        uint8_t axes;                   ///< Enabled axes (LIS3DH_AXIS_*)
+        uint8_t block_data_update;      ///< Non-zero: outputs not updated until both bytes are read
+        LIS3DH_FifoMode fifo_mode;      ///< FIFO mode (CTRL_REG5 FIFO_EN set unless bypass)
+        uint8_t fifo_watermark;         ///< FIFO threshold (FTH, 0..31)
+        uint8_t int1;                   ///< Sources routed to INT1 (LIS3DH_INT1_*)
+        uint8_t int1_latch;             ///< Non-zero: IA1 held on INT1 until INT1_SRC is read (CTRL_REG5 LIR_INT1)
+        uint8_t int1_highpass;          ///< Non-zero: IA1 fed with high-pass filtered data (CTRL_REG2 HP_IA1)
+        uint8_t click_highpass;         ///< Non-zero: click engine fed with high-pass filtered data (CTRL_REG2 HP_CLICK)
+        uint8_t adc;                    ///< Non-zero: auxiliary ADC enabled
+        uint8_t temperature;            ///< Non-zero: temperature sensor on ADC3 (needs adc and BDU)
+    } LIS3DH_Config;
+
+    /**
+    *   \brief Register values of a configuration.
+    *
+    *   \param config Configuration.
+    *   \param registers Receives TEMP_CFG_REG..CTRL_REG6.
+    *   \param fifo_ctrl_reg Receives FIFO_CTRL_REG (may be NULL).
+    */
+    void LIS3DH_EncodeConfig(const LIS3DH_Config* config,
+                             uint8_t registers[LIS3DH_CONFIG_REG_COUNT],
+                             uint8_t* fifo_ctrl_reg);
+
+    /** \brief Longest wait for the boot of the sensor, about 5 ms after power-up [us]. */
+    #ifndef LIS3DH_BOOT_TIMEOUT_US
+        #define LIS3DH_BOOT_TIMEOUT_US 10000
+    #endif
+
+    /** \brief Interval between two polls of a sensor still booting [us]. */
+    #ifndef LIS3DH_BOOT_POLL_US
+        #define LIS3DH_BOOT_POLL_US 100
+    #endif
+
+    /**
+    *   \brief Wait until the sensor is out of its boot.
+    *
+    *   Polls the address every LIS3DH_BOOT_POLL_US, then reads WHO_AM_I,
+    *   instead of waiting the whole boot time blindly: a sensor already
+    *   up (PSoC reset alone) costs a single transaction. Timestamp.h must
+    *   be started.
+    *   \param device_address I2C address of the sensor.
+    *   \param timeout_us Longest wait, LIS3DH_BOOT_TIMEOUT_US for a power-up.
+    *   \retval ERROR_I2C_NAK if the address is still not acknowledged after
+    *           \p timeout_us, ERROR if WHO_AM_I is not LIS3DH_WHO_AM_I_VALUE.
+    */
+    ErrorCode LIS3DH_WaitBoot(uint8_t device_address, uint32_t timeout_us);
+
+    /**
+    *   \brief Write a configuration to the sensor.
+    *
+    *   One burst from TEMP_CFG_REG to CTRL_REG6, then FIFO_CTRL_REG.
+    *   The registers are shadowed by the I2C interface: the ones already
+    *   holding their value are left out of the bursts, so writing the
+    *   configuration already in place costs no transaction.
+    *   \retval ERROR if a transfer was not acknowledged.
+    */
+    ErrorCode LIS3DH_Configure(const LIS3DH_Config* config);
+
+    /**
+    *   \brief Set up the IA1 generator to detect motion on any axis.
+    *
+    *   INT1_CFG enables the high events of X, Y and Z (OR combination),
+    *   then INT1_THS and INT1_DURATION go in one burst. The generator only
+    *   reaches INT1 through LIS3DH_INT1_IA1; with int1_highpass gravity
+    *   is filtered out, and a read of REFERENCE sets the filter to the
+    *   current acceleration. A threshold of 0 disables the generator.
+    *   \param device_address I2C address of the sensor.
+    *   \param full_scale Full scale the sensor runs with: it sets the
+    *          INT1_THS step (16, 32, 62 or 186 mg).
+    *   \param threshold_mg Threshold, rounded up to a whole step.
+    *   \param duration Samples the threshold must be exceeded for (0..127).
+    */
+    ErrorCode LIS3DH_ConfigureMotion(uint8_t device_address, LIS3DH_FullScale full_scale,
+                                     uint16_t threshold_mg, uint8_t duration);
+
+    /**
+    *   \brief Set up the IA1 generator to detect a free fall.
+    *
+    *   INT1_CFG enables the low events of X, Y and Z in AND combination
+    *   (AOI): every axis close to 0 g at once, which gravity alone never
+    *   gives. Unlike motion detection the generator needs the unfiltered
+    *   data (int1_highpass off). A threshold of 0 disables the generator.
+    *   \param device_address I2C address of the sensor.
+    *   \param full_scale Full scale the sensor runs with (INT1_THS step).
+    *   \param threshold_mg Magnitude below which an axis is weightless,
+    *          rounded up to a whole step (about 350 mg).
+    *   \param duration Samples the fall must last (0..127).
+    */
+    ErrorCode LIS3DH_ConfigureFreeFall(uint8_t device_address, LIS3DH_FullScale full_scale,
+                                       uint16_t threshold_mg, uint8_t duration);
+
+    /**
+    *   \brief Set up the click engine to detect single clicks on any axis.
+    *
+    *   CLICK_CFG enables the single click of X, Y and Z; CLICK_THS,
+    *   TIME_LIMIT and TIME_LATENCY go in one burst, TIME_WINDOW is left at
+    *   0 (no double clicks). A click is an acceleration beyond the
+    *   threshold that falls back below it within time_limit samples: with
+    *   click_highpass gravity is filtered out. CLICK_SRC reports the axis
+    *   and the sign; the engine only reaches INT1 through
+    *   LIS3DH_INT1_CLICK. A threshold of 0 disables the engine.
+    *   \param device_address I2C address of the sensor.
+    *   \param full_scale Full scale the sensor runs with (CLICK_THS step,
+    *          the same as INT1_THS).
+    *   \param threshold_mg Threshold, rounded up to a whole step.
+    *   \param time_limit Longest click [samples] (0..127).
+    *   \param time_latency Samples after a click during which no other is
+    *          detected (the ring of the impact).
+    *   \param latch Non-zero: the click is held on INT1 until CLICK_SRC is
+    *          read (CLICK_THS LIR_Click).
+    */
+    ErrorCode LIS3DH_ConfigureClick(uint8_t device_address, LIS3DH_FullScale full_scale,
+                                    uint16_t threshold_mg, uint8_t time_limit, uint8_t time_latency,
+                                    uint8_t latch);
+
+    /**
+    *   \brief Read TEMP_CFG_REG..CTRL_REG6 in one burst.
+    *
+    *   Served from the register shadow once it holds the values.
+    *   \param device_address I2C address of the sensor.
+    *   \param registers Receives LIS3DH_CONFIG_REG_COUNT register values.
+    */
+    ErrorCode LIS3DH_ReadConfig(uint8_t device_address, uint8_t registers[LIS3DH_CONFIG_REG_COUNT]);
+
+    /**
+    *   \brief Change some bits of a configuration register.
+    *
+    *   Read-modify-write: with the register shadowed neither the read
+    *   nor an unchanged write reaches the bus.
+    *   \param device_address I2C address of the sensor.
+    *   \param register_address TEMP_CFG_REG..CTRL_REG6 or FIFO_CTRL_REG.
+    *   \param mask Bits to be changed.
+    *   \param value New value of the bits in mask.
+    */
+    ErrorCode LIS3DH_UpdateRegister(uint8_t device_address, uint8_t register_address,
+                                    uint8_t mask, uint8_t value);
+
+    /**
+    *   \brief Right shift that turns a left-justified output into digits.
+    *
+    *   Constant expression when mode is a constant.
+    */
+    #define LIS3DH_OUTPUT_SHIFT(mode) \
+        ((mode) == LIS3DH_MODE_LOW_POWER ? 8 : (mode) == LIS3DH_MODE_HIGH_RESOLUTION ? 4 : 6)
+
+    /**
+    *   \brief Sensitivity in mg/digit (datasheet table 4).
+    *
+    *   1, 2, 4, 12 mg/digit in high resolution mode, 4 times as much in
+    *   normal mode and 16 times in low-power mode. Constant expression
+    *   when mode and full_scale are constants.
+    */
+    #define LIS3DH_SENSITIVITY_MG(mode, full_scale) \
+        (((full_scale) == LIS3DH_FULL_SCALE_16G ? 12 : 1 << (full_scale)) * \
+         ((mode) == LIS3DH_MODE_LOW_POWER ? 16 : (mode) == LIS3DH_MODE_HIGH_RESOLUTION ? 1 : 4))
+
+    /**
+    *   \brief Right shift that turns a left-justified output into digits.
+    */
+    uint8_t LIS3DH_OutputShift(LIS3DH_Mode mode);
+
+    /**
+    *   \brief Output data rate in Hz.
+    *
+    *   \retval 0 for power-down and for combinations the sensor does not
+    *           have (1.6 kHz outside low-power mode, reserved codes).
+    */
+    uint16_t LIS3DH_OdrHz(LIS3DH_Odr odr, LIS3DH_Mode mode);
+
+    /**
+    *   \brief Sensitivity in mg/digit.
+    */
+    uint8_t LIS3DH_SensitivityMg(LIS3DH_Mode mode, LIS3DH_FullScale full_scale);
+
+#endif // LIS3DH_H
+/* [] END OF FILE */
@@ -0,0 +1,168 @@
+/**
+*   \file LIS3DH_Convert.h
+*   \brief Conversion of LIS3DH output blocks, specialized at compile time.
+*
+*   The sensor delivers each sample as six bytes, OUT_X_L..OUT_Z_H, with
+*   every axis left-justified in a 16-bit two's complement word. An axis
+*   is converted as (word * gain) >> shift: gain is the sensitivity in
+*   Q(shift) fixed point, so dropping the unused low bits and scaling to
+*   mg is one multiply and one arithmetic shift. The datasheet
+*   sensitivities are whole mg/digit and the unused bits are zero, hence
+*   the result is exact.
+*
+*   LIS3DH_DEFINE_MG_CONVERTER() generates the functions of one (mode,
+*   full scale) pair with shift and gain as constants: the compiler turns
+*   the multiply into shifts where it can and the loops have no branch
+*   other than their own. Each function takes a whole block of samples,
+*   one OUT_X_L burst or a FIFO batch, and writes the output format in
+*   the same pass:
+*   - name_ToSamples(): int16_t [count][3].
+*   - name_ToPayload(): little-endian x, y, z (the samples frame payload,
+*     see Frame.h).
+*   - name_ToBridge(): 8-byte A0 xH xL yH yL zH zL C0 frames for the
+*     Bridge Control Panel.
+*
+*   When mode and full scale change at run time,
+*   LIS3DH_DEFINE_MG_CONVERTER_TABLE() generates the twelve specialized
+*   sets and a table of LIS3DH_Converter indexed by [mode][full_scale]:
+*   the switch is one pointer assignment and each block costs one
+*   indirect call.
+*/
+#ifndef LIS3DH_CONVERT_H
+    #define LIS3DH_CONVERT_H
+
+    #include "LIS3DH.h"
+
+    /** \brief Bytes of a sample in the output registers. */
+    #define LIS3DH_SAMPLE_SIZE          6
+
+    /** \brief Header, footer and size of a Bridge Control Panel frame. */
+    #define LIS3DH_BRIDGE_HEADER        0xA0
+    #define LIS3DH_BRIDGE_FOOTER        0xC0
+    #define LIS3DH_BRIDGE_FRAME_SIZE    8
+
+    /**
+    *   \brief Conversion functions of one (mode, full scale) pair.
+    */
+    typedef struct {
+        void (*to_samples)(const uint8_t* raw, int16_t (*samples)[3], uint8_t count);
+        void (*to_payload)(const uint8_t* raw, uint8_t* payload, uint8_t count);
+        void (*to_bridge)(const uint8_t* raw, uint8_t* frames, uint8_t count);
+    } LIS3DH_Converter;
+
+    /**
+    *   \brief Convert the axis whose low byte is at raw.
+    */
+    #define LIS3DH_CONVERT_AXIS(raw, shift, gain) \
+        ((int16_t)(((int32_t)(int16_t)((raw)[0] | ((raw)[1] << 8)) * (gain)) >> (shift)))
+
+    /**
+    *   \brief Define the conversion functions name_ToSamples(),
+    *          name_ToPayload() and name_ToBridge().
+    *
+    *   \param name Prefix of the functions.
+    *   \param shift Right shift applied after the gain.
+    *   \param gain Q(shift) factor from left-justified words to the output unit.
+    */
+    #define LIS3DH_DEFINE_CONVERTER(name, shift, gain)                                        \
+        static inline void name##_ToSamples(const uint8_t* raw, int16_t (*samples)[3],        \
+                                            uint8_t count)                                    \
+        {                                                                                     \
+            for (uint8_t i = 0; i < count; i++, raw += LIS3DH_SAMPLE_SIZE)                    \
+            {                                                                                 \
+                samples[i][0] = LIS3DH_CONVERT_AXIS(raw, shift, gain);                        \
+                samples[i][1] = LIS3DH_CONVERT_AXIS(raw + 2, shift, gain);                    \
+                samples[i][2] = LIS3DH_CONVERT_AXIS(raw + 4, shift, gain);                    \
+            }                                                                                 \
+        }                                                                                     \
+                                                                                              \
+        static inline void name##_ToPayload(const uint8_t* raw, uint8_t* payload,             \
+                                            uint8_t count)                                    \
+        {                                                                                     \
+            for (uint8_t i = 0; i < count; i++, raw += LIS3DH_SAMPLE_SIZE, payload += 6)      \
+            {                                                                                 \
+                int16_t x = LIS3DH_CONVERT_AXIS(raw, shift, gain);                            \
+                int16_t y = LIS3DH_CONVERT_AXIS(raw + 2, shift, gain);                        \
+                int16_t z = LIS3DH_CONVERT_AXIS(raw + 4, shift, gain);                        \
+                payload[0] = (uint8_t)(x & 0xFF);                                             \
+                payload[1] = (uint8_t)((uint16_t)x >> 8);                                     \
+                payload[2] = (uint8_t)(y & 0xFF);                                             \
+                payload[3] = (uint8_t)((uint16_t)y >> 8);                                     \
+                payload[4] = (uint8_t)(z & 0xFF);                                             \
+                payload[5] = (uint8_t)((uint16_t)z >> 8);                                     \
+            }                                                                                 \
+        }                                                                                     \
+                                                                                              \
+        static inline void name##_ToBridge(const uint8_t* raw, uint8_t* frames,               \
+                                           uint8_t count)                                     \
+        {                                                                                     \
+            for (uint8_t i = 0; i < count; i++, raw += LIS3DH_SAMPLE_SIZE,                    \
+                 frames += LIS3DH_BRIDGE_FRAME_SIZE)                                          \
+            {                                                                                 \
+                int16_t x = LIS3DH_CONVERT_AXIS(raw, shift, gain);                            \
+                int16_t y = LIS3DH_CONVERT_AXIS(raw + 2, shift, gain);                        \
+                int16_t z = LIS3DH_CONVERT_AXIS(raw + 4, shift, gain);                        \
+                frames[0] = LIS3DH_BRIDGE_HEADER;                                             \
+                frames[1] = (uint8_t)((uint16_t)x >> 8);                                      \
+                frames[2] = (uint8_t)(x & 0xFF);                                              \
+                frames[3] = (uint8_t)((uint16_t)y >> 8);                                      \
+                frames[4] = (uint8_t)(y & 0xFF);                                              \
+                frames[5] = (uint8_t)((uint16_t)z >> 8);                                      \
+                frames[6] = (uint8_t)(z & 0xFF);                                              \
+                frames[7] = LIS3DH_BRIDGE_FOOTER;                                             \
+            }                                                                                 \
+        }
+
+    /**
+    *   \brief Define conversion functions from output blocks to mg.
+    *
+    *   \param name Prefix of the functions.
+    *   \param mode LIS3DH_Mode constant.
+    *   \param full_scale LIS3DH_FullScale constant.
+    */
+    #define LIS3DH_DEFINE_MG_CONVERTER(name, mode, full_scale) \
+        LIS3DH_DEFINE_CONVERTER(name, LIS3DH_OUTPUT_SHIFT(mode), LIS3DH_SENSITIVITY_MG(mode, full_scale))
+
+    /**
+    *   \brief Define conversion functions from output blocks to digits.
+    *
+    *   \param name Prefix of the functions.
+    *   \param mode LIS3DH_Mode constant.
+    */
+    #define LIS3DH_DEFINE_DIGITS_CONVERTER(name, mode) \
+        LIS3DH_DEFINE_CONVERTER(name, LIS3DH_OUTPUT_SHIFT(mode), 1)
+
+    /** \brief LIS3DH_Converter initializer of the functions defined with prefix name. */
+    #define LIS3DH_CONVERTER(name) { name##_ToSamples, name##_ToPayload, name##_ToBridge }
+
+    /**
+    *   \brief Define the mg converters of every mode and full scale and
+    *          the table name[LIS3DH_Mode][LIS3DH_FullScale] of LIS3DH_Converter.
+    *
+    *   \param name Name of the table, prefix of the functions.
+    */
+    #define LIS3DH_DEFINE_MG_CONVERTER_TABLE(name)                                                    \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Lp2, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_2G)           \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Lp4, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_4G)           \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Lp8, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_8G)           \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Lp16, LIS3DH_MODE_LOW_POWER, LIS3DH_FULL_SCALE_16G)         \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Nm2, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_2G)              \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Nm4, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_4G)              \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Nm8, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_8G)              \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Nm16, LIS3DH_MODE_NORMAL, LIS3DH_FULL_SCALE_16G)            \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Hr2, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_2G)     \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Hr4, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_4G)     \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Hr8, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_8G)     \
+        LIS3DH_DEFINE_MG_CONVERTER(name##_Hr16, LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FULL_SCALE_16G)   \
+                                                                                                      \
+        static const LIS3DH_Converter name[3][4] = {                                                  \
+            { LIS3DH_CONVERTER(name##_Lp2), LIS3DH_CONVERTER(name##_Lp4),                             \
+              LIS3DH_CONVERTER(name##_Lp8), LIS3DH_CONVERTER(name##_Lp16) },                          \
+            { LIS3DH_CONVERTER(name##_Nm2), LIS3DH_CONVERTER(name##_Nm4),                             \
+              LIS3DH_CONVERTER(name##_Nm8), LIS3DH_CONVERTER(name##_Nm16) },                          \
+            { LIS3DH_CONVERTER(name##_Hr2), LIS3DH_CONVERTER(name##_Hr4),                             \
+              LIS3DH_CONVERTER(name##_Hr8), LIS3DH_CONVERTER(name##_Hr16) }                           \
+        };
+
+#endif // LIS3DH_CONVERT_H
+/* [] END OF FILE */
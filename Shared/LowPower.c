@@ -0,0 +1,120 @@
+/*
+* This file includes the source code of the idle scheduler.
+*/
+#include "LowPower.h"
+#include "Timestamp.h"
+#include "CyLib.h"
+#include "cyPm.h"
+
+// CTW intervals of CyPmSleep(), the n-th lasting 2^(n+1) ms
+static const uint8 sleep_times[] = {
+    PM_SLEEP_TIME_CTW_2MS, PM_SLEEP_TIME_CTW_4MS, PM_SLEEP_TIME_CTW_8MS,
+    PM_SLEEP_TIME_CTW_16MS, PM_SLEEP_TIME_CTW_32MS, PM_SLEEP_TIME_CTW_64MS,
+    PM_SLEEP_TIME_CTW_128MS, PM_SLEEP_TIME_CTW_256MS, PM_SLEEP_TIME_CTW_512MS,
+    PM_SLEEP_TIME_CTW_1024MS, PM_SLEEP_TIME_CTW_2048MS, PM_SLEEP_TIME_CTW_4096MS
+};
+#define LOW_POWER_SLEEP_TIMES (sizeof(sleep_times)/sizeof(sleep_times[0]))
+
+// Time spent in each mode [us] and LowPower_Idle() calls per mode
+static uint64_t mode_us[LOW_POWER_MODES];
+static uint32_t mode_entries[LOW_POWER_MODES];
+
+// Timestamp_Now() when the CPU has last started running
+static uint32_t active_since = 0;
+
+    void LowPower_Start(void)
+    {
+        for (uint8_t mode = 0; mode < LOW_POWER_MODES; mode++)
+        {
+            mode_us[mode] = 0;
+            mode_entries[mode] = 0;
+        }
+        active_since = Timestamp_Now();
+    }
+
+    LowPower_Mode LowPower_SelectMode(uint32_t idle_us, uint8_t can_sleep)
+    {
+        if (idle_us < LOW_POWER_TICK_US)
+        {
+            // Only SysTick would end a WFI: the deadline would be overshot
+            return LOW_POWER_ACTIVE;
+        }
+        if (can_sleep && idle_us >= LOW_POWER_SLEEP_MIN_US)
+        {
+            return LOW_POWER_SLEEP;
+        }
+        return LOW_POWER_ALT_ACTIVE;
+    }
+
+    // Longest CTW interval ending, wake-up included, before the deadline
+    static uint8_t LowPower_SleepInterval(uint32_t idle_us)
+    {
+        uint8_t interval = 0;
+        while (interval + 1u < LOW_POWER_SLEEP_TIMES &&
+               (4000u << interval) + LOW_POWER_SLEEP_WAKEUP_US <= idle_us)
+        {
+            interval++;
+        }
+        return interval;
+    }
+
+    LowPower_Mode LowPower_Idle(uint32_t idle_us, uint8_t can_sleep)
+    {
+        LowPower_Mode mode = LowPower_SelectMode(idle_us, can_sleep);
+        mode_entries[mode]++;
+        if (mode == LOW_POWER_ACTIVE)
+        {
+            return mode;
+        }
+
+        uint32_t start = Timestamp_Now();
+        mode_us[LOW_POWER_ACTIVE] += start - active_since;
+        if (mode == LOW_POWER_ALT_ACTIVE)
+        {
+            CyPmAltAct(PM_ALT_ACT_TIME_NONE, PM_ALT_ACT_SRC_NONE);
+            active_since = Timestamp_Now();
+            mode_us[LOW_POWER_ALT_ACTIVE] += active_since - start;
+        }
+        else
+        {
+            uint8_t interval = LowPower_SleepInterval(idle_us);
+            uint32_t sleep_us = 2000u << interval;
+            CyPmSaveClocks();
+            CyPmSleep(sleep_times[interval], PM_SLEEP_SRC_CTW);
+            CyPmRestoreClocks();
+
+            // SysTick has been stopped with the clocks: the PLL lock is all it has counted
+            Timestamp_Advance(sleep_us);
+            mode_us[LOW_POWER_SLEEP] += sleep_us;
+            active_since = start + sleep_us;
+        }
+        return mode;
+    }
+
+    LowPower_Stats LowPower_GetStats(void)
+    {
+        LowPower_Stats stats;
+        uint64_t total_us = 0;
+        uint64_t charge = 0;
+        static const uint32_t current_ua[LOW_POWER_MODES] = {
+            LOW_POWER_ACTIVE_UA, LOW_POWER_ALT_ACTIVE_UA, LOW_POWER_SLEEP_UA
+        };
+
+        uint8 interrupts = CyEnterCriticalSection();
+        uint64_t active_us = mode_us[LOW_POWER_ACTIVE] + (Timestamp_Now() - active_since);
+        CyExitCriticalSection(interrupts);
+
+        for (uint8_t mode = 0; mode < LOW_POWER_MODES; mode++)
+        {
+            uint64_t us = mode == LOW_POWER_ACTIVE ? active_us : mode_us[mode];
+            stats.time_ms[mode] = (uint32_t)(us / 1000u);
+            stats.entries[mode] = mode_entries[mode];
+            total_us += us;
+            charge += us * current_ua[mode];
+        }
+        stats.duty_cycle_ppm = total_us ? (uint32_t)(active_us * 1000000u / total_us) : 1000000u;
+        stats.current_ua = total_us ? (uint32_t)(charge / total_us) : LOW_POWER_ACTIVE_UA;
+        return stats;
+    }
+
+/* [] END OF FILE */
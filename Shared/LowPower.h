@@ -0,0 +1,119 @@
+/**
+*   \file LowPower.h
+*   \brief Idle scheduler: halts the CPU between events in the deepest mode the next one allows.
+*
+*   Main loops call LowPower_Idle() with interrupts disabled once they
+*   have found nothing to do, telling how long it is until the next
+*   deadline they poll for and whether the clocked peripherals may be
+*   stopped. The mode is chosen from that time:
+*
+*       Active            the deadline is closer than a SysTick period:
+*                         the caller keeps polling
+*       Alternate Active  the CPU is halted by WFI, clocks and peripherals
+*                         keep running; any interrupt (INT1, UART RX, I2C,
+*                         DMA, SysTick) wakes it within a few cycles
+*       Sleep             clocks stopped (CyPmSleep()), woken by the central
+*                         timewheel (CTW) after the longest interval that
+*                         ends before the deadline, wake-up and PLL lock
+*                         included. Only when the caller allows it: UART RX
+*                         bytes are lost, timers, SysTick, I2C and UART stop
+*
+*   The time spent in each mode is measured with Timestamp.h (started by
+*   the caller), advanced by the CTW interval after a Sleep. The average
+*   current is estimated from the typical current of each mode.
+*/
+#ifndef LOW_POWER_H
+    #define LOW_POWER_H
+
+    #include "cytypes.h"
+
+    /** \brief Idle time meaning that no deadline is pending. */
+    #define LOW_POWER_NO_DEADLINE 0xFFFFFFFFu
+
+    /**
+    *   \brief Longest halt without a peripheral interrupt [us] (SysTick period).
+    */
+    #define LOW_POWER_TICK_US 1000u
+
+    /**
+    *   \brief Sleep to Active wake-up plus the PLL lock waited for by CyPmRestoreClocks() [us].
+    */
+    #ifndef LOW_POWER_SLEEP_WAKEUP_US
+        #define LOW_POWER_SLEEP_WAKEUP_US 265u
+    #endif
+
+    /**
+    *   \brief Shortest idle time worth a Sleep [us]: the shortest CTW interval (2 ms) and the wake-up.
+    */
+    #define LOW_POWER_SLEEP_MIN_US (2000u + LOW_POWER_SLEEP_WAKEUP_US)
+
+    /**
+    *   \brief Typical supply current of the PSoC in each mode [uA], 24 MHz bus clock.
+    *
+    *   Estimates for the blocks of these designs; override them with
+    *   measured values. The sensor is not included.
+    */
+    #ifndef LOW_POWER_ACTIVE_UA
+        #define LOW_POWER_ACTIVE_UA 6300u
+    #endif
+    #ifndef LOW_POWER_ALT_ACTIVE_UA
+        #define LOW_POWER_ALT_ACTIVE_UA 2600u
+    #endif
+    #ifndef LOW_POWER_SLEEP_UA
+        #define LOW_POWER_SLEEP_UA 2u
+    #endif
+
+    /**
+    *   \brief Power modes, from the shallowest.
+    */
+    typedef enum {
+        LOW_POWER_ACTIVE,           ///< CPU running
+        LOW_POWER_ALT_ACTIVE,       ///< CPU halted by WFI, peripherals running
+        LOW_POWER_SLEEP,            ///< Clocks stopped until the CTW interval is over
+        LOW_POWER_MODES
+    } LowPower_Mode;
+
+    /**
+    *   \brief Time accounting since LowPower_Start().
+    */
+    typedef struct {
+        uint32_t time_ms[LOW_POWER_MODES];  ///< Time spent in each mode
+        uint32_t entries[LOW_POWER_MODES];  ///< LowPower_Idle() calls that chose each mode
+        uint32_t duty_cycle_ppm;            ///< Share of the time the CPU has been running
+        uint32_t current_ua;                ///< Estimated average current
+    } LowPower_Stats;
+
+    /**
+    *   \brief Clear the accounting (Timestamp_Start() must have been called).
+    */
+    void LowPower_Start(void);
+
+    /**
+    *   \brief Mode LowPower_Idle() chooses for an idle time.
+    *
+    *   \param idle_us Time until the next deadline [us], or LOW_POWER_NO_DEADLINE.
+    *   \param can_sleep Non-zero if UART, I2C and timers are idle and no
+    *                    interrupt but the CTW is expected before the deadline.
+    */
+    LowPower_Mode LowPower_SelectMode(uint32_t idle_us, uint8_t can_sleep);
+
+    /**
+    *   \brief Halt the CPU until the next interrupt or the deadline.
+    *
+    *   Call with interrupts disabled, right after checking that there is
+    *   nothing to do, so that an interrupt coming in between is not
+    *   slept through: it wakes the CPU and runs once the caller enables
+    *   interrupts again. Returns at once in Active mode.
+    *   \param idle_us Time until the next deadline [us], or LOW_POWER_NO_DEADLINE.
+    *   \param can_sleep See LowPower_SelectMode().
+    *   \retval The mode the CPU has been in.
+    */
+    LowPower_Mode LowPower_Idle(uint32_t idle_us, uint8_t can_sleep);
+
+    /**
+    *   \brief Time per mode, duty cycle and estimated current since LowPower_Start().
+    */
+    LowPower_Stats LowPower_GetStats(void);
+
+#endif // LOW_POWER_H
+/* [] END OF FILE */
@@ -0,0 +1,64 @@
+/*
+* This file includes the source code of the SysTick based time base.
+*/
+#include "Timestamp.h"
+#include "CyLib.h"
+
+/**
+*   \brief SysTick counts per microsecond (SysTick runs from the bus clock).
+*/
+#define TIMESTAMP_TICKS_PER_US (BCLK__BUS_CLK__HZ / 1000000u)
+
+// Milliseconds counted by the SysTick callback
+static volatile uint32_t timestamp_ms = 0;
+
+    static void Timestamp_Tick(void)
+    {
+        timestamp_ms++;
+    }
+
+    void Timestamp_Start(void)
+    {
+        timestamp_ms = 0;
+        CySysTickStart();
+        
+        // Take the first free callback slot (or the one installed by a previous start)
+        for (uint32 i = 0; i < CY_SYS_SYST_NUM_OF_CALLBACKS; i++)
+        {
+            cyisraddress callback = CySysTickGetCallback(i);
+            if (callback == NULL || callback == Timestamp_Tick)
+            {
+                CySysTickSetCallback(i, Timestamp_Tick);
+                break;
+            }
+        }
+    }
+
+    uint32_t Timestamp_Now(void)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        uint32_t reload = CySysTickGetReload();
+        uint32_t ms = timestamp_ms;
+        uint32_t value = CySysTickGetValue();
+        
+        // The counter has wrapped but the tick is still pending (interrupts masked
+        // or called from an ISR): account for it and read the counter again, since
+        // it may have wrapped after the first read
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+        {
+            ms++;
+            value = CySysTickGetValue();
+        }
+        CyExitCriticalSection(interrupts);
+        
+        return ms*1000u + (reload - value)/TIMESTAMP_TICKS_PER_US;
+    }
+
+    void Timestamp_Advance(uint32_t us)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        timestamp_ms += us/1000u;
+        CyExitCriticalSection(interrupts);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,35 @@
+/**
+*   \file Timestamp.h
+*   \brief Microsecond time base built on the SysTick timer.
+*
+*   SysTick interrupts every millisecond to extend the count; the
+*   sub-millisecond part is read from the SysTick counter. SysTick stops
+*   with the bus clock in Sleep mode: whoever puts the device to sleep
+*   accounts for the time with Timestamp_Advance().
+*/
+#ifndef TIMESTAMP_H
+    #define TIMESTAMP_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Start SysTick and install the millisecond callback.
+    */
+    void Timestamp_Start(void);
+
+    /**
+    *   \brief Microseconds elapsed since Timestamp_Start().
+    *
+    *   Safe to call from interrupts. Wraps after about 71 minutes.
+    */
+    uint32_t Timestamp_Now(void);
+
+    /**
+    *   \brief Add time SysTick has not counted (clocks stopped in Sleep).
+    *
+    *   \param us Time to add [us], rounded down to whole milliseconds.
+    */
+    void Timestamp_Advance(uint32_t us);
+
+#endif // TIMESTAMP_H
+/* [] END OF FILE */